@@ -5,11 +5,10 @@
 #endif
 #include "dot_messages.h"
 #include "dot.h"
-#include <gsl/gsl_linalg.h>
+#include "dot_kalman.h"
+#include "dot_grid.h"
 
 
-#define MI(M,i,j) ((i)*(M)->tda + (j))
-
 #define FILTER_MAP_ADD_CLUSTER  -1
 #define FILTER_MAP_NEW_CLUSTER  -2
 
@@ -21,10 +20,10 @@ typedef struct dot_person_filter {
   double x;
   double y;
   double logr;  // natural log of circle radius
-  gsl_matrix *P;  // estimated state covariance matrix: rows and columns in order of: x, y, logr
+  carmen_dot_kalman_cov_t P;  // estimated state covariance matrix: rows and columns in order of: x, y, logr
   double a;
-  gsl_matrix *Q;  // process noise covariance matrix
-  gsl_matrix *R;  // sensor noise covariance matrix
+  carmen_dot_kalman_cov_t Q;  // process noise covariance matrix
+  carmen_dot_kalman_noise_t R;  // sensor noise covariance matrix
   //dbug
 } carmen_dot_person_filter_t, *carmen_dot_person_filter_p;
 
@@ -88,6 +87,8 @@ static int invisible_cnt;
 static double person_filter_displacement_threshold;
 static double bic_min_variance;
 static int bic_num_params;
+static double association_gate;
+static int report_timing;
 
 static carmen_localize_param_t localize_params;
 static carmen_localize_map_t localize_map;
@@ -98,6 +99,7 @@ static carmen_dot_filter_p filters = NULL;
 static int num_filters = 0;
 static int filter_highlight = -1;
 static carmen_list_t *highlight_list;
+static carmen_dot_grid_t association_grid;
 
 
 static inline int is_in_map(int x, int y) {
@@ -110,6 +112,7 @@ static inline int is_in_map(int x, int y) {
 /*********** GRAPHICS ************/
 
 static int laser_mask[500];
+static int laser_owner[500];  // id of the filter each laser point updates, or -1
 
 #ifdef HAVE_GRAPHICS
 
@@ -177,15 +180,7 @@ static void draw_robot() {
 
 static int laser_point_belongs_to_dot(carmen_dot_filter_p f, int laser_index) {
 
-  int i, s;
-
-  for (i = 0; i < f->person_filter.sensor_update_list->length; i++) {
-    s = *(int*)carmen_list_get(f->person_filter.sensor_update_list, i);
-    if (s == laser_index)
-      return 1;
-  }
-
-  return 0;
+  return (laser_owner[laser_index] == f->id);
 }
 
 static void draw_laser() {
@@ -604,43 +599,6 @@ static double matrix_det(gsl_matrix *M) {
 }
 #endif
 
-static void matrix_invert(gsl_matrix *M) {
-
-  gsl_matrix *A;
-  gsl_permutation *p;
-  int signum;
-
-  A = gsl_matrix_alloc(M->size1, M->size2);
-  carmen_test_alloc(A);
-  p = gsl_permutation_alloc(A->size1);
-  carmen_test_alloc(p);
-  gsl_linalg_LU_decomp(M, p, &signum);
-  gsl_linalg_LU_invert(M, p, A);
-  gsl_matrix_memcpy(M, A);
-  gsl_matrix_free(A);
-  gsl_permutation_free(p);
-}
-
-static gsl_matrix *matrix_mult(gsl_matrix *A, gsl_matrix *B) {
-
-  gsl_matrix *C;
-  unsigned int i, j, k;
-
-  if (A->size2 != B->size1)
-    carmen_die("Can't multiply %dx%d matrix A with %dx%d matrix B",
-	       A->size1, A->size2, B->size1, B->size2);
-
-  C = gsl_matrix_calloc(A->size1, B->size2);
-  carmen_test_alloc(C);
-
-  for (i = 0; i < A->size1; i++)
-    for (j = 0; j < B->size2; j++)
-      for (k = 0; k < A->size2; k++)
-	C->data[MI(C,i,j)] += A->data[MI(A,i,k)]*B->data[MI(B,k,j)];
-  
-  return C;
-}
-
 #if 0
 /*
  * computes the orientation of the bivariate normal with variances
@@ -982,9 +940,9 @@ static int person_contains(carmen_dot_person_filter_p f, double x, double y, dou
   ux = f->x;
   uy = f->y;
   r = exp(f->logr);
-  vx = f->P->data[MI(f->P,0,0)];
-  vy = f->P->data[MI(f->P,1,1)];
-  vxy = f->P->data[MI(f->P,0,1)];
+  vx = f->P[0][0];
+  vy = f->P[1][1];
+  vxy = f->P[0][1];
   e1 = bnorm_w1(vx, vy, vxy);
   e2 = bnorm_w2(vx, vy, vxy);
   theta = atan2(y-uy, x-ux);
@@ -1058,12 +1016,7 @@ static void person_filter_motion_update(carmen_dot_person_filter_p f) {
 
   f->x += ax;
   f->y += ay;
-  gsl_matrix_add(f->P, f->Q);
-
-  //gsl_matrix_fprintf(stdout, f->P, "%f");
-  //printf("\n\n");
-  //gsl_matrix_fprintf(stdout, f->Q, "%f");
-  //printf("\n");
+  carmen_dot_kalman_motion_update(f->P, f->Q);
 }
 
 static int ray_intersect_arg(double rx, double ry, double rtheta,
@@ -1221,11 +1174,10 @@ static int ray_intersect_convex_polygon(double rx, double ry, double rtheta,
 /*
  * assumes expected sensor reading is on the ray
  */
-static gsl_matrix *person_filter_measurement_jacobian(carmen_dot_person_filter_p f,
-						      double lx, double ly, double ltheta) {
+static void person_filter_measurement_jacobian(carmen_dot_person_filter_p f,
+					       double lx, double ly, double ltheta,
+					       carmen_dot_kalman_jacobian_t H) {
 
-  static gsl_matrix *H = NULL;
-  static int first = 1;
   double x0, y0, y1, y2, r;
   double cos_ltheta, sin_ltheta;
   double epsilon;
@@ -1234,12 +1186,6 @@ static gsl_matrix *person_filter_measurement_jacobian(carmen_dot_person_filter_p
   sign = 1.0;
   epsilon = 0.00001;  //dbug: param?
 
-  if (first) {
-    first = 0;
-    H = gsl_matrix_calloc(2,3);
-    carmen_test_alloc(H);
-  }
-
   r = exp(f->logr);
   cos_ltheta = cos(ltheta);
   sin_ltheta = sin(ltheta);
@@ -1247,55 +1193,53 @@ static gsl_matrix *person_filter_measurement_jacobian(carmen_dot_person_filter_p
   y0 = cos_ltheta*(f->x - lx) + sin_ltheta*(f->y - ly);
 
   if (r*r - x0*x0 < 0) {  // [L^C| = 0
-    H->data[MI(H,0,0)] = 1.0;
-    H->data[MI(H,0,1)] = 0.0;
-    H->data[MI(H,1,0)] = 0.0;
-    H->data[MI(H,1,1)] = 1.0;
+    H[0][0] = 1.0;
+    H[0][1] = 0.0;
+    H[1][0] = 0.0;
+    H[1][1] = 1.0;
     if (x0 > 0.0) {
-      H->data[MI(H,0,2)] = -sin_ltheta*r;
-      H->data[MI(H,1,2)] = cos_ltheta*r;
+      H[0][2] = -sin_ltheta*r;
+      H[1][2] = cos_ltheta*r;
     }
     else {
-      H->data[MI(H,0,2)] = sin_ltheta*r;
-      H->data[MI(H,1,2)] = -cos_ltheta*r;
+      H[0][2] = sin_ltheta*r;
+      H[1][2] = -cos_ltheta*r;
     }
   }
   else if (r*r - x0*x0 < epsilon) {  // |L^C| = 1
-    H->data[MI(H,0,0)] = cos_ltheta*cos_ltheta;
-    H->data[MI(H,0,1)] = sin_ltheta*cos_ltheta;
-    H->data[MI(H,0,2)] = 0.0;
-    H->data[MI(H,1,0)] = sin_ltheta*cos_ltheta;
-    H->data[MI(H,1,1)] = sin_ltheta*sin_ltheta;
-    H->data[MI(H,1,2)] = 0.0;
+    H[0][0] = cos_ltheta*cos_ltheta;
+    H[0][1] = sin_ltheta*cos_ltheta;
+    H[0][2] = 0.0;
+    H[1][0] = sin_ltheta*cos_ltheta;
+    H[1][1] = sin_ltheta*sin_ltheta;
+    H[1][2] = 0.0;
   }
   else {  // |L^C| = 2
     y1 = y0 + sqrt(r*r - x0*x0);
     y2 = y0 - sqrt(r*r - x0*x0);
     switch (ray_intersect_arg(0.0, 0.0, M_PI/2.0, 0.0, y1, 0.0, y2)) {
     case 0:
-      H->data[MI(H,0,0)] = 0.0;
-      H->data[MI(H,0,1)] = 0.0;
-      H->data[MI(H,1,0)] = 0.0;
-      H->data[MI(H,1,1)] = 0.0;
-      H->data[MI(H,0,2)] = 0.0;
-      H->data[MI(H,1,2)] = 0.0;
+      H[0][0] = 0.0;
+      H[0][1] = 0.0;
+      H[1][0] = 0.0;
+      H[1][1] = 0.0;
+      H[0][2] = 0.0;
+      H[1][2] = 0.0;
       //carmen_die("expected sensor reading isn't on ray! (0, 0, pi/2, 0, %f, 0, %f)", y1, y2);
-      return H;
+      return;
     case 1:
       sign = 1.0;
       break;
     case 2:
       sign = -1.0;
     }
-    H->data[MI(H,0,0)] = cos_ltheta*cos_ltheta - sign*sin_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
-    H->data[MI(H,0,1)] = sin_ltheta*cos_ltheta + sign*cos_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
-    H->data[MI(H,0,2)] = sign*cos_ltheta*r*r/sqrt(r*r-x0*x0);
-    H->data[MI(H,1,0)] = sin_ltheta*cos_ltheta - sign*sin_ltheta*sin_ltheta*x0/sqrt(r*r-x0*x0);
-    H->data[MI(H,1,1)] = sin_ltheta*sin_ltheta + sign*sin_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
-    H->data[MI(H,1,2)] = sign*sin_ltheta*r*r/sqrt(r*r-x0*x0);
+    H[0][0] = cos_ltheta*cos_ltheta - sign*sin_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
+    H[0][1] = sin_ltheta*cos_ltheta + sign*cos_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
+    H[0][2] = sign*cos_ltheta*r*r/sqrt(r*r-x0*x0);
+    H[1][0] = sin_ltheta*cos_ltheta - sign*sin_ltheta*sin_ltheta*x0/sqrt(r*r-x0*x0);
+    H[1][1] = sin_ltheta*sin_ltheta + sign*sin_ltheta*cos_ltheta*x0/sqrt(r*r-x0*x0);
+    H[1][2] = sign*sin_ltheta*r*r/sqrt(r*r-x0*x0);
   }
-
-  return H;
 }
 
 static int person_filter_max_likelihood_measurement(carmen_dot_person_filter_p f, double lx, double ly,
@@ -1347,18 +1291,13 @@ static int person_filter_max_likelihood_measurement(carmen_dot_person_filter_p f
 
 static void person_filter_sensor_update(carmen_dot_person_filter_p f, carmen_robot_laser_message *laser) {
 
-  static gsl_matrix *K = NULL;
-  static gsl_matrix *M1 = NULL;
-  static gsl_matrix *M2 = NULL;
-  static gsl_matrix *H = NULL;
-  static gsl_matrix *HT = NULL;
-  static gsl_matrix *R2 = NULL;
-  static gsl_matrix *P2 = NULL;
-  static int first = 1;
-  double x, y, theta, hx, hy; //, d, dmin;
+  carmen_dot_kalman_jacobian_t H;
+  carmen_dot_kalman_state_t dx;
+  double nu[2];
+  double x, y, theta, hx, hy;
   double lx, ly, ltheta;
   float *range;
-  int i, s, n; //, j, imin;
+  int i, s;
 
   //printf("update_person_filter()\n");
 
@@ -1367,110 +1306,30 @@ static void person_filter_sensor_update(carmen_dot_person_filter_p f, carmen_rob
   ltheta = laser->theta;
   range = laser->range;
 
-  P2 = gsl_matrix_calloc(3,3);
-  carmen_test_alloc(P2);
-
-  if (first) {
-    first = 0;
-    H = gsl_matrix_alloc(2*181, 3);
-    carmen_test_alloc(H);
-    HT = gsl_matrix_alloc(3, 2*181);
-    carmen_test_alloc(HT);
-
-  }
-
-  // (x,y) update
-  if (f->sensor_update_list->length > 0) {
-    H->size1 = 2*f->sensor_update_list->length;
-    n = 0;
-    for (i = 0; i < f->sensor_update_list->length; i++) {
-      s = *(int*)carmen_list_get(f->sensor_update_list, i);
-      theta = carmen_normalize_theta(ltheta + (s-90)*M_PI/180.0);
-      M1 = person_filter_measurement_jacobian(f, lx, ly, theta);
-      H->data[MI(H,2*n,0)] = M1->data[MI(M1,0,0)];
-      H->data[MI(H,2*n,1)] = M1->data[MI(M1,0,1)];
-      H->data[MI(H,2*n,2)] = M1->data[MI(M1,0,2)];
-      H->data[MI(H,2*n+1,0)] = M1->data[MI(M1,1,0)];
-      H->data[MI(H,2*n+1,1)] = M1->data[MI(M1,1,1)];
-      H->data[MI(H,2*n+1,2)] = M1->data[MI(M1,1,2)];
-      n++;
-    }
-    HT->size2 = H->size1;
-    gsl_matrix_transpose_memcpy(HT, H);
-    
-    P2->data[MI(P2,0,0)] = f->P->data[MI(f->P,0,0)];
-    P2->data[MI(P2,0,1)] = f->P->data[MI(f->P,0,1)];
-    P2->data[MI(P2,1,0)] = f->P->data[MI(f->P,1,0)];
-    P2->data[MI(P2,1,1)] = f->P->data[MI(f->P,1,1)];
-    //dbug
-    P2->data[MI(P2,0,2)] = f->P->data[MI(f->P,0,2)];
-    P2->data[MI(P2,1,2)] = f->P->data[MI(f->P,1,2)];
-    P2->data[MI(P2,2,0)] = f->P->data[MI(f->P,2,0)];
-    P2->data[MI(P2,2,1)] = f->P->data[MI(f->P,2,1)];
-    P2->data[MI(P2,2,2)] = f->P->data[MI(f->P,2,2)];
-
-    M1 = matrix_mult(H, P2);
-    M2 = matrix_mult(M1, HT);
-
-    gsl_matrix_free(M1);
-    R2 = gsl_matrix_calloc(2*f->sensor_update_list->length,
-			   2*f->sensor_update_list->length);
-    carmen_test_alloc(R2);
-    for (i = 0; i < f->sensor_update_list->length; i++) {
-      R2->data[MI(R2,2*i,2*i)] = f->R->data[MI(f->R,0,0)];
-      R2->data[MI(R2,2*i,2*i+1)] = f->R->data[MI(f->R,0,1)];
-      R2->data[MI(R2,2*i+1,2*i)] = f->R->data[MI(f->R,1,0)];
-      R2->data[MI(R2,2*i+1,2*i+1)] = f->R->data[MI(f->R,1,1)];
-    }
-    gsl_matrix_add(M2, R2);
-    matrix_invert(M2);
-    M1 = matrix_mult(HT, M2);
-    gsl_matrix_free(M2);
-    K = matrix_mult(P2, M1);
-    gsl_matrix_free(M1);
-    
-    M1 = gsl_matrix_calloc(2*f->sensor_update_list->length, 1);
-    carmen_test_alloc(M1);
-    n = 0;
-    for (i = 0; i < f->sensor_update_list->length; i++) {
-      s = *(int*)carmen_list_get(f->sensor_update_list, i);
-      theta = carmen_normalize_theta(ltheta + (s-90)*M_PI/180.0);
-      hx = x = lx + cos(theta)*range[s];
-      hy = y = ly + sin(theta)*range[s];
-      person_filter_max_likelihood_measurement(f, lx, ly, theta, &hx, &hy);
-      M1->data[MI(M1,2*n,0)] = x - hx;
-      M1->data[MI(M1,2*n+1,0)] = y - hy;
-      n++;
-    }
-    
-    M2 = matrix_mult(K, M1);
-    gsl_matrix_free(M1);
-    
-    f->x += M2->data[MI(M2,0,0)];
-    f->y += M2->data[MI(M2,1,0)];
-    f->logr += M2->data[MI(M2,2,0)];
-    if (exp(f->logr) < 0.2)
-      f->logr = log(0.2);
-    else if (exp(f->logr) > 0.3)
-      f->logr = log(0.3);
-    
-    gsl_matrix_free(M2);
-    M1 = matrix_mult(K, H);
-    M2 = gsl_matrix_alloc(3,3);  //dbug
-    carmen_test_alloc(M2);
-    gsl_matrix_set_identity(M2);
-    gsl_matrix_sub(M2, M1);
-    gsl_matrix_free(M1);
-    M1 = matrix_mult(M2, f->P);
-    gsl_matrix_free(M2);
-    gsl_matrix_free(f->P);
-    f->P = M1;
-
-    gsl_matrix_free(K);
-    gsl_matrix_free(R2);
-  }
+  if (f->sensor_update_list->length == 0)
+    return;
 
-  gsl_matrix_free(P2);
+  // (x,y,logr) update, one laser point at a time, linearized at the prior state
+  dx[0] = dx[1] = dx[2] = 0.0;
+  for (i = 0; i < f->sensor_update_list->length; i++) {
+    s = *(int*)carmen_list_get(f->sensor_update_list, i);
+    theta = carmen_normalize_theta(ltheta + (s-90)*M_PI/180.0);
+    person_filter_measurement_jacobian(f, lx, ly, theta, H);
+    hx = x = lx + cos(theta)*range[s];
+    hy = y = ly + sin(theta)*range[s];
+    person_filter_max_likelihood_measurement(f, lx, ly, theta, &hx, &hy);
+    nu[0] = x - hx;
+    nu[1] = y - hy;
+    carmen_dot_kalman_sensor_update(f->P, dx, H, f->R, nu);
+  }
+
+  f->x += dx[0];
+  f->y += dx[1];
+  f->logr += dx[2];
+  if (exp(f->logr) < 0.2)
+    f->logr = log(0.2);
+  else if (exp(f->logr) > 0.3)
+    f->logr = log(0.3);
 }
  
 //dbug: also need to shrink polygons!!
@@ -1652,31 +1511,28 @@ static void add_new_dot_filter(int *cluster_map, int c, int n,
   pf->x0 = ux;
   pf->y0 = uy;
   pf->hidden_cnt = 0;
-  pf->P = gsl_matrix_calloc(3,3);
-  carmen_test_alloc(pf->P);
-  gsl_matrix_set(pf->P, 0, 0, 0.01); //vx);
-  gsl_matrix_set(pf->P, 0, 1, 0.001); //vxy);
-  gsl_matrix_set(pf->P, 0, 2, 0.001); //vxlogr);
-  gsl_matrix_set(pf->P, 1, 0, 0.001); //vxy);
-  gsl_matrix_set(pf->P, 1, 1, 0.01); //vy);
-  gsl_matrix_set(pf->P, 1, 2, 0.001); //vylogr);
-  gsl_matrix_set(pf->P, 2, 0, 0.001); //vxlogr);
-  gsl_matrix_set(pf->P, 2, 1, 0.001); //vylogr);
-  gsl_matrix_set(pf->P, 2, 2, 0.00001); //vlogr);
+  memset(pf->P, 0, sizeof(pf->P));
+  pf->P[0][0] = 0.01; //vx);
+  pf->P[0][1] = 0.001; //vxy);
+  pf->P[0][2] = 0.001; //vxlogr);
+  pf->P[1][0] = 0.001; //vxy);
+  pf->P[1][1] = 0.01; //vy);
+  pf->P[1][2] = 0.001; //vylogr);
+  pf->P[2][0] = 0.001; //vxlogr);
+  pf->P[2][1] = 0.001; //vylogr);
+  pf->P[2][2] = 0.00001; //vlogr);
   pf->a = default_person_filter_a;
-  pf->Q = gsl_matrix_calloc(3,3);
-  carmen_test_alloc(pf->Q);
-  gsl_matrix_set(pf->Q, 0, 0, default_person_filter_qx);
-  gsl_matrix_set(pf->Q, 0, 1, default_person_filter_qxy);
-  gsl_matrix_set(pf->Q, 1, 0, default_person_filter_qxy);
-  gsl_matrix_set(pf->Q, 1, 1, default_person_filter_qy);
-  gsl_matrix_set(pf->Q, 2, 2, default_person_filter_qlogr);
-  pf->R = gsl_matrix_calloc(2,2);
-  carmen_test_alloc(pf->R);
-  gsl_matrix_set(pf->R, 0, 0, default_person_filter_rx);
-  gsl_matrix_set(pf->R, 0, 1, default_person_filter_rxy);
-  gsl_matrix_set(pf->R, 1, 0, default_person_filter_rxy);
-  gsl_matrix_set(pf->R, 1, 1, default_person_filter_ry);
+  memset(pf->Q, 0, sizeof(pf->Q));
+  pf->Q[0][0] = default_person_filter_qx;
+  pf->Q[0][1] = default_person_filter_qxy;
+  pf->Q[1][0] = default_person_filter_qxy;
+  pf->Q[1][1] = default_person_filter_qy;
+  pf->Q[2][2] = default_person_filter_qlogr;
+  memset(pf->R, 0, sizeof(pf->R));
+  pf->R[0][0] = default_person_filter_rx;
+  pf->R[0][1] = default_person_filter_rxy;
+  pf->R[1][0] = default_person_filter_rxy;
+  pf->R[1][1] = default_person_filter_ry;
 
   /*
   for (i = 0; i < n; i++)
@@ -1911,7 +1767,8 @@ static double dot_point_likelihood(carmen_dot_filter_p f, double lx, double ly,
 
   int i;
   double d, dmin, x, y, dx, dy, hx, hy, vhx, vhy, vhxy, fval;
-  gsl_matrix *V, *M, *H, *HT;
+  carmen_dot_kalman_jacobian_t H;
+  carmen_dot_kalman_noise_t V;
 
   d = 0.0;
 
@@ -1920,20 +1777,11 @@ static double dot_point_likelihood(carmen_dot_filter_p f, double lx, double ly,
 
   if (f->type == CARMEN_DOT_PERSON) {
     person_filter_max_likelihood_measurement(&f->person_filter, lx, ly, theta, &hx, &hy);
-    H = person_filter_measurement_jacobian(&f->person_filter, lx, ly, theta);
-    if (H == NULL)
-      return 0.0;
-    HT = gsl_matrix_alloc(H->size2, H->size1);
-    carmen_test_alloc(HT);
-    gsl_matrix_transpose_memcpy(HT, H);
-    M = matrix_mult(H, f->person_filter.P);
-    V = matrix_mult(M, HT);
-    gsl_matrix_free(M);
-    gsl_matrix_free(HT);
-    vhx = V->data[MI(V,0,0)];
-    vhy = V->data[MI(V,1,1)];
-    vhxy = V->data[MI(V,0,1)];
-    gsl_matrix_free(V);
+    person_filter_measurement_jacobian(&f->person_filter, lx, ly, theta, H);
+    carmen_dot_kalman_project(H, f->person_filter.P, V);
+    vhx = V[0][0];
+    vhy = V[1][1];
+    vhxy = V[0][1];
     //if (bnorm_f(x, y, hx, hy, vhx, vhy, vhxy) > .5)
     //  printf("bnorm_f(x = %.4f, y = %.4f, hx = %.4f, hy = %.4f, vxh = %f, vhy = %f, vhxy = %f) = %.2f\n",
     //	     x, y, hx, hy, vhx, vhy, vhxy, bnorm_f(x, y, hx, hy, vhx, vhy, vhxy));
@@ -1960,10 +1808,58 @@ static double dot_point_likelihood(carmen_dot_filter_p f, double lx, double ly,
   return 0.0;
 }
 
-static double **compute_dot_point_likelihoods(carmen_robot_laser_message *laser) {
+static void filter_position(carmen_dot_filter_p f, double *x, double *y) {
 
-  int i, j;
-  double theta;
+  if (f->type == CARMEN_DOT_PERSON) {
+    *x = f->person_filter.x;
+    *y = f->person_filter.y;
+  }
+  else {
+    *x = f->trash_filter.x;
+    *y = f->trash_filter.y;
+  }
+}
+
+/*
+ * radius around filter_position() outside of which a laser point's
+ * likelihood under the filter is taken to be zero
+ */
+static double filter_gate(carmen_dot_filter_p f) {
+
+  int i;
+  double r, d;
+
+  if (f->type == CARMEN_DOT_PERSON)
+    return exp(f->person_filter.logr) + association_gate;
+
+  r = 0.0;
+  for (i = 0; i < f->trash_filter.hull_size; i++) {
+    d = dist(f->trash_filter.xhull[i] - f->trash_filter.x,
+	     f->trash_filter.yhull[i] - f->trash_filter.y);
+    if (d > r)
+      r = d;
+  }
+
+  return r + association_gate;
+}
+
+/*
+ * new clusters are gaussians, gate them at 6 stdevs
+ */
+static double cluster_gate(double vx, double vy) {
+
+  return carmen_fmax(association_gate, 6.0*sqrt(vx + vy));
+}
+
+/*
+ * dot point likelihoods are only computed for the filters whose gates
+ * (hashed in association_grid) contain the point; the rest are zero.
+ */
+static double **compute_dot_point_likelihoods(carmen_robot_laser_message *laser,
+					      double *xpoints, double *ypoints) {
+
+  int i, j, k, n, *candidates;
+  double theta, x, y;
   static double **dpl = NULL;  // dpl[filter_index][laser_index]
   static int size_dpl = 0;
 
@@ -1972,13 +1868,24 @@ static double **compute_dot_point_likelihoods(carmen_robot_laser_message *laser)
     dpl = (double **) realloc(dpl, (num_filters+1)*laser->num_readings*sizeof(double));
     carmen_test_alloc(dpl);
   }
+
+  carmen_dot_grid_clear(&association_grid);
   for (i = 0; i < num_filters; i++) {
     dpl[i] = (double *)(dpl + (i+1)*laser->num_readings);
-    for (j = 0; j < laser->num_readings; j++) {
-      if (laser_mask[j]) {
-	theta = carmen_normalize_theta(laser->theta + (j-90)*M_PI/180.0);
-	dpl[i][j] = dot_point_likelihood(&filters[i], laser->x, laser->y, theta, laser->range[j]);
-      }
+    memset(dpl[i], 0, laser->num_readings*sizeof(double));
+    filter_position(&filters[i], &x, &y);
+    carmen_dot_grid_add(&association_grid, i, x, y, filter_gate(&filters[i]));
+  }
+  carmen_dot_grid_build(&association_grid);
+
+  for (j = 0; j < laser->num_readings; j++) {
+    if (!laser_mask[j])
+      continue;
+    theta = carmen_normalize_theta(laser->theta + (j-90)*M_PI/180.0);
+    n = carmen_dot_grid_query(&association_grid, xpoints[j], ypoints[j], &candidates);
+    for (k = 0; k < n; k++) {
+      i = candidates[k];
+      dpl[i][j] = dot_point_likelihood(&filters[i], laser->x, laser->y, theta, laser->range[j]);
     }
   }
 
@@ -1996,13 +1903,26 @@ static int cluster_kmeans(double *xpoints, double *ypoints, double **dpl, int *c
   static int last_cluster_map[500];
   static double cnt[500];
   double x, y, p, pmax;
-  int n, i, j, imax;
+  int n, i, j, k, imax, num_candidates, *candidates;
 
   for (i = 0; i < num_points; i++) {
     last_cluster_map[i] = cluster_map[i] = NO_CLUSTER;
   }
 
   while (1) {
+    // step 1: hash cluster gates so each point only looks at nearby clusters
+    carmen_dot_grid_clear(&association_grid);
+    for (j = 0; j < num_clusters; j++) {
+      if (filter_map[j] < 0)
+	carmen_dot_grid_add(&association_grid, j, xcentroids[j], ycentroids[j],
+			    cluster_gate(vx[j], vy[j]));
+      else {
+	filter_position(&filters[filter_map[j]], &x, &y);
+	carmen_dot_grid_add(&association_grid, j, x, y, filter_gate(&filters[filter_map[j]]));
+      }
+    }
+    carmen_dot_grid_build(&association_grid);
+
     // step 2: assign points to max-likelihood clusters
     //printf("assigning points to centroids\n");
     for (i = 0; i < num_points; i++) {
@@ -2010,7 +1930,9 @@ static int cluster_kmeans(double *xpoints, double *ypoints, double **dpl, int *c
 	continue;
       pmax = map_prob(xpoints[i], ypoints[i]);
       imax = MAP_CLUSTER;
-      for (j = 0; j < num_clusters; j++) {
+      num_candidates = carmen_dot_grid_query(&association_grid, xpoints[i], ypoints[i], &candidates);
+      for (k = 0; k < num_candidates; k++) {
+	j = candidates[k];
 	if (filter_map[j] < 0)
 	  p = new_cluster_sensor_stdev * new_cluster_sensor_stdev * M_PI *
 	    bnorm_f(xpoints[i], ypoints[i], xcentroids[j], ycentroids[j], vx[j], vy[j], vxy[j]);
@@ -2182,9 +2104,10 @@ static void print_clusters(double *xpoints, double *ypoints, int *cluster_map, i
 }
 */
 
-static void cluster(carmen_robot_laser_message *laser) {
+// returns the number of laser points not explained by the map
+static int cluster(carmen_robot_laser_message *laser) {
 
-  int i, f, num_points, num_clusters, imin;
+  int i, f, num_points, num_valid_points, num_clusters, imin;
   static int cluster_map[500];
   static int filter_map[500];
   static double xpoints[500];
@@ -2201,6 +2124,7 @@ static void cluster(carmen_robot_laser_message *laser) {
 
   num_points = 0;
   for (i = 0; i < laser->num_readings; i++) {
+    laser_owner[i] = -1;
     if (laser->range[i] < laser_max_range) {
       ltheta = carmen_normalize_theta(laser->theta + (i-90)*M_PI/180.0);
       xpoints[i] = laser->x + cos(ltheta) * laser->range[i];
@@ -2216,11 +2140,12 @@ static void cluster(carmen_robot_laser_message *laser) {
   }
 
   if (num_points == 0)
-    return;
+    return 0;
 
+  num_valid_points = num_points;
   num_points = laser->num_readings;
 
-  dpl = compute_dot_point_likelihoods(laser);
+  dpl = compute_dot_point_likelihoods(laser, xpoints, ypoints);
 
   num_clusters = initialize_centroids(laser, xcentroids, ycentroids, filter_map);
 
@@ -2295,6 +2220,7 @@ static void cluster(carmen_robot_laser_message *laser) {
     if (f != FILTER_MAP_ADD_CLUSTER) {
       carmen_list_add(filters[f].person_filter.sensor_update_list, &i);
       carmen_list_add(filters[f].trash_filter.sensor_update_list, &i);
+      laser_owner[i] = filters[f].id;
     }
   }
 
@@ -2306,16 +2232,14 @@ static void cluster(carmen_robot_laser_message *laser) {
   for (i = 0; i < num_points; i++)
     if (laser_mask[i] && cluster_map[i] < 0)
       laser_mask[i] = 0;
+
+  return num_valid_points;
 }
 
 static void delete_filter(int i) {
 
   //printf("D%d\n", filters[i].id);
 
-  gsl_matrix_free(filters[i].person_filter.P);
-  gsl_matrix_free(filters[i].person_filter.Q);
-  gsl_matrix_free(filters[i].person_filter.R);
-
   carmen_list_destroy(&filters[i].person_filter.sensor_update_list);
   carmen_list_destroy(&filters[i].trash_filter.sensor_update_list);
 
@@ -2403,7 +2327,10 @@ static int filter_invisible(carmen_dot_filter_p f, carmen_robot_laser_message *l
 
 static void laser_handler(carmen_robot_laser_message *laser) {
 
-  int i;
+  int i, num_points;
+  double t0, t1, t2;
+  static double association_time = 0.0, update_time = 0.0;
+  static int num_scans = 0;
 
   if (static_map.map == NULL || odom.timestamp == 0.0)
     return;
@@ -2421,8 +2348,21 @@ static void laser_handler(carmen_robot_laser_message *laser) {
     filters[i].trash_filter.sensor_update_list->length = 0;
   }
 
-  cluster(laser);
+  t0 = carmen_get_time();
+  num_points = cluster(laser);
+  t1 = carmen_get_time();
   update_dots(laser);
+  t2 = carmen_get_time();
+
+  if (report_timing) {
+    association_time += t1 - t0;
+    update_time += t2 - t1;
+    num_scans++;
+    printf("%d tracks, %d points: association %.2f ms, update %.2f ms "
+	   "(mean %.2f ms, %.2f ms over %d scans)\n", num_filters, num_points,
+	   1000.0*(t1-t0), 1000.0*(t2-t1), 1000.0*association_time/num_scans,
+	   1000.0*update_time/num_scans, num_scans);
+  }
 
   // delete invisible filters (filters we can see through)
   for (i = 0; i < num_filters; i++) {
@@ -2575,9 +2515,9 @@ static void publish_all_dot_msgs() {
 	all_people_msg.people[n].x = filters[i].person_filter.x;
 	all_people_msg.people[n].y = filters[i].person_filter.y;
 	all_people_msg.people[n].r = exp(filters[i].person_filter.logr);
-	all_people_msg.people[n].vx = gsl_matrix_get(filters[i].person_filter.P, 0, 0);
-	all_people_msg.people[n].vy = gsl_matrix_get(filters[i].person_filter.P, 1, 1);
-	all_people_msg.people[n].vxy = gsl_matrix_get(filters[i].person_filter.P, 0, 1);
+	all_people_msg.people[n].vx = filters[i].person_filter.P[0][0];
+	all_people_msg.people[n].vy = filters[i].person_filter.P[1][1];
+	all_people_msg.people[n].vxy = filters[i].person_filter.P[0][1];
 	n++;
       }
   }
@@ -2691,9 +2631,9 @@ static void respond_all_people_msg(MSG_INSTANCE msgRef) {
 	msg.people[n].id = filters[i].id;
 	msg.people[n].x = filters[i].person_filter.x;
 	msg.people[n].y = filters[i].person_filter.y;
-	msg.people[n].vx = gsl_matrix_get(filters[i].person_filter.P, 0, 0);
-	msg.people[n].vy = gsl_matrix_get(filters[i].person_filter.P, 1, 1);
-	msg.people[n].vxy = gsl_matrix_get(filters[i].person_filter.P, 0, 1);
+	msg.people[n].vx = filters[i].person_filter.P[0][0];
+	msg.people[n].vy = filters[i].person_filter.P[1][1];
+	msg.people[n].vxy = filters[i].person_filter.P[0][1];
 	n++;
       }
     }
@@ -2953,7 +2893,9 @@ static void params_init(int argc, char *argv[]) {
     {"dot", "invisible_cnt", CARMEN_PARAM_INT, &invisible_cnt, 1, NULL},
     {"dot", "trash_see_through_dist", CARMEN_PARAM_DOUBLE, &trash_see_through_dist, 1, NULL},
     {"dot", "bic_min_variance", CARMEN_PARAM_DOUBLE, &bic_min_variance, 1, NULL},
-    {"dot", "bic_num_params", CARMEN_PARAM_INT, &bic_num_params, 1, NULL}
+    {"dot", "bic_num_params", CARMEN_PARAM_INT, &bic_num_params, 1, NULL},
+    {"dot", "association_gate", CARMEN_PARAM_DOUBLE, &association_gate, 1, NULL},
+    {"dot", "report_timing", CARMEN_PARAM_ONOFF, &report_timing, 1, NULL}
   };
 
   carmen_param_install_params(argc, argv, param_list,
@@ -2984,6 +2926,9 @@ int main(int argc, char *argv[]) {
   printf("done\n");
 
   params_init(argc, argv);
+  if (association_gate <= 0.0)
+    carmen_die("dot_association_gate must be positive\n");
+  carmen_dot_grid_init(&association_grid, association_gate, 1024);
   ipc_init();
 
   printf("occupied_prob = %f\n", localize_params.occupied_prob);
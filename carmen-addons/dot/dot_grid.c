@@ -0,0 +1,155 @@
+#include <carmen/carmen.h>
+#include "dot_grid.h"
+
+#define DOT_GRID_MAX_CELLS 256  // per gate, larger gates go on the global list
+
+
+static inline int grid_cell(double x, double cell_size) {
+
+  return (int)floor(x / cell_size);
+}
+
+static inline int grid_bucket(carmen_dot_grid_p grid, int cx, int cy) {
+
+  unsigned int h;
+
+  h = (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u;
+
+  return (int)(h & (unsigned int)(grid->num_buckets-1));
+}
+
+void carmen_dot_grid_init(carmen_dot_grid_p grid, double cell_size, int num_buckets) {
+
+  memset(grid, 0, sizeof(carmen_dot_grid_t));
+
+  grid->cell_size = cell_size;
+  grid->num_buckets = 1;
+  while (grid->num_buckets < num_buckets)
+    grid->num_buckets *= 2;
+
+  grid->bucket_start = (int *)calloc(grid->num_buckets+1, sizeof(int));
+  carmen_test_alloc(grid->bucket_start);
+}
+
+void carmen_dot_grid_free(carmen_dot_grid_p grid) {
+
+  free(grid->bucket_start);
+  free(grid->pending);
+  free(grid->entries);
+  free(grid->global);
+  free(grid->result);
+  memset(grid, 0, sizeof(carmen_dot_grid_t));
+}
+
+void carmen_dot_grid_clear(carmen_dot_grid_p grid) {
+
+  grid->num_pending = 0;
+  grid->num_global = 0;
+  memset(grid->bucket_start, 0, (grid->num_buckets+1)*sizeof(int));
+}
+
+/*
+ * items must be added in increasing order for queries to return them
+ * in increasing order.
+ */
+void carmen_dot_grid_add(carmen_dot_grid_p grid, int item, double x, double y, double radius) {
+
+  int cx, cy, cx0, cy0, cx1, cy1;
+
+  cx0 = grid_cell(x - radius, grid->cell_size);
+  cx1 = grid_cell(x + radius, grid->cell_size);
+  cy0 = grid_cell(y - radius, grid->cell_size);
+  cy1 = grid_cell(y + radius, grid->cell_size);
+
+  if ((double)(cx1-cx0+1)*(double)(cy1-cy0+1) > DOT_GRID_MAX_CELLS) {
+    if (grid->num_global == grid->max_global) {
+      grid->max_global = (grid->max_global ? 2*grid->max_global : 16);
+      grid->global = (int *)realloc(grid->global, grid->max_global*sizeof(int));
+      carmen_test_alloc(grid->global);
+    }
+    grid->global[grid->num_global++] = item;
+    return;
+  }
+
+  if (grid->num_pending + (cx1-cx0+1)*(cy1-cy0+1) > grid->max_pending) {
+    while (grid->num_pending + (cx1-cx0+1)*(cy1-cy0+1) > grid->max_pending)
+      grid->max_pending = (grid->max_pending ? 2*grid->max_pending : 256);
+    grid->pending = (carmen_dot_grid_entry_t *)
+      realloc(grid->pending, grid->max_pending*sizeof(carmen_dot_grid_entry_t));
+    carmen_test_alloc(grid->pending);
+  }
+
+  for (cx = cx0; cx <= cx1; cx++)
+    for (cy = cy0; cy <= cy1; cy++) {
+      grid->pending[grid->num_pending].cx = cx;
+      grid->pending[grid->num_pending].cy = cy;
+      grid->pending[grid->num_pending].item = item;
+      grid->num_pending++;
+    }
+}
+
+/*
+ * counting sort of the pending entries into their buckets (stable, so
+ * each bucket stays in item order)
+ */
+void carmen_dot_grid_build(carmen_dot_grid_p grid) {
+
+  int i, b, n;
+
+  if (grid->num_pending > grid->max_entries) {
+    grid->max_entries = grid->max_pending;
+    grid->entries = (carmen_dot_grid_entry_t *)
+      realloc(grid->entries, grid->max_entries*sizeof(carmen_dot_grid_entry_t));
+    carmen_test_alloc(grid->entries);
+  }
+
+  memset(grid->bucket_start, 0, (grid->num_buckets+1)*sizeof(int));
+  for (i = 0; i < grid->num_pending; i++)
+    grid->bucket_start[grid_bucket(grid, grid->pending[i].cx, grid->pending[i].cy)+1]++;
+  for (b = 0; b < grid->num_buckets; b++)
+    grid->bucket_start[b+1] += grid->bucket_start[b];
+
+  for (i = 0; i < grid->num_pending; i++) {
+    b = grid_bucket(grid, grid->pending[i].cx, grid->pending[i].cy);
+    n = grid->bucket_start[b]++;
+    grid->entries[n] = grid->pending[i];
+  }
+  // bucket_start[b] now holds the end of bucket b; shift it back
+  for (b = grid->num_buckets; b > 0; b--)
+    grid->bucket_start[b] = grid->bucket_start[b-1];
+  grid->bucket_start[0] = 0;
+}
+
+int carmen_dot_grid_query(carmen_dot_grid_p grid, double x, double y, int **items) {
+
+  int cx, cy, b, i, j, n, item;
+
+  cx = grid_cell(x, grid->cell_size);
+  cy = grid_cell(y, grid->cell_size);
+  b = grid_bucket(grid, cx, cy);
+
+  n = grid->bucket_start[b+1] - grid->bucket_start[b] + grid->num_global;
+  if (n > grid->max_result) {
+    grid->max_result = n;
+    grid->result = (int *)realloc(grid->result, grid->max_result*sizeof(int));
+    carmen_test_alloc(grid->result);
+  }
+
+  // merge the bucket with the global list, both in item order
+  n = 0;
+  j = 0;
+  for (i = grid->bucket_start[b]; i < grid->bucket_start[b+1]; i++) {
+    if (grid->entries[i].cx != cx || grid->entries[i].cy != cy)
+      continue;
+    item = grid->entries[i].item;
+    while (j < grid->num_global && grid->global[j] < item)
+      grid->result[n++] = grid->global[j++];
+    grid->result[n++] = item;
+  }
+  while (j < grid->num_global)
+    grid->result[n++] = grid->global[j++];
+
+  *items = grid->result;
+
+  return n;
+}
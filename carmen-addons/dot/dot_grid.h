@@ -0,0 +1,58 @@
+#ifndef DOT_GRID_H
+#define DOT_GRID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Spatial hash of circular gates, used to find the tracks (or
+ * clusters) a laser point could belong to without testing every one.
+ *
+ * Each gate is entered into every grid cell its bounding box touches;
+ * cells are hashed into a fixed number of buckets.  Gates are added
+ * with carmen_dot_grid_add() and then carmen_dot_grid_build() packs
+ * them, after which carmen_dot_grid_query() returns the gates whose
+ * cells contain a point, in increasing item order.  A query may return
+ * gates that don't actually contain the point, but never misses one
+ * that does.  Gates too large to be worth hashing are returned for
+ * every point.
+ */
+
+typedef struct {
+  int cx, cy;
+  int item;
+} carmen_dot_grid_entry_t;
+
+typedef struct {
+  double cell_size;
+  int num_buckets;
+  int *bucket_start;   // num_buckets+1 offsets into entries
+  carmen_dot_grid_entry_t *pending;
+  int num_pending, max_pending;
+  carmen_dot_grid_entry_t *entries;
+  int max_entries;
+  int *global;         // items returned for every query
+  int num_global, max_global;
+  int *result;
+  int max_result;
+} carmen_dot_grid_t, *carmen_dot_grid_p;
+
+void carmen_dot_grid_init(carmen_dot_grid_p grid, double cell_size, int num_buckets);
+void carmen_dot_grid_free(carmen_dot_grid_p grid);
+
+void carmen_dot_grid_clear(carmen_dot_grid_p grid);
+void carmen_dot_grid_add(carmen_dot_grid_p grid, int item, double x, double y, double radius);
+void carmen_dot_grid_build(carmen_dot_grid_p grid);
+
+/*
+ * returns the number of candidate items for point (x,y) and points
+ * *items at them; the array stays valid until the next query.
+ */
+int carmen_dot_grid_query(carmen_dot_grid_p grid, double x, double y, int **items);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
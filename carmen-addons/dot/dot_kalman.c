@@ -0,0 +1,98 @@
+#include <math.h>
+#include "dot_kalman.h"
+
+
+void carmen_dot_kalman_motion_update(carmen_dot_kalman_cov_t P,
+				     carmen_dot_kalman_cov_t Q) {
+
+  int i, j;
+
+  for (i = 0; i < DOT_KALMAN_N; i++)
+    for (j = 0; j < DOT_KALMAN_N; j++)
+      P[i][j] += Q[i][j];
+}
+
+void carmen_dot_kalman_project(carmen_dot_kalman_jacobian_t H,
+			       carmen_dot_kalman_cov_t P,
+			       carmen_dot_kalman_noise_t V) {
+
+  double HP[DOT_KALMAN_M][DOT_KALMAN_N];
+  int i, j, k;
+
+  for (i = 0; i < DOT_KALMAN_M; i++)
+    for (j = 0; j < DOT_KALMAN_N; j++) {
+      HP[i][j] = 0.0;
+      for (k = 0; k < DOT_KALMAN_N; k++)
+	HP[i][j] += H[i][k]*P[k][j];
+    }
+
+  for (i = 0; i < DOT_KALMAN_M; i++)
+    for (j = 0; j < DOT_KALMAN_M; j++) {
+      V[i][j] = 0.0;
+      for (k = 0; k < DOT_KALMAN_N; k++)
+	V[i][j] += HP[i][k]*H[j][k];
+    }
+}
+
+int carmen_dot_kalman_sensor_update(carmen_dot_kalman_cov_t P,
+				    carmen_dot_kalman_state_t dx,
+				    carmen_dot_kalman_jacobian_t H,
+				    carmen_dot_kalman_noise_t R,
+				    double *nu) {
+
+  double HP[DOT_KALMAN_M][DOT_KALMAN_N];
+  double S[DOT_KALMAN_M][DOT_KALMAN_M];
+  double K[DOT_KALMAN_N][DOT_KALMAN_M];
+  double e[DOT_KALMAN_M];
+  double det, s00, s01, s10, s11;
+  int i, j, k;
+
+  // HP = H*P, S = H*P*H^T + R
+  for (i = 0; i < DOT_KALMAN_M; i++)
+    for (j = 0; j < DOT_KALMAN_N; j++) {
+      HP[i][j] = 0.0;
+      for (k = 0; k < DOT_KALMAN_N; k++)
+	HP[i][j] += H[i][k]*P[k][j];
+    }
+  for (i = 0; i < DOT_KALMAN_M; i++)
+    for (j = 0; j < DOT_KALMAN_M; j++) {
+      S[i][j] = R[i][j];
+      for (k = 0; k < DOT_KALMAN_N; k++)
+	S[i][j] += HP[i][k]*H[j][k];
+    }
+
+  det = S[0][0]*S[1][1] - S[0][1]*S[1][0];
+  if (fabs(det) < 1e-12)
+    return -1;
+  s00 = S[1][1]/det;
+  s01 = -S[0][1]/det;
+  s10 = -S[1][0]/det;
+  s11 = S[0][0]/det;
+
+  // K = P*H^T*S^-1
+  for (i = 0; i < DOT_KALMAN_N; i++) {
+    double ph0 = 0.0, ph1 = 0.0;
+    for (k = 0; k < DOT_KALMAN_N; k++) {
+      ph0 += P[i][k]*H[0][k];
+      ph1 += P[i][k]*H[1][k];
+    }
+    K[i][0] = ph0*s00 + ph1*s10;
+    K[i][1] = ph0*s01 + ph1*s11;
+  }
+
+  // innovation relative to the state corrected by the previous points
+  for (i = 0; i < DOT_KALMAN_M; i++) {
+    e[i] = nu[i];
+    for (k = 0; k < DOT_KALMAN_N; k++)
+      e[i] -= H[i][k]*dx[k];
+  }
+
+  // dx += K*e, P = (I - K*H)*P
+  for (i = 0; i < DOT_KALMAN_N; i++) {
+    dx[i] += K[i][0]*e[0] + K[i][1]*e[1];
+    for (j = 0; j < DOT_KALMAN_N; j++)
+      P[i][j] -= K[i][0]*HP[0][j] + K[i][1]*HP[1][j];
+  }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef DOT_KALMAN_H
+#define DOT_KALMAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-size extended kalman filter updates for the people tracker.
+ *
+ * The person state is (x, y, logr) and every laser point on a person
+ * is a 2d measurement.  All matrices are plain arrays owned by the
+ * caller, so nothing here allocates memory.
+ */
+
+#define DOT_KALMAN_N 3  /* state dimension */
+#define DOT_KALMAN_M 2  /* measurement dimension */
+
+typedef double carmen_dot_kalman_state_t[DOT_KALMAN_N];
+typedef double carmen_dot_kalman_cov_t[DOT_KALMAN_N][DOT_KALMAN_N];
+typedef double carmen_dot_kalman_jacobian_t[DOT_KALMAN_M][DOT_KALMAN_N];
+typedef double carmen_dot_kalman_noise_t[DOT_KALMAN_M][DOT_KALMAN_M];
+
+/*
+ * P += Q
+ */
+void carmen_dot_kalman_motion_update(carmen_dot_kalman_cov_t P,
+				     carmen_dot_kalman_cov_t Q);
+
+/*
+ * V = H P H^T, the covariance of the expected measurement
+ */
+void carmen_dot_kalman_project(carmen_dot_kalman_jacobian_t H,
+			       carmen_dot_kalman_cov_t P,
+			       carmen_dot_kalman_noise_t V);
+
+/*
+ * Folds one measurement into the update of a scan.  Jacobian H and
+ * innovation nu must both be taken at the prior state; dx accumulates
+ * the state correction (start it at zero) and P is updated in place.
+ * Processing a scan's points one after another this way gives the same
+ * result as the stacked update with block diagonal sensor noise, but
+ * only ever inverts 2x2 matrices.  Returns -1 (and leaves P and dx
+ * unchanged) if the innovation covariance is singular.
+ */
+int carmen_dot_kalman_sensor_update(carmen_dot_kalman_cov_t P,
+				    carmen_dot_kalman_state_t dx,
+				    carmen_dot_kalman_jacobian_t H,
+				    carmen_dot_kalman_noise_t R,
+				    double *nu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+#include <carmen/carmen.h>
+#include "dot_kalman.h"
+
+/*
+ * Runs the person filter updates for many simultaneous tracks on
+ * synthetic scans, once with the fixed-size filter and once with the
+ * old stacked update (heap allocated 2n x 2n innovation covariance),
+ * and reports the time per scan and the largest difference between
+ * the two.
+ *
+ * usage: dot_kalman_bench [num_tracks] [points_per_track] [num_scans]
+ */
+
+typedef struct {
+  carmen_dot_kalman_state_t x;
+  carmen_dot_kalman_cov_t P;
+} bench_track_t;
+
+static carmen_dot_kalman_cov_t Q = {{0.01, 0.001, 0.0},
+				    {0.001, 0.01, 0.0},
+				    {0.0, 0.0, 0.01}};
+static carmen_dot_kalman_noise_t R = {{0.02, 0.001},
+				      {0.001, 0.02}};
+
+static double *matrix_alloc(int rows, int cols) {
+
+  double *M;
+
+  M = (double *)calloc(rows*cols, sizeof(double));
+  carmen_test_alloc(M);
+
+  return M;
+}
+
+static double *matrix_mult(double *A, double *B, int n, int m, int k) {
+
+  double *C;
+  int i, j, l;
+
+  C = matrix_alloc(n, k);
+  for (i = 0; i < n; i++)
+    for (j = 0; j < k; j++)
+      for (l = 0; l < m; l++)
+	C[i*k+j] += A[i*m+l]*B[l*k+j];
+
+  return C;
+}
+
+static int matrix_invert(double *M, int n) {
+
+  double *A, t;
+  int i, j, k, p;
+
+  A = matrix_alloc(n, 2*n);
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++)
+      A[i*2*n+j] = M[i*n+j];
+    A[i*2*n+n+i] = 1.0;
+  }
+
+  for (k = 0; k < n; k++) {
+    p = k;
+    for (i = k+1; i < n; i++)
+      if (fabs(A[i*2*n+k]) > fabs(A[p*2*n+k]))
+	p = i;
+    if (fabs(A[p*2*n+k]) < 1e-12) {
+      free(A);
+      return -1;
+    }
+    if (p != k)
+      for (j = 0; j < 2*n; j++) {
+	t = A[k*2*n+j];
+	A[k*2*n+j] = A[p*2*n+j];
+	A[p*2*n+j] = t;
+      }
+    t = A[k*2*n+k];
+    for (j = 0; j < 2*n; j++)
+      A[k*2*n+j] /= t;
+    for (i = 0; i < n; i++)
+      if (i != k) {
+	t = A[i*2*n+k];
+	for (j = 0; j < 2*n; j++)
+	  A[i*2*n+j] -= t*A[k*2*n+j];
+      }
+  }
+
+  for (i = 0; i < n; i++)
+    for (j = 0; j < n; j++)
+      M[i*n+j] = A[i*2*n+n+j];
+  free(A);
+
+  return 0;
+}
+
+/*
+ * stacked update as dot.c used to do it: K = P H^T (H P H^T + R2)^-1
+ */
+static void stacked_update(bench_track_t *t, double *H, double *nu, int n) {
+
+  double *HT, *M1, *M2, *K, *dx, *KH, *P, *P2;
+  int i, j;
+
+  HT = matrix_alloc(3, 2*n);
+  for (i = 0; i < 2*n; i++)
+    for (j = 0; j < 3; j++)
+      HT[j*2*n+i] = H[i*3+j];
+  P = matrix_alloc(3, 3);
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+      P[i*3+j] = t->P[i][j];
+
+  M1 = matrix_mult(H, P, 2*n, 3, 3);
+  M2 = matrix_mult(M1, HT, 2*n, 3, 2*n);
+  free(M1);
+  for (i = 0; i < n; i++) {
+    M2[(2*i)*2*n+2*i] += R[0][0];
+    M2[(2*i)*2*n+2*i+1] += R[0][1];
+    M2[(2*i+1)*2*n+2*i] += R[1][0];
+    M2[(2*i+1)*2*n+2*i+1] += R[1][1];
+  }
+  if (matrix_invert(M2, 2*n) < 0) {
+    free(M2);
+    free(HT);
+    free(P);
+    return;
+  }
+  M1 = matrix_mult(HT, M2, 3, 2*n, 2*n);
+  free(M2);
+  K = matrix_mult(P, M1, 3, 3, 2*n);
+  free(M1);
+
+  dx = matrix_mult(K, nu, 3, 2*n, 1);
+  for (i = 0; i < 3; i++)
+    t->x[i] += dx[i];
+  free(dx);
+
+  KH = matrix_mult(K, H, 3, 2*n, 3);
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+      KH[i*3+j] = (i == j) - KH[i*3+j];
+  P2 = matrix_mult(KH, P, 3, 3, 3);
+  for (i = 0; i < 3; i++)
+    for (j = 0; j < 3; j++)
+      t->P[i][j] = P2[i*3+j];
+
+  free(KH);
+  free(P2);
+  free(K);
+  free(HT);
+  free(P);
+}
+
+static void fixed_update(bench_track_t *t, double *H, double *nu, int n) {
+
+  carmen_dot_kalman_state_t dx;
+  int i;
+
+  dx[0] = dx[1] = dx[2] = 0.0;
+  for (i = 0; i < n; i++)
+    carmen_dot_kalman_sensor_update(t->P, dx, (double (*)[DOT_KALMAN_N])(H+6*i),
+				    R, nu+2*i);
+  for (i = 0; i < 3; i++)
+    t->x[i] += dx[i];
+}
+
+static void init_tracks(bench_track_t *tracks, int num_tracks) {
+
+  int i;
+
+  memset(tracks, 0, num_tracks*sizeof(bench_track_t));
+  for (i = 0; i < num_tracks; i++) {
+    tracks[i].x[0] = carmen_uniform_random(-5.0, 5.0);
+    tracks[i].x[1] = carmen_uniform_random(0.5, 8.0);
+    tracks[i].x[2] = log(0.25);
+    tracks[i].P[0][0] = tracks[i].P[1][1] = 0.01;
+    tracks[i].P[0][1] = tracks[i].P[1][0] = 0.001;
+    tracks[i].P[2][2] = 0.001;
+  }
+}
+
+/*
+ * jacobians and innovations for each point of each track on each scan
+ */
+static void make_scans(double *H, double *nu, int num_tracks, int n, int num_scans) {
+
+  int i, k;
+  double c, s;
+
+  for (i = 0; i < num_scans*num_tracks*n; i++) {
+    c = cos(carmen_uniform_random(-M_PI/2.0, M_PI/2.0));
+    s = sqrt(1.0 - c*c);
+    H[6*i+0] = c*c;
+    H[6*i+1] = s*c;
+    H[6*i+2] = carmen_uniform_random(-0.3, 0.3);
+    H[6*i+3] = s*c;
+    H[6*i+4] = s*s;
+    H[6*i+5] = carmen_uniform_random(-0.3, 0.3);
+    for (k = 0; k < 2; k++)
+      nu[2*i+k] = carmen_gaussian_random(0.0, 0.05);
+  }
+}
+
+static double run(void (*update)(bench_track_t *, double *, double *, int),
+		  bench_track_t *tracks, int num_tracks, double *H, double *nu,
+		  int n, int num_scans) {
+
+  double start;
+  int i, j, k;
+
+  start = carmen_get_time();
+  for (j = 0; j < num_scans; j++)
+    for (i = 0; i < num_tracks; i++) {
+      k = j*num_tracks + i;
+      carmen_dot_kalman_motion_update(tracks[i].P, Q);
+      update(&tracks[i], H+6*n*k, nu+2*n*k, n);
+    }
+
+  return carmen_get_time() - start;
+}
+
+int main(int argc, char **argv) {
+
+  int num_tracks, n, num_scans, i, j, k;
+  bench_track_t *fixed, *stacked;
+  double *H, *nu;
+  double t_fixed, t_stacked, d, dmax;
+
+  num_tracks = (argc > 1 ? atoi(argv[1]) : 100);
+  n = (argc > 2 ? atoi(argv[2]) : 10);
+  num_scans = (argc > 3 ? atoi(argv[3]) : 100);
+  if (num_tracks < 1 || n < 1 || num_scans < 1)
+    carmen_die("usage: %s [num_tracks] [points_per_track] [num_scans]\n", argv[0]);
+
+  carmen_randomize(&argc, &argv);
+
+  fixed = (bench_track_t *)calloc(num_tracks, sizeof(bench_track_t));
+  carmen_test_alloc(fixed);
+  stacked = (bench_track_t *)calloc(num_tracks, sizeof(bench_track_t));
+  carmen_test_alloc(stacked);
+  H = (double *)calloc(6*n*num_tracks*num_scans, sizeof(double));
+  carmen_test_alloc(H);
+  nu = (double *)calloc(2*n*num_tracks*num_scans, sizeof(double));
+  carmen_test_alloc(nu);
+
+  init_tracks(fixed, num_tracks);
+  memcpy(stacked, fixed, num_tracks*sizeof(bench_track_t));
+  make_scans(H, nu, num_tracks, n, num_scans);
+
+  t_stacked = run(stacked_update, stacked, num_tracks, H, nu, n, num_scans);
+  t_fixed = run(fixed_update, fixed, num_tracks, H, nu, n, num_scans);
+
+  dmax = 0.0;
+  for (i = 0; i < num_tracks; i++)
+    for (j = 0; j < 3; j++) {
+      d = fabs(fixed[i].x[j] - stacked[i].x[j]);
+      if (d > dmax)
+	dmax = d;
+      for (k = 0; k < 3; k++) {
+	d = fabs(fixed[i].P[j][k] - stacked[i].P[j][k]);
+	if (d > dmax)
+	  dmax = d;
+      }
+    }
+
+  printf("%d tracks, %d points per track, %d scans\n", num_tracks, n, num_scans);
+  printf("stacked: %8.3f ms/scan\n", 1000.0*t_stacked/num_scans);
+  printf("fixed:   %8.3f ms/scan (%.1fx)\n", 1000.0*t_fixed/num_scans,
+	 t_fixed > 0.0 ? t_stacked/t_fixed : 0.0);
+  printf("max state/covariance difference: %g\n", dmax);
+
+  free(fixed);
+  free(stacked);
+  free(H);
+  free(nu);
+
+  return 0;
+}
@@ -1,10 +1,14 @@
 #include <carmen/carmen.h>
 #include <limits.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "roadmap.h"
 #include "dynamics.h"
 
 #define MAX_NUM_VERTICES 1500
+#define MAX_EDGE_THREADS 16
+#define MIN_PAIRS_PER_THREAD 256
 
 struct state_struct {
   int id;
@@ -312,41 +316,124 @@ double carmen_roadmap_get_cost(carmen_world_point_t *point,
   return cost;
 }
 
-static int construct_edges(carmen_roadmap_t *roadmap, int id) 
+static void dynamic_program(carmen_roadmap_t *roadmap);
+
+typedef struct {
+  carmen_roadmap_t *roadmap;
+  carmen_roadmap_pair_t *pairs;
+  int *which;
+  int num;
+  int thread, num_threads;
+} edge_cost_job_t;
+
+static void *edge_cost_thread(void *arg)
 {
+  edge_cost_job_t *job = (edge_cost_job_t *)arg;
   carmen_roadmap_vertex_t *node_list;
-  carmen_roadmap_edge_t *edges;
-  int i, j;
-  int length;
-  double cost = 0;
+  carmen_roadmap_pair_t *pair;
+  int k;
+
+  node_list = (carmen_roadmap_vertex_t *)(job->roadmap->nodes->list);
+  for (k = job->thread; k < job->num; k += job->num_threads) {
+    pair = job->pairs + job->which[k];
+    pair->cost = compute_cost(node_list[pair->node].x, node_list[pair->node].y,
+			      node_list[pair->parent].x, 
+			      node_list[pair->parent].y, 
+			      job->roadmap->c_space);
+  }
+
+  return NULL;
+}
+
+/* Computes the cost of the cached pairs listed in which[], spread
+   over as many threads as there are processors. compute_cost only
+   reads the c-space, so the pairs are independent. */
+static void compute_pair_costs(carmen_roadmap_t *roadmap, int *which, int num)
+{
+  edge_cost_job_t jobs[MAX_EDGE_THREADS];
+  pthread_t threads[MAX_EDGE_THREADS];
+  int num_threads, t;
+
+  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  num_threads = carmen_clamp(1, num_threads, MAX_EDGE_THREADS);
+  num_threads = carmen_clamp(1, num / MIN_PAIRS_PER_THREAD, num_threads);
+
+  for (t = 0; t < num_threads; t++) {
+    jobs[t].roadmap = roadmap;
+    jobs[t].pairs = (carmen_roadmap_pair_t *)(roadmap->edge_costs->list);
+    jobs[t].which = which;
+    jobs[t].num = num;
+    jobs[t].thread = t;
+    jobs[t].num_threads = num_threads;
+  }
+
+  for (t = 1; t < num_threads; t++)
+    if (pthread_create(threads+t, NULL, edge_cost_thread, jobs+t) != 0)
+      carmen_die("Could not create edge cost thread\n");
+  edge_cost_thread(jobs);
+  for (t = 1; t < num_threads; t++)
+    pthread_join(threads[t], NULL);
+}
+
+static void add_pair_edges(carmen_roadmap_t *roadmap, int first_pair)
+{
+  carmen_roadmap_vertex_t *node_list;
+  carmen_roadmap_pair_t *pairs;
+  int k;
 
   node_list = (carmen_roadmap_vertex_t *)(roadmap->nodes->list);
+  pairs = (carmen_roadmap_pair_t *)(roadmap->edge_costs->list);
+  for (k = first_pair; k < roadmap->edge_costs->length; k++) 
+    if (pairs[k].cost < 9e5)
+      add_edge(node_list+pairs[k].node, node_list+pairs[k].parent, 
+	       pairs[k].cost);
+}
 
-  for (i = 0; i < roadmap->nodes->length; i++) {
-    if (i == id)
-      continue;
-    if (hypot(node_list[i].x - node_list[id].x, 
-	      node_list[i].y - node_list[id].y) < 50) {
-      cost = 1e6;
-      edges = (carmen_roadmap_edge_t *)(node_list[i].edges->list);
-      length = node_list[i].edges->length;
-      for (j = 0; j < length; j++) {
-	if (edges[j].id == id) {
-	  cost = edges[j].cost;
-	  break;
-	}
-      }
-      if (j == length) {
-	cost = compute_cost(node_list[i].x, node_list[i].y, 
-			    node_list[id].x, node_list[id].y, 
-			    roadmap->c_space);
-	if (cost < 9e5)
-	  add_edge(node_list+i, node_list+id, cost);
+/* Connects nodes first_id and above to every node within 50 cells.
+   The candidate pairs are collected first, costed in parallel and
+   cached in roadmap->edge_costs, then the edges are added in the
+   same order the node-by-node construction used to add them. */
+static void construct_edges(carmen_roadmap_t *roadmap, int first_id) 
+{
+  carmen_roadmap_vertex_t *node_list;
+  carmen_roadmap_pair_t pair;
+  int i, id, k;
+  int first_pair, num;
+  int *which;
+
+  node_list = (carmen_roadmap_vertex_t *)(roadmap->nodes->list);
+
+  if (roadmap->edge_costs == NULL)
+    roadmap->edge_costs = carmen_list_create(sizeof(carmen_roadmap_pair_t), 
+					     10*MAX_NUM_VERTICES);
+  first_pair = roadmap->edge_costs->length;
+
+  for (id = first_id; id < roadmap->nodes->length; id++) 
+    for (i = 0; i < roadmap->nodes->length; i++) {
+      /* pairs among new nodes are collected once, from the lower id */
+      if (i == id || (i >= first_id && i < id))
+	continue;
+      if (hypot(node_list[i].x - node_list[id].x, 
+		node_list[i].y - node_list[id].y) < 50) {
+	pair.parent = id;
+	pair.node = i;
+	pair.cost = 1e6;
+	carmen_list_add(roadmap->edge_costs, &pair);
       }
-    }    
-  }
-  
-  return (node_list[id].edges->length);
+    }
+
+  num = roadmap->edge_costs->length - first_pair;
+  if (num == 0)
+    return;
+
+  which = (int *)calloc(num, sizeof(int));
+  carmen_test_alloc(which);
+  for (k = 0; k < num; k++)
+    which[k] = first_pair + k;
+  compute_pair_costs(roadmap, which, num);
+  free(which);
+
+  add_pair_edges(roadmap, first_pair);
 }
 
 void carmen_roadmap_add_node(carmen_roadmap_t *roadmap, int x, int y)
@@ -355,20 +442,226 @@ void carmen_roadmap_add_node(carmen_roadmap_t *roadmap, int x, int y)
   construct_edges(roadmap, roadmap->nodes->length-1);
 }
 
+static int **alloc_grid(int x_size, int y_size)
+{
+  int **grid;
+  int x;
+
+  grid = (int **)calloc(x_size, sizeof(int *));
+  carmen_test_alloc(grid);
+  grid[0] = (int *)calloc(x_size*y_size, sizeof(int));
+  carmen_test_alloc(grid[0]);
+  for (x = 1; x < x_size; x++)
+    grid[x] = grid[0] + x*y_size;
+
+  return grid;
+}
+
+static void free_grid(int **grid)
+{
+  free(grid[0]);
+  free(grid);
+}
+
+/* Clearance of every cell: 1 on obstacles and on the map border,
+   otherwise one more than the city block distance to the nearest
+   obstacle inside the border (0 if there is none). Two raster passes
+   over the interior give exactly what growing the obstacles one
+   4-neighbourhood ring at a time used to give. */
+static void compute_clearance(carmen_map_p c_space, int **grid)
+{
+  int x, y;
+  int x_size = c_space->config.x_size, y_size = c_space->config.y_size;
+
+  for (x = 0; x < x_size; x++)
+    for (y = 0; y < y_size; y++) {
+      if (x == 0 || y == 0 || x == x_size-1 || y == y_size-1 || 
+	  c_space->map[x][y] > 0.001 || c_space->map[x][y] < 0) 
+	grid[x][y] = 1;
+      else
+	grid[x][y] = INT_MAX/2;
+    }
+
+  /* the border does not grow, so only interior neighbours count */
+  for (x = 1; x < x_size-1; x++)
+    for (y = 1; y < y_size-1; y++) {
+      if (x > 1)
+	grid[x][y] = carmen_imin(grid[x][y], grid[x-1][y]+1);
+      if (y > 1)
+	grid[x][y] = carmen_imin(grid[x][y], grid[x][y-1]+1);
+    }
+
+  for (x = x_size-2; x > 0; x--)
+    for (y = y_size-2; y > 0; y--) {
+      if (x < x_size-2)
+	grid[x][y] = carmen_imin(grid[x][y], grid[x+1][y]+1);
+      if (y < y_size-2)
+	grid[x][y] = carmen_imin(grid[x][y], grid[x][y+1]+1);
+    }
+
+  for (x = 1; x < x_size-1; x++)
+    for (y = 1; y < y_size-1; y++) 
+      if (grid[x][y] >= INT_MAX/2)
+	grid[x][y] = 0;
+}
+
+/* Turns a copy of the occupancy map into the c-space cost map, leaving
+   the clearance it was derived from in grid. */
+static void build_c_space(carmen_map_p c_space, int **grid)
+{
+  int x, y;
+
+  compute_clearance(c_space, grid);
+
+  for (x = 0; x < c_space->config.x_size; x++)
+    for (y = 0; y < c_space->config.y_size; y++) {      
+      if (x == 0 || x == c_space->config.x_size-1 || 
+	  y == 0 || y == c_space->config.y_size-1) 
+	c_space->map[x][y] = 1e6;
+      else if (grid[x][y] < 3) 
+	c_space->map[x][y] = 1e6;
+      else if (grid[x][y] < 6) 
+	c_space->map[x][y] = (6-grid[x][y])*100000;
+      else
+	c_space->map[x][y] = 1;
+    }
+}
+
+/* Rebuilds the c-space from new_map in place and records which cells
+   changed. Returns the number of changed cells, or -1 if the map
+   geometry differs and the roadmap must be initialized again. */
+int carmen_roadmap_update_c_space(carmen_map_p c_space, carmen_map_p new_map,
+				  carmen_roadmap_changes_t *changes)
+{
+  carmen_map_p new_c_space;
+  int **grid;
+  int x, y, index;
+
+  memset(changes, 0, sizeof(carmen_roadmap_changes_t));
+
+  if (new_map->config.x_size != c_space->config.x_size ||
+      new_map->config.y_size != c_space->config.y_size ||
+      new_map->config.resolution != c_space->config.resolution)
+    return -1;
+
+  new_c_space = carmen_map_copy(new_map);
+  grid = alloc_grid(new_c_space->config.x_size, new_c_space->config.y_size);
+  build_c_space(new_c_space, grid);
+  free_grid(grid);
+
+  changes->x_size = c_space->config.x_size;
+  changes->y_size = c_space->config.y_size;
+  changes->cells = (unsigned char *)calloc(changes->x_size*changes->y_size, 
+					   sizeof(unsigned char));
+  carmen_test_alloc(changes->cells);
+  changes->min_x = changes->x_size;
+  changes->min_y = changes->y_size;
+  changes->max_x = -1;
+  changes->max_y = -1;
+
+  for (x = 0; x < changes->x_size; x++)
+    for (y = 0; y < changes->y_size; y++) {
+      if (new_c_space->map[x][y] == c_space->map[x][y])
+	continue;
+      index = x*changes->y_size + y;
+      changes->cells[index] = 1;
+      changes->num_changed++;
+      changes->min_x = carmen_imin(changes->min_x, x);
+      changes->min_y = carmen_imin(changes->min_y, y);
+      changes->max_x = carmen_imax(changes->max_x, x);
+      changes->max_y = carmen_imax(changes->max_y, y);
+      c_space->map[x][y] = new_c_space->map[x][y];
+    }
+
+  carmen_map_destroy(&new_c_space);
+
+  return changes->num_changed;
+}
+
+void carmen_roadmap_free_changes(carmen_roadmap_changes_t *changes)
+{
+  if (changes->cells != NULL)
+    free(changes->cells);
+  changes->cells = NULL;
+  changes->num_changed = 0;
+}
+
+static int pair_crosses_changes(carmen_roadmap_vertex_t *n1, 
+				carmen_roadmap_vertex_t *n2,
+				carmen_roadmap_changes_t *changes)
+{
+  carmen_bresenham_param_t params;
+  int x, y;
+
+  if (carmen_imax(n1->x, n2->x) < changes->min_x ||
+      carmen_imin(n1->x, n2->x) > changes->max_x ||
+      carmen_imax(n1->y, n2->y) < changes->min_y ||
+      carmen_imin(n1->y, n2->y) > changes->max_y)
+    return 0;
+
+  carmen_get_bresenham_parameters(n1->x, n1->y, n2->x, n2->y, &params);
+  do {
+    carmen_get_current_point(&params, &x, &y);
+    if (x >= 0 && x < changes->x_size && y >= 0 && y < changes->y_size &&
+	changes->cells[x*changes->y_size + y])
+      return 1;
+  } while (carmen_get_next_point(&params));
+
+  return 0;
+}
+
+/* Recosts the cached pairs whose line crosses a changed cell, rebuilds
+   the edge lists from the cache and replans to the current goal. */
+void carmen_roadmap_update_edges(carmen_roadmap_t *roadmap, 
+				 carmen_roadmap_changes_t *changes)
+{
+  carmen_roadmap_vertex_t *node_list;
+  carmen_roadmap_pair_t *pairs;
+  int *which;
+  int i, k, num;
+
+  if (roadmap->edge_costs == NULL || changes->num_changed == 0)
+    return;
+
+  node_list = (carmen_roadmap_vertex_t *)(roadmap->nodes->list);
+  pairs = (carmen_roadmap_pair_t *)(roadmap->edge_costs->list);
+
+  which = (int *)calloc(roadmap->edge_costs->length + 1, sizeof(int));
+  carmen_test_alloc(which);
+  num = 0;
+  for (k = 0; k < roadmap->edge_costs->length; k++) 
+    if (pair_crosses_changes(node_list+pairs[k].parent, 
+			     node_list+pairs[k].node, changes))
+      which[num++] = k;
+
+  carmen_warn("Map update: %d changed cells, recomputing %d of %d edges\n",
+	      changes->num_changed, num, roadmap->edge_costs->length);
+
+  if (num > 0)
+    compute_pair_costs(roadmap, which, num);
+  free(which);
+
+  /* edge indices change, so blocked marks refer to the old lists */
+  carmen_dynamics_clear_all_blocked(roadmap);
+  for (i = 0; i < roadmap->nodes->length; i++) 
+    node_list[i].edges->length = 0;
+  add_pair_edges(roadmap, 0);
+
+  if (roadmap->goal_id >= 0)
+    dynamic_program(roadmap);
+}
+
 carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
 {
   int x, y, i;
   int **grid, *grid_ptr, **sample_grid;
-  int progress;
   int size;
-  int growth_counter;
   int x_offset[8] = {1, 1, 0, -1, -1, -1, 0, 1};
   int y_offset[8] = {0, 1, 1, 1, 0, -1, -1, -1};  
   int total;
   int sample;
   int random_value;
   int max_label;
-  int num_edges;
 
   carmen_roadmap_t *roadmap;
   carmen_map_p c_space;
@@ -380,50 +673,10 @@ carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
 				 MAX_NUM_VERTICES);
 
   size = c_space->config.x_size*c_space->config.y_size;
-  grid = (int **)calloc(c_space->config.x_size, sizeof(int *));
-  carmen_test_alloc(grid);
-  grid[0] = (int *)calloc(size, sizeof(int));
-  carmen_test_alloc(grid[0]);
-  for (x = 1; x < c_space->config.x_size; x++)
-    grid[x] = grid[0] + x*c_space->config.y_size;
-
-  sample_grid = (int **)calloc(c_space->config.x_size, sizeof(int *));
-  carmen_test_alloc(sample_grid);
-  sample_grid[0] = (int *)calloc(size, sizeof(int));
-  carmen_test_alloc(sample_grid);
-  for (x = 1; x < c_space->config.x_size; x++)
-    sample_grid[x] = sample_grid[0] + x*c_space->config.y_size;
-
-  grid_ptr = grid[0];
-  for (i = 0; i < size; i++)
-    *(grid_ptr++) = 0;
-  for (x = 0; x < c_space->config.x_size; x++)
-    for (y = 0; y < c_space->config.y_size; y++) {
-      if (x == 0 || y == 0 || x == c_space->config.x_size-1 ||
-	  y == c_space->config.y_size-1 || 
-	  c_space->map[x][y] > 0.001 || c_space->map[x][y] < 0) {
-	grid[x][y] = 1;
-	c_space->map[x][y] = 1;
-      }
-    }
-  growth_counter = 1;
+  grid = alloc_grid(c_space->config.x_size, c_space->config.y_size);
+  sample_grid = alloc_grid(c_space->config.x_size, c_space->config.y_size);
 
-  do {
-    progress = 0;    
-    for (x = 1; x < c_space->config.x_size-1; x++)
-      for (y = 1; y < c_space->config.y_size-1; y++) {	
-	if (grid[x][y] == growth_counter) {
-	  for (i = 0; i < 8; i+=2) {
-	    if (grid[x+x_offset[i]][y+y_offset[i]] == 0) {
-	      grid[x+x_offset[i]][y+y_offset[i]] = growth_counter+1;
-	      c_space->map[x][y] = growth_counter+1;
-	    }
-	    progress = 1;
-	  }
-	}
-      }
-    growth_counter++;
-  } while (progress);
+  build_c_space(c_space, grid);
   
   total = 0;
   for (x = 0; x < c_space->config.x_size; x++)
@@ -431,18 +684,9 @@ carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
       if (x == 0 || x == c_space->config.x_size-1 || 
 	  y == 0 || y == c_space->config.y_size-1) {
 	sample_grid[x][y] = total;
-	c_space->map[x][y] = 1e6;
 	continue;
       }
 
-      if (grid[x][y] < 6) {
-	if (grid[x][y] < 3) 
-	  c_space->map[x][y] = 1e6;
-	else
-	  c_space->map[x][y] = (6-grid[x][y])*100000;
-      } else
-	c_space->map[x][y] = 1;
-
       if (grid[x][y] < 6) {
 	sample_grid[x][y] = total;
 	assert (c_space->map[x][y] > 1);
@@ -473,9 +717,6 @@ carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
       }
       total++;
       sample_grid[x][y] = total;
-      //      if (grid[x][y] < 9) 
-      //	c_space->map[x][y] = (9-grid[x][y])*1e3;
-      //      else
     }  
 
   max_label = 0;
@@ -511,11 +752,8 @@ carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
   add_node(node_list, 600, 141);
   add_node(node_list, 550, 141);
 
-  free(grid[0]);
-  free(grid);
-
-  free(sample_grid[0]);
-  free(sample_grid);
+  free_grid(grid);
+  free_grid(sample_grid);
 
   roadmap = (carmen_roadmap_t *)calloc(1, sizeof(carmen_roadmap_t));
   carmen_test_alloc(roadmap);
@@ -539,8 +777,7 @@ carmen_roadmap_t *carmen_roadmap_initialize(carmen_map_p new_map)
 		roadmap->max_r_vel);
   }
 
-  for (i = 0; i < node_list->length; i++) 
-    num_edges = construct_edges(roadmap, i);
+  construct_edges(roadmap, 0);
 
   return roadmap;
 }
@@ -549,7 +786,6 @@ carmen_roadmap_t *carmen_roadmap_copy(carmen_roadmap_t *roadmap)
 {
   carmen_roadmap_t *new_roadmap;
   carmen_roadmap_vertex_t *node;
-  int num_edges;
   int i;
 
   new_roadmap = (carmen_roadmap_t *)calloc(1, sizeof(carmen_roadmap_t));
@@ -561,7 +797,15 @@ carmen_roadmap_t *carmen_roadmap_copy(carmen_roadmap_t *roadmap)
   for (i = 0; i < new_roadmap->nodes->length; i++) {
     node = (carmen_roadmap_vertex_t *)carmen_list_get(new_roadmap->nodes, i);
     node->edges = carmen_list_create(sizeof(carmen_roadmap_edge_t), 10);
-    num_edges = construct_edges(new_roadmap, i);
+  }
+
+  /* same nodes on the same c-space: the cached costs still hold */
+  if (roadmap->edge_costs != NULL) {
+    new_roadmap->edge_costs = carmen_list_duplicate(roadmap->edge_costs);
+    add_pair_edges(new_roadmap, 0);
+  } else {
+    new_roadmap->edge_costs = NULL;
+    construct_edges(new_roadmap, 0);
   }
 
   new_roadmap->path = NULL;
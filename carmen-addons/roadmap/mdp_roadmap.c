@@ -136,6 +136,27 @@ carmen_roadmap_mdp_t *carmen_roadmap_mdp_initialize(carmen_map_t *map)
   return roadmap;
 }
 
+/* Brings both roadmaps up to date with a changed map, recomputing
+   only the edges that cross changed cells. Returns -1 if the map
+   geometry changed and the roadmap has to be rebuilt. */
+int carmen_roadmap_mdp_update_map(carmen_roadmap_mdp_t *roadmap, 
+				  carmen_map_t *map)
+{
+  carmen_roadmap_changes_t changes;
+
+  if (carmen_roadmap_update_c_space(roadmap->c_space, map, &changes) < 0)
+    return -1;
+
+  if (changes.num_changed > 0) {
+    carmen_roadmap_update_edges(roadmap->roadmap, &changes);
+    carmen_roadmap_update_edges(roadmap->roadmap_without_people, &changes);
+  }
+  carmen_roadmap_free_changes(&changes);
+  roadmap->current_roadmap = NULL;
+
+  return 0;
+}
+
 void carmen_roadmap_mdp_plan(carmen_roadmap_mdp_t *roadmap, 
 			     carmen_world_point_t *goal)
 {
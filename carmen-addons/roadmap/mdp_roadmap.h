@@ -14,6 +14,8 @@ typedef struct {
 } carmen_roadmap_mdp_t;
 
 carmen_roadmap_mdp_t *carmen_roadmap_mdp_initialize(carmen_map_t *map);
+int carmen_roadmap_mdp_update_map(carmen_roadmap_mdp_t *roadmap, 
+				  carmen_map_t *map);
 
 int carmen_roadmap_mdp_num_nodes(carmen_roadmap_mdp_t *roadmap);
 carmen_roadmap_vertex_t *carmen_roadmap_mdp_get_nodes
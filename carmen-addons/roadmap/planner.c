@@ -78,7 +78,8 @@ void carmen_planner_set_map(carmen_map_p new_map)
 
   carmen_verbose("Initialized with map\n");
 
-  roadmap = carmen_roadmap_mdp_initialize(new_map);
+  if (roadmap == NULL || carmen_roadmap_mdp_update_map(roadmap, new_map) < 0)
+    roadmap = carmen_roadmap_mdp_initialize(new_map);
 
   carmen_param_set_module("robot");
   carmen_param_get_double("max_t_vel", &max_t_vel);
@@ -48,8 +48,24 @@ typedef struct {
   int blocked;
 } carmen_roadmap_edge_t;
 
+/* Cached cost of a candidate edge between two nearby nodes, including
+   candidates that turned out to be blocked (cost >= 1e6). */
+typedef struct {
+  int parent, node;
+  double cost;
+} carmen_roadmap_pair_t;
+
+/* Cells of the c-space changed by a map update. */
+typedef struct {
+  unsigned char *cells;
+  int x_size, y_size;
+  int min_x, min_y, max_x, max_y;
+  int num_changed;
+} carmen_roadmap_changes_t;
+
 typedef struct {
   carmen_list_t *nodes;
+  carmen_list_t *edge_costs;
   int goal_id;
   carmen_map_p c_space;
   carmen_list_t *path;
@@ -87,6 +103,12 @@ void carmen_roadmap_add_node(carmen_roadmap_t *roadmap, int x, int y);
 void carmen_roadmap_repair(carmen_list_t *new_nodes, 
 			   carmen_roadmap_t *roadmap);
 
+int carmen_roadmap_update_c_space(carmen_map_p c_space, carmen_map_p new_map,
+				  carmen_roadmap_changes_t *changes);
+void carmen_roadmap_update_edges(carmen_roadmap_t *roadmap, 
+				 carmen_roadmap_changes_t *changes);
+void carmen_roadmap_free_changes(carmen_roadmap_changes_t *changes);
+
 void carmen_roadmap_refine_get_radius(double vx, double vy, double vxy, 
 				      double *radius);
 
@@ -1,4 +1,5 @@
 #include "cpp_logfile.h"
+#include <pthread.h>
 
 
 LogFile::LogFile() : Collection() {
@@ -18,7 +19,7 @@ LogFile::LogFile(const LogFile& x) : Collection() {
 LogFile::~LogFile() {
 }
 
-bool LogFile::load(const char* filename, bool verbose) {
+bool LogFile::load(const char* filename, bool verbose, int filter) {
   char line[100000];
 
   carmen_FILE *logfile = NULL;
@@ -40,41 +41,60 @@ bool LogFile::load(const char* filename, bool verbose) {
     carmen_logfile_read_line(logfile_index, logfile, i, 100000, line);
 
     /* create messages */
-    if(strncmp(line, "ODOM ", 5) == 0) {
-      push_back(new OdometryMessage(line));
-    }
-    else if(strncmp(line, "RAWLASER", 8) == 0) {
-      push_back(new LaserMessage(line));
-    }
-    else if(strncmp(line, "ROBOTLASER", 10) == 0) {
-      push_back(new RobotLaserMessage(line));
-    }
-    else if(strncmp(line, "FLASER ", 7) == 0) {
-      push_back(new RobotLaserMessage(line));
-    }
-    else if(strncmp(line, "RLASER ", 7) == 0) {
-      push_back(new RobotLaserMessage(line));
-    }
-    else if(strncmp(line, "TRUEPOS ", 8) == 0) {
-      push_back(new TrueposMessage(line));
-    }
-    else if(strncmp(line, "IMU ", 4) == 0) {
-      push_back(new IMUMessage(line));
-    }
-    else if(strncmp(line, "SCANMARK ", 9) == 0) {
-      push_back(new ScanmarkMessage(line));
-    }
-    else if(strncmp(line, "POSITIONLASER ", 14) == 0) {
-      push_back(new LaserposMessage(line));
-    }
-    else if(strlen(line) > 1) {
-      push_back(new UnknownMessage(line));
-    }
+    if (messageType(line) & filter) 
+      push_back(parseMessage(line));
   }
+  carmen_logfile_free_index(&logfile_index);
   carmen_fclose(logfile);  
   return true;
 }
 
+int LogFile::messageType(const char* line) {
+  if(strncmp(line, "ODOM ", 5) == 0) 
+    return LOGFILE_ODOM;
+  else if(strncmp(line, "RAWLASER", 8) == 0) 
+    return LOGFILE_RAWLASER;
+  else if(strncmp(line, "ROBOTLASER", 10) == 0) 
+    return LOGFILE_ROBOTLASER;
+  else if(strncmp(line, "FLASER ", 7) == 0) 
+    return LOGFILE_ROBOTLASER;
+  else if(strncmp(line, "RLASER ", 7) == 0) 
+    return LOGFILE_ROBOTLASER;
+  else if(strncmp(line, "TRUEPOS ", 8) == 0) 
+    return LOGFILE_TRUEPOS;
+  else if(strncmp(line, "IMU ", 4) == 0) 
+    return LOGFILE_IMU;
+  else if(strncmp(line, "SCANMARK ", 9) == 0) 
+    return LOGFILE_SCANMARK;
+  else if(strncmp(line, "POSITIONLASER ", 14) == 0) 
+    return LOGFILE_POSITIONLASER;
+  else if(strlen(line) > 1) 
+    return LOGFILE_UNKNOWN;
+  return LOGFILE_NONE;
+}
+
+AbstractMessage* LogFile::parseMessage(char* line) {
+  switch (messageType(line)) {
+  case LOGFILE_ODOM:
+    return new OdometryMessage(line);
+  case LOGFILE_RAWLASER:
+    return new LaserMessage(line);
+  case LOGFILE_ROBOTLASER:
+    return new RobotLaserMessage(line);
+  case LOGFILE_TRUEPOS:
+    return new TrueposMessage(line);
+  case LOGFILE_IMU:
+    return new IMUMessage(line);
+  case LOGFILE_SCANMARK:
+    return new ScanmarkMessage(line);
+  case LOGFILE_POSITIONLASER:
+    return new LaserposMessage(line);
+  case LOGFILE_UNKNOWN:
+    return new UnknownMessage(line);
+  }
+  return NULL;
+}
+
 bool LogFile::save(const char* filename, bool verbose) const {
   
   carmen_FILE *logfile = NULL;
@@ -99,3 +119,211 @@ bool LogFile::save(const char* filename, bool verbose) const {
 }
 
 
+
+
+typedef struct {
+  std::vector< std::vector<char> >* lines;
+  std::vector<AbstractMessage*>* messages;
+  int begin;
+  int end;
+} LogFileParseJob;
+
+static void* logfile_parse_job(void* arg) {
+  LogFileParseJob* job = (LogFileParseJob*) arg;
+  for (int i = job->begin; i < job->end; i++)
+    (*job->messages)[i] = LogFile::parseMessage(&(*job->lines)[i][0]);
+  return NULL;
+}
+
+
+LogFileReader::LogFileReader(int filter, int bufferSize, int numThreads) {
+  m_file = NULL;
+  m_index = NULL;
+  m_nextLine = 0;
+  m_currentLine = -1;
+  m_current = NULL;
+  m_Filter = filter;
+  m_BufferSize = 1;
+  m_NumThreads = 1;
+  setBufferSize(bufferSize);
+  setNumThreads(numThreads);
+}
+
+LogFileReader::LogFileReader(const char* filename, int filter) {
+  m_file = NULL;
+  m_index = NULL;
+  m_nextLine = 0;
+  m_currentLine = -1;
+  m_current = NULL;
+  m_Filter = filter;
+  m_BufferSize = 1;
+  m_NumThreads = 1;
+  setBufferSize(1000);
+  open(filename);
+}
+
+LogFileReader::~LogFileReader() {
+  close();
+}
+
+void LogFileReader::setBufferSize(int n) {
+  if (n < 1)
+    n = 1;
+  m_BufferSize = n;
+  m_chunk.resize(n);
+  m_chunkLines.resize(n);
+}
+
+void LogFileReader::setNumThreads(int n) {
+  if (n < 1)
+    n = 1;
+  m_NumThreads = n;
+}
+
+bool LogFileReader::open(const char* filename, bool verbose) {
+  close();
+
+  m_file = carmen_fopen(filename, "r");
+  if (m_file == NULL) {
+    if (verbose)
+      carmen_warn("Error: could not open file %s for reading.\n", filename);
+    return false;
+  }
+  m_index = carmen_logfile_index_messages(m_file);
+  rewind();
+  return true;
+}
+
+void LogFileReader::close() {
+  clearBuffer();
+  if (m_index != NULL)
+    carmen_logfile_free_index(&m_index);
+  if (m_file != NULL) {
+    carmen_fclose(m_file);
+    m_file = NULL;
+  }
+  m_nextLine = 0;
+}
+
+bool LogFileReader::isOpen() const {
+  return m_index != NULL;
+}
+
+int LogFileReader::numLines() const {
+  if (m_index == NULL)
+    return 0;
+  return m_index->num_messages;
+}
+
+AbstractMessage* LogFileReader::read(int i) {
+  if (m_index == NULL || i < 0 || i >= m_index->num_messages)
+    return NULL;
+
+  int len = m_index->offset[i+1] - m_index->offset[i];
+  m_line.resize(len + 1);
+  carmen_logfile_read_line(m_index, m_file, i, len + 1, &m_line[0]);
+
+  if (!(LogFile::messageType(&m_line[0]) & m_Filter))
+    return NULL;
+  return LogFile::parseMessage(&m_line[0]);
+}
+
+void LogFileReader::fill() {
+  int n = 0;
+
+  /* read the raw lines of the next chunk, dropping filtered lines
+     before they are parsed */
+  while (n < m_BufferSize && m_nextLine < m_index->num_messages) {
+    int len = m_index->offset[m_nextLine+1] - m_index->offset[m_nextLine];
+    std::vector<char>& line = m_chunk[n];
+    line.resize(len + 1);
+    carmen_logfile_read_line(m_index, m_file, m_nextLine, len + 1, &line[0]);
+    if (LogFile::messageType(&line[0]) & m_Filter) {
+      m_chunkLines[n] = m_nextLine;
+      n++;
+    }
+    m_nextLine++;
+  }
+  if (n == 0)
+    return;
+
+  std::vector<AbstractMessage*> messages(n, (AbstractMessage*) NULL);
+  int threads = carmen_imin(m_NumThreads, n);
+
+  if (threads <= 1) {
+    for (int i = 0; i < n; i++)
+      messages[i] = LogFile::parseMessage(&m_chunk[i][0]);
+  }
+  else {
+    std::vector<pthread_t> tids(threads);
+    std::vector<LogFileParseJob> jobs(threads);
+    for (int t = 0; t < threads; t++) {
+      jobs[t].lines = &m_chunk;
+      jobs[t].messages = &messages;
+      jobs[t].begin = t * n / threads;
+      jobs[t].end = (t + 1) * n / threads;
+      if (pthread_create(&tids[t], NULL, logfile_parse_job, &jobs[t]) != 0) 
+	carmen_die("Error: could not create log file parser thread.\n");
+    }
+    for (int t = 0; t < threads; t++)
+      pthread_join(tids[t], NULL);
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (messages[i] != NULL) {
+      m_buffer.push_back(messages[i]);
+      m_bufferLines.push_back(m_chunkLines[i]);
+    }
+  }
+}
+
+AbstractMessage* LogFileReader::take() {
+  if (m_current != NULL) {
+    delete m_current;
+    m_current = NULL;
+  }
+  if (eof())
+    return NULL;
+
+  AbstractMessage* msg = m_buffer.front();
+  m_currentLine = m_bufferLines.front();
+  m_buffer.pop_front();
+  m_bufferLines.pop_front();
+  return msg;
+}
+
+AbstractMessage* LogFileReader::next() {
+  AbstractMessage* msg = take();
+  m_current = msg;
+  return msg;
+}
+
+bool LogFileReader::eof() {
+  if (m_index == NULL)
+    return true;
+  while (m_buffer.empty() && m_nextLine < m_index->num_messages)
+    fill();
+  return m_buffer.empty();
+}
+
+void LogFileReader::rewind() {
+  clearBuffer();
+  m_nextLine = 0;
+}
+
+int LogFileReader::currentLine() const {
+  return m_currentLine;
+}
+
+void LogFileReader::clearBuffer() {
+  if (m_current != NULL) {
+    delete m_current;
+    m_current = NULL;
+  }
+  for (std::deque<AbstractMessage*>::iterator it = m_buffer.begin();
+       it != m_buffer.end(); ++it)
+    delete *it;
+  m_buffer.clear();
+  m_bufferLines.clear();
+  m_currentLine = -1;
+}
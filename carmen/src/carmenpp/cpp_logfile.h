@@ -2,6 +2,7 @@
 #define CARMEN_CPP_LOGFILE_H
 
 #include <list>
+#include <deque>
 #include <vector>
 #include <carmen/cpp_global.h>
 #include <carmen/cpp_abstractmessage.h>
@@ -15,6 +16,20 @@
 
 typedef  std::vector<AbstractMessage*> Carmen_Cpp_LogFile_Collection;
 
+/** Message type bits used to filter log file lines before parsing. **/
+enum LogFileMessageType {
+  LOGFILE_NONE          = 0x00,
+  LOGFILE_ODOM          = 0x01,
+  LOGFILE_RAWLASER      = 0x02,
+  LOGFILE_ROBOTLASER    = 0x04,  /**< ROBOTLASER, FLASER and RLASER **/
+  LOGFILE_TRUEPOS       = 0x08,
+  LOGFILE_IMU           = 0x10,
+  LOGFILE_SCANMARK      = 0x20,
+  LOGFILE_POSITIONLASER = 0x40,
+  LOGFILE_UNKNOWN       = 0x80,
+  LOGFILE_ALL           = 0xff
+};
+
 class LogFile : public Carmen_Cpp_LogFile_Collection {
  public:
   LogFile();
@@ -22,11 +37,86 @@ class LogFile : public Carmen_Cpp_LogFile_Collection {
   LogFile(const char* filename);
   virtual ~LogFile();
 
-  bool load(const char* filename, bool verbose = true);
+  bool load(const char* filename, bool verbose = true,
+	    int filter = LOGFILE_ALL);
   bool save(const char* filename, bool verbose = true) const;
 
+  /** Classifies a log file line by its keyword without parsing it.
+   * Returns LOGFILE_NONE for empty lines. **/
+  static int messageType(const char* line);
+
+  /** Parses a log file line into a newly allocated message, or NULL
+   * if the line is empty. **/
+  static AbstractMessage* parseMessage(char* line);
+
  public:
   typedef Carmen_Cpp_LogFile_Collection Collection;
 };
 
+/** Reads a log file incrementally. Only the line index is kept in
+ * memory; messages are parsed on demand, either one at a time through
+ * random access or in bounded chunks while iterating forward. Lines
+ * that do not match the filter are skipped without being parsed. **/
+class LogFileReader {
+ public:
+  LogFileReader(int filter = LOGFILE_ALL, int bufferSize = 1000,
+		int numThreads = 1);
+  LogFileReader(const char* filename, int filter = LOGFILE_ALL);
+  virtual ~LogFileReader();
+
+  bool open(const char* filename, bool verbose = true);
+  void close();
+  bool isOpen() const;
+
+  /** Number of indexed lines (not filtered messages). **/
+  int numLines() const;
+
+  /** Random access: parses line i regardless of the forward position.
+   * Returns a new message owned by the caller, or NULL if the line is
+   * empty or rejected by the filter. **/
+  AbstractMessage* read(int i);
+
+  /** Forward iteration: returns the next message passing the filter,
+   * or NULL at the end of the file. The message is owned by the
+   * reader and stays valid until the following call to next(). **/
+  AbstractMessage* next();
+
+  /** Like next(), but the caller takes ownership of the message. **/
+  AbstractMessage* take();
+
+  bool eof();
+  void rewind();
+
+  /** Line number of the message last returned by next()/take(). **/
+  int currentLine() const;
+
+  DEFAULT_PARAM_SET_GET(int, Filter);
+  PARAM_GET(int, BufferSize, protected, public);
+  PARAM_GET(int, NumThreads, protected, public);
+
+ public:
+  void setBufferSize(int n);
+  void setNumThreads(int n);
+
+ protected:
+  void fill();
+  void clearBuffer();
+
+  carmen_FILE* m_file;
+  carmen_logfile_index_p m_index;
+  int m_nextLine;
+  int m_currentLine;
+  AbstractMessage* m_current;
+
+  std::vector<char> m_line;
+  std::vector< std::vector<char> > m_chunk;
+  std::vector<int> m_chunkLines;
+  std::deque<AbstractMessage*> m_buffer;
+  std::deque<int> m_bufferLines;
+
+ private:
+  LogFileReader(const LogFileReader&);
+  LogFileReader& operator=(const LogFileReader&);
+};
+
 #endif
@@ -0,0 +1,43 @@
+#include <carmen/cpp_carmen.h>
+
+int main(int argc, char** argv) {
+
+  if (argc < 2)
+    carmen_die("SYNTAX: %s <carmen log file> [num threads]\n", argv[0]);
+
+  int num_threads = 1;
+  if (argc > 2)
+    num_threads = atoi(argv[2]);
+
+  /* only robot laser messages are parsed, everything else is skipped
+     while reading */
+  LogFileReader reader(LOGFILE_ROBOTLASER, 1000, num_threads);
+  if (!reader.open(argv[1]))
+    return 1;
+
+  int cnt_robotlaser = 0;
+  int cnt_readings = 0;
+  double sum_range = 0;
+  double time = carmen_get_time();
+
+  AbstractMessage* msg;
+  while ((msg = reader.next()) != NULL) {
+    RobotLaserMessage* laser = dynamic_cast<RobotLaserMessage*>(msg);
+    if (laser == NULL)
+      continue;
+    for (int i = 0; i < laser->getNumReadings(); i++)
+      sum_range += laser->getRange(i);
+    cnt_readings += laser->getNumReadings();
+    cnt_robotlaser++;
+  }
+  time = carmen_get_time() - time;
+
+  carmen_warn("\nThis file contains:\n");
+  carmen_warn(" # lines               : %d\n", reader.numLines());
+  carmen_warn(" # robotlaser messages : %d\n", cnt_robotlaser);
+  if (cnt_readings > 0)
+    carmen_warn(" mean range            : %f\n", sum_range / cnt_readings);
+  carmen_warn(" parsing time          : %.3f s\n", time);
+
+  return 0;
+}
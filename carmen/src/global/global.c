@@ -796,6 +796,11 @@ carmen_rotate_2d(double *x, double *y, double theta)
   *y = sin(theta)*x2 + cos(theta)*(*y);
 }
 
+/* seed and generation of the per-thread random states */
+static unsigned int random_seed = 0;
+static unsigned int random_next_stream = 0;
+static volatile unsigned int random_generation = 1;
+
 unsigned int
 carmen_generate_random_seed(void)
 {
@@ -808,7 +813,7 @@ carmen_generate_random_seed(void)
     carmen_warn("Could not open /dev/random for reading: %s\n"
                 "Using time ^ PID\n", strerror(errno));
     seed = time(NULL) ^ getpid();
-    srandom(seed);
+    carmen_set_random_seed(seed);
     return seed;
   }
 
@@ -817,13 +822,13 @@ carmen_generate_random_seed(void)
     carmen_warn("Could not read an int from /dev/random: %s\n"
                 "Using time ^ PID\n", strerror(errno));
     seed = time(NULL) ^ getpid();
-    srandom(seed);
+    carmen_set_random_seed(seed);
     return seed;
   }
 
   fclose(random_fp);
 
-  srandom(seed);
+  carmen_set_random_seed(seed);
 
   return seed;
 }
@@ -853,7 +858,7 @@ carmen_randomize(int *argc, char ***argv)
 	  memmove((*argv)+i, (*argv)+i+2, bytes_to_move);
 	}
 	(*argc) -= 2;	
-	srandom(seed);
+	carmen_set_random_seed(seed);
       }
       return seed;
     }
@@ -866,48 +871,164 @@ void
 carmen_set_random_seed(unsigned int seed)
 {
   srand(seed);
+  srandom(seed);
+
+  /* thread states reseed themselves on their next use */
+  random_seed = seed;
+  random_next_stream = 0;
+  __sync_fetch_and_add(&random_generation, 1);
+}
+
+int 
+carmen_int_random(int max)
+{
+  return carmen_int_random_r(carmen_random_thread_state(), max);
+}
+
+double 
+carmen_uniform_random(double min, double max)
+{
+  return carmen_uniform_random_r(carmen_random_thread_state(), min, max);
 }
 
-/*
-	From the rand(3) man page:
+double 
+carmen_gaussian_random(double mean, double std)
+{
+  return carmen_gaussian_random_r(carmen_random_thread_state(), mean, std);
+} 
+
+/* splitmix64, used to expand a 32 bit seed into the generator state */
+static unsigned long long
+random_splitmix(unsigned long long *x)
+{
+  unsigned long long z;
+
+  z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void
+carmen_random_seed_state(carmen_random_state_t *state, unsigned int seed,
+			 unsigned int stream)
+{
+  unsigned long long x;
+  int i;
+
+  x = ((unsigned long long)stream << 32) | seed;
+  for (i = 0; i < 4; i++)
+    state->s[i] = random_splitmix(&x);
+  state->spare = 0.0;
+  state->has_spare = 0;
+}
+
+carmen_random_state_t *
+carmen_random_thread_state(void)
+{
+  static __thread carmen_random_state_t state;
+  unsigned int generation, stream;
+
+  generation = random_generation;
+  if (state.generation != generation) {
+    stream = __sync_fetch_and_add(&random_next_stream, 1);
+    carmen_random_seed_state(&state, random_seed, stream);
+    state.generation = generation;
+  }
+  return &state;
+}
 
-	In Numerical Recipes in C: The Art of Scientific Computing 
-	(William H. Press, Brian P.  Flannery, Saul A. Teukolsky, 
-	William T. Vetterling; New York: Cambridge University Press, 
-	1992 (2nd ed., p. 277)), the following comments are made:
-	"If you want to generate a random integer  between  1  and  10,  
-	you  should always do it by using high-order bits, as in
+static inline unsigned long long
+random_rotl(unsigned long long x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
 
-        j=1+(int) (10.0*rand()/(RAND_MAX+1.0));
+unsigned long long
+carmen_random_next(carmen_random_state_t *state)
+{
+  unsigned long long *s = state->s;
+  unsigned long long result, t;
 
-	and never by anything resembling
+  result = random_rotl(s[1] * 5, 7) * 9;
+  t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = random_rotl(s[3], 45);
 
-        j=1+(rand() % 10);
+  return result;
+}
 
-	(which uses lower-order bits)."
-*/
+/* uniform in [0, 1) from the top 53 bits */
+static inline double
+random_unit(carmen_random_state_t *state)
+{
+  return (carmen_random_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
 
 int 
-carmen_int_random(int max)
+carmen_int_random_r(carmen_random_state_t *state, int max)
 {
-  return (int)(max*(rand()/(RAND_MAX+1.0)));
+  return (int)(max * random_unit(state));
 }
 
 double 
-carmen_uniform_random(double min, double max)
+carmen_uniform_random_r(carmen_random_state_t *state, double min, double max)
 {
-  return min + (rand() / (double)RAND_MAX) * (max - min);
+  return min + random_unit(state) * (max - min);
 }
 
+/* Box-Muller; every other call returns the second sample of the pair */
 double 
-carmen_gaussian_random(double mean, double std)
+carmen_gaussian_random_r(carmen_random_state_t *state, double mean, double std)
 {
-  const double norm = 1.0 / (RAND_MAX + 1.0);
-  double u = 1.0 - rand() * norm;                  /* can't let u == 0 */
-  double v = rand() * norm;
-  double z = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
-  return mean + std * z;
-} 
+  double r, v;
+
+  if (state->has_spare) {
+    state->has_spare = 0;
+    return mean + std * state->spare;
+  }
+
+  r = sqrt(-2.0 * log(1.0 - random_unit(state)));  /* can't let u == 0 */
+  v = 2.0 * M_PI * random_unit(state);
+  state->spare = r * sin(v);
+  state->has_spare = 1;
+  return mean + std * r * cos(v);
+}
+
+void
+carmen_uniform_random_fill(carmen_random_state_t *state, double *samples, 
+			   int n, double min, double max)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    samples[i] = min + random_unit(state) * (max - min);
+}
+
+void
+carmen_gaussian_random_fill(carmen_random_state_t *state, double *samples, 
+			    int n, double mean, double std)
+{
+  double r, v;
+  int i = 0;
+
+  if (n > 0 && state->has_spare)
+    samples[i++] = carmen_gaussian_random_r(state, mean, std);
+
+  for (; i + 1 < n; i += 2) {
+    r = std * sqrt(-2.0 * log(1.0 - random_unit(state)));
+    v = 2.0 * M_PI * random_unit(state);
+    samples[i] = mean + r * cos(v);
+    samples[i + 1] = mean + r * sin(v);
+  }
+
+  if (i < n)
+    samples[i] = carmen_gaussian_random_r(state, mean, std);
+}
 
 int
 carmen_file_exists(const char *filename)
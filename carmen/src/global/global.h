@@ -415,6 +415,42 @@ int carmen_int_random(int max);
 double carmen_uniform_random(double min, double max);
 double carmen_gaussian_random(double mean, double std);
 
+/* xoshiro256** random number generator state.  Every thread gets its
+   own state (see carmen_random_thread_state()), seeded from the last
+   seed passed to carmen_set_random_seed() or carmen_randomize(), so
+   carmen_int_random(), carmen_uniform_random() and
+   carmen_gaussian_random() are thread-safe and reproducible.  Code that
+   runs one generator per worker can keep its own state and use the _r
+   functions directly. */
+
+typedef struct {
+  unsigned long long s[4];
+  double spare;
+  int has_spare;
+  unsigned int generation;
+} carmen_random_state_t;
+
+/* seeds state with stream number stream of seed; different streams of
+   the same seed give independent sequences */
+void carmen_random_seed_state(carmen_random_state_t *state, 
+			      unsigned int seed, unsigned int stream);
+
+/* state used by the calling thread */
+carmen_random_state_t *carmen_random_thread_state(void);
+
+unsigned long long carmen_random_next(carmen_random_state_t *state);
+int carmen_int_random_r(carmen_random_state_t *state, int max);
+double carmen_uniform_random_r(carmen_random_state_t *state, 
+			       double min, double max);
+double carmen_gaussian_random_r(carmen_random_state_t *state, 
+				double mean, double std);
+
+/* fills samples with n independent draws */
+void carmen_uniform_random_fill(carmen_random_state_t *state, double *samples,
+				int n, double min, double max);
+void carmen_gaussian_random_fill(carmen_random_state_t *state, double *samples,
+				 int n, double mean, double std);
+
 int carmen_file_exists(const char *filename);
 char *carmen_file_extension(const char *filename);
 char *carmen_file_find(const char *filename);
@@ -141,6 +141,9 @@ carmen_ipc_connect_locked(char *module_name)
   carmen_test_ipc_exit(err, "I had problems setting the IPC capacity. This is a "
 		    "very strange error and should never happen.\n", 
 		    "IPC_setCapacity");
+
+  /* let ipc_stats query the message counters of this module */
+  IPC_subscribeMsgStats();
   return 0;
 }
 
@@ -176,6 +179,9 @@ carmen_ipc_connect(char *module_name)
   carmen_test_ipc_exit(err, "I had problems setting the IPC capacity. This is a "
 		    "very strange error and should never happen.\n", 
 		    "IPC_setCapacity");
+
+  /* let ipc_stats query the message counters of this module */
+  IPC_subscribeMsgStats();
   return 0;
 }
 
@@ -205,6 +211,9 @@ carmen_ipc_connect_long(char *module_name, char *host, int port)
   carmen_test_ipc_exit(err, "I had problems setting the IPC capacity. This is a "
 		    "very strange error and should never happen.\n",
 		    "IPC_setCapacity");
+
+  /* let ipc_stats query the message counters of this module */
+  IPC_subscribeMsgStats();
   return 0;
 }
 
@@ -436,14 +445,23 @@ carmen_subscribe_message(char *message_name, char *message_fmt,
 
   if(infile == NULL) {
     err = IPC_subscribe(message_name, carmen_generic_handler, mark);
-    if(subscribe_how == CARMEN_SUBSCRIBE_LATEST)
-      IPC_setMsgQueueLength(message_name, 1);
-    else
-      IPC_setMsgQueueLength(message_name, 100);
+    carmen_ipc_set_queue_length(message_name, subscribe_how);
     carmen_test_ipc(err, "Could not subscribe", message_name);
   }
 }
 
+void
+carmen_ipc_set_queue_length(char *message_name, 
+			    carmen_subscribe_t subscribe_how)
+{
+  if(subscribe_how == CARMEN_SUBSCRIBE_LATEST)
+    IPC_setMsgQueueLength(message_name, 1);
+  else if(subscribe_how == CARMEN_SUBSCRIBE_LATEST_PER_PUBLISHER)
+    IPC_setMsgQueueLengthByPublisher(message_name, 1);
+  else
+    IPC_setMsgQueueLength(message_name, 100);
+}
+
 void
 carmen_unsubscribe_message(char *message_name, carmen_handler_t handler)
 {
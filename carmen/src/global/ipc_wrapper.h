@@ -46,9 +46,13 @@
 extern "C" {
 #endif
 
+  /* CARMEN_SUBSCRIBE_LATEST_PER_PUBLISHER keeps the latest message of
+     each publishing module (in practice, of each host) rather than only
+     the latest of all. */
 typedef enum {CARMEN_UNSUBSCRIBE, 
 	      CARMEN_SUBSCRIBE_LATEST, 
-	      CARMEN_SUBSCRIBE_ALL} carmen_subscribe_t;
+	      CARMEN_SUBSCRIBE_ALL,
+	      CARMEN_SUBSCRIBE_LATEST_PER_PUBLISHER} carmen_subscribe_t;
 
 typedef void (*carmen_handler_t)(void *);
 
@@ -65,6 +69,12 @@ carmen_subscribe_message(char *message_name, char *message_fmt,
 void
 carmen_unsubscribe_message(char *message_name, carmen_handler_t handler);
 
+  /** carmen_ipc_set_queue_length - limits how many messages central keeps
+     waiting for this module, as subscribe_how asks. **/
+void
+carmen_ipc_set_queue_length(char *message_name, 
+			    carmen_subscribe_t subscribe_how);
+
 void 
 carmen_ipc_subscribe_fd(int fd, carmen_handler_t handler);
 
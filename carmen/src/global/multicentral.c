@@ -28,6 +28,7 @@
 
 #include "global.h"
 #include <pthread.h>
+#include <poll.h>
 #include "ipc_wrapper.h"
 #include <carmen/param_interface.h>
 #include "multicentral.h"
@@ -290,23 +291,96 @@ void carmen_multicentral_reconnect_centrals(carmen_centrallist_p centrallist,
     }
 }
 
-void carmen_multicentral_ipc_sleep(carmen_centrallist_p centrallist, 
-				   double sleep_time)
+/* Most messages a central gets handled in one go, so that a flood on
+   one central cannot starve the others. */
+
+#define MAX_MESSAGES_PER_CENTRAL  100
+
+static int
+add_central_connections(carmen_centrallist_p centrallist, 
+			struct pollfd **fds, int **owner, int *max_fds)
 {
-  int i, count = 0;
+  fd_set connections;
+  int i, fd, num_fds = 0;
 
-  for(i = 0; i < centrallist->num_centrals; i++) 
-    if(centrallist->central[i].connected) 
-      count++;
-  
-  if(count == 0)
-    usleep((int)(sleep_time * 1e6));
-  else {
-    /* handle IPC messages for each central */
-    for(i = 0; i < centrallist->num_centrals; i++) 
-      if(centrallist->central[i].connected) {
-	IPC_setContext(centrallist->central[i].context);
-	carmen_ipc_sleep(sleep_time / count);
+  for(i = 0; i < centrallist->num_centrals; i++) {
+    if(!centrallist->central[i].connected)
+      continue;
+    IPC_setContext(centrallist->central[i].context);
+    connections = IPC_getConnections();
+    for(fd = 0; fd < FD_SETSIZE; fd++)
+      if(FD_ISSET(fd, &connections)) {
+	if(num_fds == *max_fds) {
+	  *max_fds = (*max_fds == 0) ? 16 : 2 * *max_fds;
+	  *fds = (struct pollfd *)realloc(*fds, *max_fds * 
+					  sizeof(struct pollfd));
+	  carmen_test_alloc(*fds);
+	  *owner = (int *)realloc(*owner, *max_fds * sizeof(int));
+	  carmen_test_alloc(*owner);
+	}
+	(*fds)[num_fds].fd = fd;
+	(*fds)[num_fds].events = POLLIN;
+	(*fds)[num_fds].revents = 0;
+	(*owner)[num_fds] = i;
+	num_fds++;
       }
   }
+  return num_fds;
+}
+
+/* Waits on the connections of every central at once and handles the
+   messages of whichever central has data as soon as it arrives, until
+   sleep_time has passed. */
+
+void carmen_multicentral_ipc_sleep(carmen_centrallist_p centrallist, 
+				   double sleep_time)
+{
+  static struct pollfd *fds = NULL;
+  static int *owner = NULL, max_fds = 0;
+  int i, j, num_fds, timeout, *handled;
+  double end_time, now;
+
+  handled = (int *)calloc(centrallist->num_centrals, sizeof(int));
+  carmen_test_alloc(handled);
+
+  /* a message may already be queued inside IPC, where poll cannot see
+     it, if it arrived while a handler waited for a reply */
+  for(i = 0; i < centrallist->num_centrals; i++)
+    if(centrallist->central[i].connected) {
+      IPC_setContext(centrallist->central[i].context);
+      for(j = 0; j < MAX_MESSAGES_PER_CENTRAL; j++)
+	if(IPC_handleMessage(0) != IPC_OK || 
+	   !centrallist->central[i].connected)
+	  break;
+    }
+
+  end_time = carmen_get_time() + sleep_time;
+  do {
+    num_fds = add_central_connections(centrallist, &fds, &owner, &max_fds);
+    now = carmen_get_time();
+    /* rounded up, so that less than a millisecond left still waits
+       rather than spinning on zero timeouts */
+    timeout = carmen_fmax(0, ceil((end_time - now) * 1000.0));
+    if(num_fds == 0) {
+      usleep(timeout * 1000);
+      break;
+    }
+    if(poll(fds, num_fds, timeout) <= 0)
+      continue;
+
+    memset(handled, 0, centrallist->num_centrals * sizeof(int));
+    for(i = 0; i < num_fds; i++) {
+      if(!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) ||
+	 handled[owner[i]] || !centrallist->central[owner[i]].connected)
+	continue;
+      handled[owner[i]] = 1;
+      IPC_setContext(centrallist->central[owner[i]].context);
+      for(j = 0; j < MAX_MESSAGES_PER_CENTRAL; j++)
+	if(IPC_handleMessage(0) != IPC_OK || 
+	   !centrallist->central[owner[i]].connected)
+	  break;
+    }
+  } while(carmen_get_time() < end_time);
+
+  free(handled);
 }
@@ -0,0 +1,234 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Measures the latency of messages received through several centrals
+ * with carmen_multicentral_ipc_sleep, and with the round robin loop it
+ * replaced.  Starts num_centrals centrals on consecutive ports from
+ * first_port, and a publisher (this program again) that sends
+ * timestamped messages to each central in turn.
+ *
+ * usage: multicentral_bench <num centrals> [messages] [first port]
+ *                           [central binary]
+ */
+
+#include "global.h"
+#include "ipc_wrapper.h"
+#include "multicentral.h"
+#include <sys/wait.h>
+
+#define BENCH_NAME      "carmen_multicentral_bench"
+#define BENCH_FMT       "{double,int}"
+#define PUBLISH_PERIOD  0.02
+#define SLEEP_TIME      0.1
+
+typedef struct {
+  double timestamp;
+  int seq;
+} bench_message;
+
+static double *latency;
+static int num_received, num_messages;
+
+static int
+publish(int num_centrals, int first_port)
+{
+  IPC_CONTEXT_PTR *contexts;
+  bench_message msg;
+  char host[256], name[256];
+  int i;
+
+  contexts = (IPC_CONTEXT_PTR *)calloc(num_centrals, sizeof(IPC_CONTEXT_PTR));
+  carmen_test_alloc(contexts);
+  IPC_setVerbosity(IPC_Silent);
+  snprintf(name, 256, "multicentral_bench_publisher-%d", getpid());
+  for (i = 0; i < num_centrals; i++) {
+    snprintf(host, 256, "localhost:%d", first_port+i);
+    if (IPC_connectModule(name, host) != IPC_OK)
+      carmen_die("Could not connect to central %s\n", host);
+    contexts[i] = IPC_getContext();
+    IPC_defineMsg(BENCH_NAME, IPC_VARIABLE_LENGTH, BENCH_FMT);
+  }
+
+  /* give the subscriber time to subscribe */
+  sleep(1);
+  for (msg.seq = 0; msg.seq < num_messages; msg.seq++) {
+    IPC_setContext(contexts[msg.seq % num_centrals]);
+    msg.timestamp = carmen_get_time();
+    IPC_publishData(BENCH_NAME, &msg);
+    usleep(PUBLISH_PERIOD*1e6);
+  }
+
+  return 0;
+}
+
+static void
+bench_handler(MSG_INSTANCE msgRef, void *callData,
+	      void *clientData __attribute__ ((unused)))
+{
+  bench_message *msg = (bench_message *)callData;
+
+  if (num_received < num_messages)
+    latency[num_received++] = carmen_get_time() - msg->timestamp;
+  IPC_freeData(IPC_msgInstanceFormatter(msgRef), callData);
+}
+
+static void
+subscribe_bench(void)
+{
+  IPC_defineMsg(BENCH_NAME, IPC_VARIABLE_LENGTH, BENCH_FMT);
+  IPC_subscribeData(BENCH_NAME, bench_handler, NULL);
+}
+
+/* carmen_multicentral_ipc_sleep as it was: each central in turn gets
+   an equal share of the sleep time */
+
+static void
+round_robin_ipc_sleep(carmen_centrallist_p centrallist, double sleep_time)
+{
+  int i, count = 0;
+
+  for(i = 0; i < centrallist->num_centrals; i++)
+    if(centrallist->central[i].connected)
+      count++;
+  for(i = 0; i < centrallist->num_centrals; i++)
+    if(centrallist->central[i].connected) {
+      IPC_setContext(centrallist->central[i].context);
+      carmen_ipc_sleep(sleep_time / count);
+    }
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+  double d = *(double *)a - *(double *)b;
+
+  return (d > 0) - (d < 0);
+}
+
+static void
+run(carmen_centrallist_p centrallist, char *program, int num_centrals,
+    int first_port, char *method, int round_robin)
+{
+  char num_str[32], messages_str[32], port_str[32];
+  double start, mean = 0;
+  pid_t publisher;
+  int i;
+
+  snprintf(num_str, 32, "%d", num_centrals);
+  snprintf(messages_str, 32, "%d", num_messages);
+  snprintf(port_str, 32, "%d", first_port);
+  num_received = 0;
+  publisher = fork();
+  if (publisher == 0) {
+    execl(program, program, "-publish", num_str, messages_str, port_str,
+	  (char *)NULL);
+    carmen_die("Could not run %s as a publisher\n", program);
+  }
+
+  start = carmen_get_time();
+  while (num_received < num_messages &&
+	 carmen_get_time() - start < 5 + num_messages*PUBLISH_PERIOD*2) {
+    if (round_robin)
+      round_robin_ipc_sleep(centrallist, SLEEP_TIME);
+    else
+      carmen_multicentral_ipc_sleep(centrallist, SLEEP_TIME);
+  }
+  waitpid(publisher, NULL, 0);
+
+  if (num_received == 0)
+    carmen_die("%s: no messages received\n", method);
+  qsort(latency, num_received, sizeof(double), compare_doubles);
+  for (i = 0; i < num_received; i++)
+    mean += latency[i];
+  mean /= num_received;
+  printf("%2d centrals, %-11s: %4d/%d messages, latency mean %8.3f ms, "
+	 "median %8.3f ms, max %8.3f ms\n", num_centrals, method,
+	 num_received, num_messages, 1000*mean,
+	 1000*latency[num_received/2], 1000*latency[num_received-1]);
+}
+
+int main(int argc, char **argv)
+{
+  carmen_centrallist_p centrallist;
+  int num_centrals, first_port, i;
+  char *central, list_filename[256], port_str[32];
+  char *central_argv[3];
+  pid_t *centrals;
+  FILE *fp;
+
+  if (argc >= 5 && !strcmp(argv[1], "-publish")) {
+    num_messages = atoi(argv[3]);
+    return publish(atoi(argv[2]), atoi(argv[4]));
+  }
+
+  if (argc < 2)
+    carmen_die("usage: %s <num centrals> [messages] [first port] "
+	       "[central binary]\n", argv[0]);
+  num_centrals = atoi(argv[1]);
+  num_messages = (argc > 2 ? atoi(argv[2]) : 200);
+  first_port = (argc > 3 ? atoi(argv[3]) : 1400);
+  central = (argc > 4 ? argv[4] : "central");
+  latency = (double *)calloc(num_messages, sizeof(double));
+  carmen_test_alloc(latency);
+
+  centrals = (pid_t *)calloc(num_centrals, sizeof(pid_t));
+  carmen_test_alloc(centrals);
+  snprintf(list_filename, 256, "/tmp/multicentral_bench-%d", getpid());
+  fp = fopen(list_filename, "w");
+  if (fp == NULL)
+    carmen_die("Could not write %s\n", list_filename);
+  for (i = 0; i < num_centrals; i++) {
+    snprintf(port_str, 32, "-p%d", first_port+i);
+    centrals[i] = fork();
+    if (centrals[i] == 0) {
+      freopen("/dev/null", "w", stdout);
+      freopen("/dev/null", "w", stderr);
+      execlp(central, central, port_str, "-s", (char *)NULL);
+      _exit(1);
+    }
+    fprintf(fp, "localhost:%d\n", first_port+i);
+  }
+  fclose(fp);
+  sleep(1);
+
+  central_argv[0] = argv[0];
+  central_argv[1] = "-central";
+  central_argv[2] = list_filename;
+  centrallist = carmen_multicentral_initialize(3, central_argv, NULL);
+  carmen_multicentral_subscribe_messages(centrallist, subscribe_bench);
+
+  run(centrallist, argv[0], num_centrals, first_port, "round robin", 1);
+  run(centrallist, argv[0], num_centrals, first_port, "poll", 0);
+
+  for (i = 0; i < num_centrals; i++)
+    kill(centrals[i], SIGTERM);
+  unlink(list_filename);
+
+  return 0;
+}
@@ -1012,6 +1012,9 @@ void x_ipc_execHnd(CONNECTION_PTR connection, DATA_MSG_PTR dataMsg)
 #ifdef LISPWORKS_FFI_HACK
   BOOLEAN isLisp;
 #endif
+  double start = 0.0, hndStart;
+  unsigned int length;
+  BOOLEAN timed;
   
   /* RTG Don't really know what intent is, but trying to use it. */
   if (dataMsg->intent == QUERY_REPLY_INTENT) {
@@ -1061,6 +1064,9 @@ void x_ipc_execHnd(CONNECTION_PTR connection, DATA_MSG_PTR dataMsg)
   /* If the handler is *not* in the message list, it was probably deregistered 
      after central sent it the message */
   if (x_ipc_listMemberItem(hnd, msg->hndList)) {
+    timed = IPC_STATS_SAMPLED(msg->stats.msgsIn);
+    if (timed) start = ipcTimeInSecs();
+    length = dataMsg->msgTotal;
     data = (char *)x_ipc_decodeDataInLanguage(dataMsg, msg->msgData->msgFormat, 
 					hnd->hndLanguage);
     x_ipc_dataMsgFree(dataMsg);
@@ -1074,7 +1080,11 @@ void x_ipc_execHnd(CONNECTION_PTR connection, DATA_MSG_PTR dataMsg)
     currentContext = x_ipcGetContext();
 #ifdef NMP_IPC
     if (hnd->clientData == NO_CLIENT_DATA) {
+      hndStart = ipcTimeInSecs();
       (*hnd->hndProc)(x_ipcRef, data);
+      ipcStatsHandled(msg, length,
+		      timed ? IPC_STATS_SAMPLING*(hndStart - start) : 0.0,
+		      ipcTimeInSecs() - hndStart);
       endExecHandler(x_ipcRef, connection, msg, tmpParentRef);
     } else {
       if (ipcFormatClassType(msg->msgData->msgFormat) == VarArrayFMT) {
@@ -1106,8 +1116,12 @@ void x_ipc_execHnd(CONNECTION_PTR connection, DATA_MSG_PTR dataMsg)
 	      data = (char *)data1;
 	    }
 	  }
+	  hndStart = ipcTimeInSecs();
 	  (*((X_IPC_HND_DATA_FN)hnd->hndProc))(x_ipcRef, data, hnd->clientData);
 	  x_ipcSetContext(currentContext);
+	  ipcStatsHandled(msg, length,
+			  timed ? IPC_STATS_SAMPLING*(hndStart - start) : 0.0,
+			  ipcTimeInSecs() - hndStart);
 	  endExecHandler(x_ipcRef, connection, msg, tmpParentRef);
 	}
     }
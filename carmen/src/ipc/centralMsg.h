@@ -226,6 +226,10 @@
 #define X_IPC_DIRECT_MSG_QUERY_FORMAT "string"
 #define X_IPC_DIRECT_MSG_QUERY_REPLY  DIRECT_MSG_FORMAT
 
+#define X_IPC_MSG_STATS_QUERY        "x_ipc_msgStatsQuery"
+#define X_IPC_MSG_STATS_QUERY_FORMAT NULL
+#define X_IPC_MSG_STATS_QUERY_REPLY  IPC_MODULE_STATS_FORMAT
+
 #define X_IPC_MAP_NAMED         "map"
 #define X_IPC_MAP_NAMED_FORMAT  "fmat"
 
@@ -240,6 +244,7 @@
 #define X_IPC_LIMIT_PENDING_INFORM        "x_ipc_limitPendingMsg"
 #define X_IPC_LIMIT_PENDING_INFORM_OLD    "limitPendingMsg"
 #define X_IPC_LIMIT_PENDING_INFORM_FORMAT "{string, string, int}"
+#define X_IPC_LIMIT_PENDING_BY_PUBLISHER_INFORM "x_ipc_limitPendingByPublisher"
 
 #define X_IPC_RESERVE_RESOURCE_QUERY        "x_ipc_reserveResourceMsg"
 #define X_IPC_RESERVE_RESOURCE_QUERY_OLD    "reserveResourceMsg"
@@ -2941,6 +2941,16 @@ static int32 numPending (MSG_PTR msg, MSG_QUEUE_PTR msgQueue)
   return num;
 }
 
+int32 x_ipcNumQueued (MSG_PTR msg)
+{
+  int32 num;
+
+  LOCK_CM_MUTEX;
+  num = numPending(msg, &GET_C_GLOBAL(msgQueue));
+  UNLOCK_CM_MUTEX;
+  return num;
+}
+
 /* Remove the oldest message of the same type as "msg".
    Move up all entries of the same message, to ensure fairness.
    Return the original position of the newest message, which is where
@@ -255,6 +255,7 @@ void initMsgQueue (MSG_QUEUE_PTR msgQueue);
 void enqueueMsg (MSG_QUEUE_PTR msgQueue,
 		 CONNECTION_PTR connection, DATA_MSG_PTR dataMsg);
 QUEUED_MSG_PTR dequeueMsg (MSG_QUEUE_PTR msgQueue);
+int32 x_ipcNumQueued (MSG_PTR msg);
 
 void x_ipcModuleInitialize(void);
 
@@ -1910,6 +1910,30 @@ static void directMsgHnd(DISPATCH_PTR dispatch, char **name)
   x_ipc_freeDataStructure(dispatch->msg->msgData->msgFormat, name);
 }
 
+static int clearPending(const char *msgName, MSG_PTR msg, void *param)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(msgName, param)
+#endif
+  msg->stats.pending = 0;
+  return 1;
+}
+
+static void msgStatsHnd(DISPATCH_PTR dispatch, void *empty)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(empty)
+#endif
+  IPC_MODULE_STATS_PTR stats;
+  
+  x_ipc_hashTableIterate((HASH_ITER_FN)clearPending,
+			 GET_C_GLOBAL(messageTable), NULL);
+  resourceCountPending();
+  stats = ipcCollectMsgStats("central");
+  centralReply(dispatch, (void *)stats);
+  IPC_freeMsgStats(stats);
+}
+
 static void moduleConnectedHnd (DISPATCH_PTR dispatch, char **moduleName)
 {
   int found = 0;
@@ -2008,6 +2032,12 @@ static void serverMessagesInitialize(void)
 		       getMsgInfoHnd);
   Add_Message_To_Ignore(X_IPC_MESSAGES_QUERY);
 
+  centralRegisterQuery(X_IPC_MSG_STATS_QUERY,
+		       X_IPC_MSG_STATS_QUERY_FORMAT,
+		       X_IPC_MSG_STATS_QUERY_REPLY,
+		       msgStatsHnd);
+  Add_Message_To_Ignore(X_IPC_MSG_STATS_QUERY);
+
   centralRegisterQuery(X_IPC_HND_INFO_QUERY, 
 		       X_IPC_HND_INFO_QUERY_FORMAT, 
 		       X_IPC_HND_INFO_QUERY_REPLY, 
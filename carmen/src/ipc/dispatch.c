@@ -1105,6 +1105,8 @@ void deliverDispatch(DISPATCH_PTR dispatch)
     dispatch->msgData->intent = dispatch->hnd->hndData->refId;
     dispatch->msgData->msgRef = dispatch->locId;
     
+    dispatch->msg->stats.msgsOut++;
+    dispatch->msg->stats.bytesOut += dispatch->msgData->msgTotal;
     (void)x_ipc_dataMsgSend(dispatch->desId, dispatch->msgData);
   }
 }
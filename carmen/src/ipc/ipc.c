@@ -370,27 +370,31 @@ IPC_RETURN_TYPE IPC_publish (const char *msgName,
 			     unsigned int length, BYTE_ARRAY content)
 {
   MSG_PTR msg;
-  CONST_FORMAT_PTR format;
+
+  msg = ipcFindMsg(msgName);
+  if (!msg) {
+    PASS_ON_ERROR();
+  } else {
+    return _IPC_publish(msg, length, content, 0.0);
+  }
+}
+
+/* "marshallTime" is the time IPC_publishData took to marshall "content",
+   if it was timed */
+IPC_RETURN_TYPE _IPC_publish (MSG_PTR msg,
+			      unsigned int length, BYTE_ARRAY content,
+			      double marshallTime)
+{
+  const char *msgName = msg->msgData->name;
   void *dataToSend;
   IPC_VARCONTENT_TYPE vc;
 
-  if (!msgName || strlen(msgName) == 0) {
-    RETURN_ERROR(IPC_Null_Argument);
-  } else if (!X_IPC_CONNECTED()) {
-    RETURN_ERROR(IPC_Not_Connected);
+  if (ipcDataToSend(msg->msgData->msgFormat, msgName, length, content,
+		    &dataToSend, &vc) != IPC_OK) {
+    PASS_ON_ERROR();
   } else {
-    msg = x_ipc_msgFind(msgName);
-    if (!msg) {
-      RETURN_ERROR(IPC_Message_Not_Defined);
-    } else {
-      format = msg->msgData->msgFormat;
-      if (ipcDataToSend(format, msgName, length, content, &dataToSend, &vc)
-	  != IPC_OK) {
-	PASS_ON_ERROR();
-      } else {
-	return ipcReturnValue(x_ipcBroadcast(msgName, dataToSend));
-      }
-    }
+    ipcStatsSent(msg, dataToSend, &vc, marshallTime);
+    return ipcReturnValue(x_ipcBroadcast(msgName, dataToSend));
   }
 }
 
@@ -607,6 +611,28 @@ IPC_RETURN_TYPE IPC_setMsgQueueLength (const char *msgName, int queueLength)
   }
 }
 
+IPC_RETURN_TYPE IPC_setMsgQueueLengthByPublisher (const char *msgName,
+						  int queueLength)
+{
+  MSG_PTR msg;
+
+  if (queueLength < 1) {
+    RETURN_ERROR(IPC_Argument_Out_Of_Range);
+  } else if (!X_IPC_CONNECTED()) {
+    RETURN_ERROR(IPC_Not_Connected);
+  } else {
+    /* Messages queued in the module itself are not told apart */
+    msg = x_ipc_findOrRegisterMessage(msgName);
+    msg->limit = queueLength;
+    LOCK_M_MUTEX;
+    x_ipcLimitPendingMessagesByPublisher(msgName,
+					 GET_M_GLOBAL(modNameGlobal), 
+					 queueLength);
+    UNLOCK_M_MUTEX;
+    return IPC_OK;
+  }
+}
+
 IPC_RETURN_TYPE IPC_setMsgPriority (const char *msgName, int priority)
 {
   SET_MSG_PRIORITY_TYPE setMsgData;
@@ -807,10 +833,231 @@ int IPC_numHandlers (const char *msgName)
   }
 }
 
+static void ipcMsgStatsHnd (MSG_INSTANCE msgRef, BYTE_ARRAY callData,
+			    void *clientData)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(clientData)
+#endif
+  IPC_MODULE_STATS_PTR stats;
+
+  if (IPC_getMsgStats(&stats) == IPC_OK) {
+    IPC_respondData(msgRef, IPC_MSG_STATS_REPLY, stats);
+    IPC_freeMsgStats(stats);
+  }
+  if (callData) IPC_freeByteArray(callData);
+}
+
+static int ipcSetQueued (const char *msgName, MSG_PTR msg, void *param)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(msgName, param)
+#endif
+  msg->stats.pending = x_ipcNumQueued(msg);
+  return TRUE;
+}
+
+IPC_RETURN_TYPE IPC_getMsgStats (IPC_MODULE_STATS_PTR *stats)
+{
+  const char *modName;
+
+  if (!stats) {
+    RETURN_ERROR(IPC_Null_Argument);
+  } else if (!X_IPC_INITIALIZED()) {
+    RETURN_ERROR(IPC_Not_Initialized);
+  } else {
+    LOCK_CM_MUTEX;
+    x_ipc_hashTableIterate((HASH_ITER_FN)ipcSetQueued,
+			   GET_C_GLOBAL(messageTable), NULL);
+    UNLOCK_CM_MUTEX;
+    LOCK_M_MUTEX;
+    modName = GET_M_GLOBAL(modNameGlobal);
+    UNLOCK_M_MUTEX;
+    *stats = ipcCollectMsgStats(modName);
+    return IPC_OK;
+  }
+}
+
+IPC_RETURN_TYPE IPC_subscribeMsgStats (void)
+{
+  char msgName[MAX_MESSAGE_NAME_LENGTH];
+  const char *modName;
+
+  if (!X_IPC_CONNECTED()) {
+    RETURN_ERROR(IPC_Not_Connected);
+  } else {
+    LOCK_M_MUTEX;
+    modName = GET_M_GLOBAL(modNameGlobal);
+    UNLOCK_M_MUTEX;
+    snprintf(msgName, sizeof(msgName), "%s%s", IPC_MSG_STATS_QUERY, modName);
+    if (IPC_defineMsg(msgName, 0, NULL) != IPC_OK ||
+	IPC_defineMsg(IPC_MSG_STATS_REPLY, IPC_VARIABLE_LENGTH,
+		      IPC_MODULE_STATS_FORMAT) != IPC_OK) {
+      PASS_ON_ERROR();
+    } else {
+      return IPC_subscribe(msgName, ipcMsgStatsHnd, NULL);
+    }
+  }
+}
+
+IPC_RETURN_TYPE IPC_queryMsgStats (const char *moduleName,
+				   IPC_MODULE_STATS_PTR *stats,
+				   unsigned int timeoutMsecs)
+{
+  char msgName[MAX_MESSAGE_NAME_LENGTH];
+  X_IPC_RETURN_VALUE_TYPE status;
+
+  if (!stats) {
+    RETURN_ERROR(IPC_Null_Argument);
+  } else if (!X_IPC_CONNECTED()) {
+    RETURN_ERROR(IPC_Not_Connected);
+  } else if (!moduleName) {
+    *stats = NEW(IPC_MODULE_STATS_TYPE);
+    status = x_ipcQueryCentral(X_IPC_MSG_STATS_QUERY, NULL, (void *)*stats);
+    if (status != Success) {
+      x_ipcFree((void *)*stats);
+      *stats = NULL;
+    }
+    return ipcReturnValue(status);
+  } else {
+    snprintf(msgName, sizeof(msgName), "%s%s", IPC_MSG_STATS_QUERY,
+	     moduleName);
+    if (!IPC_isMsgDefined(msgName)) {
+      *stats = NULL;
+      RETURN_ERROR(IPC_Message_Not_Defined);
+    } else {
+      return IPC_queryResponseData(msgName, NULL, (void **)stats,
+				   timeoutMsecs);
+    }
+  }
+}
+
+void IPC_freeMsgStats (IPC_MODULE_STATS_PTR stats)
+{
+  int i;
+
+  if (!stats) return;
+  for (i=0; i<stats->numMsgs; i++) {
+    x_ipcFree((void *)stats->msgs[i].msgName);
+  }
+  x_ipcFree((void *)stats->msgs);
+  x_ipcFree((void *)stats->moduleName);
+  x_ipcFree((void *)stats);
+}
+
 /****************************************************************
  *                INTERNAL FUNCTIONS 
  ****************************************************************/
 
+/* The message to publish or respond with, or NULL (setting IPC_errno) */
+MSG_PTR ipcFindMsg (const char *msgName)
+{
+  MSG_PTR msg;
+
+  if (!msgName || strlen(msgName) == 0) {
+    ipcSetError(IPC_Null_Argument);
+    return NULL;
+  } else if (!X_IPC_CONNECTED()) {
+    ipcSetError(IPC_Not_Connected);
+    return NULL;
+  } else {
+    msg = x_ipc_msgFind(msgName);
+    if (!msg) ipcSetError(IPC_Message_Not_Defined);
+    return msg;
+  }
+}
+
+double ipcTimeInSecs (void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec/1000000.0;
+}
+
+/* "dataToSend" and "vc" as set by ipcDataToSend */
+void ipcStatsSent (MSG_PTR msg, void *dataToSend, IPC_VARCONTENT_PTR vc,
+		   double marshallTime)
+{
+  CONST_FORMAT_PTR format = msg->msgData->msgFormat;
+
+  msg->stats.msgsOut++;
+  msg->stats.bytesOut += (dataToSend == (void *)vc ? vc->length :
+			  format ? (unsigned)format->formatter.a[2].i : 0);
+  msg->stats.marshallTime += marshallTime;
+}
+
+void ipcStatsHandled (MSG_PTR msg, unsigned int length,
+		      double unmarshallTime, double handlerTime)
+{
+  IPC_MSG_STATS_PTR stats = &msg->stats;
+  double usecs;
+  int bucket;
+
+  stats->msgsIn++;
+  stats->bytesIn += length;
+  stats->unmarshallTime += unmarshallTime;
+  stats->handlerTime += handlerTime;
+  if (handlerTime > stats->maxHandlerTime)
+    stats->maxHandlerTime = handlerTime;
+  for (bucket=0, usecs=handlerTime*1000000.0;
+       usecs >= 2.0 && bucket < IPC_STATS_HISTOGRAM_SIZE-1; usecs /= 2.0)
+    bucket++;
+  stats->handlerHistogram[bucket]++;
+}
+
+/* Messages with handlers are listed even before they are used, so that
+   one can see which never arrive */
+static BOOLEAN ipcMsgUsed (MSG_PTR msg)
+{
+  return (msg->stats.msgsIn > 0 || msg->stats.msgsOut > 0 ||
+	  msg->stats.pending > 0 || x_ipc_listLength(msg->hndList) > 0);
+}
+
+static int ipcCountUsed (const char *msgName, MSG_PTR msg, int *num)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(msgName)
+#endif
+  if (ipcMsgUsed(msg)) (*num)++;
+  return TRUE;
+}
+
+static int ipcCopyUsed (const char *msgName, MSG_PTR msg,
+			IPC_MODULE_STATS_PTR stats)
+{
+  IPC_MSG_STATS_PTR msgStats;
+
+  if (ipcMsgUsed(msg)) {
+    msgStats = &stats->msgs[stats->numMsgs++];
+    *msgStats = msg->stats;
+    msgStats->msgName = strdup(msgName);
+  }
+  return TRUE;
+}
+
+/* Copies the counters of the messages in use, in a form
+   that IPC_freeMsgStats frees */
+IPC_MODULE_STATS_PTR ipcCollectMsgStats (const char *moduleName)
+{
+  IPC_MODULE_STATS_PTR stats;
+  int num = 0;
+
+  stats = NEW(IPC_MODULE_STATS_TYPE);
+  stats->moduleName = strdup(moduleName ? moduleName : "");
+  LOCK_CM_MUTEX;
+  x_ipc_hashTableIterate((HASH_ITER_FN)ipcCountUsed,
+			 GET_C_GLOBAL(messageTable), &num);
+  stats->numMsgs = 0;
+  stats->msgs = (IPC_MSG_STATS_PTR)x_ipcMalloc(sizeof(IPC_MSG_STATS_TYPE)*
+					       (num > 0 ? num : 1));
+  x_ipc_hashTableIterate((HASH_ITER_FN)ipcCopyUsed,
+			 GET_C_GLOBAL(messageTable), stats);
+  UNLOCK_CM_MUTEX;
+  return stats;
+}
+
+
 
 /* Check that the length used in the publish matches the message format length.
  * If the message is fixed-length:
@@ -321,6 +321,12 @@ IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_setCapacity,
 IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_setMsgQueueLength,
 		     (const char *msgName, int queueLength));
 
+/* Like IPC_setMsgQueueLength, but central keeps up to "queueLength"
+   instances from each publishing module, rather than in all, so that a
+   slow subscriber still sees the latest message of every publisher. */
+IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_setMsgQueueLengthByPublisher,
+		     (const char *msgName, int queueLength));
+
 IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_setMsgPriority,
 		     (const char *msgName, int priority));
 
@@ -487,6 +493,65 @@ IPC_EXTERN_FUNCTION (IPC_CONTEXT_PTR IPC_getContext,
 IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_setContext,
 		     (IPC_CONTEXT_PTR context));
 
+/*****************************************************************
+ *                     MESSAGE STATISTICS
+ *****************************************************************/
+
+/* Counters kept for every message, by central and by each module.
+   Central counts the messages it receives and routes, and how many wait
+   in its queues for busy handlers.  A module counts the messages it
+   publishes and handles, times marshalling, unmarshalling and its
+   handlers, and counts the messages queued for it locally.  Marshalling
+   and unmarshalling times are estimated from every fourth message.
+   handlerHistogram[i] counts the handler calls that took from 2^i to
+   2^(i+1) microseconds; the first bucket also holds faster calls and the
+   last slower ones.  Times are in seconds. */
+
+#define IPC_STATS_HISTOGRAM_SIZE 20
+
+typedef struct {
+  const char *msgName;
+  unsigned int msgsIn, msgsOut;
+  double bytesIn, bytesOut;
+  double marshallTime, unmarshallTime, handlerTime, maxHandlerTime;
+  int pending;
+  unsigned int handlerHistogram[IPC_STATS_HISTOGRAM_SIZE];
+} IPC_MSG_STATS_TYPE, *IPC_MSG_STATS_PTR;
+
+typedef struct {
+  const char *moduleName;
+  int numMsgs;
+  IPC_MSG_STATS_PTR msgs;
+} IPC_MODULE_STATS_TYPE, *IPC_MODULE_STATS_PTR;
+
+#define IPC_MSG_STATS_FORMAT \
+  "{string, uint, uint, double, double, double, double, double, double, int, [uint:20]}"
+#define IPC_MODULE_STATS_FORMAT \
+  "{string, int, <" IPC_MSG_STATS_FORMAT ":2>}"
+
+/* Modules that call IPC_subscribeMsgStats answer this query, with the
+   module name appended */
+#define IPC_MSG_STATS_QUERY       "ipc_msgStats:"
+#define IPC_MSG_STATS_REPLY       "ipc_msgStatsReply"
+
+/* A snapshot of the counters of this module, for the messages it has used */
+IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_getMsgStats,
+		     (IPC_MODULE_STATS_PTR *stats));
+
+/* Lets other modules query the counters of this module */
+IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_subscribeMsgStats,
+		     (void));
+
+/* The counters of central (moduleName NULL) or of a module that has
+   called IPC_subscribeMsgStats */
+IPC_EXTERN_FUNCTION (IPC_RETURN_TYPE IPC_queryMsgStats,
+		     (const char *moduleName,
+		      IPC_MODULE_STATS_PTR *stats,
+		      unsigned int timeoutMsecs));
+
+IPC_EXTERN_FUNCTION (void IPC_freeMsgStats,
+		     (IPC_MODULE_STATS_PTR stats));
+
 /*****************************************************************
  *                     TIMER FUNCTIONS
  *****************************************************************/
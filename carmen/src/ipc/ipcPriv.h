@@ -423,8 +423,36 @@ extern IPC_RETURN_TYPE _IPC_queryResponse (const char *msgName,
 #pragma export off
 #endif
 
+struct _MSG;
+
+extern IPC_RETURN_TYPE _IPC_publish (struct _MSG *msg,
+				     unsigned int length, BYTE_ARRAY content,
+				     double marshallTime);
+
+extern IPC_RETURN_TYPE _IPC_respond (MSG_INSTANCE msgInstance,
+				     struct _MSG *msg,
+				     unsigned int length, BYTE_ARRAY content,
+				     double marshallTime);
+
 unsigned long ipcNextTime (void);
 
+struct _MSG *ipcFindMsg (const char *msgName);
+
+double ipcTimeInSecs (void);
+
+/* Marshalling and unmarshalling are timed for one message in
+   IPC_STATS_SAMPLING, and the times scaled up, to save clock reads */
+#define IPC_STATS_SAMPLING 4
+#define IPC_STATS_SAMPLED(count) ((count) % IPC_STATS_SAMPLING == 0)
+
+void ipcStatsSent (struct _MSG *msg, void *dataToSend,
+		   IPC_VARCONTENT_PTR vc, double marshallTime);
+
+void ipcStatsHandled (struct _MSG *msg, unsigned int length,
+		      double unmarshallTime, double handlerTime);
+
+IPC_MODULE_STATS_PTR ipcCollectMsgStats (const char *moduleName);
+
 void ipcTriggerTimers (void);
 
 /*****************************************************************
@@ -0,0 +1,185 @@
+/*
+ * Prints the message counters of central and of every module that
+ * answers IPC_MSG_STATS_QUERY (all CARMEN modules do): messages and
+ * bytes in and out, messages waiting in queues, and the time spent
+ * marshalling, unmarshalling and in handlers.  With -r, counts two
+ * snapshots some seconds apart and prints rates instead of totals.
+ * Unused and internal messages are left out unless -a is given.
+ *
+ * usage: ipc_stats [-central host] [-m module] [-r seconds] [-a]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ipc.h"
+
+#define QUERY_TIMEOUT 2000 /* msecs */
+#define MAX_MODULES   256
+
+static int showAll = 0;
+
+/* Upper bound, in microseconds, of the histogram bucket holding the
+   given fraction of the handler calls */
+static double histogramPercentile (IPC_MSG_STATS_PTR stats, double fraction)
+{
+  unsigned int total = 0, sum = 0;
+  int i;
+
+  for (i=0; i<IPC_STATS_HISTOGRAM_SIZE; i++)
+    total += stats->handlerHistogram[i];
+  for (i=0; i<IPC_STATS_HISTOGRAM_SIZE; i++) {
+    sum += stats->handlerHistogram[i];
+    if (sum >= fraction*total) break;
+  }
+  return (double)(2 << (i < IPC_STATS_HISTOGRAM_SIZE ? i :
+			 IPC_STATS_HISTOGRAM_SIZE-1));
+}
+
+static IPC_MSG_STATS_PTR findMsg (IPC_MODULE_STATS_PTR stats,
+				  const char *msgName)
+{
+  int i;
+
+  for (i=0; stats && i<stats->numMsgs; i++)
+    if (!strcmp(stats->msgs[i].msgName, msgName)) return &stats->msgs[i];
+  return NULL;
+}
+
+/* Subtracts the counters of "before" from those of "after" */
+static void subtractStats (IPC_MODULE_STATS_PTR after,
+			   IPC_MODULE_STATS_PTR before)
+{
+  IPC_MSG_STATS_PTR a, b;
+  int i, j;
+
+  for (i=0; i<after->numMsgs; i++) {
+    a = &after->msgs[i];
+    b = findMsg(before, a->msgName);
+    if (!b) continue;
+    a->msgsIn -= b->msgsIn;
+    a->msgsOut -= b->msgsOut;
+    a->bytesIn -= b->bytesIn;
+    a->bytesOut -= b->bytesOut;
+    a->marshallTime -= b->marshallTime;
+    a->unmarshallTime -= b->unmarshallTime;
+    a->handlerTime -= b->handlerTime;
+    for (j=0; j<IPC_STATS_HISTOGRAM_SIZE; j++)
+      a->handlerHistogram[j] -= b->handlerHistogram[j];
+  }
+}
+
+static int internalMsg (const char *msgName)
+{
+  return (!strncmp(msgName, "x_ipc_", 6) || !strncmp(msgName, "ipc_", 4) ||
+	  !strncmp(msgName, "IPC_", 4));
+}
+
+static void printStats (IPC_MODULE_STATS_PTR stats, double period)
+{
+  IPC_MSG_STATS_PTR msg;
+  double scale = (period > 0 ? 1/period : 1);
+  int i;
+
+  printf("\n%s%s\n", stats->moduleName,
+	 period > 0 ? " (per second)" : "");
+  printf("  %-36s %9s %9s %9s %9s %5s %8s %8s %9s %9s %9s\n", "message",
+	 "msgs in", "KB in", "msgs out", "KB out", "queue", "marsh us",
+	 "unmar us", "hnd us", "hnd p99", "hnd max");
+  for (i=0; i<stats->numMsgs; i++) {
+    msg = &stats->msgs[i];
+    if (!showAll && (internalMsg(msg->msgName) ||
+		     (msg->msgsIn == 0 && msg->msgsOut == 0 &&
+		      msg->pending == 0)))
+      continue;
+    printf("  %-36s %9.1f %9.1f %9.1f %9.1f %5d", msg->msgName,
+	   msg->msgsIn*scale, msg->bytesIn*scale/1024, msg->msgsOut*scale,
+	   msg->bytesOut*scale/1024, msg->pending);
+    if (msg->msgsOut > 0 && msg->marshallTime > 0)
+      printf(" %8.1f", 1e6*msg->marshallTime/msg->msgsOut);
+    else
+      printf(" %8s", "-");
+    if (msg->msgsIn > 0 && msg->handlerTime > 0)
+      printf(" %8.1f %9.1f %9.0f %9.0f\n",
+	     1e6*msg->unmarshallTime/msg->msgsIn,
+	     1e6*msg->handlerTime/msg->msgsIn,
+	     histogramPercentile(msg, 0.99), 1e6*msg->maxHandlerTime);
+    else
+      printf(" %8s %9s %9s %9s\n", "-", "-", "-", "-");
+  }
+}
+
+static IPC_MODULE_STATS_PTR queryStats (const char *moduleName)
+{
+  IPC_MODULE_STATS_PTR stats;
+
+  if (IPC_queryMsgStats(moduleName, &stats, QUERY_TIMEOUT) != IPC_OK)
+    return NULL;
+  return stats;
+}
+
+int main (int argc, char **argv)
+{
+  IPC_MODULE_STATS_PTR before[MAX_MODULES+1], after[MAX_MODULES+1];
+  const char *modules[MAX_MODULES+1], *host = NULL, *only = NULL;
+  char name[200];
+  double period = 0;
+  int i, numModules = 0;
+  size_t prefix = strlen(IPC_MSG_STATS_QUERY);
+
+  for (i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "-central") && i+1 < argc) host = argv[++i];
+    else if (!strcmp(argv[i], "-m") && i+1 < argc) only = argv[++i];
+    else if (!strcmp(argv[i], "-r") && i+1 < argc) period = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-a")) showAll = 1;
+    else {
+      fprintf(stderr, "usage: %s [-central host] [-m module] [-r seconds] "
+	      "[-a]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  IPC_setVerbosity(IPC_Silent);
+  snprintf(name, sizeof(name), "ipc_stats-%d", getpid());
+  if (IPC_connectModule(name, host) != IPC_OK) {
+    fprintf(stderr, "Could not connect to central.\n");
+    return 1;
+  }
+
+  /* central comes first (a NULL module name); the modules that answer
+     stats queries show up among the messages it knows about */
+  modules[numModules] = NULL;
+  before[numModules++] = queryStats(NULL);
+  if (!before[0]) {
+    fprintf(stderr, "Central did not answer; it may be too old to keep "
+	    "message counters.\n");
+    return 1;
+  }
+  if (only) {
+    modules[numModules++] = only;
+  } else {
+    for (i=0; i<before[0]->numMsgs && numModules <= MAX_MODULES; i++)
+      if (!strncmp(before[0]->msgs[i].msgName, IPC_MSG_STATS_QUERY, prefix) &&
+	  IPC_isModuleConnected(before[0]->msgs[i].msgName + prefix) == 1)
+	modules[numModules++] = before[0]->msgs[i].msgName + prefix;
+  }
+
+  if (period > 0) {
+    for (i=1; i<numModules; i++) before[i] = queryStats(modules[i]);
+    usleep(period*1e6);
+  }
+  for (i=0; i<numModules; i++) after[i] = queryStats(modules[i]);
+
+  for (i=(only ? 1 : 0); i<numModules; i++) {
+    if (!after[i]) {
+      printf("\n%s did not answer\n", modules[i] ? modules[i] : "central");
+      continue;
+    }
+    if (period > 0 && before[i]) subtractStats(after[i], before[i]);
+    printStats(after[i], period > 0 && before[i] ? period : 0);
+  }
+
+  IPC_disconnect();
+  return 0;
+}
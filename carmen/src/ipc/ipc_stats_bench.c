@@ -0,0 +1,110 @@
+/*
+ * Measures what the message counters cost.  Sends laser sized messages
+ * to itself through central and times the round trip, then times the
+ * counting and clock reads a message now goes through (on both the
+ * publishing and the handling side) and prints the one as a fraction of
+ * the other.  Also checks the counters against the messages sent.
+ *
+ * usage: ipc_stats_bench [messages] [central host]
+ */
+
+#include <unistd.h>
+#include <sys/time.h>
+#include "globalM.h"
+
+#define BENCH_NAME      "ipc_stats_bench_laser"
+#define BENCH_FMT       "{int, double, <float:1>, double, string}"
+#define NUM_READINGS    361
+
+typedef struct {
+  int num_readings;
+  double fov;
+  float *range;
+  double timestamp;
+  char *host;
+} laser_message;
+
+static int received;
+
+static void laserHandler (MSG_INSTANCE msgRef, void *callData,
+			  void *clientData)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(clientData)
+#endif
+  received++;
+  IPC_freeData(IPC_msgInstanceFormatter(msgRef), callData);
+}
+
+int main (int argc, char **argv)
+{
+  IPC_MODULE_STATS_PTR stats;
+  laser_message laser;
+  MSG_TYPE msg;
+  MSG_DATA_TYPE msgData;
+  IPC_VARCONTENT_TYPE vc;
+  double start, roundTrip, counting, t, hndStart;
+  int i, n, numMessages;
+  char name[200];
+
+  numMessages = (argc > 1 ? atoi(argv[1]) : 2000);
+  IPC_setVerbosity(IPC_Silent);
+  snprintf(name, sizeof(name), "ipc_stats_bench-%d", getpid());
+  if (IPC_connectModule(name, argc > 2 ? argv[2] : NULL) != IPC_OK) {
+    fprintf(stderr, "Could not connect to central.\n");
+    return 1;
+  }
+  IPC_defineMsg(BENCH_NAME, IPC_VARIABLE_LENGTH, BENCH_FMT);
+  IPC_subscribeData(BENCH_NAME, laserHandler, NULL);
+
+  laser.num_readings = NUM_READINGS;
+  laser.fov = M_PI;
+  laser.range = (float *)calloc(NUM_READINGS, sizeof(float));
+  for (i=0; i<NUM_READINGS; i++) laser.range[i] = 1.0 + i/100.0;
+  laser.host = name;
+
+  start = ipcTimeInSecs();
+  for (i=0; i<numMessages; i++) {
+    laser.timestamp = ipcTimeInSecs();
+    IPC_publishData(BENCH_NAME, &laser);
+    while (received <= i) IPC_handleMessage(1000);
+  }
+  roundTrip = (ipcTimeInSecs() - start)/numMessages;
+
+  /* what IPC_publishData and x_ipc_execHnd now add: the two updates,
+     two clock reads around the handler and, for one message in
+     IPC_STATS_SAMPLING, three more around marshalling and unmarshalling */
+  bzero((void *)&msg, sizeof(msg));
+  bzero((void *)&msgData, sizeof(msgData));
+  msg.msgData = &msgData;
+  vc.length = 1500;
+  n = numMessages*100;
+  start = ipcTimeInSecs();
+  for (i=0; i<n; i++) {
+    t = (IPC_STATS_SAMPLED(msg.stats.msgsOut) ? ipcTimeInSecs() : 0.0);
+    ipcStatsSent(&msg, &vc, &vc, t > 0 ? ipcTimeInSecs() - t : 0.0);
+    t = (IPC_STATS_SAMPLED(msg.stats.msgsIn) ? ipcTimeInSecs() : 0.0);
+    hndStart = ipcTimeInSecs();
+    ipcStatsHandled(&msg, 1500, t > 0 ? hndStart - t : 0.0,
+		    ipcTimeInSecs() - hndStart);
+  }
+  counting = (ipcTimeInSecs() - start)/n;
+
+  printf("%d messages of %d readings: round trip %.1f us, counting %.3f us "
+	 "(%.2f%%)\n", numMessages, NUM_READINGS, 1e6*roundTrip,
+	 1e6*counting, 100*counting/roundTrip);
+
+  if (IPC_getMsgStats(&stats) == IPC_OK) {
+    for (i=0; i<stats->numMsgs; i++)
+      if (!strcmp(stats->msgs[i].msgName, BENCH_NAME))
+	printf("counted %u out (%.0f bytes), %u in, handler mean %.1f us, "
+	       "marshall mean %.1f us\n", stats->msgs[i].msgsOut,
+	       stats->msgs[i].bytesOut, stats->msgs[i].msgsIn,
+	       1e6*stats->msgs[i].handlerTime/stats->msgs[i].msgsIn,
+	       1e6*stats->msgs[i].marshallTime/stats->msgs[i].msgsOut);
+    IPC_freeMsgStats(stats);
+  }
+
+  IPC_disconnect();
+  return 0;
+}
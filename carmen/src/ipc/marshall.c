@@ -310,18 +310,31 @@ IPC_RETURN_TYPE IPC_unmarshallData(FORMATTER_PTR formatter,
   }
 }
 
+/* Looks the message up only once, for both marshalling and publishing */
 IPC_RETURN_TYPE IPC_publishData (const char *msgName, void *dataptr)
 {
   IPC_VARCONTENT_TYPE varcontent;
   IPC_RETURN_TYPE retVal;
+  MSG_PTR msg;
+  BOOLEAN timed;
+  double start = 0.0, marshallTime = 0.0;
 
-  if (!msgName || strlen(msgName) == 0) {
-    RETURN_ERROR(IPC_Null_Argument);
-  } else if (_IPC_marshall(IPC_msgFormatter(msgName), 
-			   dataptr, &varcontent, FALSE) != IPC_OK){
+  if (!(msg = ipcFindMsg(msgName))) {
+    PASS_ON_ERROR();
+  } else if (msg->msgData->resFormat &&
+	     msg->msgData->resFormat->type == BadFormatFMT) {
+    RETURN_ERROR(IPC_Illegal_Formatter);
+  }
+  timed = IPC_STATS_SAMPLED(msg->stats.msgsOut);
+  if (timed) start = ipcTimeInSecs();
+  if (_IPC_marshall(msg->msgData->resFormat, 
+		    dataptr, &varcontent, FALSE) != IPC_OK) {
     PASS_ON_ERROR();
   } else {
-    retVal = IPC_publishVC(msgName, &varcontent);
+    if (timed)
+      marshallTime = IPC_STATS_SAMPLING*(ipcTimeInSecs() - start);
+    retVal = _IPC_publish(msg, varcontent.length, varcontent.content,
+			  marshallTime);
     if (varcontent.content != dataptr) x_ipcFree(varcontent.content);
     return retVal;
   }
@@ -332,16 +345,28 @@ IPC_RETURN_TYPE IPC_respondData (MSG_INSTANCE msgInstance,
 {
   IPC_VARCONTENT_TYPE varcontent;
   IPC_RETURN_TYPE retVal;
+  MSG_PTR msg;
+  BOOLEAN timed;
+  double start = 0.0, marshallTime = 0.0;
 
-  if (!msgName || strlen(msgName) == 0) {
-    RETURN_ERROR(IPC_Null_Argument);
-  } else if (!msgInstance) {
+  if (!msgInstance) {
     RETURN_ERROR(IPC_Null_Argument);
-  } else if (_IPC_marshall(IPC_msgFormatter(msgName),
-			   dataptr, &varcontent, FALSE) != IPC_OK) {
+  } else if (!(msg = ipcFindMsg(msgName))) {
+    PASS_ON_ERROR();
+  } else if (msg->msgData->resFormat &&
+	     msg->msgData->resFormat->type == BadFormatFMT) {
+    RETURN_ERROR(IPC_Illegal_Formatter);
+  }
+  timed = IPC_STATS_SAMPLED(msg->stats.msgsOut);
+  if (timed) start = ipcTimeInSecs();
+  if (_IPC_marshall(msg->msgData->resFormat,
+		    dataptr, &varcontent, FALSE) != IPC_OK) {
     PASS_ON_ERROR();
   } else {
-    retVal = IPC_respondVC(msgInstance, msgName, &varcontent);
+    if (timed)
+      marshallTime = IPC_STATS_SAMPLING*(ipcTimeInSecs() - start);
+    retVal = _IPC_respond(msgInstance, msg, varcontent.length,
+			  varcontent.content, marshallTime);
     if (varcontent.content != dataptr) x_ipcFree(varcontent.content);
     return retVal;
   }
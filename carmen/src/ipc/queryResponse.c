@@ -89,28 +89,34 @@ IPC_RETURN_TYPE IPC_respond (MSG_INSTANCE msgInstance, const char *msgName,
 			     unsigned int length, BYTE_ARRAY content)
 {
   MSG_PTR msg;
+
+  if (!msgInstance) {
+    RETURN_ERROR(IPC_Null_Argument);
+  } else if (!(msg = ipcFindMsg(msgName))) {
+    PASS_ON_ERROR();
+  } else {
+    return _IPC_respond(msgInstance, msg, length, content, 0.0);
+  }
+}
+
+/* "marshallTime" is the time IPC_respondData took to marshall "content",
+   if it was timed */
+IPC_RETURN_TYPE _IPC_respond (MSG_INSTANCE msgInstance, MSG_PTR msg,
+			      unsigned int length, BYTE_ARRAY content,
+			      double marshallTime)
+{
   void *replyData;
   IPC_VARCONTENT_TYPE vc;
 
-  if (!msgName || strlen(msgName) == 0) {
-    RETURN_ERROR(IPC_Null_Argument);
-  } else if (!msgInstance) {
-    RETURN_ERROR(IPC_Null_Argument);
-  } else if (!X_IPC_CONNECTED()) {
-    RETURN_ERROR(IPC_Not_Connected);
+  if (ipcDataToSend(msg->msgData->msgFormat, msg->msgData->name, 
+		    length, content, &replyData, &vc) != IPC_OK) {
+    PASS_ON_ERROR();
   } else {
-    msg = x_ipc_msgFind(msgName);
-    if (!msg) {
-      RETURN_ERROR(IPC_Message_Not_Defined);
-    } else if (ipcDataToSend(msg->msgData->msgFormat, msgName, 
-			     length, content, &replyData, &vc) != IPC_OK) {
-      PASS_ON_ERROR();
-    } else {
-      return ipcReturnValue(x_ipc_sendResponse(msgInstance, msg,
-					       (char *)replyData,
-					       ReplyClass, NULL,
-					       msgInstance->responseSd));
-    }
+    ipcStatsSent(msg, replyData, &vc, marshallTime);
+    return ipcReturnValue(x_ipc_sendResponse(msgInstance, msg,
+					     (char *)replyData,
+					     ReplyClass, NULL,
+					     msgInstance->responseSd));
   }
 }
 
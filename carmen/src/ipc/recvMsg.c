@@ -600,6 +600,11 @@ void recvMessageBuild(MODULE_PTR module, DATA_MSG_PTR dataMsg)
   if (dataMsg->intent != NO_REF)
     msg = (MSG_PTR)idTableItem(ABS(dataMsg->intent), GET_C_GLOBAL(msgIdTable));
   
+  if (msg && dataMsg->msgRef != NO_REF) {
+    msg->stats.msgsIn++;
+    msg->stats.bytesIn += dataMsg->msgTotal;
+  }
+  
   msg_class = (X_IPC_MSG_CLASS_TYPE)dataMsg->classId;
   classForm = GET_CLASS_FORMAT(&msg_class);
   
@@ -372,6 +372,7 @@ MSG_PTR x_ipc_msgCreate(MSG_DATA_PTR msgData)
   msg->priority = DEFAULT_PRIORITY;
   msg->limit    = MAX_INT;
   msg->notifyHandlerChange = FALSE;
+  bzero((void *)&msg->stats, sizeof(msg->stats));
 #endif
   
   /* 11-Jun-91: fedor: Blah! storing the parse string should 
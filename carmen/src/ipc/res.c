@@ -463,6 +463,7 @@ RESOURCE_PTR resourceCreate(int readSd, int writeSd,
   resource->attendingList = x_ipc_listCreate();
   resource->pendingLimit = NO_PENDING_LIMIT;
   resource->msgLimitList = NULL;
+  resource->publisherLimitList = NULL;
   
   RESOURCE_SET_STATUS(ActiveResource, resource);
   
@@ -712,9 +713,12 @@ void resourceDelete(RESOURCE_PTR resource)
   
   (void)x_ipc_listIterate((LIST_ITER_FN)clearLimits, 
 		    (char *)NULL, resource->msgLimitList);
+  (void)x_ipc_listIterate((LIST_ITER_FN)clearLimits, 
+		    (char *)NULL, resource->publisherLimitList);
   x_ipc_listFree(&(resource->pendingList));
   x_ipc_listFree(&(resource->attendingList));
   x_ipc_listFree(&(resource->msgLimitList));
+  x_ipc_listFree(&(resource->publisherLimitList));
   /* Need to remove references from the handlers to the resouce. */
   x_ipc_hashTableIterate((HASH_ITER_FN)clearHndRes, GET_C_GLOBAL(handlerTable), 
 		   resource);
@@ -888,17 +892,19 @@ static int32 limitEqFunc(char *msgName, LIMIT_PENDING_PTR limitPtr)
   return(x_ipc_strKeyEqFunc(msgName, limitPtr->msgName));
 }
 
-/* Returns the number of pending messages of the given name, and sets
-   the first one of the list that matches */
-static int32 numPending (const char *msgName, LIST_PTR pendingList,
-		       DISPATCH_PTR *oldest)
+/* Returns the number of pending messages of the given name (sent by the
+   given module, unless "org" is NULL), and sets the first one of the
+   list that matches */
+static int32 numPending (const char *msgName, MODULE_PTR org,
+			 LIST_PTR pendingList, DISPATCH_PTR *oldest)
 {
   DISPATCH_PTR dispatch;
   int32 num = 0;
   
   dispatch = (DISPATCH_PTR)x_ipc_listFirst(pendingList);
   while (dispatch) {
-    if (STREQ(dispatch->msg->msgData->name, msgName)) {
+    if (STREQ(dispatch->msg->msgData->name, msgName) &&
+	(!org || dispatch->org == org)) {
       if (num == 0) *oldest = dispatch;
       num++;
     }
@@ -952,9 +958,10 @@ static void deletePendingDispatch(DISPATCH_PTR dispatch)
 }
 
 /* Delete the dispatch, but move all dispatches with the same message name
-   up, to ensure fairness */
+   (and from the same module, unless "org" is NULL) up, to ensure fairness */
 static void removePendingWithFairness (DISPATCH_PTR oldDispatch, 
-				       DISPATCH_PTR newDispatch)
+				       DISPATCH_PTR newDispatch,
+				       MODULE_PTR org)
 {
   DISPATCH_PTR moveUp;
   LIST_PTR pendingList;
@@ -970,7 +977,8 @@ static void removePendingWithFairness (DISPATCH_PTR oldDispatch,
   element = pendingList->first;
   while (element) {
     moveUp = (DISPATCH_PTR)element->item;
-    if (STREQ(moveUp->msg->msgData->name, msgName)) {
+    if (STREQ(moveUp->msg->msgData->name, msgName) &&
+	(!org || moveUp->org == org)) {
       if (lastDispatchElement) {
 	lastDispatchElement->item = element->item;
       }
@@ -1014,16 +1022,28 @@ void resourcePending(DISPATCH_PTR dispatch)
 					   dispatch->hnd->hndData->msgName,
 					   resource->msgLimitList);
     if (msgLimit &&
-	msgLimit->limit <= numPending(msgLimit->msgName,
+	msgLimit->limit <= numPending(msgLimit->msgName, NULL,
+				      resource->pendingList, &oldest)) {
+      removePendingWithFairness(oldest, dispatch, NULL);
+      return;
+    }
+  }
+  if (resource->publisherLimitList) {
+    msgLimit = 
+      (LIMIT_PENDING_PTR)x_ipc_listMemReturnItem((LIST_ITER_FN)limitEqFunc,
+					   dispatch->hnd->hndData->msgName,
+					   resource->publisherLimitList);
+    if (msgLimit &&
+	msgLimit->limit <= numPending(msgLimit->msgName, dispatch->org,
 				      resource->pendingList, &oldest)) {
-      removePendingWithFairness(oldest, dispatch);
+      removePendingWithFairness(oldest, dispatch, dispatch->org);
       return;
     }
   }
   if (resource->pendingLimit != NO_PENDING_LIMIT &&
       resource->pendingLimit <= x_ipc_listLength(resource->pendingList)) {
     oldest = (DISPATCH_PTR)x_ipc_listFirst(resource->pendingList);
-    removePendingWithFairness(oldest, dispatch);
+    removePendingWithFairness(oldest, dispatch, NULL);
     return;
   }
   
@@ -1231,26 +1251,31 @@ static void addHndToResourceHnd(DISPATCH_PTR dispatch,
 
 /******************************************************************************
  *
- * FUNCTION: void limitPendingHnd(dispatch, limitPendingData)
+ * FUNCTION: void limitPending(dispatch, limitPendingData, byPublisher)
  *
- * DESCRIPTION: The handler for both x_ipcLimitPendingMessages and
- *                x_ipcLimitPendingResource.
+ * DESCRIPTION: Does the work of limitPendingHnd and
+ *                limitPendingByPublisherHnd.
  *              If the msgName field is NULL, the limit applies to all
  *                messages in the resource, o/w just to the named message.
+ *              If "byPublisher", the limit on a named message is kept
+ *                separately for each module that sends it.  A message is
+ *                limited one way or the other; the latest request wins.
  *              The resource must have been registered already.
  *
  * INPUTS: 
  * DISPATCH_PTR dispatch;
  * LIMIT_PENDING_PTR limitPendingData;
+ * BOOLEAN byPublisher;
  *
  * OUTPUTS: void.
  *
  *****************************************************************************/
 
-static void limitPendingHnd(DISPATCH_PTR dispatch,
-			    LIMIT_PENDING_PTR limitPendingData)
+static void limitPending(DISPATCH_PTR dispatch,
+			 LIMIT_PENDING_PTR limitPendingData,
+			 BOOLEAN byPublisher)
 {
-  LIST_PTR resList;
+  LIST_PTR resList, *limitList, otherList;
   RESOURCE_PTR resource;
   LIMIT_PENDING_PTR msgLimit;
   int32 freeData = TRUE;
@@ -1285,13 +1310,27 @@ static void limitPendingHnd(DISPATCH_PTR dispatch,
       }
       resource->pendingLimit = limitPendingData->limit;
     } else {
-      if (!resource->msgLimitList) resource->msgLimitList = x_ipc_listCreate();
+      limitList = (byPublisher ? &resource->publisherLimitList
+		   : &resource->msgLimitList);
+      otherList = (byPublisher ? resource->msgLimitList
+		   : resource->publisherLimitList);
+      if (otherList) {
+	msgLimit = 
+	  (LIMIT_PENDING_PTR)x_ipc_listMemReturnItem((LIST_ITER_FN)limitEqFunc,
+					       limitPendingData->msgName,
+					       otherList);
+	if (msgLimit) {
+	  x_ipc_listDeleteItem(msgLimit, otherList);
+	  clearLimits(NULL, msgLimit);
+	}
+      }
+      if (!*limitList) *limitList = x_ipc_listCreate();
       msgLimit = 
 	(LIMIT_PENDING_PTR)x_ipc_listMemReturnItem((LIST_ITER_FN)limitEqFunc,
 					     limitPendingData->msgName,
-					     resource->msgLimitList);
+					     *limitList);
       if (!msgLimit) {
-	x_ipc_listInsertItem(limitPendingData, resource->msgLimitList);
+	x_ipc_listInsertItem(limitPendingData, *limitList);
 	freeData = FALSE;
       } else if (msgLimit->limit != limitPendingData->limit) {
 	LOG_STATUS3("WARNING: Changing pending message limit of %s from %d to %d",
@@ -1305,6 +1344,35 @@ static void limitPendingHnd(DISPATCH_PTR dispatch,
     x_ipc_freeDataStructure(dispatch->msg->msgData->msgFormat, limitPendingData);
   }
 }
+
+/******************************************************************************
+ *
+ * FUNCTION: void limitPendingHnd(dispatch, limitPendingData)
+ *
+ * DESCRIPTION: The handler for both x_ipcLimitPendingMessages and
+ *                x_ipcLimitPendingResource.
+ *
+ *****************************************************************************/
+
+static void limitPendingHnd(DISPATCH_PTR dispatch,
+			    LIMIT_PENDING_PTR limitPendingData)
+{
+  limitPending(dispatch, limitPendingData, FALSE);
+}
+
+/******************************************************************************
+ *
+ * FUNCTION: void limitPendingByPublisherHnd(dispatch, limitPendingData)
+ *
+ * DESCRIPTION: The handler for x_ipcLimitPendingMessagesByPublisher.
+ *
+ *****************************************************************************/
+
+static void limitPendingByPublisherHnd(DISPATCH_PTR dispatch,
+				       LIMIT_PENDING_PTR limitPendingData)
+{
+  limitPending(dispatch, limitPendingData, TRUE);
+}
 
 /*****************************************************************
  * Return TRUE if the resource lock/reservation request came from
@@ -1667,6 +1735,11 @@ void resourceInitialize(void)
 			limitPendingHnd);
   Add_Message_To_Ignore(X_IPC_LIMIT_PENDING_INFORM_OLD);
   
+  centralRegisterInform(X_IPC_LIMIT_PENDING_BY_PUBLISHER_INFORM,
+			X_IPC_LIMIT_PENDING_INFORM_FORMAT,
+			limitPendingByPublisherHnd);
+  Add_Message_To_Ignore(X_IPC_LIMIT_PENDING_BY_PUBLISHER_INFORM);
+  
   centralRegisterQuery(X_IPC_RESERVE_RESOURCE_QUERY,
 		       X_IPC_RESERVE_RESOURCE_QUERY_FORMAT,
 		       X_IPC_RESERVE_RESOURCE_QUERY_REPLY,
@@ -1756,7 +1829,7 @@ static BOOLEAN purgeResoucePendingItr(void *key, LIST_PTR resList)
       oldest = (DISPATCH_PTR)x_ipc_listFirst(resource->pendingList);
       newest = (DISPATCH_PTR)x_ipc_listLast(resource->pendingList);
       if ((oldest) && (newest) && (oldest != newest))
-	removePendingWithFairness(oldest, newest);
+	removePendingWithFairness(oldest, newest, NULL);
       tmp = nextTmp;
     }
   }
@@ -1770,6 +1843,47 @@ void purgeResoucePending(void)
 }
 
 
+/******************************************************************************
+ *
+ * FUNCTION: void resourceCountPending(void)
+ *
+ * DESCRIPTION: Add the messages waiting on each resource to the pending
+ *              count of their message.
+ *
+ * INPUTS: void
+ *
+ * OUTPUTS: void
+ *
+ *****************************************************************************/
+
+static BOOLEAN countPendingItr(void *key, LIST_PTR resList)
+{
+#ifdef UNUSED_PRAGMA
+#pragma unused(key)
+#endif
+  const LIST_ELEM_TYPE *tmp, *pending;
+  RESOURCE_PTR resource;
+  
+  if (!resList)
+    return FALSE;
+  else {
+    for (tmp = resList->first; tmp; tmp = tmp->next) {
+      resource = (RESOURCE_PTR) tmp->item;
+      for (pending = resource->pendingList->first; pending;
+	   pending = pending->next)
+	((DISPATCH_PTR)pending->item)->msg->stats.pending++;
+    }
+  }
+  return TRUE;
+}
+
+void resourceCountPending(void)
+{  
+  x_ipc_hashTableIterate((HASH_ITER_FN)countPendingItr,
+		   GET_C_GLOBAL(resourceTable), NULL);
+}
+
+
 /******************************************************************************
  *
  * FUNCTION: void showResourceStatus(void)
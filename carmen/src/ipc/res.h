@@ -153,6 +153,7 @@ typedef struct _RESOURCE {
   struct _LIST *pendingList, *attendingList;
   int32 pendingLimit;
   LIST_PTR msgLimitList;
+  LIST_PTR publisherLimitList; /* Limits counted per publishing module */
 } RESOURCE_TYPE, *RESOURCE_PTR;
 
 #define RESOURCE_SET_STATUS(stat, resource) (resource->status = stat) 
@@ -173,6 +174,7 @@ void resourceProcessPending(DISPATCH_PTR dispatch);
 
 void resourceInitialize(void);
 void purgeResoucePending(void);
+void resourceCountPending(void);
 void showResourceStatus(void);
 void unlockResource(char *name);
 
@@ -290,6 +290,41 @@ void x_ipcLimitPendingMessages(const char *msgName, const char *resName,
   (void)x_ipcInform(X_IPC_LIMIT_PENDING_INFORM, (void *)&limitPendingData);
 }
 
+/******************************************************************************
+ *
+ * FUNCTION: void x_ipcLimitPendingMessagesByPublisher(msgName, resName, limit)
+ *
+ * DESCRIPTION: Like x_ipcLimitPendingMessages, but the limit applies to
+ *              the messages from each sending module separately, so that
+ *              the latest message of every publisher is kept.
+ *
+ * INPUTS: char *msgName; Name of the message to limit
+ *         char *resName; Name of the resource whose pending queue is affected
+ *         int32 limit;     Maximum number of pending messages to maintain,
+ *                          per publishing module
+ *
+ * OUTPUTS: void
+ *
+ *****************************************************************************/
+
+void x_ipcLimitPendingMessagesByPublisher(const char *msgName,
+					  const char *resName, int32 limit)
+{
+  LIMIT_PENDING_TYPE limitPendingData;
+  
+  limitPendingData.msgName = msgName;
+  limitPendingData.resName = resName;
+  limitPendingData.limit = limit;
+  
+  if (limit < 0) {
+    X_IPC_MOD_ERROR2("Illegal pending limit %d for %s ignored.", limit, msgName);
+    return;
+  }
+  
+  (void)x_ipcInform(X_IPC_LIMIT_PENDING_BY_PUBLISHER_INFORM,
+		    (void *)&limitPendingData);
+}
+
 /******************************************************************************
  *
  * FUNCTION: X_IPC_REF_PTR x_ipcReserveResource(resName)
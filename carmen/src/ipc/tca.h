@@ -756,6 +756,9 @@ IPC_EXTERN_FUNCTION( void x_ipcRegisterExitProc,
 IPC_EXTERN_FUNCTION( void x_ipcLimitPendingMessages,
 		     (const char *msgName, const char *resName, int32 limit));
 
+IPC_EXTERN_FUNCTION( void x_ipcLimitPendingMessagesByPublisher,
+		     (const char *msgName, const char *resName, int32 limit));
+
 IPC_EXTERN_FUNCTION( void x_ipcIgnoreLogging, (char *msgName));
 
 IPC_EXTERN_FUNCTION( void x_ipcResumeLogging, (char *msgName));
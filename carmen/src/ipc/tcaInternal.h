@@ -827,6 +827,7 @@ typedef struct _MSG {
   int32 priority;
   int32 limit; /* Queue limit. Used for modules & direct connection messages */
   int notifyHandlerChange;
+  IPC_MSG_STATS_TYPE stats;
 #endif
 } MSG_TYPE, *MSG_PTR;
 
@@ -180,6 +180,11 @@ public class IPC {
     msgHashTable.put(handlerName, hashKey);
     msgHashTable.put(hashKey, new handlerHashData(msgHandler, dataClass));
 
+    /* Compile the marshalling for the data class now, rather than
+       for the first message */
+    if (IPC_isMsgDefined(msgName))
+      codecs.precompile(IPC_msgFormatter(msgName), coerceDataClass(dataClass));
+
     return IPC_subscribe(msgName, handlerName, handlerNum);
   }
 
@@ -376,9 +381,9 @@ public class IPC {
     formatters.VARCONTENT varcontent = new formatters.VARCONTENT();
     int retVal, marshallRet = IPC_OK;
 
-    try { marshallRet = formatters.marshall(IPC_msgFormatter(msgName), 
-					    coerceDataObject(data), 
-					    varcontent);
+    try { marshallRet = codecs.marshall(IPC_msgFormatter(msgName), 
+					coerceDataObject(data), 
+					varcontent);
     } catch ( Exception e) { 
       handleException("publishData", msgName, e);
     }
@@ -386,7 +391,7 @@ public class IPC {
       return IPC_Error;
     } else {
       retVal = IPC_publish(msgName, varcontent.length, varcontent.byteArray);
-      if (varcontent.byteArray != 0) IPC_freeByteArray(varcontent.byteArray);
+      codecs.release(varcontent);
 
       return retVal;
     } 
@@ -416,8 +421,8 @@ public class IPC {
     int retVal, marshallRet = IPC_OK;
 
     try {
-      marshallRet = formatters.marshall(IPC_msgFormatter(msgName), 
-					coerceDataObject(data), varcontent);
+      marshallRet = codecs.marshall(IPC_msgFormatter(msgName), 
+				    coerceDataObject(data), varcontent);
     } catch ( Exception e) {
       handleException("respondData", msgName, e);
     }
@@ -426,7 +431,7 @@ public class IPC {
     } else {
       retVal = IPC_respond(msgInstance.cptr, msgName,
 			   varcontent.length, varcontent.byteArray);
-      if (varcontent.byteArray != 0) IPC_freeByteArray(varcontent.byteArray);
+      codecs.release(varcontent);
       return retVal;
     }
   }
@@ -464,8 +469,8 @@ public class IPC {
     int retVal, marshallRet = IPC_OK;
 
     try {
-      marshallRet = formatters.marshall(IPC_msgFormatter(msgName), 
-					coerceDataObject(data), varcontent);
+      marshallRet = codecs.marshall(IPC_msgFormatter(msgName), 
+				    coerceDataObject(data), varcontent);
     } catch ( Exception e) {
       handleException("queryNotifyData", msgName, e);
     }
@@ -479,7 +484,7 @@ public class IPC {
 
       retVal = IPC_queryNotify(msgName, varcontent.length, 
 			       varcontent.byteArray, handlerNum);
-      if (varcontent.byteArray != 0) IPC_freeByteArray(varcontent.byteArray);
+      codecs.release(varcontent);
       return retVal;
     }
   }
@@ -534,17 +539,17 @@ public class IPC {
     int retVal;
 
     try {
-      if (formatters.marshall(IPC_msgFormatter(msgName),coerceDataObject(data),
-			      varcontent) != IPC_Error) {
+      if (codecs.marshall(IPC_msgFormatter(msgName), coerceDataObject(data),
+			  varcontent) != IPC_Error) {
 	queryResponse response = new queryResponse();
 
 	retVal = IPC_queryResponse(msgName, varcontent.length,
 				   varcontent.byteArray, response,
 				   timeoutMSecs);
-	if (varcontent.byteArray != 0) IPC_freeByteArray(varcontent.byteArray);
+	codecs.release(varcontent);
 	if (retVal == IPC_OK && varcontent.byteArray != 0) {
 	  responseObject = unmarshallMsgData(response.formatter,
-					     response.byteArray,
+					     response.byteArray, -1,
 					     responseClass);
 	}
       }
@@ -821,8 +826,9 @@ public class IPC {
     }
   }
 
+  /* "length" is that of the byte array, or -1 if not known */
   private static Object unmarshallMsgData (int formatter, int byteArray,
-					   Class msgDataClass) 
+					   int length, Class msgDataClass) 
       throws Exception {
     Object object = null;
 
@@ -837,7 +843,7 @@ public class IPC {
       // Create an object type that Java IPC can handle
       object = coerceDataClass(msgDataClass).newInstance();
     }
-    formatters.unmarshall(formatter, byteArray, object);
+    codecs.unmarshall(formatter, byteArray, length, object);
     IPC_freeByteArray(byteArray);
     if (formatters.IPCPrim.class.isAssignableFrom(object.getClass())) {
 	object = ((formatters.IPCPrim)object).coerce();
@@ -856,6 +862,7 @@ public class IPC {
       try {
 	  int formatter = IPC_msgInstanceFormatter(msgInstance);
 	  object = unmarshallMsgData(formatter, byteArray,
+				     IPC_dataLength(msgInstance),
 				     handlerData.dataClass);
 	  handlerData.handler.handle(new MSG_INSTANCE(msgInstance), object);
       } catch ( Exception e) {
@@ -878,7 +885,8 @@ public class IPC {
       Object object;
       try {
 	object = unmarshallMsgData(IPC_msgInstanceFormatter(msgInstance),
-				   byteArray, handlerData.dataClass);
+				   byteArray, IPC_dataLength(msgInstance),
+				   handlerData.dataClass);
 	handlerData.handler.handle(new MSG_INSTANCE(msgInstance), object);
       } catch ( Exception e) { 
 	handleException("queryNotifyCallbackHandler", 
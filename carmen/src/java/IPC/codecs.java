@@ -0,0 +1,745 @@
+/*****************************************************************************
+ * PROJECT:	CARMEN
+ *
+ * FILE:	codecs.java
+ *
+ * DESCRIPTION: Compiled marshalling of JAVA objects for IPC.
+ *
+ *              formatters walks the C format tree through JNI and looks
+ *              fields up by reflection for every value of every message.
+ *              Here the format is walked once per (formatter, class) pair
+ *              and turned into a tree of codecs that hold the fields they
+ *              read and write.  Messages are encoded into a direct
+ *              ByteBuffer that IPC sends from without copying, and decoded
+ *              from a ByteBuffer over the received byte array, with bulk
+ *              transfers for arrays of numbers.
+ *
+ *              Formats and classes the codecs cannot handle (and any
+ *              mismatch between the two) are left to formatters, which
+ *              also reports the errors.
+ *
+ *****************************************************************************/
+
+package IPC;
+
+import java.lang.reflect.Array;
+import java.lang.reflect.Field;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Map;
+
+public class codecs {
+  /* Off until ipcBench has been run against C programs; set to true to
+     marshall with the codecs rather than with formatters */
+  public static boolean enabled = false;
+
+  private native static ByteBuffer byteArrayBuffer(int byteArray, int length);
+  private native static int bufferAddress(ByteBuffer buffer);
+  private native static boolean dataIsBigEndian();
+  private native static void freeByteArray(int byteArray);
+
+  /* A codec reads and writes one value of "object": one of its fields, or
+     for structures and arrays with no field, the object itself */
+  private static abstract class Codec {
+    abstract int size (Object object) throws Exception;
+    abstract void encode (Object object, ByteBuffer buffer) throws Exception;
+    abstract void decode (Object object, ByteBuffer buffer) throws Exception;
+    /* A new value to decode into, for elements of arrays */
+    Object newValue () throws Exception {
+      throw new Exception("Cannot create an array element of this format");
+    }
+  }
+
+  private static Class primClass (int type) throws Exception {
+    switch (type) {
+    case primFmttrs.CHAR_FMT: return char.class;
+    case primFmttrs.BOOLEAN_FMT: return boolean.class;
+    case primFmttrs.BYTE_FMT:
+    case primFmttrs.UBYTE_FMT: return byte.class;
+    case primFmttrs.SHORT_FMT:
+    case primFmttrs.USHORT_FMT: return short.class;
+    case primFmttrs.INT_FMT:
+    case primFmttrs.UINT_FMT: return int.class;
+    case primFmttrs.LONG_FMT:
+    case primFmttrs.ULONG_FMT: return long.class;
+    case primFmttrs.FLOAT_FMT: return float.class;
+    case primFmttrs.DOUBLE_FMT: return double.class;
+    case primFmttrs.STR_FMT: return String.class;
+    default: throw new Exception("Unhandled format "+ type);
+    }
+  }
+
+  /* Bytes taken by a value of the type; 0 for strings, whose size varies */
+  private static int primSize (int type) {
+    switch (type) {
+    case primFmttrs.CHAR_FMT: return primFmttrs.CHAR_SIZE;
+    case primFmttrs.BYTE_FMT:
+    case primFmttrs.UBYTE_FMT: return primFmttrs.BYTE_SIZE;
+    case primFmttrs.SHORT_FMT:
+    case primFmttrs.USHORT_FMT: return primFmttrs.SHORT_SIZE;
+    case primFmttrs.LONG_FMT:
+    case primFmttrs.ULONG_FMT: return primFmttrs.LONG_SIZE;
+    case primFmttrs.FLOAT_FMT: return primFmttrs.FLOAT_SIZE;
+    case primFmttrs.DOUBLE_FMT: return primFmttrs.DOUBLE_SIZE;
+    case primFmttrs.STR_FMT: return 0;
+    default: return primFmttrs.INT_SIZE;
+    }
+  }
+
+  /* IPC sends longs as 32 bit ints */
+  private static int checkedLong (long theLong) throws Exception {
+    if (theLong > Integer.MAX_VALUE || theLong < Integer.MIN_VALUE) {
+      throw new Exception("Will lose precision in transferring long: "
+			  + theLong);
+    }
+    return (int)theLong;
+  }
+
+  /* Length of the string in bytes, as sent; only strings that are not
+     plain ASCII need to be converted to find it */
+  private static int byteLength (String string) throws Exception {
+    int i, length = string.length();
+
+    for (i=0; i<length; i++)
+      if (string.charAt(i) >= 0x80) return string.getBytes("UTF-8").length;
+    return length;
+  }
+
+  /* Strings go as their length, then the characters; an empty string
+     (or null) as a zero length and a single 'Z' */
+  private static int stringSize (String string) throws Exception {
+    int length = (string == null ? 0 : byteLength(string));
+    return primFmttrs.INT_SIZE + (length == 0 ? 1 : length);
+  }
+
+  private static void putString (ByteBuffer buffer, String string)
+    throws Exception {
+    int i, length = (string == null ? 0 : byteLength(string));
+
+    buffer.putInt(length);
+    if (length == 0) {
+      buffer.put((byte)'Z');
+    } else if (length == string.length()) {
+      for (i=0; i<length; i++) buffer.put((byte)string.charAt(i));
+    } else {
+      buffer.put(string.getBytes("UTF-8"));
+    }
+  }
+
+  private static String getString (ByteBuffer buffer) throws Exception {
+    int length = buffer.getInt();
+
+    if (length == 0) {
+      buffer.get();
+      return "";
+    } else {
+      byte[] bytes = new byte[length];
+      buffer.get(bytes);
+      return new String(bytes, "UTF-8");
+    }
+  }
+
+  private static void skip (ByteBuffer buffer, int n) {
+    buffer.position(buffer.position() + n);
+  }
+
+  private static int elementsSize (int type, Object array, int len)
+    throws Exception {
+    int i, size = 0;
+
+    if (type != primFmttrs.STR_FMT) return len*primSize(type);
+    for (i=0; i<len; i++) size += stringSize(((String[])array)[i]);
+    return size;
+  }
+
+  private static void encodeElements (int type, Object array, int len,
+				      ByteBuffer buffer) throws Exception {
+    int i;
+
+    switch (type) {
+    case primFmttrs.BYTE_FMT:
+    case primFmttrs.UBYTE_FMT:
+      buffer.put((byte[])array, 0, len); break;
+    case primFmttrs.SHORT_FMT:
+    case primFmttrs.USHORT_FMT:
+      buffer.asShortBuffer().put((short[])array, 0, len);
+      skip(buffer, len*primFmttrs.SHORT_SIZE); break;
+    case primFmttrs.INT_FMT:
+    case primFmttrs.UINT_FMT:
+      buffer.asIntBuffer().put((int[])array, 0, len);
+      skip(buffer, len*primFmttrs.INT_SIZE); break;
+    case primFmttrs.FLOAT_FMT:
+      buffer.asFloatBuffer().put((float[])array, 0, len);
+      skip(buffer, len*primFmttrs.FLOAT_SIZE); break;
+    case primFmttrs.DOUBLE_FMT:
+      buffer.asDoubleBuffer().put((double[])array, 0, len);
+      skip(buffer, len*primFmttrs.DOUBLE_SIZE); break;
+    case primFmttrs.CHAR_FMT:
+      for (i=0; i<len; i++) buffer.put((byte)((char[])array)[i]);
+      break;
+    case primFmttrs.BOOLEAN_FMT:
+      for (i=0; i<len; i++) buffer.putInt(((boolean[])array)[i] ? 1 : 0);
+      break;
+    case primFmttrs.LONG_FMT:
+    case primFmttrs.ULONG_FMT:
+      for (i=0; i<len; i++) buffer.putInt(checkedLong(((long[])array)[i]));
+      break;
+    case primFmttrs.STR_FMT:
+      for (i=0; i<len; i++) putString(buffer, ((String[])array)[i]);
+      break;
+    }
+  }
+
+  private static void decodeElements (int type, Object array, int len,
+				      ByteBuffer buffer) throws Exception {
+    int i;
+
+    switch (type) {
+    case primFmttrs.BYTE_FMT:
+    case primFmttrs.UBYTE_FMT:
+      buffer.get((byte[])array, 0, len); break;
+    case primFmttrs.SHORT_FMT:
+    case primFmttrs.USHORT_FMT:
+      buffer.asShortBuffer().get((short[])array, 0, len);
+      skip(buffer, len*primFmttrs.SHORT_SIZE); break;
+    case primFmttrs.INT_FMT:
+    case primFmttrs.UINT_FMT:
+      buffer.asIntBuffer().get((int[])array, 0, len);
+      skip(buffer, len*primFmttrs.INT_SIZE); break;
+    case primFmttrs.FLOAT_FMT:
+      buffer.asFloatBuffer().get((float[])array, 0, len);
+      skip(buffer, len*primFmttrs.FLOAT_SIZE); break;
+    case primFmttrs.DOUBLE_FMT:
+      buffer.asDoubleBuffer().get((double[])array, 0, len);
+      skip(buffer, len*primFmttrs.DOUBLE_SIZE); break;
+    case primFmttrs.CHAR_FMT:
+      for (i=0; i<len; i++) ((char[])array)[i] = (char)buffer.get();
+      break;
+    case primFmttrs.BOOLEAN_FMT:
+      for (i=0; i<len; i++) ((boolean[])array)[i] = (buffer.getInt() != 0);
+      break;
+    case primFmttrs.LONG_FMT:
+    case primFmttrs.ULONG_FMT:
+      for (i=0; i<len; i++) ((long[])array)[i] = buffer.getInt();
+      break;
+    case primFmttrs.STR_FMT:
+      for (i=0; i<len; i++) ((String[])array)[i] = getString(buffer);
+      break;
+    }
+  }
+
+  private static class PrimCodec extends Codec {
+    PrimCodec (int theType, Field theField) {
+      type = theType; field = theField; size = primSize(type);
+    }
+
+    int size (Object object) throws Exception {
+      return (type == primFmttrs.STR_FMT
+	      ? stringSize((String)field.get(object)) : size);
+    }
+
+    void encode (Object object, ByteBuffer buffer) throws Exception {
+      switch (type) {
+      case primFmttrs.CHAR_FMT:
+	buffer.put((byte)field.getChar(object)); break;
+      case primFmttrs.BYTE_FMT:
+      case primFmttrs.UBYTE_FMT:
+	buffer.put(field.getByte(object)); break;
+      case primFmttrs.SHORT_FMT:
+      case primFmttrs.USHORT_FMT:
+	buffer.putShort(field.getShort(object)); break;
+      case primFmttrs.INT_FMT:
+      case primFmttrs.UINT_FMT:
+	buffer.putInt(field.getInt(object)); break;
+      case primFmttrs.BOOLEAN_FMT:
+	buffer.putInt(field.getBoolean(object) ? 1 : 0); break;
+      case primFmttrs.LONG_FMT:
+      case primFmttrs.ULONG_FMT:
+	buffer.putInt(checkedLong(field.getLong(object))); break;
+      case primFmttrs.FLOAT_FMT:
+	buffer.putFloat(field.getFloat(object)); break;
+      case primFmttrs.DOUBLE_FMT:
+	buffer.putDouble(field.getDouble(object)); break;
+      case primFmttrs.STR_FMT:
+	putString(buffer, (String)field.get(object)); break;
+      }
+    }
+
+    void decode (Object object, ByteBuffer buffer) throws Exception {
+      switch (type) {
+      case primFmttrs.CHAR_FMT:
+	field.setChar(object, (char)buffer.get()); break;
+      case primFmttrs.BYTE_FMT:
+      case primFmttrs.UBYTE_FMT:
+	field.setByte(object, buffer.get()); break;
+      case primFmttrs.SHORT_FMT:
+      case primFmttrs.USHORT_FMT:
+	field.setShort(object, buffer.getShort()); break;
+      case primFmttrs.INT_FMT:
+      case primFmttrs.UINT_FMT:
+	field.setInt(object, buffer.getInt()); break;
+      case primFmttrs.BOOLEAN_FMT:
+	field.setBoolean(object, buffer.getInt() != 0); break;
+      case primFmttrs.LONG_FMT:
+      case primFmttrs.ULONG_FMT:
+	field.setLong(object, buffer.getInt()); break;
+      case primFmttrs.FLOAT_FMT:
+	field.setFloat(object, buffer.getFloat()); break;
+      case primFmttrs.DOUBLE_FMT:
+	field.setDouble(object, buffer.getDouble()); break;
+      case primFmttrs.STR_FMT:
+	field.set(object, getString(buffer)); break;
+      }
+    }
+
+    private int type, size;
+    private Field field;
+  }
+
+  private static class StructCodec extends Codec {
+    StructCodec (Field theField, Class theClass, Codec[] theMembers) {
+      field = theField; structClass = theClass; members = theMembers;
+    }
+
+    private Object struct (Object object) throws Exception {
+      return (field == null ? object : field.get(object));
+    }
+
+    int size (Object object) throws Exception {
+      Object struct = struct(object);
+      int i, size = 0;
+
+      for (i=0; i<members.length; i++) size += members[i].size(struct);
+      return size;
+    }
+
+    void encode (Object object, ByteBuffer buffer) throws Exception {
+      Object struct = struct(object);
+
+      for (int i=0; i<members.length; i++) members[i].encode(struct, buffer);
+    }
+
+    void decode (Object object, ByteBuffer buffer) throws Exception {
+      Object struct = struct(object);
+
+      if (struct == null) {
+	struct = structClass.newInstance();
+	field.set(object, struct);
+      }
+      for (int i=0; i<members.length; i++) members[i].decode(struct, buffer);
+    }
+
+    Object newValue () throws Exception { return structClass.newInstance(); }
+
+    private Field field;
+    private Class structClass;
+    private Codec[] members;
+  }
+
+  /* Fixed and variable length arrays, of any number of dimensions.  The
+     sizes of a variable length array are fields of the enclosing
+     structure; on the wire it is preceded by its number of elements. */
+  private static class ArrayCodec extends Codec {
+    ArrayCodec (Field theField, Class theClass, int[] theDims,
+		Field[] theSizeFields, int theElementType, Codec theElement) {
+      field = theField; arrayClass = theClass; dims = theDims;
+      sizeFields = theSizeFields; elementType = theElementType;
+      element = theElement;
+      numDims = (dims != null ? dims.length : sizeFields.length);
+    }
+
+    private int dim (int d, Object struct) throws Exception {
+      return (sizeFields == null ? dims[d] : sizeFields[d].getInt(struct));
+    }
+
+    private int numElements (Object struct) throws Exception {
+      int d, n = 1;
+
+      for (d=0; d<numDims; d++) n *= dim(d, struct);
+      return n;
+    }
+
+    private static Object reuse (Object array, Class arrayClass, int len) {
+      return (array != null && Array.getLength(array) == len ? array
+	      : Array.newInstance(arrayClass.getComponentType(), len));
+    }
+
+    private int arraySize (Object array, int d, Object struct)
+      throws Exception {
+      int i, size = 0, len = dim(d, struct);
+
+      if (d < numDims-1) {
+	for (i=0; i<len; i++)
+	  size += arraySize(((Object[])array)[i], d+1, struct);
+      } else if (element == null) {
+	size = elementsSize(elementType, array, len);
+      } else {
+	for (i=0; i<len; i++) size += element.size(((Object[])array)[i]);
+      }
+      return size;
+    }
+
+    private void encodeArray (Object array, int d, Object struct,
+			      ByteBuffer buffer) throws Exception {
+      int i, len = dim(d, struct);
+
+      if (d < numDims-1) {
+	for (i=0; i<len; i++)
+	  encodeArray(((Object[])array)[i], d+1, struct, buffer);
+      } else if (element == null) {
+	encodeElements(elementType, array, len, buffer);
+      } else {
+	for (i=0; i<len; i++) element.encode(((Object[])array)[i], buffer);
+      }
+    }
+
+    private void decodeArray (Object array, int d, int len, Object struct,
+			      ByteBuffer buffer) throws Exception {
+      int i;
+
+      if (d < numDims-1) {
+	Object[] arrays = (Object[])array;
+	Class subClass = array.getClass().getComponentType();
+	int nextLen = dim(d+1, struct);
+	for (i=0; i<len; i++) {
+	  arrays[i] = reuse(arrays[i], subClass, nextLen);
+	  decodeArray(arrays[i], d+1, nextLen, struct, buffer);
+	}
+      } else if (element == null) {
+	decodeElements(elementType, array, len, buffer);
+      } else {
+	Object[] elements = (Object[])array;
+	for (i=0; i<len; i++) {
+	  if (elements[i] == null) elements[i] = element.newValue();
+	  element.decode(elements[i], buffer);
+	}
+      }
+    }
+
+    int size (Object object) throws Exception {
+      Object array = (field == null ? object : field.get(object));
+
+      return ((sizeFields != null ? primFmttrs.INT_SIZE : 0) +
+	      arraySize(array, 0, object));
+    }
+
+    void encode (Object object, ByteBuffer buffer) throws Exception {
+      Object array = (field == null ? object : field.get(object));
+
+      if (sizeFields != null) buffer.putInt(numElements(object));
+      encodeArray(array, 0, object, buffer);
+    }
+
+    void decode (Object object, ByteBuffer buffer) throws Exception {
+      int len = (sizeFields == null ? dims[0] : buffer.getInt());
+      Object array;
+
+      if (sizeFields != null && numDims > 1) len = dim(0, object);
+      if (field == null) {
+	/* Top-level arrays are created by the caller */
+	array = object;
+      } else {
+	array = reuse(field.get(object), arrayClass, len);
+	field.set(object, array);
+      }
+      decodeArray(array, 0, len, object, buffer);
+    }
+
+    Object newValue () throws Exception {
+      return Array.newInstance(arrayClass.getComponentType(), dims[0]);
+    }
+
+    private Field field;
+    private Class arrayClass;
+    private int[] dims;
+    private Field[] sizeFields;
+    private int numDims, elementType;
+    private Codec element;
+  }
+
+  /* Pointers go as a 'Z' (or 0 for null) and then the data pointed to.
+     The target is compiled when first needed, since formats that point
+     to themselves would otherwise never finish compiling. */
+  private static class PointerCodec extends Codec {
+    PointerCodec (int theFormat, int theParentFormat, Class theClass,
+		  Field[] theFields, int theIndex) {
+      format = theFormat; parentFormat = theParentFormat;
+      enclosingClass = theClass; fields = theFields; index = theIndex;
+      field = fields[index];
+    }
+
+    private Codec target () throws Exception {
+      if (target == null)
+	target = compile(formatters.formatChoosePtrFormat(format, parentFormat),
+			 enclosingClass, fields, index, 0);
+      return target;
+    }
+
+    int size (Object object) throws Exception {
+      return 1 + (field.get(object) != null ? target().size(object) : 0);
+    }
+
+    void encode (Object object, ByteBuffer buffer) throws Exception {
+      if (field.get(object) == null) {
+	buffer.put((byte)0);
+      } else {
+	buffer.put((byte)'Z');
+	target().encode(object, buffer);
+      }
+    }
+
+    void decode (Object object, ByteBuffer buffer) throws Exception {
+      if (buffer.get() == 0) {
+	field.set(object, null);
+      } else {
+	target().decode(object, buffer);
+      }
+    }
+
+    private int format, parentFormat, index;
+    private Class enclosingClass;
+    private Field[] fields;
+    private Field field;
+    private Codec target;
+  }
+
+  private static Field checkedField (Field[] fields, int index, Class type)
+    throws Exception {
+    if (index >= fields.length ||
+	(type != null && fields[index].getType() != type)) {
+      throw new Exception("Data structure does not match format");
+    }
+    /* As formatters does, for public fields of classes that are not */
+    fields[index].setAccessible(true);
+    return fields[index];
+  }
+
+  private static Codec compileArray (int format, boolean variable,
+				     Class oclass, Field[] fields, int index)
+    throws Exception {
+    int formatArray = formatters.formatFormatArray(format);
+    int elementFormat = formatters.formatFormatArrayItem(formatArray, 1);
+    int d, numDims = formatters.formatFormatArrayMax(formatArray)-2;
+    int[] dims = null;
+    Field[] sizeFields = null;
+    Field field = (fields == null ? null : checkedField(fields, index, null));
+    Class arrayClass = (field == null ? oclass : field.getType());
+    Class elementClass = arrayClass;
+    Codec element = null;
+    int elementType = 0;
+
+    if (variable && field == null) {
+      throw new Exception("No structure holds the array sizes");
+    }
+    if (variable) sizeFields = new Field[numDims];
+    else dims = new int[numDims];
+    for (d=0; d<numDims; d++) {
+      int item = formatters.formatFormatArrayItem(formatArray, d+2);
+      if (!variable) {
+	dims[d] = item;
+      } else if (numDims > 1 && item-1 >= index) {
+	/* The sizes are needed to decode the array, so they must come first */
+	throw new Exception("Array sizes follow the array");
+      } else {
+	sizeFields[d] = checkedField(fields, item-1, int.class);
+      }
+      if (!elementClass.isArray()) {
+	throw new Exception("Data structure does not match format");
+      }
+      elementClass = elementClass.getComponentType();
+    }
+
+    while (formatters.formatType(elementFormat) == formatters.NamedFMT)
+      elementFormat = formatters.findNamedFormat(elementFormat);
+    switch (formatters.formatType(elementFormat)) {
+    case formatters.PrimitiveFMT:
+      elementType = formatters.formatPrimitiveProc(elementFormat);
+      break;
+    case formatters.EnumFMT:
+      elementType = primFmttrs.INT_FMT;
+      break;
+    case formatters.StructFMT:
+    case formatters.FixedArrayFMT:
+      element = compile(elementFormat, elementClass, null, 0, 0);
+      break;
+    default:
+      throw new Exception("Cannot compile arrays of this format");
+    }
+    if (element == null && elementClass != primClass(elementType)) {
+      throw new Exception("Data structure does not match format");
+    }
+    return new ArrayCodec(field, arrayClass, dims, sizeFields,
+			  elementType, element);
+  }
+
+  /* Compiles "format" for field "index" of "oclass", whose public fields
+     are "fields"; with no fields, for "oclass" itself (the top level, or
+     an array element).  A top-level primitive is the "value" field of
+     one of the formatters.IPCPrim classes. */
+  private static Codec compile (int format, Class oclass, Field[] fields,
+				int index, int parentFormat)
+    throws Exception {
+    switch (formatters.formatType(format)) {
+    case formatters.PrimitiveFMT:
+    case formatters.EnumFMT: {
+      int type = (formatters.formatType(format) == formatters.EnumFMT
+		  ? primFmttrs.INT_FMT : formatters.formatPrimitiveProc(format));
+      if (fields == null) fields = oclass.getFields();
+      return new PrimCodec(type, checkedField(fields, index, primClass(type)));
+    }
+
+    case formatters.StructFMT: {
+      int formatArray = formatters.formatFormatArray(format);
+      int i, n = formatters.formatFormatArrayMax(formatArray);
+      Field field = (fields == null ? null : checkedField(fields, index, null));
+      Class structClass = (field == null ? oclass : field.getType());
+      Field[] members = structClass.getFields();
+      Codec[] memberCodecs = new Codec[n-1];
+
+      if (structClass.isPrimitive() || structClass.isArray() ||
+	  members.length < n-1) {
+	throw new Exception("Data structure does not match format");
+      }
+      for (i=1; i<n; i++) {
+	int member = formatters.formatFormatArrayItem(formatArray, i);
+	memberCodecs[i-1] = compile(member, structClass, members, i-1, format);
+      }
+      return new StructCodec(field, structClass, memberCodecs);
+    }
+
+    case formatters.FixedArrayFMT:
+      return compileArray(format, false, oclass, fields, index);
+
+    case formatters.VarArrayFMT:
+      return compileArray(format, true, oclass, fields, index);
+
+    case formatters.PointerFMT:
+      if (fields == null ||
+	  checkedField(fields, index, null).getType().isPrimitive()) {
+	throw new Exception("Cannot compile pointers to primitives");
+      }
+      return new PointerCodec(format, parentFormat, oclass, fields, index);
+
+    case formatters.NamedFMT:
+      return compile(formatters.findNamedFormat(format), oclass, fields,
+		     index, parentFormat);
+
+    default:
+      throw new Exception("Cannot compile format of type "+
+			  formatters.formatType(format));
+    }
+  }
+
+  /* Codecs by class, then by formatter.  NONE marks the pairs left to
+     formatters. */
+  private static Map codecTable = Collections.synchronizedMap(new HashMap());
+  private static final Object NONE = new Object();
+
+  private static Codec find (int formatter, Class oclass) {
+    if (!enabled || formatter == 0) return null;
+
+    Map byFormatter = (Map)codecTable.get(oclass);
+    if (byFormatter == null) {
+      byFormatter = Collections.synchronizedMap(new HashMap());
+      codecTable.put(oclass, byFormatter);
+    }
+    Integer key = new Integer(formatter);
+    Object codec = byFormatter.get(key);
+    if (codec == null) {
+      try {
+	codec = compile(formatter, oclass, null, 0, 0);
+      } catch (Exception e) {
+	codec = NONE;
+      }
+      byFormatter.put(key, codec);
+    }
+    return (codec == NONE ? null : (Codec)codec);
+  }
+
+  /* Compiles the codec for data of class "oclass" now, rather than for
+     the first message */
+  public static void precompile (int formatter, Class oclass) {
+    find(formatter, oclass);
+  }
+
+  /* Each thread encodes into its own direct buffer, which is kept (and
+     grown as needed) between messages */
+  private static class EncodeBuffer {
+    ByteBuffer buffer;
+    int address;
+  }
+
+  private static ThreadLocal encodeBuffers = new ThreadLocal() {
+      protected Object initialValue () { return new EncodeBuffer(); }
+    };
+
+  private static ByteBuffer encodeBuffer (int length) {
+    EncodeBuffer encodeBuffer = (EncodeBuffer)encodeBuffers.get();
+
+    if (encodeBuffer.buffer == null || encodeBuffer.buffer.capacity() < length) {
+      int capacity = (encodeBuffer.buffer == null ? 1024
+		      : 2*encodeBuffer.buffer.capacity());
+      encodeBuffer.buffer = ByteBuffer.allocateDirect(Math.max(capacity,
+							      length));
+      encodeBuffer.buffer.order(ByteOrder.nativeOrder());
+      encodeBuffer.address = bufferAddress(encodeBuffer.buffer);
+    }
+    encodeBuffer.buffer.clear();
+    return encodeBuffer.buffer;
+  }
+
+  /* Like formatters.marshall.  The byte array filled in is the thread's
+     encode buffer, valid until the next message is marshalled; pass it
+     to release rather than freeing it. */
+  public static int marshall (int formatter, Object object,
+			      formatters.VARCONTENT varcontent)
+    throws Exception {
+    Codec codec = find(formatter, object.getClass());
+
+    if (codec == null) {
+      return formatters.marshall(formatter, object, varcontent);
+    } else {
+      ByteBuffer buffer = encodeBuffer(varcontent.length = codec.size(object));
+      codec.encode(object, buffer);
+      if (buffer.position() != varcontent.length)
+	throw new Exception("Mismatch between buffer size ("+
+			    varcontent.length+") and encoded data ("+
+			    buffer.position()+")");
+      varcontent.byteArray = (varcontent.length > 0
+			      ? bufferAddress(buffer) : 0);
+      return IPC.IPC_OK;
+    }
+  }
+
+  /* Frees the byte array of a marshalled message, unless it is the
+     encode buffer */
+  public static void release (formatters.VARCONTENT varcontent) {
+    EncodeBuffer encodeBuffer = (EncodeBuffer)encodeBuffers.get();
+
+    if (varcontent.byteArray != 0 &&
+	varcontent.byteArray != encodeBuffer.address) {
+      freeByteArray(varcontent.byteArray);
+    }
+  }
+
+  /* Like formatters.unmarshall, given the length of the byte array; with
+     a negative length (not known) it is left to formatters */
+  public static int unmarshall (int formatter, int byteArray, int length,
+				Object object) throws Exception {
+    Codec codec = (length < 0 ? null : find(formatter, object.getClass()));
+
+    if (codec == null) {
+      return formatters.unmarshall(formatter, byteArray, object);
+    } else {
+      if (byteArray != 0 && length > 0) {
+	ByteBuffer buffer = byteArrayBuffer(byteArray, length);
+	buffer.order(dataIsBigEndian() ? ByteOrder.BIG_ENDIAN
+		     : ByteOrder.LITTLE_ENDIAN);
+	codec.decode(object, buffer);
+      }
+      return IPC.IPC_OK;
+    }
+  }
+}
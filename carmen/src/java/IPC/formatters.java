@@ -54,14 +54,15 @@ public class formatters {
   public static final int NamedFMT      = 7;
   public static final int EnumFMT       = 8;
 
-  private native static int formatType(int formatter);
-  private native static int formatPrimitiveProc(int formatter);
-  private native static int formatChoosePtrFormat(int formatter, 
-						  int parentFormat);
-  private native static int formatFormatArray(int formatter);
-  private native static int formatFormatArrayMax(int formatArray);
-  private native static int formatFormatArrayItem(int formatArray, int n);
-  private native static int findNamedFormat(int format);
+  // The format accessors are shared with codecs
+  native static int formatType(int formatter);
+  native static int formatPrimitiveProc(int formatter);
+  native static int formatChoosePtrFormat(int formatter, 
+					  int parentFormat);
+  native static int formatFormatArray(int formatter);
+  native static int formatFormatArrayMax(int formatArray);
+  native static int formatFormatArrayItem(int formatArray, int n);
+  native static int findNamedFormat(int format);
   private native static boolean checkMarshallStatus(int formatter);
   private native static int createBuffer(int byteArray);
   private native static void freeBuffer(int buffer);
@@ -0,0 +1,73 @@
+ /*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation; 
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more 
+ * details.
+ *
+ * You should have received a copy of the GNU General 
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, 
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+/* Native methods of IPC.codecs, written by hand in the layout javah
+   gives.  Byte arrays and buffer addresses are ptraddr (see IPC.h),
+   which IPC.codecs declares as int, as IPC and formatters do. */
+#include <jni.h>
+
+#ifndef _Included_codecs
+#define _Included_codecs
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     IPC.codecs
+ * Method:    static ByteBuffer byteArrayBuffer(int byteArray, int length)
+ * C:         (ptraddr byteArray, jint length) -> jobject
+ */
+JNIEXPORT jobject JNICALL Java_IPC_codecs_byteArrayBuffer
+  (JNIEnv *, jclass, ptraddr, jint);
+
+/*
+ * Class:     IPC.codecs
+ * Method:    static int bufferAddress(ByteBuffer buffer)
+ * C:         (jobject buffer) -> ptraddr
+ */
+JNIEXPORT ptraddr JNICALL Java_IPC_codecs_bufferAddress
+  (JNIEnv *, jclass, jobject);
+
+/*
+ * Class:     IPC.codecs
+ * Method:    static boolean dataIsBigEndian()
+ * C:         () -> jboolean
+ */
+JNIEXPORT jboolean JNICALL Java_IPC_codecs_dataIsBigEndian
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     IPC.codecs
+ * Method:    static void freeByteArray(int byteArray)
+ * C:         (ptraddr byteArray) -> void
+ */
+JNIEXPORT void JNICALL Java_IPC_codecs_freeByteArray
+  (JNIEnv *, jclass, ptraddr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
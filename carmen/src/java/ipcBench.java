@@ -0,0 +1,128 @@
+/*
+ * Measures the Java marshalling with the compiled codecs against the
+ * formatters they replace.  Sends laser and grid sized messages to
+ * itself through central, once with each, and prints the time spent in
+ * publishData and the round trip per message.  Also checks that the
+ * data arrives unchanged.
+ *
+ * usage: java -classpath Carmen.jar:. ipcBench [messages] [central host]
+ */
+
+import java.util.Arrays;
+import IPC.*;
+
+public class ipcBench {
+  private static final String LASER_MSG = "ipcBench_laser";
+  private static final String LASER_FMT =
+    "{int, double, <float:1>, double, string}";
+  private static final String GRID_MSG  = "ipcBench_grid";
+  private static final String GRID_FMT  = "{int, int, <float:1, 2>, string}";
+
+  public static class laser {
+    public int num_readings;
+    public double fov;
+    public float[] range;
+    public double timestamp;
+    public String host;
+  }
+
+  public static class grid {
+    public int x_size;
+    public int y_size;
+    public float[][] cells;
+    public String name;
+  }
+
+  private static Object received;
+
+  private static class benchHandler implements IPC.HANDLER_TYPE {
+    public void handle (IPC.MSG_INSTANCE msgInstance, Object callData) {
+      received = callData;
+    }
+  }
+
+  private static boolean sameData (Object sent, Object got) {
+    if (sent instanceof laser) {
+      laser a = (laser)sent, b = (laser)got;
+      return (a.num_readings == b.num_readings && a.fov == b.fov &&
+	      Arrays.equals(a.range, b.range) &&
+	      a.timestamp == b.timestamp && a.host.equals(b.host));
+    } else {
+      grid a = (grid)sent, b = (grid)got;
+      if (a.x_size != b.x_size || a.y_size != b.y_size ||
+	  !a.name.equals(b.name))
+	return false;
+      for (int x=0; x<a.x_size; x++)
+	if (!Arrays.equals(a.cells[x], b.cells[x])) return false;
+      return true;
+    }
+  }
+
+  private static void run (String msgName, Object data, int numMessages,
+			   boolean compiled) {
+    long start, publishTime = 0;
+    int i;
+
+    codecs.enabled = compiled;
+    start = System.nanoTime();
+    for (i=0; i<numMessages; i++) {
+      long publishStart = System.nanoTime();
+      received = null;
+      IPC.publishData(msgName, data);
+      publishTime += System.nanoTime() - publishStart;
+      while (received == null) IPC.listen(1000);
+      if (i == 0 && !sameData(data, received)) {
+	System.err.println(msgName +": data differs after the round trip");
+	System.exit(1);
+      }
+    }
+    long total = System.nanoTime() - start;
+    System.out.println(msgName +" "+ (compiled ? "codecs    " : "formatters")
+		       +": publish "+ (publishTime/1000/numMessages)
+		       +" us, round trip "+ (total/1000/numMessages)
+		       +" us, "+ (long)(1e9*numMessages/total) +" msgs/s");
+  }
+
+  public static void main (String args[]) throws Exception {
+    int numMessages = (args.length > 0 ? Integer.parseInt(args[0]) : 2000);
+    String host = (args.length > 1 ? args[1] : null);
+    int i, x, y;
+
+    IPC.setVerbosity(IPC.IPC_Silent);
+    if (IPC.connectModule("ipcBench", host) != IPC.IPC_OK) {
+      System.err.println("Could not connect to central.");
+      System.exit(1);
+    }
+    IPC.defineMsg(LASER_MSG, LASER_FMT);
+    IPC.defineMsg(GRID_MSG, GRID_FMT);
+    IPC.subscribeData(LASER_MSG, new benchHandler(), laser.class);
+    IPC.subscribeData(GRID_MSG, new benchHandler(), grid.class);
+
+    laser scan = new laser();
+    scan.num_readings = 361;
+    scan.fov = Math.PI;
+    scan.range = new float[scan.num_readings];
+    for (i=0; i<scan.num_readings; i++) scan.range[i] = 1.0f + i/100.0f;
+    scan.timestamp = IPC.timeInMillis()/1000.0;
+    scan.host = "ipcBench";
+
+    grid map = new grid();
+    map.x_size = 200;
+    map.y_size = 150;
+    map.cells = new float[map.x_size][map.y_size];
+    for (x=0; x<map.x_size; x++)
+      for (y=0; y<map.y_size; y++) map.cells[x][y] = (x*y % 7)/7.0f;
+    map.name = "ipcBench";
+
+    /* warm up both paths first */
+    run(LASER_MSG, scan, Math.max(numMessages/10, 1), false);
+    run(LASER_MSG, scan, Math.max(numMessages/10, 1), true);
+
+    run(LASER_MSG, scan, numMessages, false);
+    run(LASER_MSG, scan, numMessages, true);
+    run(GRID_MSG, map, Math.max(numMessages/10, 1), false);
+    run(GRID_MSG, map, Math.max(numMessages/10, 1), true);
+
+    IPC.disconnect();
+  }
+}
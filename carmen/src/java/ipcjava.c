@@ -70,6 +70,7 @@
 #include "IPC.h"
 #include "formatters.h"
 #include "primFmttrs.h"
+#include "codecs.h"
 
 #define JAVA
 #include "ipcLisp.c"
@@ -1010,3 +1011,44 @@ JNIEXPORT void JNICALL Java_IPC_primFmttrs_formatPutString (JNIEnv *env, jclass
   }
   (*env)->ReleaseStringUTFChars(env, theString, cstring);
 }
+
+/*****************************************************************
+ *
+ * For codecs.java
+ * 
+ ****************************************************************/
+
+/* A ByteBuffer over the byte array itself, so that the codecs can read
+   a message without copying it into the JVM first */
+JNIEXPORT jobject JNICALL
+Java_IPC_codecs_byteArrayBuffer (JNIEnv *env, jclass theClass,
+				 ptraddr byteArray, jint length)
+{
+  return (*env)->NewDirectByteBuffer(env, (void *)byteArray, (jlong)length);
+}
+
+JNIEXPORT ptraddr JNICALL
+Java_IPC_codecs_bufferAddress (JNIEnv *env, jclass theClass, jobject buffer)
+{
+  return (ptraddr)(*env)->GetDirectBufferAddress(env, buffer);
+}
+
+/* Byte order of the message being handled (formatGetInt and friends
+   use the same) */
+JNIEXPORT jboolean JNICALL
+Java_IPC_codecs_dataIsBigEndian (JNIEnv *env, jclass theClass)
+{
+  int byteOrder;
+
+  LOCK_M_MUTEX;
+  byteOrder = GET_M_GLOBAL(byteOrder);
+  UNLOCK_M_MUTEX;
+
+  return (byteOrder == BIG_ENDIAN ? JNI_TRUE : JNI_FALSE);
+}
+
+JNIEXPORT void JNICALL
+Java_IPC_codecs_freeByteArray (JNIEnv *env, jclass theClass, ptraddr byteArray)
+{
+  IPC_freeByteArray((BYTE_ARRAY)byteArray);
+}
@@ -84,21 +84,22 @@ int carmen_hokuyo_handle(carmen_laser_device_t* device){
       fprintf(stderr,"num ranages =%d, there should be %d... something weird is going on\n",reading.n_ranges, normal_n_ranges);
       return 0;
     }
-    carmen_laser_laser_static_message message;
-    message.id=device->laser_id;
-    message.config=device->config;
-    message.num_readings=reading.n_ranges;
-    message.num_remissions=0;
+    carmen_laser_laser_static_message local_message;
+    carmen_laser_laser_static_message* message=carmen_laser_reserve_message(device, &local_message);
+    message->id=device->laser_id;
+    message->config=device->config;
+    message->num_readings=reading.n_ranges;
+    message->num_remissions=0;
     gettimeofday(&timestamp, NULL);
-    message.timestamp=timestamp.tv_sec + 1e-6*timestamp.tv_usec;
+    message->timestamp=timestamp.tv_sec + 1e-6*timestamp.tv_usec;
     for (int j=0; j<reading.n_ranges; j++){
-      message.range[j]=0.001*reading.ranges[j];
-      if (message.range[j] <= 0.02) {
-	message.range[j] += device->config.maximum_range;
+      message->range[j]=0.001*reading.ranges[j];
+      if (message->range[j] <= 0.02) {
+	message->range[j] += device->config.maximum_range;
       }
     }
     if (device->f_onreceive!=NULL)
-      (*device->f_onreceive)(device, &message);
+      (*device->f_onreceive)(device, message);
     return 1;
   } else {
     fprintf(stderr, "E");
@@ -171,6 +172,7 @@ carmen_laser_device_t* carmen_create_hokuyo_instance(carmen_laser_laser_config_t
   device->f_handle=carmen_hokuyo_handle_sleep;
   device->f_close=carmen_hokuyo_close;
   device->f_onreceive=NULL;
+  device->f_reserve=NULL;
   return device;
 }
 
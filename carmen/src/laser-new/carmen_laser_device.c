@@ -112,6 +112,13 @@ int carmen_laser_laser_message_check_configuration(carmen_laser_laser_config_t*
   return 0;
 }
 
+carmen_laser_laser_static_message* carmen_laser_reserve_message(struct carmen_laser_device_t * device, carmen_laser_laser_static_message* fallback){
+  carmen_laser_laser_static_message* m=NULL;
+  if (device->f_reserve!=NULL)
+    m=(*device->f_reserve)(device);
+  return m ? m : fallback;
+}
+
 int carmen_laser_calibrate_timestamp_recover_handler(struct carmen_laser_device_t * device , carmen_laser_laser_static_message* m){
   fprintf(stderr,".");
   if (!device->curr_frames){
@@ -12,6 +12,7 @@
 
 struct carmen_laser_device_t;
 typedef int (*carmen_laser_fct_onreceive_t)(struct carmen_laser_device_t * , carmen_laser_laser_static_message* );
+typedef carmen_laser_laser_static_message* (*carmen_laser_fct_reserve_t)(struct carmen_laser_device_t * );
 typedef int (*carmen_laser_fct_init_t)(struct carmen_laser_device_t* );
 typedef int (*carmen_laser_fct_connect_t)(struct carmen_laser_device_t *, char* filename, int baudrate);
 typedef int (*carmen_laser_fct_configure_t)(struct carmen_laser_device_t *);
@@ -36,6 +37,9 @@ typedef struct carmen_laser_device_t{
 	carmen_laser_fct_handle_t f_handle;
 	carmen_laser_fct_close_t f_close;
 	carmen_laser_fct_onreceive_t f_onreceive;
+	//optional: returns a queue slot the driver fills in place before
+	//passing it to f_onreceive (NULL when no slot is available)
+	carmen_laser_fct_reserve_t f_reserve;
 
   
   //timestamp recovering
@@ -67,6 +71,8 @@ carmen_laser_device_t* carmen_create_laser_instance(carmen_laser_laser_config_t*
 
 int carmen_laser_register_devices(void);
 
+carmen_laser_laser_static_message* carmen_laser_reserve_message(struct carmen_laser_device_t * device, carmen_laser_laser_static_message* fallback);
+
 void carmen_laser_calibrate_timestamp(struct carmen_laser_device_t * device, int avg_cycles);
 
 #endif
@@ -44,11 +44,15 @@ int carmen_laser_message_queue_add(carmen_laser_message_queue_t* queue, carmen_l
 
 int carmen_laser_message_queue_get(carmen_laser_message_queue_t* queue, carmen_laser_laser_static_message* message){
 	int returnedSize;
-	if (!queue->size)
-	  return -1;
 #ifdef LASER_USE_PTHREAD
 	pthread_mutex_lock(&queue->mutex);
 #endif
+	if (!queue->size){
+#ifdef LASER_USE_PTHREAD
+	  pthread_mutex_unlock(&queue->mutex);
+#endif
+	  return -1;
+	}
 	returnedSize=queue->size-1;
 	if (queue->size>0){
 		*message=queue->readings[queue->head++];
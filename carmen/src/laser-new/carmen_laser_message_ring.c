@@ -0,0 +1,106 @@
+#include <carmen/carmen.h>
+#include "carmen_laser_message_ring.h"
+
+#define RING_MASK (CARMEN_LASER_MESSAGE_RING_SIZE-1)
+
+void carmen_laser_message_ring_init(carmen_laser_message_ring_t* ring){
+	ring->head=ring->tail=ring->dropped=0;
+#ifdef LASER_USE_PTHREAD
+	ring->notify=NULL;
+#endif
+}
+
+carmen_laser_laser_static_message* carmen_laser_message_ring_reserve(carmen_laser_message_ring_t* ring){
+	unsigned int tail=ring->tail;
+	unsigned int head=__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (tail-head>=CARMEN_LASER_MESSAGE_RING_SIZE)
+		return NULL;
+	/* reserving again before committing returns the same slot */
+	ring->read_time[tail&RING_MASK]=carmen_get_time();
+	return ring->readings+(tail&RING_MASK);
+}
+
+void carmen_laser_message_ring_commit(carmen_laser_message_ring_t* ring){
+	__atomic_store_n(&ring->tail, ring->tail+1, __ATOMIC_RELEASE);
+#ifdef LASER_USE_PTHREAD
+	if (ring->notify)
+		sem_post(ring->notify);
+#endif
+}
+
+int carmen_laser_message_ring_push(carmen_laser_message_ring_t* ring, carmen_laser_laser_static_message* message){
+	carmen_laser_laser_static_message* slot=carmen_laser_message_ring_reserve(ring);
+	if (!slot){
+		ring->dropped++;
+		return 0;
+	}
+	if (slot!=message){
+		/* message was not filled in place, copy only the used part */
+		slot->id=message->id;
+		slot->config=message->config;
+		slot->num_readings=message->num_readings;
+		slot->num_remissions=message->num_remissions;
+		memcpy(slot->range, message->range, message->num_readings*sizeof(float));
+		memcpy(slot->remission, message->remission, message->num_remissions*sizeof(float));
+		slot->timestamp=message->timestamp;
+		slot->host=message->host;
+	}
+	carmen_laser_message_ring_commit(ring);
+	return 1;
+}
+
+carmen_laser_laser_static_message* carmen_laser_message_ring_peek(carmen_laser_message_ring_t* ring){
+	unsigned int head=ring->head;
+	unsigned int tail=__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head==tail)
+		return NULL;
+	return ring->readings+(head&RING_MASK);
+}
+
+double carmen_laser_message_ring_peek_read_time(carmen_laser_message_ring_t* ring){
+	return ring->read_time[ring->head&RING_MASK];
+}
+
+void carmen_laser_message_ring_release(carmen_laser_message_ring_t* ring){
+	__atomic_store_n(&ring->head, ring->head+1, __ATOMIC_RELEASE);
+}
+
+int carmen_laser_message_ring_size(carmen_laser_message_ring_t* ring){
+	unsigned int tail=__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	unsigned int head=__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	return (int)(tail-head);
+}
+
+
+void carmen_laser_latency_histogram_reset(carmen_laser_latency_histogram_t* histogram){
+	memset(histogram, 0, sizeof(carmen_laser_latency_histogram_t));
+}
+
+void carmen_laser_latency_histogram_add(carmen_laser_latency_histogram_t* histogram, double latency){
+	int bin=0;
+	double us=latency*1e6;
+	while (us>=2. && bin<CARMEN_LASER_LATENCY_BINS-1){
+		us*=0.5;
+		bin++;
+	}
+	histogram->bins[bin]++;
+	histogram->count++;
+	histogram->sum+=latency;
+	if (latency>histogram->max)
+		histogram->max=latency;
+}
+
+double carmen_laser_latency_histogram_percentile(carmen_laser_latency_histogram_t* histogram, double p){
+	unsigned int i, n=0;
+	if (!histogram->count)
+		return 0.;
+	for (i=0; i<CARMEN_LASER_LATENCY_BINS; i++){
+		n+=histogram->bins[i];
+		if (n>=p*histogram->count)
+			break;
+	}
+	if (i>=CARMEN_LASER_LATENCY_BINS-1)
+		return histogram->max;
+	/* upper edge of the bin */
+	return ldexp(1e-6, i+1);
+}
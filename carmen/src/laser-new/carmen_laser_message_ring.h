@@ -0,0 +1,60 @@
+#ifndef CARMEN_LASER_MESSAGE_RING
+#define CARMEN_LASER_MESSAGE_RING
+
+#ifdef LASER_USE_PTHREAD
+#include <semaphore.h>
+#endif
+
+#include "laser_messages.h"
+#include "laser_static_messages.h"
+
+/* Lock-free single-producer/single-consumer ring of laser messages.
+   The driver thread reserves the slot at the tail, fills it in place
+   and commits it; the publishing thread peeks at the head, reads the
+   message in place and releases it. head and tail are free running
+   counters, each written by one side only. */
+
+#define CARMEN_LASER_MESSAGE_RING_SIZE 128  /* must be a power of two */
+
+typedef struct {
+	carmen_laser_laser_static_message readings[CARMEN_LASER_MESSAGE_RING_SIZE];
+	double read_time[CARMEN_LASER_MESSAGE_RING_SIZE];
+	unsigned int head;     /* written by the consumer */
+	unsigned int tail;     /* written by the producer */
+	unsigned int dropped;  /* written by the producer */
+#ifdef LASER_USE_PTHREAD
+	sem_t* notify;         /* posted once per commit, may be NULL */
+#endif
+} carmen_laser_message_ring_t;
+
+void carmen_laser_message_ring_init(carmen_laser_message_ring_t* ring);
+
+/* producer side */
+carmen_laser_laser_static_message* carmen_laser_message_ring_reserve(carmen_laser_message_ring_t* ring);
+void carmen_laser_message_ring_commit(carmen_laser_message_ring_t* ring);
+int carmen_laser_message_ring_push(carmen_laser_message_ring_t* ring, carmen_laser_laser_static_message* message);
+
+/* consumer side */
+carmen_laser_laser_static_message* carmen_laser_message_ring_peek(carmen_laser_message_ring_t* ring);
+double carmen_laser_message_ring_peek_read_time(carmen_laser_message_ring_t* ring);
+void carmen_laser_message_ring_release(carmen_laser_message_ring_t* ring);
+
+int carmen_laser_message_ring_size(carmen_laser_message_ring_t* ring);
+
+
+/* Latency histogram with logarithmic bins: bin k counts latencies in
+   [2^k, 2^(k+1)) microseconds, the last bin everything above. */
+
+#define CARMEN_LASER_LATENCY_BINS 24
+
+typedef struct {
+	unsigned int bins[CARMEN_LASER_LATENCY_BINS];
+	unsigned int count;
+	double sum, max;
+} carmen_laser_latency_histogram_t;
+
+void carmen_laser_latency_histogram_reset(carmen_laser_latency_histogram_t* histogram);
+void carmen_laser_latency_histogram_add(carmen_laser_latency_histogram_t* histogram, double latency);
+double carmen_laser_latency_histogram_percentile(carmen_laser_latency_histogram_t* histogram, double p);
+
+#endif
@@ -61,28 +61,29 @@ int carmen_s300_handle(carmen_laser_device_t* device){
 	
 	if (n_ranges){
 		unsigned int j;
-		carmen_laser_laser_static_message message;
-		message.id=device->laser_id;
-		message.config=device->config;
+		carmen_laser_laser_static_message local_message;
+		carmen_laser_laser_static_message* message=carmen_laser_reserve_message(device, &local_message);
+		message->id=device->laser_id;
+		message->config=device->config;
 
-		message.config.start_angle= -0.5 * message.config.fov + M_PI/720.;
+		message->config.start_angle= -0.5 * message->config.fov + M_PI/720.;
 		
 		if (sick->angular_resolution==0)
-		  message.config.angular_resolution=M_PI/360;
+		  message->config.angular_resolution=M_PI/360;
 
-		message.num_readings=n_ranges;
-		message.num_remissions=n_remissions;
-		message.timestamp=(double)timestamp.tv_sec+1e-6*timestamp.tv_usec;
+		message->num_readings=n_ranges;
+		message->num_remissions=n_remissions;
+		message->timestamp=(double)timestamp.tv_sec+1e-6*timestamp.tv_usec;
 
 		for (j=0; j<n_ranges; j++){
 			// the S300 reports cm measurements
-			message.range[j]=0.01*irange[j];
+			message->range[j]=0.01*irange[j];
 		}
 		for (j=0; j<n_remissions; j++){
-			message.remission[j]=0.001*iremission[j];
+			message->remission[j]=0.001*iremission[j];
 		}
 		if (device->f_onreceive!=NULL)
-			(*device->f_onreceive)(device, &message);
+			(*device->f_onreceive)(device, message);
 		return 1;
 	}
 	return 0;
@@ -119,6 +120,7 @@ carmen_laser_device_t* carmen_create_s300_instance(carmen_laser_laser_config_t*
 	device->f_handle=carmen_s300_handle_sleep;
 	device->f_close=carmen_s300_close;
 	device->f_onreceive=NULL;
+	device->f_reserve=NULL;
 	return device;
 }
 
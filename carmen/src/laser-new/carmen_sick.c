@@ -96,32 +96,33 @@ int carmen_sick_handle(carmen_laser_device_t* device){
 
 	if (n_ranges){
 		unsigned int j;
-		carmen_laser_laser_static_message message;
-		message.id=device->laser_id;
-		message.config=device->config;
+		carmen_laser_laser_static_message local_message;
+		carmen_laser_laser_static_message* message=carmen_laser_reserve_message(device, &local_message);
+		message->id=device->laser_id;
+		message->config=device->config;
 
 		/// FIX: explain what  M_PI/720.*offset is ? (the interlaced mode?)
-		///		message.config.start_angle=M_PI/720.*offset;
+		///		message->config.start_angle=M_PI/720.*offset;
 
 		//this is for adjusting the initial offset when in interlaced mode.
 		//offset can range from 0 to 3 and it is the offset of the first beam.
 		//the offset in is obtained by multiplying the offset value with 0.25 degrees (M_PI/720 rad).
 
-		message.config.start_angle= -0.5 * message.config.fov + M_PI/720.*offset;
+		message->config.start_angle= -0.5 * message->config.fov + M_PI/720.*offset;
 		if (sick->angular_resolution==0)
-		  message.config.angular_resolution=M_PI/180;
+		  message->config.angular_resolution=M_PI/180;
 
-		message.num_readings=n_ranges;
-		message.num_remissions=n_remissions;
-		message.timestamp=(double)timestamp.tv_sec+1e-6*timestamp.tv_usec;
+		message->num_readings=n_ranges;
+		message->num_remissions=n_remissions;
+		message->timestamp=(double)timestamp.tv_sec+1e-6*timestamp.tv_usec;
 		for (j=0; j<n_ranges; j++){
-			message.range[j]=0.001*irange[j];
+			message->range[j]=0.001*irange[j];
 		}
 		for (j=0; j<n_remissions; j++){
-			message.remission[j]=0.001*iremission[j];
+			message->remission[j]=0.001*iremission[j];
 		}
 		if (device->f_onreceive!=NULL)
-			(*device->f_onreceive)(device, &message);
+			(*device->f_onreceive)(device, message);
 		return 1;
 	}
 	return 0;
@@ -171,6 +172,7 @@ carmen_laser_device_t* carmen_create_sick_instance(carmen_laser_laser_config_t*
 	device->f_handle=carmen_sick_handle_sleep;
 	device->f_close=carmen_sick_close;
 	device->f_onreceive=NULL;
+	device->f_reserve=NULL;
 	return device;
 }
 
@@ -1,18 +1,23 @@
 #include <carmen/carmen.h>
 #include "carmen_laser_device.h"
-#include "carmen_laser_message_queue.h"
+#include "carmen_laser_message_ring.h"
 #include "laser_messages.h"
 #include <signal.h>
 #include <stdio.h>
 #include <pthread.h>
 #include <math.h>
 #include <errno.h>
+#include <semaphore.h>
 
 
 //#define MAX_REQUESTED_LASER_IDS 100
 
 volatile int carmen_laser_has_to_stop=0;
-carmen_laser_message_queue_t carmen_laser_queue;
+
+/* one lock-free ring per device, all of them post to the same
+   semaphore to wake up the publishing thread */
+carmen_laser_message_ring_t* carmen_laser_rings = NULL;
+sem_t carmen_laser_ready;
 
 carmen_laser_device_t** carmen_laser_pdevice = NULL;
 int  *carmen_laser_flipped=NULL;
@@ -60,8 +65,12 @@ int delete_lock(char* filename){
   return unlink(buf);
 }
 
-int carmen_laser_enqueue(struct carmen_laser_device_t * device __attribute__((unused)), carmen_laser_laser_static_message* message){
-  carmen_laser_message_queue_add(&carmen_laser_queue, message);
+carmen_laser_laser_static_message* carmen_laser_reserve(struct carmen_laser_device_t * device){
+  return carmen_laser_message_ring_reserve(carmen_laser_rings+id_to_index(device->laser_id));
+}
+
+int carmen_laser_enqueue(struct carmen_laser_device_t * device, carmen_laser_laser_static_message* message){
+  carmen_laser_message_ring_push(carmen_laser_rings+id_to_index(device->laser_id), message);
   return 0;
 }
 
@@ -74,7 +83,7 @@ int carmen_laser_enqueue_correct(struct carmen_laser_device_t * device __attribu
     message->timestamp=expectedTime;
     //fprintf(stderr,"c");
   }
-  carmen_laser_message_queue_add(&carmen_laser_queue, message);
+  carmen_laser_message_ring_push(carmen_laser_rings+id_to_index(device->laser_id), message);
   return 0;
 }
 
@@ -83,6 +92,25 @@ void sigquit_handler(int q __attribute__((unused))){
   carmen_laser_has_to_stop=1;
 }
 
+/* returns the ring holding the oldest pending scan, so that scans of
+   different lasers are published in the order they were read */
+carmen_laser_message_ring_t* carmen_laser_oldest_ring(int num_laser_devices){
+  carmen_laser_message_ring_t* oldest=NULL;
+  double oldest_time=0;
+  int i;
+  for (i=0; i<num_laser_devices; i++) {
+    carmen_laser_message_ring_t* ring=carmen_laser_rings+i;
+    if (carmen_laser_message_ring_peek(ring)==NULL)
+      continue;
+    double t=carmen_laser_message_ring_peek_read_time(ring);
+    if (oldest==NULL || t<oldest_time) {
+      oldest=ring;
+      oldest_time=t;
+    }
+  }
+  return oldest;
+}
+
 
 void* laser_fn (struct carmen_laser_device_t * device){
   int result=0;
@@ -177,6 +205,7 @@ int carmen_laser_create_device(int laser_id,
 
   //install the enqueuing handler
   (*pdevice)->f_onreceive=carmen_laser_enqueue;
+  (*pdevice)->f_reserve=carmen_laser_reserve;
   (*pdevice)->config=config;
 
   //attempt initializing the device
@@ -250,6 +279,13 @@ int carmen_laser_read_parameters(int argc, char **argv)
   carmen_laser_pdevice        =  calloc(  num_laser_devices, sizeof(carmen_laser_device_t*) );
   carmen_test_alloc(carmen_laser_pdevice);
 
+  carmen_laser_rings          =  calloc(  num_laser_devices, sizeof(carmen_laser_message_ring_t) );
+  carmen_test_alloc(carmen_laser_rings);
+  for (i=0; i<num_laser_devices; i++) {
+    carmen_laser_message_ring_init(carmen_laser_rings+i);
+    carmen_laser_rings[i].notify=&carmen_laser_ready;
+  }
+
   if (num_laser_devices<1)
     carmen_die("You have to specify at least one laser device to run laser.\nPlease check you ini file for the parameter num_laser_devices.\n");
 
@@ -559,12 +595,9 @@ int main(int argc, char **argv)
   void * tresult;
   char* hostname;
   static carmen_laser_laser_message msg;
-  static float ranges[4096];
-  static float remissions[4096];
-  msg.range=ranges;
-  msg.remission=remissions;
 
   hostname = carmen_get_host();
+  sem_init(&carmen_laser_ready, 0, 0);
   carmen_ipc_initialize(argc, argv);
   carmen_param_check_version(argv[0]);
 
@@ -602,32 +635,28 @@ int main(int argc, char **argv)
 
   //waits in the queue
   double lastTime=0;
-  carmen_laser_laser_static_message m;
+  carmen_laser_latency_histogram_t latency;
+  carmen_laser_latency_histogram_reset(&latency);
   while (! carmen_laser_has_to_stop){
-    carmen_laser_message_queue_wait_get(&carmen_laser_queue, &m);
+    if (sem_wait(&carmen_laser_ready) != 0)
+      continue;
+
+    carmen_laser_message_ring_t* ring = carmen_laser_oldest_ring(num_laser_devices);
+    if (ring == NULL)
+      continue;
+    carmen_laser_laser_static_message* m = carmen_laser_message_ring_peek(ring);
 
     if (lastTime==0)
       lastTime = carmen_get_time();
     c++;
-    msg.num_readings = m.num_readings;
-    msg.num_remissions = m.num_remissions;
-    msg.config = m.config;
-    msg.id = m.id;
-
-    //    fprintf(stderr, "r=%d\n", m.num_readings);
-    if (m.num_readings){
-      msg.range=ranges;
-      memcpy(msg.range,m.range, m.num_readings*sizeof(float));
-    } else {
-      msg.range=NULL;
-    }
+    msg.num_readings = m->num_readings;
+    msg.num_remissions = m->num_remissions;
+    msg.config = m->config;
+    msg.id = m->id;
 
-    if (m.num_remissions){
-      msg.remission=remissions;
-      memcpy(msg.remission, m.remission, m.num_remissions*sizeof(float));
-    } else {
-      msg.remission=NULL;
-    }
+    /* the slot is ours until it is released, publish straight from it */
+    msg.range = m->num_readings ? m->range : NULL;
+    msg.remission = m->num_remissions ? m->remission : NULL;
 
     /* is the laser flipped (mouted upside down) */
     int idx = id_to_index(msg.id);
@@ -638,32 +667,46 @@ int main(int argc, char **argv)
       if (msg.range != NULL) {
 	for (i=0; i < upto; i++) {
 	  tmp = msg.range[i] ;
-	  msg.range[i] = msg.range[msg.num_readings-i];
-	  msg.range[msg.num_readings-i] = tmp;
+	  msg.range[i] = msg.range[msg.num_readings-1-i];
+	  msg.range[msg.num_readings-1-i] = tmp;
 	}
       }
       upto=msg.num_remissions/2;
       if (msg.remission != NULL) {
 	for (i=0; i < upto; i++) {
 	  tmp = msg.remission[i] ;
-	  msg.remission[i] = msg.remission[msg.num_remissions-i];
-	  msg.remission[msg.num_remissions-i] = tmp;
+	  msg.remission[i] = msg.remission[msg.num_remissions-1-i];
+	  msg.remission[msg.num_remissions-1-i] = tmp;
 	}
       }
     }
 
-    msg.timestamp = m.timestamp;
+    msg.timestamp = m->timestamp;
     msg.host = hostname;
 
     if (msg.id>0)
       carmen_laser_publish_laser_message(msg.id, &msg);
 
+    carmen_laser_latency_histogram_add(&latency, carmen_get_time() - 
+				       carmen_laser_message_ring_peek_read_time(ring));
+    carmen_laser_message_ring_release(ring);
+
     if (c>0 && !(c%10)){
       double time=carmen_get_time();
       if (time-lastTime > 3.0) {
-
+	int queued=0, dropped=0;
+	for (i=0; i<num_laser_devices; i++) {
+	  queued += carmen_laser_message_ring_size(carmen_laser_rings+i);
+	  dropped += carmen_laser_rings[i].dropped;
+	}
 	fprintf(stderr, "status:   send-queue: %d msg(s),   laser-msg freqency: %.3f Hz (globally)\n",
-		carmen_laser_queue.size, ((double)c)/(time-lastTime));
+		queued, ((double)c)/(time-lastTime));
+	fprintf(stderr, "          read-to-publish latency: mean %.2f ms,  p50 < %.2f ms,  p99 < %.2f ms,  max %.2f ms,  dropped: %d\n",
+		1e3*latency.sum/latency.count,
+		1e3*carmen_laser_latency_histogram_percentile(&latency, 0.5),
+		1e3*carmen_laser_latency_histogram_percentile(&latency, 0.99),
+		1e3*latency.max, dropped);
+	carmen_laser_latency_histogram_reset(&latency);
 	c=0;
 	lastTime=time;
       }
@@ -155,8 +155,11 @@ void create_stretched_likelihood_map(carmen_localize_map_p lmap,
     }
 }
 
-void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
-			    carmen_localize_param_p param)
+/* allocates the likelihood fields of lmap for the map cmap, without
+   computing them */
+
+void carmen_localize_allocate_map(carmen_map_p cmap, 
+				  carmen_localize_map_p lmap)
 {
   int i;
 
@@ -185,15 +188,6 @@ void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
   for(i = 0; i < lmap->config.x_size; i++)
     lmap->prob[i] = lmap->complete_prob + i * lmap->config.y_size;
 
-  /* allocate prob map */
-  lmap->complete_prob = (float *)calloc(lmap->config.x_size *
-					lmap->config.y_size, sizeof(float));
-  carmen_test_alloc(lmap->complete_prob);
-  lmap->prob = (float **)calloc(lmap->config.x_size, sizeof(float *));
-  carmen_test_alloc(lmap->prob);
-  for(i = 0; i < lmap->config.x_size; i++)
-    lmap->prob[i] = lmap->complete_prob + i * lmap->config.y_size;
-
   /* allocate gprob map */
   lmap->complete_gprob = (float *)calloc(lmap->config.x_size *
 					 lmap->config.y_size, sizeof(float));
@@ -224,6 +218,12 @@ void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
   carmen_test_alloc(lmap->y_offset);
   for(i = 0; i < lmap->config.x_size; i++)
     lmap->y_offset[i] = lmap->complete_y_offset + i * lmap->config.y_size;
+}
+
+void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
+			    carmen_localize_param_p param)
+{
+  carmen_localize_allocate_map(cmap, lmap);
 
   create_distance_map(cmap, lmap, param);
 /*   create_likelihood_map(lmap, lmap->prob, param->lmap_std); */
@@ -234,6 +234,85 @@ void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
 
 }
 
+/* hash of the occupancy grid, so cached likelihood fields can be
+   matched to the map they were computed from */
+
+unsigned int carmen_localize_map_hash(carmen_map_p cmap)
+{
+  unsigned char *p;
+  unsigned int hash = 2166136261u;
+  int i, n;
+
+  p = (unsigned char *)cmap->complete_map;
+  n = cmap->config.x_size * cmap->config.y_size * sizeof(float);
+  for(i = 0; i < n; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  hash ^= (unsigned int)cmap->config.x_size * 73856093u;
+  hash ^= (unsigned int)cmap->config.y_size * 19349663u;
+  return hash;
+}
+
+/* describes the likelihood fields of lmap, and the parameters they
+   depend on, for storing them in (or loading them from) a map file.
+   The fields point at lmap's arrays. */
+
+void carmen_localize_get_likelihood(carmen_localize_map_p lmap,
+				    carmen_localize_param_p param,
+				    carmen_map_likelihood_p likelihood)
+{
+  likelihood->x_size = lmap->config.x_size;
+  likelihood->y_size = lmap->config.y_size;
+  likelihood->resolution = lmap->config.resolution;
+  likelihood->gridmap_hash = carmen_localize_map_hash(&lmap->carmen_map);
+  likelihood->occupied_prob = param->occupied_prob;
+  likelihood->lmap_std = param->lmap_std;
+  likelihood->global_lmap_std = param->global_lmap_std;
+  likelihood->tracking_beam_minlikelihood = 
+    param->tracking_beam_minlikelihood;
+  likelihood->global_beam_minlikelihood = param->global_beam_minlikelihood;
+  likelihood->distance = lmap->complete_distance;
+  likelihood->x_offset = lmap->complete_x_offset;
+  likelihood->y_offset = lmap->complete_y_offset;
+  likelihood->prob = lmap->complete_prob;
+  likelihood->gprob = lmap->complete_gprob;
+}
+
+/* returns 1 if two sets of likelihood fields were built from the same
+   map with the same parameters */
+
+int carmen_localize_likelihood_matches(carmen_map_likelihood_p l1,
+				       carmen_map_likelihood_p l2)
+{
+  return (l1->x_size == l2->x_size && l1->y_size == l2->y_size &&
+	  l1->resolution == l2->resolution &&
+	  l1->gridmap_hash == l2->gridmap_hash &&
+	  l1->occupied_prob == l2->occupied_prob &&
+	  l1->lmap_std == l2->lmap_std &&
+	  l1->global_lmap_std == l2->global_lmap_std &&
+	  l1->tracking_beam_minlikelihood == 
+	  l2->tracking_beam_minlikelihood &&
+	  l1->global_beam_minlikelihood == l2->global_beam_minlikelihood);
+}
+
+/* frees the arrays allocated by carmen_to_localize_map (but not the
+   raw carmen map it refers to) */
+
+void carmen_localize_free_map(carmen_localize_map_p lmap)
+{
+  free(lmap->complete_x_offset);
+  free(lmap->complete_y_offset);
+  free(lmap->complete_distance);
+  free(lmap->complete_prob);
+  free(lmap->complete_gprob);
+  free(lmap->x_offset);
+  free(lmap->y_offset);
+  free(lmap->distance);
+  free(lmap->prob);
+  free(lmap->gprob);
+}
+
 /* Writes a carmen map out to a ppm file */
 
 void carmen_localize_write_map_to_ppm(char *filename, 
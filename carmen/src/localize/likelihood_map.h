@@ -44,9 +44,23 @@ typedef struct {
   float **distance, **prob, **gprob;
 } carmen_localize_map_t, *carmen_localize_map_p;
 
+void carmen_localize_allocate_map(carmen_map_p cmap, 
+				  carmen_localize_map_p lmap);
+
 void carmen_to_localize_map(carmen_map_p cmap, carmen_localize_map_p lmap,
 			    carmen_localize_param_p param);
 
+unsigned int carmen_localize_map_hash(carmen_map_p cmap);
+
+void carmen_localize_get_likelihood(carmen_localize_map_p lmap,
+				    carmen_localize_param_p param,
+				    carmen_map_likelihood_p likelihood);
+
+int carmen_localize_likelihood_matches(carmen_map_likelihood_p l1,
+				       carmen_map_likelihood_p l2);
+
+void carmen_localize_free_map(carmen_localize_map_p lmap);
+
 void carmen_localize_write_map_to_ppm(char *filename, 
 				      carmen_localize_map_p map);
 
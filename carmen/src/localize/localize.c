@@ -27,6 +27,7 @@
  ********************************************************/
 
 #include <carmen/carmen.h>
+#include <pthread.h>
 #include "localizecore.h"
 #include "localize_messages.h"
 
@@ -38,6 +39,31 @@ carmen_localize_summary_t summary;
 
 carmen_robot_laser_message front_laser;
 
+/* Map updates are converted into likelihood maps on a worker thread
+   while tracking goes on with the old map.  The finished map is swapped
+   in from the IPC thread, between laser scans.  If updates arrive
+   faster than maps can be built, only the newest one is kept. */
+
+static pthread_t map_builder;
+static int map_builder_running = 0;
+static int map_builder_done = 0;
+static carmen_map_p building_map = NULL;  /* raw map being converted */
+static carmen_map_p pending_map = NULL;   /* newest update not yet started */
+static carmen_map_p current_map = NULL;   /* raw map behind map.carmen_map */
+static carmen_localize_map_t next_map;
+
+/* map file the likelihood fields are cached in, or NULL */
+static char *likelihood_cache = NULL;
+
+/* Particle and sensor messages are published at most this often (Hz,
+   0 for every scan), only while someone is subscribed to them, and
+   with at most max_published_particles particles (0 for all). */
+static double particle_publish_rate = 0.0;
+static double sensor_publish_rate = 0.0;
+static int max_published_particles = 0;
+static double last_particle_publish = 0;
+static double last_front_sensor_publish = 0, last_rear_sensor_publish = 0;
+
 /* publish a global position message */
 
 void publish_globalpos(carmen_localize_summary_p summary)
@@ -57,23 +83,183 @@ void publish_globalpos(carmen_localize_summary_p summary)
 		       CARMEN_LOCALIZE_GLOBALPOS_NAME);  
 }
 
-/* publish a particle message */
+/* returns 1 if a message published at rate (Hz) is due, and notes
+   that it is being published now */
+
+static int publish_due(double *last_publish, double rate)
+{
+  double t = carmen_get_time();
+
+  if(rate > 0 && t - *last_publish < 1.0 / rate)
+    return 0;
+  *last_publish = t;
+  return 1;
+}
+
+/* asking central is a round trip, so the answer is kept for a second */
+
+static int have_subscribers(char *msg_name, double *last_check, 
+			    int *num_handlers)
+{
+  double t = carmen_get_time();
+
+  if(t - *last_check > 1.0) {
+    *num_handlers = IPC_numHandlers(msg_name);
+    *last_check = t;
+  }
+  return (*num_handlers != 0);
+}
+
+/* draw num_published of the filter's particles in proportion to their
+   weights, with evenly spaced strata so the cloud keeps its shape.
+   Doesn't touch the filter's random numbers. */
+
+static void decimate_particles(carmen_localize_particle_filter_p filter,
+			       carmen_localize_particle_ipc_p published,
+			       int num_published)
+{
+  static double *cumulative_sum = NULL;
+  static int max_particles = 0;
+  double max_weight, weight_sum, position, step_size;
+  int i, n, which_particle;
+
+  n = filter->param->num_particles;
+  if(n > max_particles) {
+    cumulative_sum = (double *)realloc(cumulative_sum, n * sizeof(double));
+    carmen_test_alloc(cumulative_sum);
+    max_particles = n;
+  }
+
+  max_weight = filter->particles[0].weight;
+  for(i = 1; i < n; i++)
+    if(filter->particles[i].weight > max_weight)
+      max_weight = filter->particles[i].weight;
+  weight_sum = 0.0;
+  for(i = 0; i < n; i++) {
+    weight_sum += exp(filter->particles[i].weight - max_weight);
+    cumulative_sum[i] = weight_sum;
+  }
+
+  step_size = weight_sum / num_published;
+  position = 0.5 * step_size;
+  which_particle = 0;
+  for(i = 0; i < num_published; i++) {
+    while(which_particle < n - 1 && position > cumulative_sum[which_particle])
+      which_particle++;
+    published[i].x = filter->particles[which_particle].x;
+    published[i].y = filter->particles[which_particle].y;
+    published[i].theta = filter->particles[which_particle].theta;
+    published[i].weight = 0.0;
+    position += step_size;
+  }
+}
+
+static short quantize(double v, double resolution)
+{
+  v = floor(v / resolution + 0.5);
+  if(v > 32767)
+    return 32767;
+  if(v < -32767)
+    return -32767;
+  return (short)v;
+}
+
+static void publish_compact_particles(carmen_localize_particle_ipc_p particles,
+				      int num_particles,
+				      carmen_localize_summary_p summary)
+{
+  static carmen_localize_compact_particle_message cmsg;
+  static int max_particles = 0;
+  double extent;
+  int i;
+  IPC_RETURN_TYPE err;
+
+  if(num_particles > max_particles) {
+    cmsg.x = (short *)realloc(cmsg.x, num_particles * sizeof(short));
+    carmen_test_alloc(cmsg.x);
+    cmsg.y = (short *)realloc(cmsg.y, num_particles * sizeof(short));
+    carmen_test_alloc(cmsg.y);
+    cmsg.theta = (short *)realloc(cmsg.theta, num_particles * sizeof(short));
+    carmen_test_alloc(cmsg.theta);
+    max_particles = num_particles;
+  }
+
+  /* centimeters, unless the cloud is too spread out for that */
+  extent = 0.0;
+  for(i = 0; i < num_particles; i++) {
+    extent = carmen_fmax(extent, fabs(particles[i].x - summary->mean.x));
+    extent = carmen_fmax(extent, fabs(particles[i].y - summary->mean.y));
+  }
+  cmsg.resolution = carmen_fmax(0.01, extent / 32767.0);
+
+  for(i = 0; i < num_particles; i++) {
+    cmsg.x[i] = quantize(particles[i].x - summary->mean.x, cmsg.resolution);
+    cmsg.y[i] = quantize(particles[i].y - summary->mean.y, cmsg.resolution);
+    cmsg.theta[i] = quantize(carmen_normalize_theta(particles[i].theta),
+			     M_PI / 32768.0);
+  }
+
+  cmsg.timestamp = carmen_get_time();
+  cmsg.host = carmen_get_host();
+  cmsg.num_particles = num_particles;
+  cmsg.globalpos = summary->mean;
+  cmsg.globalpos_std = summary->std;
+  cmsg.globalpos_xy_cov = summary->xy_cov;
+  err = IPC_publishData(CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME, &cmsg);
+  carmen_test_ipc_exit(err, "Could not publish", 
+		       CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME);  
+}
+
+/* publish a particle message, and the compact particle message if
+   anyone wants it */
 
 void publish_particles(carmen_localize_particle_filter_p filter, 
 		       carmen_localize_summary_p summary)
 {
   static carmen_localize_particle_message pmsg;
+  static carmen_localize_particle_ipc_p published = NULL;
+  static int max_published = 0;
+  static double last_check = 0, last_compact_check = 0;
+  static int num_handlers = 0, num_compact_handlers = 0;
+  int full, compact, num_published;
   IPC_RETURN_TYPE err;
 
-  pmsg.timestamp = carmen_get_time();
-  pmsg.host = carmen_get_host();
-  pmsg.globalpos = summary->mean;
-  pmsg.globalpos_std = summary->mean;
-  pmsg.num_particles = filter->param->num_particles;
-  pmsg.particles = (carmen_localize_particle_ipc_p)filter->particles;
-  err = IPC_publishData(CARMEN_LOCALIZE_PARTICLE_NAME, &pmsg);
-  carmen_test_ipc_exit(err, "Could not publish", 
-		       CARMEN_LOCALIZE_PARTICLE_NAME);  
+  full = have_subscribers(CARMEN_LOCALIZE_PARTICLE_NAME, &last_check, 
+			  &num_handlers);
+  compact = have_subscribers(CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME, 
+			     &last_compact_check, &num_compact_handlers);
+  if(!full && !compact)
+    return;
+
+  num_published = filter->param->num_particles;
+  if(max_published_particles > 0 && num_published > max_published_particles) {
+    num_published = max_published_particles;
+    if(num_published > max_published) {
+      published = (carmen_localize_particle_ipc_p)
+	realloc(published, num_published * sizeof(carmen_localize_particle_ipc_t));
+      carmen_test_alloc(published);
+      max_published = num_published;
+    }
+    decimate_particles(filter, published, num_published);
+    pmsg.particles = published;
+  }
+  else
+    pmsg.particles = (carmen_localize_particle_ipc_p)filter->particles;
+  pmsg.num_particles = num_published;
+
+  if(compact)
+    publish_compact_particles(pmsg.particles, pmsg.num_particles, summary);
+
+  if(full) {
+    pmsg.timestamp = carmen_get_time();
+    pmsg.host = carmen_get_host();
+    pmsg.globalpos = summary->mean;
+    pmsg.globalpos_std = summary->std;
+    pmsg.globalpos_xy_cov = summary->xy_cov;
+    err = IPC_publishData(CARMEN_LOCALIZE_PARTICLE_NAME, &pmsg);
+    carmen_test_ipc_exit(err, "Could not publish", 
+			 CARMEN_LOCALIZE_PARTICLE_NAME);  
+  }
   fprintf(stderr, "P");
 }
 
@@ -84,9 +270,15 @@ void publish_sensor(carmen_localize_particle_filter_p filter,
 		    carmen_robot_laser_message *laser, int front)
 {
   static carmen_localize_sensor_message sensor;
+  static double last_check = 0;
+  static int num_handlers = 0;
   IPC_RETURN_TYPE err;
   double cost, sint;
 
+  if(!have_subscribers(CARMEN_LOCALIZE_SENSOR_NAME, &last_check, 
+		       &num_handlers))
+    return;
+
   sensor.timestamp = carmen_get_time();
   sensor.host = carmen_get_host();
   if(front) {
@@ -144,9 +336,83 @@ void carmen_localize_initialize_placename_handler(carmen_localize_initialize_pla
   publish_particles(filter, &summary);
 }
 
+static void *build_localize_map(void *arg __attribute__ ((unused)))
+{
+  carmen_to_localize_map(building_map, &next_map, filter->param);
+  __atomic_store_n(&map_builder_done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void start_map_builder(void)
+{
+  building_map = pending_map;
+  pending_map = NULL;
+  map_builder_done = 0;
+  map_builder_running = 1;
+  carmen_warn("Creating likelihood maps in the background...\n");
+  if(pthread_create(&map_builder, NULL, build_localize_map, NULL) != 0)
+    carmen_die("Could not start the map builder thread.\n");
+}
+
+/* swap in a finished likelihood map; the particles are kept if the map
+   has the same geometry as the old one */
+
+static void check_map_builder(void)
+{
+  carmen_localize_param_p param;
+  int i, compatible;
+
+  if(!map_builder_running || 
+     !__atomic_load_n(&map_builder_done, __ATOMIC_ACQUIRE))
+    return;
+
+  pthread_join(map_builder, NULL);
+  map_builder_running = 0;
+
+  compatible = (next_map.config.x_size == map.config.x_size &&
+		next_map.config.y_size == map.config.y_size &&
+		next_map.config.resolution == map.config.resolution);
+
+  carmen_localize_free_map(&map);
+  free(map.carmen_map.complete_map);
+  free(map.carmen_map.map);
+  if(current_map != NULL)
+    free(current_map);
+  current_map = building_map;
+  building_map = NULL;
+  map = next_map;
+
+  if(!compatible) {
+    param = filter->param;
+    for(i = 0; i < filter->param->num_particles; i++) 
+      free(filter->temp_weights[i]);  
+    free(filter->temp_weights);
+    free(filter->particles);
+    free(filter->motion_noise);
+    free(filter);
+    filter = carmen_localize_particle_filter_new(param);
+    carmen_warn("Likelihood maps updated, map size changed: "
+		"localize needs to be reinitialized.\n");
+  }
+  else
+    carmen_warn("Likelihood maps updated.\n");
+
+  if(pending_map != NULL)
+    start_map_builder();
+}
+
+static void map_builder_timer(void *clientdata __attribute__ ((unused)),
+			      unsigned long currenttime __attribute__ ((unused)),
+			      unsigned long scheduledTime 
+			      __attribute__ ((unused)))
+{
+  check_map_builder();
+}
+
 void robot_frontlaser_handler(carmen_robot_laser_message *flaser)
 {
   fprintf(stderr, "F");
+  check_map_builder();
   carmen_localize_run(filter, &map, flaser, 
 	       filter->param->front_laser_offset, 0);
   if(filter->initialized) {
@@ -155,8 +421,10 @@ void robot_frontlaser_handler(carmen_robot_laser_message *flaser)
 			      flaser->config.angular_resolution,
 			      flaser->config.start_angle, 0);
     publish_globalpos(&summary);
-    publish_particles(filter, &summary);
-    publish_sensor(filter, &summary, flaser, 1);
+    if(publish_due(&last_particle_publish, particle_publish_rate))
+      publish_particles(filter, &summary);
+    if(publish_due(&last_front_sensor_publish, sensor_publish_rate))
+      publish_sensor(filter, &summary, flaser, 1);
   }
 }
 
@@ -168,7 +436,8 @@ void robot_rearlaser_handler(carmen_robot_laser_message *rlaser)
 			      rlaser->range, filter->param->rear_laser_offset,
 			      rlaser->config.angular_resolution,
 			      rlaser->config.start_angle, 0);
-    publish_sensor(filter, &summary, rlaser, 0);
+    if(publish_due(&last_rear_sensor_publish, sensor_publish_rate))
+      publish_sensor(filter, &summary, rlaser, 0);
   }
   //rlaser = rlaser;
 }
@@ -176,41 +445,18 @@ void robot_rearlaser_handler(carmen_robot_laser_message *rlaser)
 void 
 map_update_handler(carmen_map_t *new_map) 
 {
-  int i;
-  carmen_localize_param_p param;
-
-  param = filter->param;
-
-  for(i = 0; i < filter->param->num_particles; i++) 
-    free(filter->temp_weights[i]);  
-  free(filter->temp_weights);
-  free(filter->particles);
-  free(filter);
-
-  free(map.complete_x_offset);
-  free(map.complete_y_offset);
-  free(map.complete_distance);
-  free(map.complete_prob);
-  free(map.complete_gprob);
-  free(map.x_offset);
-  free(map.y_offset);
-  free(map.distance);
-  free(map.prob);
-  free(map.gprob);
-  
-  filter = carmen_localize_particle_filter_new(param);
-  carmen_to_localize_map(new_map, &map, param);	
+  /* the message buffer is reused, so the builder gets its own copy */
+  if(pending_map != NULL)
+    carmen_map_destroy(&pending_map);
+  pending_map = carmen_map_copy(new_map);
+  if(!map_builder_running)
+    start_map_builder();
 
   if (placelist.num_places > 0)
     free(placelist.places);
 
   if(carmen_map_get_placelist(&placelist) < 0)
     carmen_die("Could not get placelist from the map server.\n");
-
-  /* create a localize map */
-  carmen_warn("Creating likelihood maps... ");
-  carmen_warn("done.\n");
-
 }
 
 static void
@@ -314,6 +560,13 @@ int register_ipc_messages(void)
 		      CARMEN_LOCALIZE_PARTICLE_FMT);
   carmen_test_ipc_exit(err, "Could not define", CARMEN_LOCALIZE_PARTICLE_NAME);
 
+  /* register compact particle message */
+  err = IPC_defineMsg(CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME, 
+		      IPC_VARIABLE_LENGTH, 
+		      CARMEN_LOCALIZE_COMPACT_PARTICLE_FMT);
+  carmen_test_ipc_exit(err, "Could not define", 
+		       CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME);
+
   /* register sensor message */
   err = IPC_defineMsg(CARMEN_LOCALIZE_SENSOR_NAME, IPC_VARIABLE_LENGTH,
 		      CARMEN_LOCALIZE_SENSOR_FMT);
@@ -429,7 +682,15 @@ void read_parameters(int argc, char **argv, carmen_localize_param_p param)
     {"localize", "tracking_beam_minlikelihood", CARMEN_PARAM_DOUBLE, 
      &param->tracking_beam_minlikelihood, 0, NULL},
     {"localize", "global_beam_minlikelihood", CARMEN_PARAM_DOUBLE, 
-     &param->global_beam_minlikelihood, 0, NULL}
+     &param->global_beam_minlikelihood, 0, NULL},
+    {"localize", "likelihood_cache", CARMEN_PARAM_STRING, 
+     &likelihood_cache, 0, NULL},
+    {"localize", "particle_publish_rate", CARMEN_PARAM_DOUBLE, 
+     &particle_publish_rate, 1, NULL},
+    {"localize", "sensor_publish_rate", CARMEN_PARAM_DOUBLE, 
+     &sensor_publish_rate, 1, NULL},
+    {"localize", "max_published_particles", CARMEN_PARAM_INT, 
+     &max_published_particles, 1, NULL}
   };
 
   carmen_param_install_params(argc, argv, param_list, 
@@ -437,6 +698,93 @@ void read_parameters(int argc, char **argv, carmen_localize_param_p param)
 
   param->integrate_angle = carmen_degrees_to_radians(integrate_angle_deg);
 
+  if(likelihood_cache != NULL && 
+     (likelihood_cache[0] == '\0' || 
+      carmen_strcasecmp(likelihood_cache, "none") == 0))
+    likelihood_cache = NULL;
+
+}
+
+/* load the likelihood fields from the cache file, if it holds fields
+   built from the same map with the same parameters */
+
+static int load_cached_likelihood(carmen_map_p raw_map, 
+				  carmen_localize_map_p lmap,
+				  carmen_localize_param_p param)
+{
+  carmen_map_likelihood_t expected, cached;
+
+  if(!carmen_file_exists(likelihood_cache) || 
+     !carmen_map_file(likelihood_cache) ||
+     carmen_map_chunk_exists(likelihood_cache, 
+			     CARMEN_MAP_LIKELIHOOD_CHUNK) <= 0)
+    return -1;
+
+  carmen_localize_allocate_map(raw_map, lmap);
+  carmen_localize_get_likelihood(lmap, param, &expected);
+  cached = expected;
+  if(carmen_map_read_likelihood_chunk(likelihood_cache, &cached) < 0 ||
+     !carmen_localize_likelihood_matches(&expected, &cached)) {
+    carmen_localize_free_map(lmap);
+    return -1;
+  }
+  return 0;
+}
+
+/* store the likelihood fields in the cache file, replacing any that
+   are already there.  If the cache file is a map file all its other
+   chunks are kept. */
+
+static void save_cached_likelihood(carmen_localize_map_p lmap,
+				   carmen_localize_param_p param)
+{
+  carmen_map_likelihood_t likelihood;
+  carmen_FILE *in_fp, *out_fp;
+  char *tmp_filename, *ext;
+  int err;
+
+  ext = carmen_file_extension(likelihood_cache);
+  tmp_filename = (char *)calloc(strlen(likelihood_cache) + 10, sizeof(char));
+  carmen_test_alloc(tmp_filename);
+  if(ext != NULL && strcmp(ext, ".gz") == 0)
+    sprintf(tmp_filename, "%s.tmp.gz", likelihood_cache);
+  else
+    sprintf(tmp_filename, "%s.tmp", likelihood_cache);
+
+  out_fp = carmen_fopen(tmp_filename, "w");
+  if(out_fp == NULL) {
+    carmen_warn("Could not open %s for writing.\n", tmp_filename);
+    free(tmp_filename);
+    return;
+  }
+
+  if(carmen_file_exists(likelihood_cache) && 
+     carmen_map_file(likelihood_cache)) {
+    in_fp = carmen_fopen(likelihood_cache, "r");
+    err = (in_fp == NULL || 
+	   carmen_map_strip(in_fp, out_fp, CARMEN_MAP_LIKELIHOOD_CHUNK) < 0);
+    if(in_fp != NULL)
+      carmen_fclose(in_fp);
+  }
+  else
+    err = (carmen_map_write_comment_chunk(out_fp, lmap->config.x_size,
+					  lmap->config.y_size,
+					  lmap->config.resolution, "localize",
+					  "likelihood field cache\n") < 0 ||
+	   carmen_map_write_id(out_fp) < 0);
+
+  if(!err) {
+    carmen_localize_get_likelihood(lmap, param, &likelihood);
+    err = (carmen_map_write_likelihood_chunk(out_fp, &likelihood) < 0);
+  }
+  carmen_fclose(out_fp);
+
+  if(err || rename(tmp_filename, likelihood_cache) < 0) {
+    carmen_warn("Could not write likelihood fields to %s.\n", 
+		likelihood_cache);
+    unlink(tmp_filename);
+  }
+  free(tmp_filename);
 }
 
 /* create localize specific maps */
@@ -456,9 +804,18 @@ void create_localize_map(carmen_localize_map_t *map,
     carmen_die("Could not get placelist from the map server.\n");
 
   /* create a localize map */
+  if(likelihood_cache != NULL &&
+     load_cached_likelihood(&raw_map, map, param) == 0) {
+    carmen_warn("Loaded likelihood maps from %s.\n", likelihood_cache);
+    return;
+  }
   carmen_warn("Creating likelihood maps... ");
   carmen_to_localize_map(&raw_map, map, param);
   carmen_warn("done.\n");
+  if(likelihood_cache != NULL) {
+    carmen_warn("Saving likelihood maps to %s.\n", likelihood_cache);
+    save_cached_likelihood(map, param);
+  }
 }
 
 void shutdown_localize(int x)
@@ -509,6 +866,7 @@ int main(int argc, char **argv)
   carmen_map_subscribe_gridmap_update_message(NULL, (carmen_handler_t)
 					      map_update_handler,
 					      CARMEN_SUBSCRIBE_LATEST);
+  carmen_ipc_addPeriodicTimer(0.1, map_builder_timer, NULL);
 
   /* Loop forever */
   carmen_ipc_dispatch();
@@ -0,0 +1,464 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/* Replays a log through the localization filter offline, without
+   central, param_daemon or playback, as fast as possible and with a
+   fixed random seed.  Reports scans per second, the time spent in each
+   stage of the filter, and the pose error against TRUEPOS lines if the
+   log has them.
+
+   Parameters are read from an ini file the same way param_daemon
+   reads them: the [*] and [expert] sections, and the section of the
+   robot given with -robot. */
+
+#include <carmen/carmen.h>
+#include <carmen/readlog.h>
+#include "localizecore.h"
+
+#define MAX_LINE_LENGTH 100000
+
+static carmen_localize_param_t param;
+#ifndef OLD_MOTION_MODEL
+static carmen_localize_motion_model_t motion_model;
+#endif
+static double integrate_angle_deg = 3.0;
+
+static carmen_param_t param_list[] = {
+  {"robot", "frontlaser_offset", CARMEN_PARAM_DOUBLE,
+   &param.front_laser_offset, 0, NULL},
+  {"robot", "frontlaser_side_offset", CARMEN_PARAM_DOUBLE,
+   &param.front_laser_side_offset, 0, NULL},
+  {"robot", "frontlaser_angular_offset", CARMEN_PARAM_DOUBLE,
+   &param.front_laser_angle_offset, 0, NULL},
+  {"localize", "num_particles", CARMEN_PARAM_INT,
+   &param.num_particles, 0, NULL},
+  {"localize", "laser_max_range", CARMEN_PARAM_DOUBLE, &param.max_range,
+   0, NULL},
+  {"localize", "min_wall_prob", CARMEN_PARAM_DOUBLE,
+   &param.min_wall_prob, 0, NULL},
+  {"localize", "outlier_fraction", CARMEN_PARAM_DOUBLE,
+   &param.outlier_fraction, 0, NULL},
+  {"localize", "update_distance", CARMEN_PARAM_DOUBLE,
+   &param.update_distance, 0, NULL},
+  {"localize", "integrate_angle_deg", CARMEN_PARAM_DOUBLE,
+   &integrate_angle_deg, 0, NULL},
+  {"localize", "do_scanmatching", CARMEN_PARAM_ONOFF,
+   &param.do_scanmatching, 0, NULL},
+  {"localize", "constrain_to_map", CARMEN_PARAM_ONOFF,
+   &param.constrain_to_map, 0, NULL},
+#ifdef OLD_MOTION_MODEL
+  {"localize", "odom_a1", CARMEN_PARAM_DOUBLE, &param.odom_a1, 0, NULL},
+  {"localize", "odom_a2", CARMEN_PARAM_DOUBLE, &param.odom_a2, 0, NULL},
+  {"localize", "odom_a3", CARMEN_PARAM_DOUBLE, &param.odom_a3, 0, NULL},
+  {"localize", "odom_a4", CARMEN_PARAM_DOUBLE, &param.odom_a4, 0, NULL},
+#else
+  {"localize", "mean_c_d", CARMEN_PARAM_DOUBLE, &motion_model.mean_c_d, 0, NULL},
+  {"localize", "mean_c_t", CARMEN_PARAM_DOUBLE, &motion_model.mean_c_t, 0, NULL},
+  {"localize", "std_dev_c_d", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_c_d, 0, NULL},
+  {"localize", "std_dev_c_t", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_c_t, 0, NULL},
+  {"localize", "mean_d_d", CARMEN_PARAM_DOUBLE, &motion_model.mean_d_d, 0, NULL},
+  {"localize", "mean_d_t", CARMEN_PARAM_DOUBLE, &motion_model.mean_d_t, 0, NULL},
+  {"localize", "std_dev_d_d", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_d_d, 0, NULL},
+  {"localize", "std_dev_d_t", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_d_t, 0, NULL},
+  {"localize", "mean_t_d", CARMEN_PARAM_DOUBLE, &motion_model.mean_t_d, 0, NULL},
+  {"localize", "mean_t_t", CARMEN_PARAM_DOUBLE, &motion_model.mean_t_t, 0, NULL},
+  {"localize", "std_dev_t_d", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_t_d, 0, NULL},
+  {"localize", "std_dev_t_t", CARMEN_PARAM_DOUBLE, &motion_model.std_dev_t_t, 0, NULL},
+#endif
+  {"localize", "occupied_prob", CARMEN_PARAM_DOUBLE,
+   &param.occupied_prob, 0, NULL},
+  {"localize", "lmap_std", CARMEN_PARAM_DOUBLE,
+   &param.lmap_std, 0, NULL},
+  {"localize", "global_lmap_std", CARMEN_PARAM_DOUBLE,
+   &param.global_lmap_std, 0, NULL},
+  {"localize", "global_evidence_weight", CARMEN_PARAM_DOUBLE,
+   &param.global_evidence_weight, 0, NULL},
+  {"localize", "global_distance_threshold", CARMEN_PARAM_DOUBLE,
+   &param.global_distance_threshold, 0, NULL},
+  {"localize", "global_test_samples", CARMEN_PARAM_INT,
+   &param.global_test_samples, 0, NULL},
+  {"localize", "use_sensor", CARMEN_PARAM_ONOFF,
+   &param.use_sensor, 0, NULL},
+  {"localize", "tracking_beam_minlikelihood", CARMEN_PARAM_DOUBLE,
+   &param.tracking_beam_minlikelihood, 0, NULL},
+  {"localize", "global_beam_minlikelihood", CARMEN_PARAM_DOUBLE,
+   &param.global_beam_minlikelihood, 0, NULL}
+};
+
+static int num_params = sizeof(param_list) / sizeof(param_list[0]);
+
+/* defaults are the values from carmen.ini */
+
+static void set_default_parameters(void)
+{
+  memset(&param, 0, sizeof(carmen_localize_param_t));
+  param.num_particles = 250;
+  param.max_range = 50.0;
+  param.min_wall_prob = 0.25;
+  param.outlier_fraction = 0.90;
+  param.update_distance = 0.20;
+  param.occupied_prob = 0.5;
+  param.lmap_std = 0.3;
+  param.global_lmap_std = 0.6;
+  param.global_evidence_weight = 0.01;
+  param.global_distance_threshold = 2.0;
+  param.global_test_samples = 100000;
+  param.use_sensor = 1;
+  param.tracking_beam_minlikelihood = 0.45;
+  param.global_beam_minlikelihood = 0.9;
+#ifdef OLD_MOTION_MODEL
+  param.odom_a1 = 0.2;
+  param.odom_a2 = 0.01;
+  param.odom_a3 = 0.2;
+  param.odom_a4 = 0.01;
+#else
+  memset(&motion_model, 0, sizeof(carmen_localize_motion_model_t));
+  motion_model.mean_c_d = -0.0123;
+  motion_model.mean_c_t = -0.1065;
+  motion_model.std_dev_c_d = 0.1380;
+  motion_model.std_dev_c_t = 0.2347;
+  motion_model.mean_d_d = 1.0055;
+  motion_model.mean_d_t = 0.0025;
+  motion_model.std_dev_d_d = 0.1925;
+  motion_model.std_dev_d_t = 0.3982;
+  motion_model.mean_t_d = -0.0025;
+  motion_model.mean_t_t = 0.9638;
+  motion_model.std_dev_t_d = 0.0110;
+  motion_model.std_dev_t_t = 0.3300;
+#endif
+}
+
+static void set_parameter(char *name, char *value)
+{
+  char full_name[1024];
+  int i;
+
+  for(i = 0; i < num_params; i++) {
+    snprintf(full_name, 1024, "%s_%s", param_list[i].module,
+	     param_list[i].variable);
+    if(carmen_strcasecmp(full_name, name) != 0)
+      continue;
+    switch(param_list[i].type) {
+    case CARMEN_PARAM_INT:
+      *((int *)param_list[i].user_variable) = atoi(value);
+      break;
+    case CARMEN_PARAM_DOUBLE:
+      *((double *)param_list[i].user_variable) = atof(value);
+      break;
+    case CARMEN_PARAM_ONOFF:
+      *((int *)param_list[i].user_variable) =
+	(carmen_strncasecmp(value, "on", 2) == 0);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static void read_ini_file(char *filename, char *robot)
+{
+  FILE *fp;
+  char line[MAX_LINE_LENGTH], *mark, *name, *value;
+  int use_section = 0, found_robot = 0;
+
+  fp = fopen(filename, "r");
+  if(fp == NULL)
+    carmen_die_syserror("Could not open %s for reading", filename);
+
+  while(fgets(line, MAX_LINE_LENGTH, fp) != NULL) {
+    mark = strchr(line, '#');
+    if(mark != NULL)
+      mark[0] = '\0';
+    name = strtok(line, " \t\r\n");
+    if(name == NULL)
+      continue;
+    value = strtok(NULL, " \t\r\n");
+
+    if(name[0] == '[') {
+      mark = strchr(name, ']');
+      if(mark != NULL)
+	mark[0] = '\0';
+      use_section = (strcmp(name + 1, "*") == 0 ||
+		     carmen_strcasecmp(name + 1, "expert") == 0);
+      if(robot != NULL && carmen_strcasecmp(name + 1, robot) == 0) {
+	use_section = 1;
+	found_robot = 1;
+      }
+    }
+    else if(use_section && value != NULL)
+      set_parameter(name, value);
+  }
+  fclose(fp);
+
+  if(robot != NULL && !found_robot)
+    carmen_die("Did not find a section for robot %s in %s.\n", robot,
+	       filename);
+}
+
+/* load the likelihood fields from the map file if it has a matching
+   likelihood chunk, otherwise compute them */
+
+static void create_localize_map(char *filename, carmen_localize_map_p lmap)
+{
+  carmen_map_p raw_map;
+  carmen_map_likelihood_t expected, cached;
+  double start;
+
+  raw_map = (carmen_map_p)calloc(1, sizeof(carmen_map_t));
+  carmen_test_alloc(raw_map);
+  if(carmen_map_read_gridmap_chunk(filename, raw_map) < 0)
+    carmen_die("Could not read a gridmap from %s.\n", filename);
+
+  start = carmen_get_time();
+  if(carmen_map_chunk_exists(filename, CARMEN_MAP_LIKELIHOOD_CHUNK) > 0) {
+    carmen_localize_allocate_map(raw_map, lmap);
+    carmen_localize_get_likelihood(lmap, &param, &expected);
+    cached = expected;
+    if(carmen_map_read_likelihood_chunk(filename, &cached) == 0 &&
+       carmen_localize_likelihood_matches(&expected, &cached)) {
+      printf("likelihood maps: loaded in %.3f s\n",
+	     carmen_get_time() - start);
+      return;
+    }
+    carmen_localize_free_map(lmap);
+  }
+  carmen_to_localize_map(raw_map, lmap, &param);
+  printf("likelihood maps: built in %.3f s\n", carmen_get_time() - start);
+}
+
+/* where the true pose was at the time of the laser, from the last
+   truepos message and the odometry since then */
+
+static carmen_point_t true_pose_at(carmen_simulator_truepos_message *truepos,
+				   carmen_point_t odometry)
+{
+  carmen_point_t pose;
+  double dx, dy, c, s, local_x, local_y;
+
+  dx = odometry.x - truepos->odometrypose.x;
+  dy = odometry.y - truepos->odometrypose.y;
+  c = cos(truepos->odometrypose.theta);
+  s = sin(truepos->odometrypose.theta);
+  local_x = c * dx + s * dy;
+  local_y = -s * dx + c * dy;
+
+  c = cos(truepos->truepose.theta);
+  s = sin(truepos->truepose.theta);
+  pose.x = truepos->truepose.x + c * local_x - s * local_y;
+  pose.y = truepos->truepose.y + s * local_x + c * local_y;
+  pose.theta = carmen_normalize_theta(truepos->truepose.theta +
+				      odometry.theta -
+				      truepos->odometrypose.theta);
+  return pose;
+}
+
+static void usage(char *progname)
+{
+  carmen_die("usage: %s [-ini <ini file>] [-robot <robot>] "
+	     "[-particles <n>] [-seed <n>]\n"
+	     "       [-init <x> <y> <theta deg>] <map file> <log file>\n\n"
+	     "Without -init the filter is started from the first TRUEPOS "
+	     "line,\nor by global localization if the log has none.\n",
+	     progname);
+}
+
+int main(int argc, char **argv)
+{
+  char *ini_filename = NULL, *robot = NULL;
+  char *map_filename, *log_filename, *line;
+  int i, num_particles = 0, have_init = 0, have_truepos = 0;
+  unsigned int seed = 1;
+  carmen_point_t init_pose, init_std, odometry, true_pose;
+  carmen_localize_map_t map;
+  carmen_localize_particle_filter_p filter;
+  carmen_localize_summary_t summary;
+  carmen_robot_laser_message laser;
+  carmen_simulator_truepos_message truepos;
+  carmen_FILE *logfile;
+  carmen_logfile_index_p index;
+  int num_scans = 0, num_resamples = 0, num_errors = 0;
+  double t, t_start, t_odometry = 0, t_laser = 0, t_resample = 0;
+  double t_summarize = 0, t_total;
+  double err, err_theta, err_sum = 0, err_sq_sum = 0, err_max = 0;
+  double err_theta_sum = 0;
+
+  set_default_parameters();
+
+  for(i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if(strcmp(argv[i], "-ini") == 0 && i + 1 < argc)
+      ini_filename = argv[++i];
+    else if(strcmp(argv[i], "-robot") == 0 && i + 1 < argc)
+      robot = argv[++i];
+    else if(strcmp(argv[i], "-particles") == 0 && i + 1 < argc)
+      num_particles = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+      seed = strtoul(argv[++i], NULL, 10);
+    else if(strcmp(argv[i], "-init") == 0 && i + 3 < argc) {
+      init_pose.x = atof(argv[++i]);
+      init_pose.y = atof(argv[++i]);
+      init_pose.theta = carmen_degrees_to_radians(atof(argv[++i]));
+      have_init = 1;
+    }
+    else
+      usage(argv[0]);
+  }
+  if(argc - i != 2)
+    usage(argv[0]);
+  map_filename = argv[i];
+  log_filename = argv[i + 1];
+
+  if(ini_filename != NULL)
+    read_ini_file(ini_filename, robot);
+  if(num_particles > 0)
+    param.num_particles = num_particles;
+  param.integrate_angle = carmen_degrees_to_radians(integrate_angle_deg);
+#ifndef OLD_MOTION_MODEL
+  param.motion_model = &motion_model;
+#endif
+
+  carmen_set_random_seed(seed);
+
+  create_localize_map(map_filename, &map);
+  filter = carmen_localize_particle_filter_new(&param);
+
+  logfile = carmen_fopen(log_filename, "r");
+  if(logfile == NULL)
+    carmen_die("Could not open log file %s for reading.\n", log_filename);
+  index = carmen_logfile_index_messages(logfile);
+
+  line = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
+  carmen_test_alloc(line);
+  memset(&laser, 0, sizeof(carmen_robot_laser_message));
+  memset(&truepos, 0, sizeof(carmen_simulator_truepos_message));
+
+  init_std.x = 0.2;
+  init_std.y = 0.2;
+  init_std.theta = carmen_degrees_to_radians(4.0);
+
+  printf("%d particles, seed %u\n", param.num_particles, seed);
+
+  t_start = carmen_get_time();
+  while(!carmen_logfile_eof(index)) {
+    if(carmen_logfile_read_next_line(index, logfile, MAX_LINE_LENGTH,
+				     line) <= 0)
+      continue;
+
+    if(strncmp(line, "TRUEPOS ", 8) == 0) {
+      carmen_string_to_simulator_truepos_message(line, &truepos);
+      have_truepos = 1;
+      continue;
+    }
+    if(strncmp(line, "ROBOTLASER1 ", 12) == 0)
+      carmen_string_to_robot_laser_message(line, &laser);
+    else if(strncmp(line, "FLASER ", 7) == 0)
+      carmen_string_to_robot_laser_message_orig(line, &laser);
+    else
+      continue;
+
+    odometry = laser.robot_pose;
+
+    if(!filter->initialized) {
+      if(have_init)
+	carmen_localize_initialize_particles_gaussian(filter, init_pose,
+						      init_std);
+      else if(have_truepos)
+	carmen_localize_initialize_particles_gaussian
+	  (filter, true_pose_at(&truepos, odometry), init_std);
+      else
+	carmen_localize_initialize_particles_uniform(filter, &laser, &map);
+    }
+
+    /* the steps of carmen_localize_run, timed one by one */
+    t = carmen_get_time();
+    carmen_localize_incorporate_odometry(filter, odometry);
+    t_odometry += carmen_get_time() - t;
+
+    if(param.use_sensor) {
+      t = carmen_get_time();
+      carmen_localize_incorporate_laser(filter, &map, laser.num_readings,
+					laser.range, param.front_laser_offset,
+					laser.config.angular_resolution,
+					laser.config.maximum_range,
+					laser.config.start_angle, 0);
+      t_laser += carmen_get_time() - t;
+
+      if(filter->distance_travelled > param.update_distance) {
+	t = carmen_get_time();
+	carmen_localize_resample(filter);
+	filter->distance_travelled = 0;
+	filter->initialized = 1;
+	t_resample += carmen_get_time() - t;
+	num_resamples++;
+      }
+    }
+
+    t = carmen_get_time();
+    carmen_localize_summarize(filter, &summary, &map, laser.num_readings,
+			      laser.range, param.front_laser_offset,
+			      laser.config.angular_resolution,
+			      laser.config.start_angle, 0);
+    t_summarize += carmen_get_time() - t;
+    num_scans++;
+
+    if(have_truepos) {
+      true_pose = true_pose_at(&truepos, odometry);
+      err = hypot(summary.mean.x - true_pose.x, summary.mean.y - true_pose.y);
+      err_theta = fabs(carmen_normalize_theta(summary.mean.theta -
+					      true_pose.theta));
+      err_sum += err;
+      err_sq_sum += err * err;
+      err_theta_sum += err_theta;
+      if(err > err_max)
+	err_max = err;
+      num_errors++;
+    }
+  }
+  t_total = carmen_get_time() - t_start;
+
+  if(num_scans == 0)
+    carmen_die("No laser messages in %s.\n", log_filename);
+
+  printf("%d scans in %.3f s (%.1f scans/s, includes log parsing)\n",
+	 num_scans, t_total, num_scans / t_total);
+  printf("odometry:   %8.3f ms/scan\n", 1000.0 * t_odometry / num_scans);
+  printf("laser:      %8.3f ms/scan\n", 1000.0 * t_laser / num_scans);
+  printf("resample:   %8.3f ms/resample (%d resamples)\n",
+	 num_resamples ? 1000.0 * t_resample / num_resamples : 0.0,
+	 num_resamples);
+  printf("summarize:  %8.3f ms/scan\n", 1000.0 * t_summarize / num_scans);
+  if(num_errors > 0)
+    printf("pose error: mean %.3f m, rms %.3f m, max %.3f m, "
+	   "heading %.2f deg (%d scans)\n", err_sum / num_errors,
+	   sqrt(err_sq_sum / num_errors), err_max,
+	   carmen_radians_to_degrees(err_theta_sum / num_errors), num_errors);
+  else
+    printf("pose error: no TRUEPOS lines in log\n");
+
+  carmen_fclose(logfile);
+  return 0;
+}
@@ -65,6 +65,42 @@ carmen_localize_unsubscribe_particle_message(carmen_handler_t handler)
   carmen_unsubscribe_message(CARMEN_LOCALIZE_PARTICLE_NAME, handler);
 }
 
+void
+carmen_localize_subscribe_compact_particle_message(carmen_localize_compact_particle_message 
+						   *particle,
+						   carmen_handler_t handler,
+						   carmen_subscribe_t subscribe_how)
+{
+  carmen_subscribe_message(CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME, 
+                           CARMEN_LOCALIZE_COMPACT_PARTICLE_FMT,
+                           particle, 
+			   sizeof(carmen_localize_compact_particle_message), 
+			   handler, subscribe_how);
+}
+
+void
+carmen_localize_unsubscribe_compact_particle_message(carmen_handler_t handler)
+{
+  carmen_unsubscribe_message(CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME, handler);
+}
+
+void
+carmen_localize_uncompact_particles(carmen_localize_compact_particle_message 
+				    *particle, 
+				    carmen_localize_particle_ipc_p particles)
+{
+  int i;
+
+  for(i = 0; i < particle->num_particles; i++) {
+    particles[i].x = particle->globalpos.x + 
+      particle->x[i] * particle->resolution;
+    particles[i].y = particle->globalpos.y + 
+      particle->y[i] * particle->resolution;
+    particles[i].theta = particle->theta[i] * (M_PI / 32768.0);
+    particles[i].weight = 0.0;
+  }
+}
+
 void
 carmen_localize_subscribe_sensor_message(carmen_localize_sensor_message 
 					 *sensor,
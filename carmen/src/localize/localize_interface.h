@@ -64,6 +64,22 @@ carmen_localize_subscribe_particle_message(carmen_localize_particle_message
 void
 carmen_localize_unsubscribe_particle_message(carmen_handler_t handler);
 
+void 
+carmen_localize_subscribe_compact_particle_message(carmen_localize_compact_particle_message 
+						   *particle, 
+						   carmen_handler_t handler,
+						   carmen_subscribe_t subscribe_how);
+
+void
+carmen_localize_unsubscribe_compact_particle_message(carmen_handler_t handler);
+
+/** Expands the particles of a compact particle message into an array
+    of num_particles particles. **/
+void
+carmen_localize_uncompact_particles(carmen_localize_compact_particle_message 
+				    *particle, 
+				    carmen_localize_particle_ipc_p particles);
+
 void 
 carmen_localize_subscribe_initialize_message(carmen_localize_initialize_message *init_msg,
 					     carmen_handler_t handler, 
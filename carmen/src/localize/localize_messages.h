@@ -103,6 +103,24 @@ typedef struct {
 #define CARMEN_LOCALIZE_PARTICLE_NAME "carmen_localize_particle"
 #define CARMEN_LOCALIZE_PARTICLE_FMT  "{int,<{float,float,float,float}:1>,{double,double,double},{double,double,double},double,double,string}"
 
+/* compact particle message for visualization.  Particles are
+   quantized relative to globalpos: x and y in units of resolution
+   meters, theta in units of pi/32768.  They are drawn in proportion to
+   their weights, so they all carry the same weight. */
+
+typedef struct {
+  int num_particles;
+  short *x, *y, *theta;
+  double resolution;
+  carmen_point_t globalpos, globalpos_std;
+  double globalpos_xy_cov;
+  double timestamp;
+  char *host;
+} carmen_localize_compact_particle_message;
+
+#define CARMEN_LOCALIZE_COMPACT_PARTICLE_NAME "carmen_localize_compact_particle"
+#define CARMEN_LOCALIZE_COMPACT_PARTICLE_FMT  "{int,<short:1>,<short:1>,<short:1>,double,{double,double,double},{double,double,double},double,double,string}"
+
 /* sensor message in localize coordinates */
 
 typedef struct {
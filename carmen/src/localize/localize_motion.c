@@ -127,3 +127,43 @@ double carmen_localize_sample_noisy_turn(double delta_t, double delta_theta,
 
   return sample;
 }
+
+/* n samples of a gaussian truncated at 2 standard deviations, like the
+   rejection loops above */
+static void sample_truncated(carmen_random_state_t *rng, double *samples,
+			     int n, double mean, double std_dev)
+{
+  int i;
+  double z;
+
+  if (std_dev < 1e-6) {
+    for (i = 0; i < n; i++)
+      samples[i] = mean;
+    return;
+  }
+
+  carmen_gaussian_random_fill(rng, samples, n, 0.0, 1.0);
+  for (i = 0; i < n; i++) {
+    z = samples[i];
+    while (fabs(z) > 2)
+      z = carmen_gaussian_random_r(rng, 0.0, 1.0);
+    samples[i] = mean + std_dev*z;
+  }
+}
+
+void carmen_localize_sample_noisy_motion(double delta_t, double delta_theta,
+					 carmen_localize_motion_model_t *model,
+					 carmen_random_state_t *rng,
+					 double *downrange, double *crossrange,
+					 double *turn, int n)
+{
+  sample_truncated(rng, downrange, n,
+		   delta_t*model->mean_d_d+delta_theta*model->mean_d_t,
+		   fabs(delta_t)*model->std_dev_d_d+fabs(delta_theta)*model->std_dev_d_t);
+  sample_truncated(rng, crossrange, n,
+		   delta_t*model->mean_c_d+delta_theta*model->mean_c_t,
+		   fabs(delta_t)*model->std_dev_c_d+fabs(delta_theta)*model->std_dev_c_t);
+  sample_truncated(rng, turn, n,
+		   delta_t*model->mean_t_d+delta_theta*model->mean_t_t,
+		   fabs(delta_t)*model->std_dev_t_d+fabs(delta_theta)*model->std_dev_t_t);
+}
@@ -75,6 +75,14 @@ double carmen_localize_sample_noisy_turn(double delta_t,
 					 double delta_theta,
 					 carmen_localize_motion_model_t *model);
 
+/* Draws n samples of each of the above at once from the generator
+   state rng, e.g. one per particle for a single odometry step. */
+void carmen_localize_sample_noisy_motion(double delta_t, double delta_theta,
+					 carmen_localize_motion_model_t *model,
+					 carmen_random_state_t *rng,
+					 double *downrange, double *crossrange,
+					 double *turn, int n);
+
 #ifdef __cplusplus
 }
 #endif
@@ -431,7 +431,7 @@ void carmen_localize_initialize_particles_manual(carmen_localize_particle_filter
 void carmen_localize_incorporate_odometry(carmen_localize_particle_filter_p filter,
 					  carmen_point_t odometry_position)
 {
-  int i, backwards;
+  int i, n, backwards;
   double delta_t, delta_theta;
   double dx, dy, odom_theta;
 #ifndef OLD_MOTION_MODEL
@@ -441,6 +441,8 @@ void carmen_localize_incorporate_odometry(carmen_localize_particle_filter_p filt
   double dhatr1, dhatt, dhatr2;
   double std_r1, std_r2, std_t;
 #endif
+  double *noise;
+  carmen_random_state_t *rng;
 
   /* The dr1/dr2 code becomes unstable if dt is too small. */
   if(filter->first_odometry) {
@@ -460,16 +462,26 @@ void carmen_localize_incorporate_odometry(carmen_localize_particle_filter_p filt
 
   filter->distance_travelled += delta_t;
 
+  /* draw the noise for all particles at once */
+  n = filter->param->num_particles;
+  if(filter->motion_noise_size < 3 * n) {
+    filter->motion_noise_size = 3 * n;
+    filter->motion_noise = (double *)realloc(filter->motion_noise, 
+					     3 * n * sizeof(double));
+    carmen_test_alloc(filter->motion_noise);
+  }
+  noise = filter->motion_noise;
+  rng = carmen_random_thread_state();
+
 #ifndef OLD_MOTION_MODEL
-  for(i = 0; i < filter->param->num_particles; i++) {
-    downrange = 
-      carmen_localize_sample_noisy_downrange(delta_t, delta_theta, 
-					     filter->param->motion_model);
-    crossrange = 
-      carmen_localize_sample_noisy_crossrange(delta_t, delta_theta,
-					      filter->param->motion_model);
-    turn = carmen_localize_sample_noisy_turn(delta_t, delta_theta,
-					     filter->param->motion_model);
+  carmen_localize_sample_noisy_motion(delta_t, delta_theta, 
+				      filter->param->motion_model, rng,
+				      noise, noise + n, noise + 2 * n, n);
+
+  for(i = 0; i < n; i++) {
+    downrange = noise[i];
+    crossrange = noise[n + i];
+    turn = noise[2 * n + i];
 
     if(backwards) {
       filter->particles[i].x -= downrange * 
@@ -517,11 +529,15 @@ void carmen_localize_incorporate_odometry(carmen_localize_particle_filter_p filt
   std_t = filter->param->odom_a3 * delta_t + filter->param->odom_a4 * fabs(dr1 + dr2);
   std_r2 = filter->param->odom_a1 * fabs(dr2) + filter->param->odom_a2 * delta_t;
 
+  carmen_gaussian_random_fill(rng, noise, n, dr1, std_r1);
+  carmen_gaussian_random_fill(rng, noise + n, n, delta_t, std_t);
+  carmen_gaussian_random_fill(rng, noise + 2 * n, n, dr2, std_r2);
+
   /* update the positions of all of the particles */
-  for(i = 0; i < filter->param->num_particles; i++) {
-    dhatr1 = carmen_gaussian_random(dr1, std_r1);
-    dhatt = carmen_gaussian_random(delta_t, std_t);
-    dhatr2 = carmen_gaussian_random(dr2, std_r2);
+  for(i = 0; i < n; i++) {
+    dhatr1 = noise[i];
+    dhatt = noise[n + i];
+    dhatr2 = noise[2 * n + i];
     
     if(backwards) {
       filter->particles[i].x -=
@@ -94,6 +94,8 @@ typedef struct {
   float **temp_weights;
   float distance_travelled;
   char laser_mask[MAX_BEAMS_PER_SCAN];
+  double *motion_noise;  /* 3*num_particles motion samples, grown on demand */
+  int motion_noise_size;
 } carmen_localize_particle_filter_t, *carmen_localize_particle_filter_p;
 
 typedef struct {
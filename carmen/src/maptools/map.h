@@ -124,6 +124,20 @@ typedef struct {
   carmen_hmap_link_p links;
 } carmen_hmap_t, *carmen_hmap_p;
 
+/* Precomputed likelihood fields for localization, stored together
+   with the parameters they were built with.  Arrays are x-major like
+   carmen_map_t's complete_map. */
+typedef struct {
+  int x_size, y_size;
+  double resolution;
+  unsigned int gridmap_hash;     // hash of the gridmap the fields came from
+  double occupied_prob;
+  double lmap_std, global_lmap_std;
+  double tracking_beam_minlikelihood, global_beam_minlikelihood;
+  float *distance, *prob, *gprob;
+  short int *x_offset, *y_offset;
+} carmen_map_likelihood_t, *carmen_map_likelihood_p;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,303 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Encodings of the float grid carried by map messages.
+ *
+ * CARMEN_MAP_ENCODING_RLE is lossless: a palette of the (up to 254)
+ * most frequent cell values followed by runs along the map columns,
+ *
+ *   unsigned char num_palette
+ *   float         palette[num_palette]
+ *   runs:         unsigned char code, [float value,] varint length - 1
+ *
+ * where a code below num_palette indexes the palette and code 255 is
+ * followed by the value itself.  The varint holds 7 bits per byte, low
+ * bits first, with the high bit set on every byte but the last.  Maps
+ * mostly hold a few values (unknown, free, occupied) in long runs, so
+ * this comes close to deflate in size at several times its speed, both
+ * to encode and to decode.
+ */
+
+#include <carmen/carmen.h>
+#include "map_interface.h"
+#ifndef NO_ZLIB
+#include <zlib.h>
+#endif
+
+#define PALETTE_SIZE  254
+#define LITERAL       255
+#define HASH_SIZE     8192
+
+typedef union {
+  float f;
+  unsigned int i;
+} float_bits_t;
+
+typedef struct {
+  unsigned int key;
+  int count;
+  int index;
+  int used;
+} value_count_t;
+
+static carmen_inline value_count_t *
+lookup(value_count_t *table, unsigned int key)
+{
+  unsigned int h = (key * 2654435761u) >> 19;
+
+  while (table[h].used && table[h].key != key)
+    h = (h+1) & (HASH_SIZE-1);
+
+  return table+h;
+}
+
+static int
+compare_counts(const void *a, const void *b)
+{
+  return (*(value_count_t **)b)->count - (*(value_count_t **)a)->count;
+}
+
+/* counts how many cells hold each value, for the first values seen
+   until the table is three quarters full; the most frequent values in
+   a map show up early anyway */
+
+static int
+build_palette(float *data, int n, value_count_t *table, float *palette)
+{
+  value_count_t *entry, **sorted;
+  float_bits_t value;
+  int i, run, num_values = 0, num_palette;
+
+  for (i = 0; i < n; i += run) {
+    value.f = data[i];
+    for (run = 1; i+run < n && ((float_bits_t *)data)[i+run].i == value.i; 
+	 run++);
+    entry = lookup(table, value.i);
+    if (!entry->used) {
+      if (num_values >= HASH_SIZE*3/4)
+	continue;
+      entry->used = 1;
+      entry->key = value.i;
+      entry->index = LITERAL;
+      num_values++;
+    }
+    entry->count += run;
+  }
+
+  sorted = (value_count_t **)calloc(num_values, sizeof(value_count_t *));
+  carmen_test_alloc(sorted);
+  for (i = 0, num_values = 0; i < HASH_SIZE; i++)
+    if (table[i].used)
+      sorted[num_values++] = table+i;
+  qsort(sorted, num_values, sizeof(value_count_t *), compare_counts);
+
+  num_palette = carmen_imin(num_values, PALETTE_SIZE);
+  for (i = 0; i < num_palette; i++) {
+    sorted[i]->index = i;
+    value.i = sorted[i]->key;
+    palette[i] = value.f;
+  }
+  free(sorted);
+
+  return num_palette;
+}
+
+static int
+encode_rle(float *data, int n, unsigned char **buf, int *size)
+{
+  value_count_t *table, *entry;
+  float palette[PALETTE_SIZE];
+  int num_palette, i, run, length, limit;
+  float_bits_t value;
+  unsigned char *out, *end;
+
+  table = (value_count_t *)calloc(HASH_SIZE, sizeof(value_count_t));
+  carmen_test_alloc(table);
+  num_palette = build_palette(data, n, table, palette);
+
+  /* give up once the runs get as large as the raw floats */
+  limit = n*sizeof(float);
+  *buf = (unsigned char *)calloc(limit, sizeof(unsigned char));
+  carmen_test_alloc(*buf);
+  out = *buf;
+  end = *buf + limit;
+  if (1 + num_palette*sizeof(float) >= (unsigned int)limit) {
+    free(table);
+    free(*buf);
+    return -1;
+  }
+  *(out++) = num_palette;
+  memcpy(out, palette, num_palette*sizeof(float));
+  out += num_palette*sizeof(float);
+
+  for (i = 0; i < n; i += run) {
+    value.f = data[i];
+    for (run = 1; i+run < n && ((float_bits_t *)data)[i+run].i == value.i; 
+	 run++);
+    /* code, literal and a varint of up to 5 bytes */
+    if (end - out < 10) {
+      free(table);
+      free(*buf);
+      return -1;
+    }
+    entry = lookup(table, value.i);
+    if (entry->used && entry->index != LITERAL)
+      *(out++) = entry->index;
+    else {
+      *(out++) = LITERAL;
+      memcpy(out, &value.f, sizeof(float));
+      out += sizeof(float);
+    }
+    for (length = run-1; length >= 128; length >>= 7)
+      *(out++) = (length & 127) | 128;
+    *(out++) = length;
+  }
+  free(table);
+
+  *size = out - *buf;
+
+  return 0;
+}
+
+static int
+decode_rle(unsigned char *buf, int size, float *data, int n)
+{
+  float palette[PALETTE_SIZE];
+  unsigned char *in, *end;
+  int num_palette, i = 0, code, run, shift;
+  float value;
+
+  if (size < 1)
+    return -1;
+  num_palette = buf[0];
+  if (num_palette > PALETTE_SIZE || 
+      size < 1 + num_palette*(int)sizeof(float))
+    return -1;
+  memcpy(palette, buf+1, num_palette*sizeof(float));
+
+  in = buf + 1 + num_palette*sizeof(float);
+  end = buf + size;
+  while (in < end && i < n) {
+    code = *(in++);
+    if (code == LITERAL) {
+      if (end - in < (int)sizeof(float))
+	return -1;
+      memcpy(&value, in, sizeof(float));
+      in += sizeof(float);
+    } 
+    else if (code < num_palette)
+      value = palette[code];
+    else
+      return -1;
+    run = 0;
+    shift = 0;
+    do {
+      if (in == end || shift > 28)
+	return -1;
+      run |= (*in & 127) << shift;
+      shift += 7;
+    } while (*(in++) & 128);
+    run++;
+    if (run > n-i)
+      return -1;
+    while (run-- > 0)
+      data[i++] = value;
+  }
+
+  return (i == n && in == end) ? 0 : -1;
+}
+
+int
+carmen_map_encode(float *data, int n, int encodings,
+		  unsigned char **buf, int *size)
+{
+#ifndef NO_ZLIB
+  uLongf compress_buf_size;
+#endif
+
+  if ((encodings & (1 << CARMEN_MAP_ENCODING_RLE)) &&
+      encode_rle(data, n, buf, size) == 0)
+    return CARMEN_MAP_ENCODING_RLE;
+
+#ifndef NO_ZLIB
+  if (encodings & (1 << CARMEN_MAP_ENCODING_ZLIB)) {
+    compress_buf_size = n*sizeof(float)*1.01+12;
+    *buf = (unsigned char *)calloc(compress_buf_size, sizeof(unsigned char));
+    carmen_test_alloc(*buf);
+    if (compress(*buf, &compress_buf_size, (Bytef *)data,
+		 n*sizeof(float)) == Z_OK) {
+      *size = compress_buf_size;
+      return CARMEN_MAP_ENCODING_ZLIB;
+    }
+    free(*buf);
+  }
+#endif
+
+  *size = n*sizeof(float);
+  *buf = (unsigned char *)calloc(*size, sizeof(unsigned char));
+  carmen_test_alloc(*buf);
+  memcpy(*buf, data, *size);
+
+  return CARMEN_MAP_ENCODING_RAW;
+}
+
+int
+carmen_map_decode(unsigned char *buf, int size, int encoding,
+		  float *data, int n)
+{
+#ifndef NO_ZLIB
+  uLongf uncompress_size_result;
+#endif
+
+  switch (encoding) {
+  case CARMEN_MAP_ENCODING_RAW:
+    if (size != n*(int)sizeof(float))
+      return -1;
+    memcpy(data, buf, size);
+    return 0;
+  case CARMEN_MAP_ENCODING_ZLIB:
+#ifndef NO_ZLIB
+    uncompress_size_result = n*sizeof(float);
+    if (uncompress((Bytef *)data, &uncompress_size_result, buf, size) != Z_OK
+	|| uncompress_size_result != n*sizeof(float))
+      return -1;
+    return 0;
+#else
+    carmen_warn("Received compressed map from server. This program was\n"
+		"compiled without zlib support, so this map cannot be\n"
+		"used. Sorry.\n");
+    return -1;
+#endif
+  case CARMEN_MAP_ENCODING_RLE:
+    return decode_rle(buf, size, data, n);
+  }
+
+  carmen_warn("Received map with unknown encoding %d.\n", encoding);
+  return -1;
+}
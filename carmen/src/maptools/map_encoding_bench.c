@@ -0,0 +1,105 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Encodes and decodes the gridmap of each map file with every map
+ * message encoding, and reports the encoded size and the time per
+ * encode and decode.  Every round trip is checked to be exact.
+ *
+ * usage: map_encoding_bench <map file> [map file ...]
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+#include "map_interface.h"
+
+#define REPETITIONS 10
+
+static char *encoding_names[] = {"raw", "zlib", "rle"};
+
+static void bench(carmen_map_p map, int encoding)
+{
+  int n = map->config.x_size*map->config.y_size;
+  unsigned char *buf = NULL;
+  int i, size = 0, used = -1;
+  float *data;
+  double start, t_encode, t_decode;
+
+  data = (float *)calloc(n, sizeof(float));
+  carmen_test_alloc(data);
+
+  start = carmen_get_time();
+  for (i = 0; i < REPETITIONS; i++) {
+    free(buf);
+    used = carmen_map_encode(map->complete_map, n, 1 << encoding, &buf,
+			     &size);
+  }
+  t_encode = (carmen_get_time() - start)/REPETITIONS;
+
+  start = carmen_get_time();
+  for (i = 0; i < REPETITIONS; i++)
+    if (carmen_map_decode(buf, size, used, data, n) < 0)
+      carmen_die("Could not decode %s\n", encoding_names[used]);
+  t_decode = (carmen_get_time() - start)/REPETITIONS;
+
+  if (memcmp(data, map->complete_map, n*sizeof(float)) != 0)
+    carmen_die("%s round trip is not exact\n", encoding_names[used]);
+
+  printf("  %-5s %10d bytes (%5.1f%%)  encode %8.3f ms  decode %8.3f ms%s\n",
+	 encoding_names[encoding], size, 100.0*size/(n*sizeof(float)),
+	 1000.0*t_encode, 1000.0*t_decode,
+	 used != encoding ? "  (fell back)" : "");
+
+  free(buf);
+  free(data);
+}
+
+int main(int argc, char **argv)
+{
+  carmen_map_t map;
+  int i, encoding;
+
+  if (argc < 2)
+    carmen_die("usage: %s <map file> [map file ...]\n", argv[0]);
+
+  for (i = 1; i < argc; i++) {
+    if (carmen_map_read_gridmap_chunk(argv[i], &map) < 0) {
+      carmen_warn("Could not read a gridmap from %s\n", argv[i]);
+      continue;
+    }
+    printf("%s: %d x %d cells\n", argv[i], map.config.x_size,
+	   map.config.y_size);
+    for (encoding = CARMEN_MAP_ENCODING_RAW;
+	 encoding <= CARMEN_MAP_ENCODING_RLE; encoding++)
+      bench(&map, encoding);
+    free(map.complete_map);
+    free(map.map);
+  }
+
+  return 0;
+}
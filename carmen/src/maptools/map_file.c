@@ -0,0 +1,370 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Map files opened once: the chunk headers are read in one pass into a
+ * table of contents, and chunks are then found without rescanning the
+ * file.  Uncompressed files are mapped into memory, and a gridmap whose
+ * floats happen to be aligned in the file is handed out in place;
+ * gzipped files (recognised by their magic number, whatever their
+ * extension) are inflated into memory once.
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#define GZIP_MAGIC_0   0x1f
+#define GZIP_MAGIC_1   0x8b
+
+static int
+load_compressed(carmen_map_file_p file)
+{
+#ifndef NO_ZLIB
+  gzFile fp;
+  int size = 0, max_size = 1 << 20, n;
+
+  fp = gzopen(file->filename, "rb");
+  if (fp == NULL)
+    return -1;
+  file->data = (unsigned char *)calloc(max_size, sizeof(unsigned char));
+  carmen_test_alloc(file->data);
+  while ((n = gzread(fp, file->data + size, max_size - size)) > 0) {
+    size += n;
+    if (size == max_size) {
+      max_size *= 2;
+      file->data = (unsigned char *)realloc(file->data, max_size);
+      carmen_test_alloc(file->data);
+    }
+  }
+  gzclose(fp);
+  if (n < 0) {
+    free(file->data);
+    file->data = NULL;
+    return -1;
+  }
+  file->size = size;
+  return 0;
+#else
+  carmen_warn("Error: %s is compressed, and this program was compiled\n"
+	      "       without zlib support.\n", file->filename);
+  return -1;
+#endif
+}
+
+/* maps the file privately, so that a caller may scribble on a gridmap
+   handed out in place without touching the file */
+
+static int
+load_file(carmen_map_file_p file)
+{
+  struct stat file_stat;
+  unsigned char *data;
+  int fd;
+
+  fd = open(file->filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &file_stat) < 0 || file_stat.st_size == 0) {
+    close(fd);
+    return -1;
+  }
+  data = (unsigned char *)mmap(NULL, file_stat.st_size,
+			       PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+
+  if (file_stat.st_size >= 2 && data[0] == GZIP_MAGIC_0 &&
+      data[1] == GZIP_MAGIC_1) {
+    munmap(data, file_stat.st_size);
+    close(fd);
+    return load_compressed(file);
+  }
+
+  file->data = data;
+  file->size = file_stat.st_size;
+  file->mapped = 1;
+  file->fd = fd;
+  return 0;
+}
+
+/* skips the comment lines and checks the file label, as
+   carmen_map_read_comment_chunk does */
+
+static int
+skip_comments(carmen_map_file_p file)
+{
+  int pos = 0, label_length;
+
+  while (pos < file->size && file->data[pos] == '#') {
+    while (pos < file->size && file->data[pos] != '\n')
+      pos++;
+    pos++;
+  }
+
+  label_length = strlen(CARMEN_MAP_LABEL);
+  if (pos + label_length + (int)strlen(CARMEN_MAP_VERSION) > file->size ||
+      strncmp((char *)file->data+pos, CARMEN_MAP_LABEL, label_length) ||
+      strncmp((char *)file->data+pos+label_length, CARMEN_MAP_VERSION,
+	      strlen(CARMEN_MAP_VERSION)))
+    return -1;
+
+  return pos + label_length + strlen(CARMEN_MAP_VERSION);
+}
+
+static void
+build_contents(carmen_map_file_p file, int pos)
+{
+  carmen_map_chunk_p chunk;
+  int type, size, max_chunks = 16;
+  unsigned char *name, *end;
+
+  file->chunks = (carmen_map_chunk_p)calloc(max_chunks,
+					    sizeof(carmen_map_chunk_t));
+  carmen_test_alloc(file->chunks);
+
+  /* a truncated last chunk is left out */
+  while (pos + 1 + (int)sizeof(int) + 10 <= file->size) {
+    type = file->data[pos];
+    memcpy(&size, file->data + pos + 1, sizeof(int));
+    if (size < 10 || size > file->size - pos - 1 - (int)sizeof(int))
+      break;
+
+    if (file->num_chunks == max_chunks) {
+      max_chunks *= 2;
+      file->chunks = (carmen_map_chunk_p)
+	realloc(file->chunks, max_chunks*sizeof(carmen_map_chunk_t));
+      carmen_test_alloc(file->chunks);
+    }
+    chunk = file->chunks + file->num_chunks;
+    chunk->type = type & ~CARMEN_MAP_NAMED_CHUNK_FLAG;
+    chunk->name = NULL;
+    chunk->offset = pos;
+    chunk->size = size;
+    chunk->data_offset = pos + 1 + sizeof(int) + 10;
+    if (CARMEN_MAP_CHUNK_IS_NAMED(type)) {
+      name = file->data + chunk->data_offset;
+      end = memchr(name, '\0', pos + 1 + sizeof(int) + size -
+		   chunk->data_offset);
+      if (end == NULL)
+	break;
+      chunk->name = (char *)name;
+      chunk->data_offset += end - name + 1;
+    }
+    file->num_chunks++;
+
+    pos += 1 + sizeof(int) + size;
+  }
+}
+
+carmen_map_file_p
+carmen_map_file_open(char *filename)
+{
+  carmen_map_file_p file;
+  int pos;
+
+  if (filename == NULL)
+    return NULL;
+
+  file = (carmen_map_file_p)calloc(1, sizeof(carmen_map_file_t));
+  carmen_test_alloc(file);
+  file->filename = carmen_new_string("%s", filename);
+  file->fd = -1;
+
+  if (load_file(file) < 0) {
+    fprintf(stderr, "Error: could not open file %s for reading.\n",
+	    filename);
+    free(file->filename);
+    free(file);
+    return NULL;
+  }
+
+  pos = skip_comments(file);
+  if (pos < 0) {
+    fprintf(stderr, "Error: Could not read comment chunk.\n");
+    carmen_map_file_close(file);
+    return NULL;
+  }
+  build_contents(file, pos);
+
+  return file;
+}
+
+void
+carmen_map_file_close(carmen_map_file_p file)
+{
+  if (file == NULL)
+    return;
+
+  if (file->mapped) {
+    munmap(file->data, file->size);
+    close(file->fd);
+  }
+  else
+    free(file->data);
+  free(file->chunks);
+  free(file->filename);
+  free(file);
+}
+
+carmen_map_chunk_p
+carmen_map_file_find_chunk(carmen_map_file_p file, int chunk_type,
+			   char *name)
+{
+  int i;
+
+  chunk_type &= ~CARMEN_MAP_NAMED_CHUNK_FLAG;
+  for (i = 0; i < file->num_chunks; i++)
+    if (file->chunks[i].type == chunk_type &&
+	(name == NULL ||
+	 (file->chunks[i].name != NULL && !strcmp(file->chunks[i].name, name))))
+      return file->chunks + i;
+
+  return NULL;
+}
+
+/* reads rather than copies out of the mapping, which would fault in
+   every page first */
+
+static int
+read_floats(carmen_map_file_p file, off_t offset, float *data, int n)
+{
+  char *buf = (char *)data;
+  size_t left = n*sizeof(float);
+  ssize_t result;
+
+  while (left > 0) {
+    result = pread(file->fd, buf, left, offset);
+    if (result <= 0)
+      return -1;
+    buf += result;
+    offset += result;
+    left -= result;
+  }
+
+  return 0;
+}
+
+static int
+get_gridmap(carmen_map_file_p file, char *name, carmen_map_p map,
+	    int in_place)
+{
+  carmen_map_chunk_p chunk;
+  unsigned char *data;
+  int size_x, size_y, n;
+  float resolution;
+
+  chunk = carmen_map_file_find_chunk(file, CARMEN_MAP_GRIDMAP_CHUNK, name);
+  if (chunk == NULL) {
+    if (name)
+      fprintf(stderr, "Error: Could not find a gridmap chunk named \"%s\"\n",
+	      name);
+    else
+      fprintf(stderr, "Error: Could not find a gridmap chunk.\n");
+    return -1;
+  }
+
+  data = file->data + chunk->data_offset;
+  memcpy(&size_x, data, sizeof(int));
+  memcpy(&size_y, data + sizeof(int), sizeof(int));
+  memcpy(&resolution, data + 2*sizeof(int), sizeof(float));
+  data += 2*sizeof(int) + sizeof(float);
+  if (size_x <= 0 || size_y <= 0 ||
+      (double)size_x*size_y*sizeof(float) >
+      file->data + chunk->offset + 1 + sizeof(int) + chunk->size - data) {
+    carmen_warn("Error: gridmap chunk in %s is truncated.\n", file->filename);
+    return -1;
+  }
+
+  map->config.x_size = size_x;
+  map->config.y_size = size_y;
+  map->config.resolution = resolution;
+  map->config.map_name = carmen_new_string("%s", name ? name :
+					   file->filename);
+
+  if (in_place && file->mapped &&
+      ((unsigned long)data) % sizeof(float) == 0)
+    map->complete_map = (float *)data;
+  else {
+    map->complete_map = (float *)calloc(size_x*size_y, sizeof(float));
+    carmen_test_alloc(map->complete_map);
+    if (!file->mapped)
+      memcpy(map->complete_map, data, size_x*size_y*sizeof(float));
+    else if (read_floats(file, data - file->data, map->complete_map,
+			 size_x*size_y) < 0) {
+      carmen_warn("Error: could not read the gridmap in %s.\n",
+		  file->filename);
+      free(map->complete_map);
+      free(map->config.map_name);
+      return -1;
+    }
+  }
+  map->map = (float **)calloc(size_x, sizeof(float *));
+  carmen_test_alloc(map->map);
+  for (n = 0; n < size_x; n++)
+    map->map[n] = map->complete_map + n*size_y;
+
+  return 0;
+}
+
+int
+carmen_map_file_read_gridmap(carmen_map_file_p file, char *name,
+			     carmen_map_p map)
+{
+  return get_gridmap(file, name, map, 0);
+}
+
+int
+carmen_map_file_map_gridmap(carmen_map_file_p file, char *name,
+			    carmen_map_p map)
+{
+  return get_gridmap(file, name, map, 1);
+}
+
+int
+carmen_map_file_gridmap_in_place(carmen_map_file_p file, carmen_map_p map)
+{
+  unsigned char *data = (unsigned char *)map->complete_map;
+
+  return file->mapped && data >= file->data && data < file->data + file->size;
+}
+
+void
+carmen_map_file_free_gridmap(carmen_map_file_p file, carmen_map_p map)
+{
+  if (!carmen_map_file_gridmap_in_place(file, map))
+    free(map->complete_map);
+  free(map->map);
+  free(map->config.map_name);
+  map->complete_map = NULL;
+  map->map = NULL;
+  map->config.map_name = NULL;
+}
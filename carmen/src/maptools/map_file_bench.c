@@ -0,0 +1,118 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Times loading the gridmap of each map file through carmen_FILE
+ * (carmen_map_read_gridmap_chunk) against an opened map file, copied
+ * and in place, and checks that all three agree.
+ *
+ * usage: map_file_bench <map file> [map file ...]
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+
+#define REPETITIONS 10
+
+int main(int argc, char **argv)
+{
+  carmen_map_file_p file;
+  carmen_map_t map, copied, mapped;
+  double start, t_stdio, t_copy, t_map;
+  int i, r, n, in_place;
+
+  if (argc < 2)
+    carmen_die("usage: %s <map file> [map file ...]\n", argv[0]);
+
+  for (i = 1; i < argc; i++) {
+    if (carmen_map_read_gridmap_chunk(argv[i], &map) < 0) {
+      carmen_warn("Could not read a gridmap from %s\n", argv[i]);
+      continue;
+    }
+    n = map.config.x_size*map.config.y_size;
+
+    start = carmen_get_time();
+    for (r = 0; r < REPETITIONS; r++) {
+      free(map.complete_map);
+      free(map.map);
+      free(map.config.map_name);
+      carmen_map_read_gridmap_chunk(argv[i], &map);
+    }
+    t_stdio = (carmen_get_time() - start)/REPETITIONS;
+
+    start = carmen_get_time();
+    for (r = 0; r < REPETITIONS; r++) {
+      file = carmen_map_file_open(argv[i]);
+      if (file == NULL || carmen_map_file_read_gridmap(file, NULL,
+						       &copied) < 0)
+	carmen_die("Could not read %s as a map file\n", argv[i]);
+      carmen_map_file_close(file);
+      if (r < REPETITIONS-1) {
+	free(copied.complete_map);
+	free(copied.map);
+	free(copied.config.map_name);
+      }
+    }
+    t_copy = (carmen_get_time() - start)/REPETITIONS;
+
+    start = carmen_get_time();
+    for (r = 0; r < REPETITIONS; r++) {
+      file = carmen_map_file_open(argv[i]);
+      carmen_map_file_map_gridmap(file, NULL, &mapped);
+      if (r < REPETITIONS-1) {
+	carmen_map_file_free_gridmap(file, &mapped);
+	carmen_map_file_close(file);
+      }
+    }
+    t_map = (carmen_get_time() - start)/REPETITIONS;
+    in_place = carmen_map_file_gridmap_in_place(file, &mapped);
+
+    if (copied.config.x_size != map.config.x_size ||
+	copied.config.y_size != map.config.y_size ||
+	memcmp(copied.complete_map, map.complete_map, n*sizeof(float)) ||
+	memcmp(mapped.complete_map, map.complete_map, n*sizeof(float)))
+      carmen_die("%s: gridmaps differ\n", argv[i]);
+
+    printf("%s: %d x %d cells, %d chunks\n", argv[i], map.config.x_size,
+	   map.config.y_size, file->num_chunks);
+    printf("  carmen_FILE %8.3f ms  copied %8.3f ms  in place %8.3f ms%s\n",
+	   1000.0*t_stdio, 1000.0*t_copy, 1000.0*t_map,
+	   in_place ? "" : " (unaligned, copied)");
+
+    carmen_map_file_free_gridmap(file, &mapped);
+    carmen_map_file_close(file);
+    free(copied.complete_map);
+    free(copied.map);
+    free(copied.config.map_name);
+    free(map.complete_map);
+    free(map.map);
+    free(map.config.map_name);
+  }
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Writes map files whose comments and gridmap names leave the cells at
+ * every offset modulo 4, and checks that each gridmap reads back the
+ * same through carmen_FILE and through an opened map file, and that
+ * carmen_map_file_map_gridmap hands it out in place.
+ *
+ * usage: map_file_test
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+
+#define SIZE_X 37
+#define SIZE_Y 23
+
+static void
+check_gridmap(char *filename, char *name, float **prob)
+{
+  carmen_map_file_p file;
+  carmen_map_t map, mapped;
+  int x;
+
+  memset(&map, 0, sizeof(carmen_map_t));
+  if ((name == NULL && carmen_map_read_gridmap_chunk(filename, &map) < 0) ||
+      (name && carmen_map_read_named_gridmap_chunk(filename, name, &map) < 0))
+    carmen_die("%s: carmen_FILE could not read gridmap %s\n", filename,
+	       name ? name : "");
+
+  file = carmen_map_file_open(filename);
+  if (file == NULL || carmen_map_file_map_gridmap(file, name, &mapped) < 0)
+    carmen_die("%s: could not map gridmap %s\n", filename, name ? name : "");
+
+  if (!carmen_map_file_gridmap_in_place(file, &mapped))
+    carmen_die("%s: gridmap %s was copied, not used in place\n", filename,
+	       name ? name : "");
+  if (map.config.x_size != SIZE_X || map.config.y_size != SIZE_Y ||
+      mapped.config.x_size != SIZE_X || mapped.config.y_size != SIZE_Y)
+    carmen_die("%s: gridmap %s has the wrong size\n", filename,
+	       name ? name : "");
+  for (x = 0; x < SIZE_X; x++)
+    if (memcmp(map.map[x], prob[x], SIZE_Y*sizeof(float)) ||
+	memcmp(mapped.map[x], prob[x], SIZE_Y*sizeof(float)))
+      carmen_die("%s: gridmap %s differs from what was written\n",
+		 filename, name ? name : "");
+
+  carmen_map_file_free_gridmap(file, &mapped);
+  carmen_map_file_close(file);
+  free(map.complete_map);
+  free(map.map);
+  free(map.config.map_name);
+}
+
+int main(void)
+{
+  char filename[] = "/tmp/map_file_testXXXXXX";
+  char description[8], name[8];
+  float *complete_map, *prob[SIZE_X];
+  carmen_FILE *fp;
+  int fd, x, y, i;
+
+  complete_map = (float *)calloc(SIZE_X*SIZE_Y, sizeof(float));
+  carmen_test_alloc(complete_map);
+  for (x = 0; x < SIZE_X; x++) {
+    prob[x] = complete_map + x*SIZE_Y;
+    for (y = 0; y < SIZE_Y; y++)
+      prob[x][y] = (x*SIZE_Y + y) / (float)(SIZE_X*SIZE_Y);
+  }
+
+  fd = mkstemp(filename);
+  if (fd < 0)
+    carmen_die_syserror("Could not create %s", filename);
+  close(fd);
+
+  for (i = 0; i < 4; i++) {
+    fp = carmen_fopen(filename, "w");
+    if (fp == NULL)
+      carmen_die_syserror("Could not open %s for writing", filename);
+    /* each character shifts everything after the comment by one */
+    memset(description, 'd', i);
+    strcpy(description + i, "\n");
+    memset(name, 'n', i + 1);
+    name[i + 1] = '\0';
+    carmen_map_write_comment_chunk(fp, SIZE_X, SIZE_Y, 0.1, "map_file_test",
+				   description);
+    carmen_map_write_id(fp);
+    carmen_map_write_creator_chunk(fp, "map_file_test", "");
+    carmen_map_write_gridmap_chunk(fp, prob, SIZE_X, SIZE_Y, 0.1);
+    carmen_map_write_named_gridmap_chunk(fp, name, prob, SIZE_X, SIZE_Y, 0.1);
+    carmen_fclose(fp);
+
+    check_gridmap(filename, NULL, prob);
+    check_gridmap(filename, name, prob);
+  }
+
+  unlink(filename);
+  free(complete_map);
+  printf("map_file_test: all gridmaps used in place\n");
+
+  return 0;
+}
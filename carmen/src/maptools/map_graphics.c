@@ -142,46 +142,29 @@ recover_centre(GtkMapViewer *map_view, carmen_world_point_p new_centre)
   screen_to_world(&screen, new_centre, map_view);
 }
 
-static void pixbuf_destroyed(guchar *pixels, 
-			     gpointer data __attribute__ ((unused)))
-{
-  free(pixels);
-}
+/* composites the visible part of the map into current_pixbuf, scaling
+   each tile from the coarsest level that is still at least as fine as
+   the screen */
 
 static void 
 regenerate_map_pixmap(GtkMapViewer *map_view) 
 {
-  int x_render_size, y_render_size;
-  unsigned char *image_data;
-  GdkPixbuf *image = NULL;
-  GdkPixbuf *rotated_image = NULL;
-  GdkPixbuf *final_image = NULL;
+  GdkPixbuf *tile_pixbuf;
+  unsigned char *tile_image;
+  carmen_map_config_t config;
+  int level, x_tiles, y_tiles;
   double x_ratio, y_ratio;
   double scale_to_fit_window;
-  carmen_map_config_t config;
-  double zoom;
+  double zoom, tile_scale, tile_pixels, left, top, x0, y0;
+  int width, height, tx, ty, tx1, ty1;
+  int dest_x, dest_y, dest_x1, dest_y1;
 
-  if (map_view == NULL || map_view->internal_map == NULL)
+  if (map_view == NULL || map_view->internal_map == NULL || 
+      map_view->tiles == NULL)
     return;
 
-  if (map_view->current_pixbuf != NULL) {
-    g_object_unref(map_view->current_pixbuf);
-    map_view->current_pixbuf = NULL;
-  }
-
-  image_data = carmen_graphics_convert_to_image(map_view->internal_map, 
-						map_view->draw_flags);
-
   config = (map_view->internal_map)->config;
 
-  image = gdk_pixbuf_new_from_data((guchar *)image_data, GDK_COLORSPACE_RGB,
-				   FALSE, 8,  config.y_size, config.x_size, 
-				   config.y_size*3, pixbuf_destroyed, NULL);
-
-  rotated_image = gdk_pixbuf_rotate_simple
-    (image, GDK_PIXBUF_ROTATE_COUNTERCLOCKWISE);
-  g_object_unref(image);  
-
   x_ratio = map_view->port_size_x / (double)config.x_size;
   y_ratio = map_view->port_size_y / (double)config.y_size;
 
@@ -189,13 +172,63 @@ regenerate_map_pixmap(GtkMapViewer *map_view)
   zoom = 100.0/map_view->zoom;
   map_view->rescale_size = scale_to_fit_window*zoom;
 
-  x_render_size = map_view->rescale_size*config.x_size;
-  y_render_size = map_view->rescale_size*config.y_size;
+  if (map_view->port_size_x <= 0 || map_view->port_size_y <= 0)
+    return;
+
+  if (map_view->current_pixbuf != NULL &&
+      (gdk_pixbuf_get_width(map_view->current_pixbuf) != 
+       map_view->port_size_x ||
+       gdk_pixbuf_get_height(map_view->current_pixbuf) != 
+       map_view->port_size_y)) {
+    g_object_unref(map_view->current_pixbuf);
+    map_view->current_pixbuf = NULL;
+  }
+  if (map_view->current_pixbuf == NULL)
+    map_view->current_pixbuf = 
+      gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, map_view->port_size_x, 
+		     map_view->port_size_y);
+
+  left = map_view->x_scroll_adj->value;
+  top = map_view->y_scroll_adj->value;
+  width = carmen_fmin(map_view->port_size_x, 
+		      map_view->rescale_size*config.x_size - left);
+  height = carmen_fmin(map_view->port_size_y, 
+		       map_view->rescale_size*config.y_size - top);
+  if (width <= 0 || height <= 0)
+    return;
 
-  final_image = gdk_pixbuf_scale_simple(rotated_image, x_render_size, 
-					y_render_size, GDK_INTERP_TILES);
-  map_view->current_pixbuf = final_image;
-  g_object_unref(rotated_image);
+  level = carmen_map_tiles_level(map_view->tiles, map_view->rescale_size);
+  x_tiles = map_view->tiles->level[level].x_tiles;
+  y_tiles = map_view->tiles->level[level].y_tiles;
+  tile_scale = map_view->rescale_size*(1 << level);
+  tile_pixels = CARMEN_MAP_TILE_SIZE*tile_scale;
+
+  tx1 = carmen_fmin((left+width-1)/tile_pixels, x_tiles-1);
+  ty1 = carmen_fmin((top+height-1)/tile_pixels, y_tiles-1);
+
+  for (ty = top/tile_pixels; ty <= ty1; ty++)
+    for (tx = left/tile_pixels; tx <= tx1; tx++) {
+      x0 = tx*tile_pixels - left;
+      y0 = ty*tile_pixels - top;
+      /* neighbouring tiles round to the same edge, so there are no
+	 gaps between them */
+      dest_x = carmen_fmax(0, carmen_round(x0));
+      dest_y = carmen_fmax(0, carmen_round(y0));
+      dest_x1 = carmen_fmin(width, carmen_round(x0+tile_pixels));
+      dest_y1 = carmen_fmin(height, carmen_round(y0+tile_pixels));
+      if (dest_x1 <= dest_x || dest_y1 <= dest_y)
+	continue;
+
+      tile_image = carmen_map_tiles_get(map_view->tiles, level, tx, ty);
+      tile_pixbuf = gdk_pixbuf_new_from_data
+	((guchar *)tile_image, GDK_COLORSPACE_RGB, FALSE, 8, 
+	 CARMEN_MAP_TILE_SIZE, CARMEN_MAP_TILE_SIZE, CARMEN_MAP_TILE_SIZE*3, 
+	 NULL, NULL);
+      gdk_pixbuf_scale(tile_pixbuf, map_view->current_pixbuf, dest_x, dest_y,
+		       dest_x1-dest_x, dest_y1-dest_y, x0, y0, tile_scale,
+		       tile_scale, GDK_INTERP_TILES);
+      g_object_unref(tile_pixbuf);
+    }
 }
 
 static void 
@@ -263,25 +296,18 @@ redraw (GtkMapViewer *map_view, int map_changed, int viewport_changed)
     top_left.x = map_view->x_scroll_adj->value;
     top_left.y = map_view->y_scroll_adj->value;
 
-    if (top_left.x + map_view->port_size_x > 
-	gdk_pixbuf_get_width(map_view->current_pixbuf))
-      x_render_size = gdk_pixbuf_get_width(map_view->current_pixbuf) - 
-	top_left.x;
-    else
-      x_render_size = map_view->port_size_x;
-
-    if (top_left.y + map_view->port_size_y > 
-	gdk_pixbuf_get_height(map_view->current_pixbuf))
-      y_render_size = gdk_pixbuf_get_height(map_view->current_pixbuf) - 
-	top_left.y;
-    else
-      y_render_size = map_view->port_size_y;
-
-    gdk_draw_pixbuf(map_view->drawing_pixmap, 
-		    widget->style->fg_gc[GTK_WIDGET_STATE (widget)],
-		    map_view->current_pixbuf, top_left.x, top_left.y, 
-		    0, 0, x_render_size, y_render_size, 
-		    GDK_RGB_DITHER_NONE, 0, 0);
+    /* current_pixbuf holds the viewport, which may reach past the map */
+    x_render_size = carmen_fmin(map_view->port_size_x, 
+				map_view->rescale_size*width - top_left.x);
+    y_render_size = carmen_fmin(map_view->port_size_y, 
+				map_view->rescale_size*height - top_left.y);
+
+    if (x_render_size > 0 && y_render_size > 0)
+      gdk_draw_pixbuf(map_view->drawing_pixmap, 
+		      widget->style->fg_gc[GTK_WIDGET_STATE (widget)],
+		      map_view->current_pixbuf, 0, 0, 0, 0, 
+		      x_render_size, y_render_size, 
+		      GDK_RGB_DITHER_NONE, 0, 0);
   }
 
   if (map_view->user_draw_routine != NULL)
@@ -565,12 +591,18 @@ carmen_map_graphics_add_map(GtkMapViewer *map_view, carmen_map_p new_map,
   carmen_world_point_t point;
   carmen_map_config_t config;
 
+  /* the tile builder reads the old map until it is stopped */
+  carmen_map_tiles_free(map_view->tiles);
+  map_view->tiles = NULL;
+
   if (map_view->internal_map != NULL)
     carmen_map_destroy(&(map_view->internal_map));
 
   if (new_map != NULL) {
     map_view->internal_map = carmen_map_copy(new_map);
     map_view->draw_flags = new_flags;
+    map_view->tiles = carmen_map_tiles_new(map_view->internal_map, 
+					   new_flags, 1);
   }
 
   point.pose.x = (new_map->config.x_size*3/4)*new_map->config.resolution;
@@ -593,9 +625,14 @@ carmen_map_graphics_modify_map(GtkMapViewer *map_view, float *data,
   if (map_view->internal_map == NULL)
     return;
   
-  config = map_view->internal_map->config;
-  memcpy(map_view->internal_map->complete_map, data, 
-	 sizeof(float)*config.x_size*config.y_size);
+  /* only the tiles whose cells changed are rendered again */
+  if (map_view->tiles != NULL)
+    carmen_map_tiles_update(map_view->tiles, data, new_flags);
+  else {
+    config = map_view->internal_map->config;
+    memcpy(map_view->internal_map->complete_map, data, 
+	   sizeof(float)*config.x_size*config.y_size);
+  }
   map_view->draw_flags = new_flags;
 
   redraw(map_view, 1, 0);
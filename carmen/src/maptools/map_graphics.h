@@ -38,9 +38,11 @@ extern "C" {
 #endif
 
 #include <carmen/global_graphics.h>
+#include <carmen/map_tiles.h>
 
 typedef struct {
   carmen_map_t * internal_map;
+  carmen_map_tiles_p tiles;
   int draw_flags;
   carmen_world_point_t centre;
   double zoom;
@@ -30,15 +30,19 @@
  * library of function for mapserver clients  *
  **********************************************/
 #include <carmen/carmen.h>
-#ifndef NO_ZLIB
-#include <zlib.h>
-#endif
 
 carmen_map_t **map_update;
 carmen_handler_t *map_update_handler_external;
 char ***zone_update;
 carmen_handler_t *zone_update_handler_external;
 
+/* the encodings carmen_map_decode can undo in this build */
+#ifdef NO_ZLIB
+#define DECODABLE_ENCODINGS (CARMEN_MAP_ALL_ENCODINGS &	\
+			     ~(1 << CARMEN_MAP_ENCODING_ZLIB))
+#else
+#define DECODABLE_ENCODINGS CARMEN_MAP_ALL_ENCODINGS
+#endif
 
 /* subscribe to incoming gridmap messages */
 
@@ -125,12 +129,6 @@ map_update_interface_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
   carmen_map_t *new_map;
   int i;
 
-#ifndef NO_ZLIB
-  int uncompress_return;
-  int uncompress_size;
-  uLongf uncompress_size_result;
-#endif
-
   context_id = get_context_id();
 
   if (context_id < 0) 
@@ -160,42 +158,21 @@ map_update_interface_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
     calloc(new_map->config.x_size*new_map->config.y_size, sizeof(float));
   carmen_test_alloc(new_map->complete_map);
   
-#ifndef NO_ZLIB
-  if (map_msg.compressed) 
-    {
-      uncompress_size = new_map->config.x_size*new_map->config.y_size*
-	sizeof(float);
-      uncompress_size_result = uncompress_size;
-      uncompress_return = uncompress((void *)new_map->complete_map,   
-				     &uncompress_size_result,
-				     (void *)map_msg.map, 
-				     map_msg.size);
-    } 
-  else 
-    {
-      memcpy(new_map->complete_map, map_msg.map, map_msg.size);
-    }
-#else
-  if (map_msg.compressed) 
+  if (carmen_map_decode(map_msg.map, map_msg.size, map_msg.compressed,
+			new_map->complete_map, 
+			new_map->config.x_size*new_map->config.y_size) < 0)
     {
-      carmen_warn("Received compressed map from server. This program was\n"
-		  "compiled without zlib support, so this map cannot be\n"
-		  "used. Sorry.\n");
-      
+      carmen_warn("Could not decode map update.\n");
+      free(new_map->complete_map);
       memset(new_map, 0, sizeof(carmen_map_t));
-      
+
       if (map_msg.map)
 	free(map_msg.map);
       if (map_msg.err_mesg)
 	free(map_msg.err_mesg);
-      
+
       return;
-    } 
-  else 
-    {
-      memcpy(new_map->complete_map, map_msg.map, map_msg.size);
     }
-#endif 
   new_map->map = (float **)
     calloc(map_msg.config.x_size, sizeof(float *));
   carmen_test_alloc(new_map->map);
@@ -250,10 +227,7 @@ carmen_map_subscribe_gridmap_update_message(carmen_map_t *map,
 
   err = IPC_subscribe(CARMEN_MAP_GRIDMAP_UPDATE_NAME, 
 		      map_update_interface_handler, NULL);
-  if (subscribe_how == CARMEN_SUBSCRIBE_LATEST)
-    IPC_setMsgQueueLength(CARMEN_MAP_GRIDMAP_UPDATE_NAME, 1);
-  else
-    IPC_setMsgQueueLength(CARMEN_MAP_GRIDMAP_UPDATE_NAME, 100);
+  carmen_ipc_set_queue_length(CARMEN_MAP_GRIDMAP_UPDATE_NAME, subscribe_how);
 
   carmen_test_ipc(err, "Could not subscribe", CARMEN_MAP_GRIDMAP_UPDATE_NAME);
 }
@@ -329,10 +303,7 @@ carmen_map_subscribe_map_zone_message(char **zone_name,
 
   err = IPC_subscribe(CARMEN_MAP_ZONE_NAME, 
 		      zone_update_interface_handler, NULL);
-  if (subscribe_how == CARMEN_SUBSCRIBE_LATEST)
-    IPC_setMsgQueueLength(CARMEN_MAP_ZONE_NAME, 1);
-  else
-    IPC_setMsgQueueLength(CARMEN_MAP_ZONE_NAME, 100);
+  carmen_ipc_set_queue_length(CARMEN_MAP_ZONE_NAME, subscribe_how);
 
   carmen_test_ipc(err, "Could not subscribe", CARMEN_MAP_ZONE_NAME);
 }
@@ -448,16 +419,26 @@ carmen_map_get_gridmap_by_name(char *name, carmen_map_p client_map)
   IPC_RETURN_TYPE err;
   static carmen_gridmap_request_message *query;
   static carmen_named_gridmap_request named_query;
+  static carmen_encoded_gridmap_request encoded_query;
   static carmen_grid_map_message *response;
   unsigned int timeout = 10000;
   int i;
-#ifndef NO_ZLIB
-  int uncompress_return;
-  int uncompress_size;
-  uLongf uncompress_size_result;
-#endif
 
-  if (name) {
+  err = IPC_defineMsg(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_ENCODED_GRIDMAP_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define message", 
+		       CARMEN_ENCODED_GRIDMAP_REQUEST_NAME);
+
+  /* older map servers don't handle encoded requests */
+  if (IPC_numHandlers(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME) > 0) {
+    encoded_query.name = name ? name : "";
+    encoded_query.encodings = DECODABLE_ENCODINGS;
+    encoded_query.host = carmen_get_host();
+    encoded_query.timestamp = carmen_get_time();
+    err = IPC_queryResponseData(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME, 
+				&encoded_query, (void **)&response, timeout);
+  }
+  else if (name) {
     err = IPC_defineMsg(CARMEN_NAMED_GRIDMAP_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
 			CARMEN_NAMED_GRIDMAP_REQUEST_FMT);
     carmen_test_ipc_exit(err, "Could not define message", 
@@ -506,28 +487,13 @@ carmen_map_get_gridmap_by_name(char *name, carmen_map_p client_map)
 	       sizeof(float));
       carmen_test_alloc(client_map->complete_map);
 
-#ifndef NO_ZLIB
-      if (response->compressed) 
-	{
-	  uncompress_size = client_map->config.x_size*
-	    client_map->config.y_size*sizeof(float);
-	  uncompress_size_result = uncompress_size;
-	  uncompress_return = uncompress
-	    ((void *)client_map->complete_map,   
-	     &uncompress_size_result,
-	     (void *)response->map, response->size);
-	} 
-      else 
-	{
-	  memcpy(client_map->complete_map, response->map, response->size);
-	}
-#else
-      if (response->compressed) 
+      if (carmen_map_decode(response->map, response->size, 
+			    response->compressed, client_map->complete_map,
+			    client_map->config.x_size*
+			    client_map->config.y_size) < 0)
 	{
-	  carmen_warn("Received compressed map from server. This program was\n"
-		      "compiled without zlib support, so this map cannot be\n"
-		      "used. Sorry.\n");
-	  
+	  carmen_warn("Could not decode map from server.\n");
+	  free(client_map->complete_map);
 	  memset(client_map, 0, sizeof(carmen_map_t));
 	  
 	  if (response->map)
@@ -538,11 +504,7 @@ carmen_map_get_gridmap_by_name(char *name, carmen_map_p client_map)
 	  
 	  return -1;
 	} 
-      else 
-	{
-	  memcpy(client_map->complete_map, response->map, response->size);
-	}
-#endif 
+
       client_map->map = (float **)
 	calloc(response->config.x_size, sizeof(float *));
       carmen_test_alloc(client_map->map);
@@ -566,6 +528,184 @@ carmen_map_get_gridmap(carmen_map_p client_map)
   return carmen_map_get_gridmap_by_name(NULL, client_map);
 }
 
+static int
+get_gridmap_region(char *request_name, void *request, 
+		   carmen_map_region_p region)
+{
+  IPC_RETURN_TYPE err;
+  carmen_gridmap_region_message *response;
+  unsigned int timeout = 10000;
+  int i, width, height;
+
+  err = IPC_defineMsg(CARMEN_MAP_GRIDMAP_REGION_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_MAP_GRIDMAP_REGION_FMT);
+  carmen_test_ipc_exit(err, "Could not define message", 
+		       CARMEN_MAP_GRIDMAP_REGION_NAME);
+
+  err = IPC_queryResponseData(request_name, request, (void **)&response, 
+			      timeout);
+  if (err != IPC_OK)
+    {
+      carmen_test_ipc(err, "Could not get map region", request_name);
+      carmen_warn("\nDid you remember to start the mapserver?\n");
+      return -1;
+    }
+
+  if (response->err_mesg != NULL && response->err_mesg[0] != '\0')
+    {
+      carmen_warn("Error receiving map region: %s\n", response->err_mesg);
+      free(response->map);
+      free(response->err_mesg);
+      free(response->config.map_name);
+      free(response);
+      return -1;
+    }
+
+  memset(region, 0, sizeof(carmen_map_region_t));
+  region->config = response->config;
+  region->x_origin = response->x_origin;
+  region->y_origin = response->y_origin;
+  region->x_size = response->x_size;
+  region->y_size = response->y_size;
+  region->step = response->step;
+  region->version = response->version;
+
+  width = (response->x_size+response->step-1)/response->step;
+  height = (response->y_size+response->step-1)/response->step;
+  region->window.config.x_size = width;
+  region->window.config.y_size = height;
+  region->window.config.resolution = 
+    response->config.resolution*response->step;
+  region->window.config.map_name = response->config.map_name;
+
+  if (width > 0 && height > 0)
+    {
+      region->window.complete_map = (float *)
+	calloc(width*height, sizeof(float));
+      carmen_test_alloc(region->window.complete_map);
+      if (carmen_map_decode(response->map, response->size, 
+			    response->compressed, region->window.complete_map,
+			    width*height) < 0)
+	{
+	  carmen_warn("Could not decode map region from server.\n");
+	  free(region->window.complete_map);
+	  free(response->map);
+	  free(response->err_mesg);
+	  free(response->config.map_name);
+	  free(response);
+	  memset(region, 0, sizeof(carmen_map_region_t));
+	  return -1;
+	}
+      region->window.map = (float **)calloc(width, sizeof(float *));
+      carmen_test_alloc(region->window.map);
+      for (i = 0; i < width; i++)
+	region->window.map[i] = region->window.complete_map + i*height;
+    }
+
+  free(response->map);
+  free(response->err_mesg);
+  free(response);
+
+  return 0;
+}
+
+int
+carmen_map_get_gridmap_region(int x_origin, int y_origin, 
+			      int x_size, int y_size, int step,
+			      carmen_map_region_p region)
+{
+  IPC_RETURN_TYPE err;
+  carmen_gridmap_region_request query;
+
+  err = IPC_defineMsg(CARMEN_GRIDMAP_REGION_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_GRIDMAP_REGION_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define message", 
+		       CARMEN_GRIDMAP_REGION_REQUEST_NAME);
+
+  query.x_origin = x_origin;
+  query.y_origin = y_origin;
+  query.x_size = x_size;
+  query.y_size = y_size;
+  query.step = step;
+  query.encodings = DECODABLE_ENCODINGS;
+  query.timestamp = carmen_get_time();
+  query.host = carmen_get_host();
+
+  return get_gridmap_region(CARMEN_GRIDMAP_REGION_REQUEST_NAME, &query, 
+			    region);
+}
+
+int
+carmen_map_get_gridmap_delta(int since_version, carmen_map_region_p region)
+{
+  IPC_RETURN_TYPE err;
+  carmen_gridmap_delta_request query;
+
+  err = IPC_defineMsg(CARMEN_GRIDMAP_DELTA_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_GRIDMAP_DELTA_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define message", 
+		       CARMEN_GRIDMAP_DELTA_REQUEST_NAME);
+
+  query.since_version = since_version;
+  query.encodings = DECODABLE_ENCODINGS;
+  query.timestamp = carmen_get_time();
+  query.host = carmen_get_host();
+
+  return get_gridmap_region(CARMEN_GRIDMAP_DELTA_REQUEST_NAME, &query, 
+			    region);
+}
+
+int
+carmen_map_apply_gridmap_region(carmen_map_region_p region, carmen_map_p map)
+{
+  int i;
+
+  if (region->step != 1)
+    {
+      carmen_warn("carmen_map_apply_gridmap_region needs a full resolution "
+		  "region.\n");
+      return -1;
+    }
+
+  if (map->complete_map == NULL ||
+      map->config.x_size != region->config.x_size ||
+      map->config.y_size != region->config.y_size ||
+      map->config.resolution != region->config.resolution)
+    {
+      free(map->complete_map);
+      free(map->map);
+      free(map->config.map_name);
+      map->config = region->config;
+      if (region->config.map_name)
+	map->config.map_name = carmen_new_string("%s", 
+						 region->config.map_name);
+      map->complete_map = (float *)
+	calloc(map->config.x_size*map->config.y_size, sizeof(float));
+      carmen_test_alloc(map->complete_map);
+      for (i = 0; i < map->config.x_size*map->config.y_size; i++)
+	map->complete_map[i] = -1;
+      map->map = (float **)calloc(map->config.x_size, sizeof(float *));
+      carmen_test_alloc(map->map);
+      for (i = 0; i < map->config.x_size; i++)
+	map->map[i] = map->complete_map + i*map->config.y_size;
+    }
+
+  for (i = 0; i < region->x_size; i++)
+    memcpy(map->map[region->x_origin+i]+region->y_origin, 
+	   region->window.map[i], region->y_size*sizeof(float));
+
+  return 0;
+}
+
+void
+carmen_map_free_gridmap_region(carmen_map_region_p region)
+{
+  free(region->window.complete_map);
+  free(region->window.map);
+  free(region->config.map_name);
+  memset(region, 0, sizeof(carmen_map_region_t));
+}
+
 /*
 void 
 carmen_placelist_interface_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData, 
@@ -67,6 +67,45 @@ void carmen_map_subscribe_map_zone_message(char **zone_name,
 int carmen_map_get_gridmap(carmen_map_p map);
 int carmen_map_get_gridmap_by_name(char *name, carmen_map_p map);
 
+/* a window of the map, as answered by region and delta requests; config
+   describes the whole map, and window holds ceil(x_size/step) by
+   ceil(y_size/step) values at step times the map resolution */
+typedef struct {
+  carmen_map_config_t config;
+  int x_origin, y_origin;
+  int x_size, y_size;
+  int step;
+  int version;
+  carmen_map_t window;
+} carmen_map_region_t, *carmen_map_region_p;
+
+/* request a window of the map; each window cell holds the most occupied
+   cell of its step by step block */
+int carmen_map_get_gridmap_region(int x_origin, int y_origin, 
+				  int x_size, int y_size, int step,
+				  carmen_map_region_p region);
+
+/* request the cells that changed since a version returned by an earlier
+   region or delta request (pass -1 for the whole map) */
+int carmen_map_get_gridmap_delta(int since_version, 
+				 carmen_map_region_p region);
+
+/* copy a full resolution window into map, reallocating it (and setting
+   the cells outside the window to unknown) if its geometry differs */
+int carmen_map_apply_gridmap_region(carmen_map_region_p region, 
+				    carmen_map_p map);
+
+void carmen_map_free_gridmap_region(carmen_map_region_p region);
+
+/* encode n map cells in the first of RLE, zlib and raw that encodings
+   allows and that works; returns the encoding used, with *buf malloced */
+int carmen_map_encode(float *data, int n, int encodings,
+		      unsigned char **buf, int *size);
+
+/* decode n map cells; returns -1 if buf doesn't hold exactly n cells */
+int carmen_map_decode(unsigned char *buf, int size, int encoding,
+		      float *data, int n);
+
 /* subscribe to map messages output by the map server */
 void carmen_map_subscribe_gridmap_update_message(carmen_map_t *map, 
 						 carmen_handler_t handler, 
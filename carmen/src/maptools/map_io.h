@@ -48,6 +48,10 @@ extern "C" {
 #define CARMEN_MAP_CREATOR_CHUNK     32
 #define CARMEN_MAP_GLOBAL_OFFSET_CHUNK     64
 #define CARMEN_MAP_HMAP_CHUNK        3
+#define CARMEN_MAP_LIKELIHOOD_CHUNK  5
+/* filler written before a gridmap chunk so that its cells start 4-byte
+   aligned in the file; readers skip it like any unknown chunk */
+#define CARMEN_MAP_PADDING_CHUNK     6
 
 #define CARMEN_MAP_NAMED_CHUNK_FLAG (1 << 7)
 #define CARMEN_MAP_CHUNK_IS_NAMED(type) ((type) & CARMEN_MAP_NAMED_CHUNK_FLAG)
@@ -105,6 +109,9 @@ int carmen_map_write_named_global_offset_chunk(carmen_FILE *fp, char *name,
 
 int carmen_map_write_hmap_chunk(carmen_FILE *fp, carmen_hmap_p hmap);
 
+int carmen_map_write_likelihood_chunk(carmen_FILE *fp, 
+				      carmen_map_likelihood_p likelihood);
+
 int carmen_map_write_to_ppm(carmen_map_p map, char *output_filename);
 
 int carmen_map_chunk_exists(char *filename, int specific_chunk);
@@ -151,7 +158,54 @@ int carmen_map_read_named_global_offset_chunk(char *filename, char *chunk_name,
 
 int carmen_map_read_hmap_chunk(char *filename, carmen_hmap_p hmap);
 
+int carmen_map_read_likelihood_chunk(char *filename, 
+				     carmen_map_likelihood_p likelihood);
+
 int carmen_map_file(char *filename);
+
+/* One entry of the table of contents of an open map file.  name points
+   into the file data and is NULL for unnamed chunks; data_offset is the
+   offset of the chunk contents, past the description and name. */
+typedef struct {
+  int type;
+  char *name;
+  int offset;
+  int size;
+  int data_offset;
+} carmen_map_chunk_t, *carmen_map_chunk_p;
+
+typedef struct {
+  char *filename;
+  unsigned char *data;
+  int size;
+  int mapped, fd;
+  int num_chunks;
+  carmen_map_chunk_p chunks;
+} carmen_map_file_t, *carmen_map_file_p;
+
+/* Reads the chunk headers of filename in one pass; returns NULL if the
+   file cannot be read or is not a map file. */
+carmen_map_file_p carmen_map_file_open(char *filename);
+void carmen_map_file_close(carmen_map_file_p file);
+/* First chunk of the given type, or the chunk of that type named name
+   if name is not NULL. */
+carmen_map_chunk_p carmen_map_file_find_chunk(carmen_map_file_p file, 
+					      int chunk_type, char *name);
+/* Copies the gridmap (named name, or the first one if name is NULL)
+   into memory of its own, to be freed like any carmen_map_t. */
+int carmen_map_file_read_gridmap(carmen_map_file_p file, char *name,
+				 carmen_map_p map);
+/* Like carmen_map_file_read_gridmap, but leaves the cells in the mapped
+   file where it can.  The map is only valid until the file is closed,
+   and only while nobody truncates the file; writes to it stay private.
+   Free it with carmen_map_file_free_gridmap. */
+int carmen_map_file_map_gridmap(carmen_map_file_p file, char *name,
+				carmen_map_p map);
+void carmen_map_file_free_gridmap(carmen_map_file_p file, carmen_map_p map);
+/* Whether carmen_map_file_map_gridmap left the cells of map in the
+   mapped file rather than copying them. */
+int carmen_map_file_gridmap_in_place(carmen_map_file_p file, carmen_map_p map);
+
 int carmen_map_initialize_ipc(void);
 void carmen_map_set_filename(char *new_filename);
 void carmen_map_publish_update(void);
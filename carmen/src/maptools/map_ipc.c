@@ -28,17 +28,38 @@
 
 #include <carmen/carmen.h>
 #include "map_io.h"
-#ifndef NO_ZLIB
-#include <zlib.h>
-#endif
+#include "map_interface.h"
 
 /*****************************************
  * ipc library for the map server        *
  *****************************************/
 
+#define MAP_HISTORY_SIZE 32
+
+/* what clients that can't say which encodings they accept understand */
+#define LEGACY_ENCODINGS ((1 << CARMEN_MAP_ENCODING_RAW) |	\
+			  (1 << CARMEN_MAP_ENCODING_ZLIB))
+
 static char *filename = NULL;
 static char *map_zone_name = NULL;
 
+/* the map served to region and delta requests, reloaded whenever the
+   file, its modification time or the zone changes */
+
+typedef struct {
+  int version;
+  int x0, y0, x1, y1;
+} map_change_t;
+
+static carmen_map_t current_map;
+static int current_version = 0;
+static char *current_filename = NULL;
+static char *current_zone_name = NULL;
+static time_t current_mtime = 0;
+static off_t current_file_size = 0;
+static map_change_t history[MAP_HISTORY_SIZE];
+static int history_length = 0;
+
 static void
 hmap_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData, 
 		     void *clientData __attribute__ ((unused)))
@@ -133,53 +154,18 @@ change_map_zone_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
    loads a map from a file and sends it 
    back to the client */
 
-#ifndef NO_ZLIB
-
-static void
-compress_map_msg(carmen_grid_map_message *map_msg, carmen_map_t *map)
-{
-  uLongf compress_buf_size;
-  int compress_return = -1;
-
-  compress_buf_size = map->config.x_size*map->config.y_size*1.01+12;
-  compress_buf_size *= sizeof(float);
-  map_msg->map = (unsigned char *)
-    calloc(compress_buf_size, sizeof(unsigned char));
-  carmen_test_alloc(map_msg->map);
-  compress_return = compress((void *)map_msg->map, 
-			     &compress_buf_size,
-			     (void *)map->complete_map, 
-			     (uLong)map->config.x_size * 
-			     map->config.y_size*sizeof(float));
-  if (compress_return != Z_OK) 
-    {
-      free(map_msg->map);
-      map_msg->map = (unsigned char *)map->complete_map;
-      map_msg->size = map->config.x_size * map->config.y_size*sizeof(float);
-      map_msg->compressed = 0;
-    } 
-  else 
-    {
-      map_msg->size = compress_buf_size;
-      map_msg->compressed = 1;
-      free(map->complete_map);
-    }
-}
-#endif
-
 static void
-assemble_named_map_msg(char *name, carmen_grid_map_message *map_msg)
+assemble_named_map_msg(char *name, int encodings, 
+		       carmen_grid_map_message *map_msg)
 {
+  carmen_map_file_p file;
   carmen_map_t map;
-  int ret_val;
-
-  if (name)
-    ret_val = carmen_map_read_named_gridmap_chunk(filename, name, &map);
-  else
-    ret_val = carmen_map_read_gridmap_chunk(filename, &map);
 
-  if(ret_val < 0)
+  /* encoded straight out of the mapped file */
+  file = carmen_map_file_open(filename);
+  if(file == NULL || carmen_map_file_map_gridmap(file, name, &map) < 0)
     {
+      carmen_map_file_close(file);
       memset(map_msg, 0, sizeof(carmen_grid_map_message));
       map_msg->err_mesg = (char *)calloc(17, sizeof(char));
       carmen_test_alloc(map_msg->err_mesg);
@@ -191,17 +177,14 @@ assemble_named_map_msg(char *name, carmen_grid_map_message *map_msg)
       return;
     }
 
-  free(map.map);
-
-#ifndef NO_ZLIB
-  compress_map_msg(map_msg, &map);
-#else
-  map_msg->map = (unsigned char *)map.complete_map;
-  map_msg->size = map.config.x_size * map.config.y_size*sizeof(float);
-  map_msg->compressed = 0;
-#endif
-
+  map_msg->compressed = 
+    carmen_map_encode(map.complete_map, map.config.x_size*map.config.y_size,
+		      encodings, &map_msg->map, &map_msg->size);
   map_msg->config = map.config;
+  map_msg->config.map_name = carmen_new_string("%s", map.config.map_name);
+  carmen_map_file_free_gridmap(file, &map);
+  carmen_map_file_close(file);
+
   map_msg->err_mesg = (char *)calloc(1, sizeof(char));
   carmen_test_alloc(map_msg->err_mesg);
   map_msg->err_mesg[0] = '\0';
@@ -213,7 +196,257 @@ assemble_named_map_msg(char *name, carmen_grid_map_message *map_msg)
 static void
 assemble_map_msg(carmen_grid_map_message *map_msg)
 {
-  assemble_named_map_msg(map_zone_name, map_msg);
+  assemble_named_map_msg(map_zone_name, LEGACY_ENCODINGS, map_msg);
+}
+
+/* records which cells differ between the cached map and a newly loaded
+   one; a new geometry forgets the history, so every delta request gets
+   the whole map */
+
+static void
+record_change(carmen_map_p new_map)
+{
+  int x, y, x0, y0, x1, y1;
+  float *old_column, *new_column;
+
+  if (current_map.complete_map == NULL ||
+      new_map->config.x_size != current_map.config.x_size ||
+      new_map->config.y_size != current_map.config.y_size ||
+      new_map->config.resolution != current_map.config.resolution) {
+    current_version++;
+    history_length = 0;
+    return;
+  }
+
+  x0 = new_map->config.x_size;
+  y0 = new_map->config.y_size;
+  x1 = y1 = 0;
+  for (x = 0; x < new_map->config.x_size; x++) {
+    old_column = current_map.map[x];
+    new_column = new_map->map[x];
+    for (y = 0; y < new_map->config.y_size; y++)
+      if (old_column[y] != new_column[y]) {
+	x0 = carmen_fmin(x0, x);
+	x1 = carmen_fmax(x1, x+1);
+	y0 = carmen_fmin(y0, y);
+	y1 = carmen_fmax(y1, y+1);
+      }
+  }
+  if (x1 == 0)
+    return;
+
+  current_version++;
+  memmove(history+1, history, (MAP_HISTORY_SIZE-1)*sizeof(map_change_t));
+  history[0].version = current_version;
+  history[0].x0 = x0;
+  history[0].y0 = y0;
+  history[0].x1 = x1;
+  history[0].y1 = y1;
+  if (history_length < MAP_HISTORY_SIZE)
+    history_length++;
+}
+
+static int
+refresh_current_map(void)
+{
+  struct stat file_stat;
+  carmen_map_file_p file;
+  carmen_map_t new_map;
+  int ret_val;
+
+  if (filename == NULL || stat(filename, &file_stat) < 0)
+    return -1;
+
+  if (current_map.complete_map != NULL &&
+      !strcmp(filename, current_filename) &&
+      ((map_zone_name == NULL && current_zone_name == NULL) ||
+       (map_zone_name != NULL && current_zone_name != NULL &&
+	!strcmp(map_zone_name, current_zone_name))) &&
+      file_stat.st_mtime == current_mtime &&
+      file_stat.st_size == current_file_size)
+    return 0;
+
+  file = carmen_map_file_open(filename);
+  if (file == NULL)
+    return -1;
+  ret_val = carmen_map_file_read_gridmap(file, map_zone_name, &new_map);
+  carmen_map_file_close(file);
+  if (ret_val < 0)
+    return -1;
+
+  if (current_version == 0)
+    /* start from the clock, so that versions handed out by an earlier
+       map server are not taken for ours */
+    current_version = ((int)carmen_get_time()) & 0x3fffffff;
+  record_change(&new_map);
+
+  if (current_map.complete_map != NULL) {
+    free(current_map.complete_map);
+    free(current_map.map);
+  }
+  current_map = new_map;
+
+  free(current_filename);
+  current_filename = carmen_new_string("%s", filename);
+  free(current_zone_name);
+  current_zone_name = map_zone_name ? carmen_new_string("%s", map_zone_name) : NULL;
+  current_mtime = file_stat.st_mtime;
+  current_file_size = file_stat.st_size;
+
+  return 0;
+}
+
+/* cuts a window out of the cached map, keeping the most occupied cell
+   of each step by step block so that obstacles survive downsampling */
+
+static void
+assemble_region_msg(int x_origin, int y_origin, int x_size, int y_size,
+		    int step, int encodings, 
+		    carmen_gridmap_region_message *region_msg)
+{
+  int x0, y0, x1, y1, width, height, i, j, x, y;
+  float *data, *column, value;
+
+  memset(region_msg, 0, sizeof(carmen_gridmap_region_message));
+  region_msg->timestamp = carmen_get_time();
+  region_msg->host = carmen_get_host();
+
+  if (refresh_current_map() < 0) {
+    region_msg->err_mesg = carmen_new_string("Could not read map");
+    return;
+  }
+
+  if (step < 1)
+    step = 1;
+  x0 = carmen_fmax(x_origin, 0);
+  y0 = carmen_fmax(y_origin, 0);
+  x1 = carmen_fmin((double)x_origin+x_size, current_map.config.x_size);
+  y1 = carmen_fmin((double)y_origin+y_size, current_map.config.y_size);
+  if (x1 < x0)
+    x1 = x0;
+  if (y1 < y0)
+    y1 = y0;
+
+  region_msg->config = current_map.config;
+  region_msg->x_origin = x0;
+  region_msg->y_origin = y0;
+  region_msg->x_size = x1-x0;
+  region_msg->y_size = y1-y0;
+  region_msg->step = step;
+  region_msg->version = current_version;
+  region_msg->err_mesg = (char *)calloc(1, sizeof(char));
+  carmen_test_alloc(region_msg->err_mesg);
+
+  width = (x1-x0+step-1)/step;
+  height = (y1-y0+step-1)/step;
+  if (width == 0 || height == 0)
+    return;
+
+  data = (float *)calloc(width*height, sizeof(float));
+  carmen_test_alloc(data);
+  if (step == 1) 
+    for (i = 0; i < width; i++)
+      memcpy(data+i*height, current_map.map[x0+i]+y0, height*sizeof(float));
+  else 
+    for (i = 0; i < width; i++)
+      for (j = 0; j < height; j++) {
+	value = -FLT_MAX;
+	for (x = x0+i*step; x < x0+(i+1)*step && x < x1; x++) {
+	  column = current_map.map[x];
+	  for (y = y0+j*step; y < y0+(j+1)*step && y < y1; y++)
+	    if (column[y] > value)
+	      value = column[y];
+	}
+	data[i*height+j] = value;
+      }
+
+  region_msg->compressed = 
+    carmen_map_encode(data, width*height, encodings, &region_msg->map, 
+		      &region_msg->size);
+  free(data);
+}
+
+static void 
+respond_region_msg(MSG_INSTANCE msgRef, 
+		   carmen_gridmap_region_message *region_msg)
+{
+  IPC_RETURN_TYPE err;
+
+  err = IPC_respondData(msgRef, CARMEN_MAP_GRIDMAP_REGION_NAME, region_msg);
+  carmen_test_ipc(err, "Could not respond", CARMEN_MAP_GRIDMAP_REGION_NAME);
+
+  free(region_msg->map);
+  free(region_msg->err_mesg);
+}
+
+static void 
+gridmap_region_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData, 
+			       void *clientData __attribute__ ((unused)))
+{
+  carmen_gridmap_region_request req;
+  carmen_gridmap_region_message region_msg;
+  FORMATTER_PTR formatter;
+  IPC_RETURN_TYPE err;
+
+  formatter = IPC_msgInstanceFormatter(msgRef);
+  err = IPC_unmarshallData(formatter, callData, &req, 
+			   sizeof(carmen_gridmap_region_request));
+  IPC_freeByteArray(callData);  
+
+  carmen_test_ipc_return(err, "Could not unmarshall data", 
+			 IPC_msgInstanceName(msgRef));
+
+  assemble_region_msg(req.x_origin, req.y_origin, req.x_size, req.y_size,
+		      req.step, req.encodings, &region_msg);
+  respond_region_msg(msgRef, &region_msg);
+}
+
+/* answers with the bounding box of everything that changed since the
+   requested version, an empty window if nothing did, or the whole map
+   if the version is too old or not ours */
+
+static void 
+gridmap_delta_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData, 
+			      void *clientData __attribute__ ((unused)))
+{
+  carmen_gridmap_delta_request req;
+  carmen_gridmap_region_message region_msg;
+  FORMATTER_PTR formatter;
+  IPC_RETURN_TYPE err;
+  int i, x0, y0, x1, y1;
+
+  formatter = IPC_msgInstanceFormatter(msgRef);
+  err = IPC_unmarshallData(formatter, callData, &req, 
+			   sizeof(carmen_gridmap_delta_request));
+  IPC_freeByteArray(callData);  
+
+  carmen_test_ipc_return(err, "Could not unmarshall data", 
+			 IPC_msgInstanceName(msgRef));
+
+  if (refresh_current_map() < 0 || req.since_version < 0 ||
+      req.since_version > current_version ||
+      req.since_version < current_version - history_length) {
+    assemble_region_msg(0, 0, INT_MAX, INT_MAX, 1, req.encodings, 
+			&region_msg);
+    respond_region_msg(msgRef, &region_msg);
+    return;
+  }
+
+  x0 = y0 = INT_MAX;
+  x1 = y1 = 0;
+  for (i = 0; i < history_length && history[i].version > req.since_version;
+       i++) {
+    x0 = carmen_fmin(x0, history[i].x0);
+    y0 = carmen_fmin(y0, history[i].y0);
+    x1 = carmen_fmax(x1, history[i].x1);
+    y1 = carmen_fmax(y1, history[i].y1);
+  }
+  if (x1 == 0)
+    assemble_region_msg(0, 0, 0, 0, 1, req.encodings, &region_msg);
+  else
+    assemble_region_msg(x0, y0, x1-x0, y1-y0, 1, req.encodings, 
+			&region_msg);
+  respond_region_msg(msgRef, &region_msg);
 }
 
 static void 
@@ -240,6 +473,7 @@ gridmap_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
 
   free(map_msg.map);
   free(map_msg.err_mesg);
+  free(map_msg.config.map_name);
 }
 
 static void 
@@ -259,13 +493,43 @@ named_gridmap_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
   carmen_test_ipc_return(err, "Could not unmarshall data", 
 			 IPC_msgInstanceName(msgRef));
 
-  assemble_named_map_msg(req.name, &map_msg);
+  assemble_named_map_msg(req.name, LEGACY_ENCODINGS, &map_msg);
 
   err = IPC_respondData(msgRef, CARMEN_MAP_GRIDMAP_NAME, &map_msg);  
   carmen_test_ipc(err, "Could not respond", CARMEN_MAP_GRIDMAP_NAME);
 
   free(map_msg.map);
   free(map_msg.err_mesg);
+  free(map_msg.config.map_name);
+}
+
+static void 
+encoded_gridmap_request_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData, 
+				void *clientData __attribute__ ((unused)))
+{
+  carmen_encoded_gridmap_request req;
+  carmen_grid_map_message map_msg;
+  FORMATTER_PTR formatter;
+  IPC_RETURN_TYPE err;
+
+  formatter = IPC_msgInstanceFormatter(msgRef);
+  err = IPC_unmarshallData(formatter, callData, &req, 
+			   sizeof(carmen_encoded_gridmap_request));
+  IPC_freeByteArray(callData);  
+
+  carmen_test_ipc_return(err, "Could not unmarshall data", 
+			 IPC_msgInstanceName(msgRef));
+
+  assemble_named_map_msg((req.name && req.name[0]) ? req.name : map_zone_name,
+			 req.encodings, &map_msg);
+
+  err = IPC_respondData(msgRef, CARMEN_MAP_GRIDMAP_NAME, &map_msg);  
+  carmen_test_ipc(err, "Could not respond", CARMEN_MAP_GRIDMAP_NAME);
+
+  free(map_msg.map);
+  free(map_msg.err_mesg);
+  free(map_msg.config.map_name);
+  free(req.name);
 }
 
 
@@ -539,6 +803,22 @@ carmen_map_initialize_ipc(void)
 		      CARMEN_NAMED_GRIDMAP_REQUEST_FMT);
   carmen_test_ipc_exit(err, "Could not define", CARMEN_NAMED_GRIDMAP_REQUEST_NAME);
 
+  err = IPC_defineMsg(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_ENCODED_GRIDMAP_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define", CARMEN_ENCODED_GRIDMAP_REQUEST_NAME);
+
+  err = IPC_defineMsg(CARMEN_GRIDMAP_REGION_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_GRIDMAP_REGION_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define", CARMEN_GRIDMAP_REGION_REQUEST_NAME);
+
+  err = IPC_defineMsg(CARMEN_GRIDMAP_DELTA_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_GRIDMAP_DELTA_REQUEST_FMT);
+  carmen_test_ipc_exit(err, "Could not define", CARMEN_GRIDMAP_DELTA_REQUEST_NAME);
+
+  err = IPC_defineMsg(CARMEN_MAP_GRIDMAP_REGION_NAME, IPC_VARIABLE_LENGTH, 
+		      CARMEN_MAP_GRIDMAP_REGION_FMT);
+  carmen_test_ipc_exit(err, "Could not define", CARMEN_MAP_GRIDMAP_REGION_NAME);
+
   err = IPC_defineMsg(CARMEN_PLACELIST_REQUEST_NAME, IPC_VARIABLE_LENGTH, 
 		      CARMEN_DEFAULT_MESSAGE_FMT);
   carmen_test_ipc_exit(err, "Could not define", CARMEN_PLACELIST_REQUEST_NAME);
@@ -596,6 +876,21 @@ carmen_map_initialize_ipc(void)
   carmen_test_ipc(err, "Could not subscribe", CARMEN_NAMED_GRIDMAP_REQUEST_NAME);
   IPC_setMsgQueueLength(CARMEN_NAMED_GRIDMAP_REQUEST_NAME, 100);
 
+  err = IPC_subscribe(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME, 
+		      encoded_gridmap_request_handler, NULL);
+  carmen_test_ipc(err, "Could not subscribe", CARMEN_ENCODED_GRIDMAP_REQUEST_NAME);
+  IPC_setMsgQueueLength(CARMEN_ENCODED_GRIDMAP_REQUEST_NAME, 100);
+
+  err = IPC_subscribe(CARMEN_GRIDMAP_REGION_REQUEST_NAME, 
+		      gridmap_region_request_handler, NULL);
+  carmen_test_ipc(err, "Could not subscribe", CARMEN_GRIDMAP_REGION_REQUEST_NAME);
+  IPC_setMsgQueueLength(CARMEN_GRIDMAP_REGION_REQUEST_NAME, 100);
+
+  err = IPC_subscribe(CARMEN_GRIDMAP_DELTA_REQUEST_NAME, 
+		      gridmap_delta_request_handler, NULL);
+  carmen_test_ipc(err, "Could not subscribe", CARMEN_GRIDMAP_DELTA_REQUEST_NAME);
+  IPC_setMsgQueueLength(CARMEN_GRIDMAP_DELTA_REQUEST_NAME, 100);
+
   err = IPC_subscribe(CARMEN_PLACELIST_REQUEST_NAME, 
 		      placelist_request_handler, NULL);
   carmen_test_ipc(err, "Could not subscribe", CARMEN_PLACELIST_REQUEST_NAME);
@@ -642,6 +937,7 @@ carmen_map_publish_update(void)
 
   free(map_msg.map);
   free(map_msg.err_mesg);
+  free(map_msg.config.map_name);
 }
 
 void
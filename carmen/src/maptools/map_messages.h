@@ -68,6 +68,17 @@ typedef struct {
 #define CARMEN_MAP_HMAP_NAME "carmen_hmap_message"
 #define CARMEN_MAP_HMAP_FMT  "{{int, <string:1>, int, <{int, int, <int:2>, int, <{double, double, double}:4>}:3>},double,string}"
 
+/* values of the compressed field of map messages; requests that carry
+   an encodings field give the ones they accept as a bitmask of
+   (1 << CARMEN_MAP_ENCODING_...) */
+#define CARMEN_MAP_ENCODING_RAW    0
+#define CARMEN_MAP_ENCODING_ZLIB   1
+#define CARMEN_MAP_ENCODING_RLE    2
+
+#define CARMEN_MAP_ALL_ENCODINGS   ((1 << CARMEN_MAP_ENCODING_RAW) |	\
+				    (1 << CARMEN_MAP_ENCODING_ZLIB) |	\
+				    (1 << CARMEN_MAP_ENCODING_RLE))
+
 typedef struct {
   unsigned char * map;
   int size;
@@ -95,6 +106,70 @@ typedef struct {
 #define CARMEN_NAMED_GRIDMAP_REQUEST_NAME    "carmen_named_gridmap_request"
 #define CARMEN_NAMED_GRIDMAP_REQUEST_FMT     "{string,double,string}"
 
+/** Request for the whole gridmap (of zone name, or of the current zone
+    if name is empty) in one of the given encodings; answered with a
+    carmen_grid_map_message. **/
+typedef struct {
+  char *name;
+  int encodings;
+  double timestamp;
+  char *host;
+} carmen_encoded_gridmap_request;
+
+#define CARMEN_ENCODED_GRIDMAP_REQUEST_NAME    "carmen_encoded_gridmap_request"
+#define CARMEN_ENCODED_GRIDMAP_REQUEST_FMT     "{string,int,double,string}"
+
+/** Request for the window of x_size by y_size cells starting at cell
+    (x_origin, y_origin), with one value per step by step block of
+    cells.  The server clips the window to the map. **/
+typedef struct {
+  int x_origin, y_origin;
+  int x_size, y_size;
+  int step;
+  int encodings;
+  double timestamp;
+  char *host;
+} carmen_gridmap_region_request;
+
+#define CARMEN_GRIDMAP_REGION_REQUEST_NAME    "carmen_gridmap_region_request"
+#define CARMEN_GRIDMAP_REGION_REQUEST_FMT     "{int,int,int,int,int,int,double,string}"
+
+/** Request for the cells that changed since map version since_version.
+    An unknown or negative version gets the whole map. **/
+typedef struct {
+  int since_version;
+  int encodings;
+  double timestamp;
+  char *host;
+} carmen_gridmap_delta_request;
+
+#define CARMEN_GRIDMAP_DELTA_REQUEST_NAME    "carmen_gridmap_delta_request"
+#define CARMEN_GRIDMAP_DELTA_REQUEST_FMT     "{int,int,double,string}"
+
+/** Answer to region and delta requests.  config describes the whole
+    map; the window covers x_size by y_size cells from (x_origin,
+    y_origin), and map holds ceil(x_size/step) by ceil(y_size/step)
+    floats, column by column like carmen_map_t.  version identifies the
+    map the window was cut from. **/
+typedef struct {
+  unsigned char * map;
+  int size;
+  int compressed;
+  carmen_map_config_t config;
+  int x_origin, y_origin;
+  int x_size, y_size;
+  int step;
+  int version;
+
+  char *err_mesg;
+
+  double timestamp;
+  char *host;
+} carmen_gridmap_region_message;
+
+#define CARMEN_MAP_GRIDMAP_REGION_NAME    "carmen_grid_map_region_message"
+#define CARMEN_MAP_GRIDMAP_REGION_FMT     "{<char:2>, int, int, {int, int, double, string}, int, int, int, int, int, int, string, double, string}"
+
 typedef struct {  
   carmen_place_p places;
   int num_places;
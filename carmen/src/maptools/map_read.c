@@ -1298,3 +1298,118 @@ int carmen_map_read_hmap_chunk(char *filename, carmen_hmap_p hmap)
 
 
 
+
+static int read_likelihood_field(carmen_FILE *fp, void **data, int raw_size)
+{
+  int field_raw_size, stored_size;
+
+  if(carmen_fread(&field_raw_size, sizeof(int), 1, fp) < 1 ||
+     carmen_fread(&stored_size, sizeof(int), 1, fp) < 1)
+    return -1;
+  if(field_raw_size != raw_size || stored_size < 0 || stored_size > raw_size)
+    return -1;
+
+  if(*data == NULL) {
+    *data = calloc(raw_size, 1);
+    carmen_test_alloc(*data);
+  }
+
+  if(stored_size == raw_size)
+    return (carmen_fread(*data, raw_size, 1, fp) < 1 ? -1 : 0);
+
+#ifndef NO_ZLIB
+  {
+    uLongf uncompressed_size = raw_size;
+    unsigned char *stored;
+    int err;
+
+    stored = (unsigned char *)calloc(stored_size, 1);
+    carmen_test_alloc(stored);
+    if(carmen_fread(stored, stored_size, 1, fp) < 1) {
+      free(stored);
+      return -1;
+    }
+    err = uncompress((Bytef *)*data, &uncompressed_size, stored, stored_size);
+    free(stored);
+    if(err != Z_OK || (int)uncompressed_size != raw_size)
+      return -1;
+    return 0;
+  }
+#else
+  carmen_warn("Error: likelihood chunk is compressed, but CARMEN was "
+	      "built without zlib.\n");
+  return -1;
+#endif
+}
+
+/* reads the likelihood fields into the arrays given in likelihood, or
+   into newly allocated arrays if they are NULL.  Fails if the chunk
+   doesn't have the size given in likelihood (unless that is 0). */
+
+int carmen_map_read_likelihood_chunk(char *filename, 
+				     carmen_map_likelihood_p likelihood)
+{
+  carmen_FILE *fp;
+  int chunk_type, chunk_size, x_size, y_size, num_cells, err;
+  char chunk_description[12];
+
+  fp = carmen_fopen(filename, "r");
+  if(fp == NULL) {
+    fprintf(stderr, "Error: could not open file %s for reading.\n",
+	    filename);
+    return -1;
+  }
+  if(carmen_map_advance_to_chunk(fp, CARMEN_MAP_LIKELIHOOD_CHUNK) < 0) {
+    carmen_fclose(fp);
+    return -1;
+  }
+  chunk_type = carmen_fgetc(fp);
+  carmen_fread(&chunk_size, sizeof(int), 1, fp);
+  carmen_fread(chunk_description, 10, 1, fp);
+
+  if (CARMEN_MAP_CHUNK_IS_NAMED(chunk_type)) {
+    if (read_string(NULL, -1, fp) < 0) {
+      carmen_warn("Error: Unexpected EOF.\n");
+      carmen_fclose(fp);
+      return -1;
+    }
+  }
+
+  carmen_fread(&x_size, sizeof(int), 1, fp);
+  carmen_fread(&y_size, sizeof(int), 1, fp);
+  if((likelihood->x_size != 0 || likelihood->y_size != 0) &&
+     (x_size != likelihood->x_size || y_size != likelihood->y_size)) {
+    carmen_fclose(fp);
+    return -1;
+  }
+  likelihood->x_size = x_size;
+  likelihood->y_size = y_size;
+  carmen_fread(&likelihood->resolution, sizeof(double), 1, fp);
+  carmen_fread(&likelihood->gridmap_hash, sizeof(unsigned int), 1, fp);
+  carmen_fread(&likelihood->occupied_prob, sizeof(double), 1, fp);
+  carmen_fread(&likelihood->lmap_std, sizeof(double), 1, fp);
+  carmen_fread(&likelihood->global_lmap_std, sizeof(double), 1, fp);
+  carmen_fread(&likelihood->tracking_beam_minlikelihood, sizeof(double), 
+	       1, fp);
+  carmen_fread(&likelihood->global_beam_minlikelihood, sizeof(double), 
+	       1, fp);
+
+  num_cells = x_size * y_size;
+  err = 0;
+  if(read_likelihood_field(fp, (void **)&likelihood->distance, 
+			   num_cells * sizeof(float)) < 0 ||
+     read_likelihood_field(fp, (void **)&likelihood->x_offset, 
+			   num_cells * sizeof(short int)) < 0 ||
+     read_likelihood_field(fp, (void **)&likelihood->y_offset, 
+			   num_cells * sizeof(short int)) < 0 ||
+     read_likelihood_field(fp, (void **)&likelihood->prob, 
+			   num_cells * sizeof(float)) < 0 ||
+     read_likelihood_field(fp, (void **)&likelihood->gprob, 
+			   num_cells * sizeof(float)) < 0) {
+    carmen_warn("Error: corrupt likelihood chunk in %s.\n", filename);
+    err = -1;
+  }
+
+  carmen_fclose(fp);
+  return err;
+}
@@ -0,0 +1,416 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+#include <carmen/carmen.h>
+#include "map_tiles.h"
+
+/* these must match global_graphics.h, which needs GTK */
+#define TILES_INVERT          1
+#define TILES_RESCALE         2
+#define TILES_BLACK_AND_WHITE 8
+
+#define T CARMEN_MAP_TILE_SIZE
+
+/* the same colours as carmen_graphics_convert_to_image */
+
+static carmen_inline void
+cell_colour(unsigned char *pixel, double value, int flags,
+	    double min_val, double max_val)
+{
+  int rescale = (flags & TILES_RESCALE) && max_val >= 0;
+
+  if (value < 0 && value > -1.5) {
+    if (flags & TILES_BLACK_AND_WHITE) {
+      pixel[0] = 255; pixel[1] = 255; pixel[2] = 255;
+    } else {
+      pixel[0] = 0; pixel[1] = 0; pixel[2] = 255;
+    }
+  }
+  else if (value < -1.5) { // for offlimits
+    if (flags & TILES_BLACK_AND_WHITE) {
+      pixel[0] = 205; pixel[1] = 205; pixel[2] = 205;
+    } else {
+      pixel[0] = 255; pixel[1] = 0; pixel[2] = 0;
+    }
+  }
+  else if (!rescale && value > 1.0) {
+    if (flags & TILES_BLACK_AND_WHITE) {
+      pixel[0] = 128; pixel[1] = 128; pixel[2] = 128;
+    } else {
+      pixel[0] = 255; pixel[1] = 0; pixel[2] = 0;
+    }
+  } else {
+    if (rescale)
+      value = (value - min_val) / (max_val - min_val);
+    if (!(flags & TILES_INVERT))
+      value = 1 - value;
+    pixel[0] = pixel[1] = pixel[2] = value * 255;
+  }
+}
+
+static void
+find_range(carmen_map_tiles_p tiles, double *min_val, double *max_val)
+{
+  float *data = tiles->map->complete_map;
+  int i, n = tiles->map->config.x_size*tiles->map->config.y_size;
+
+  *max_val = -MAXDOUBLE;
+  *min_val = MAXDOUBLE;
+  if (!(tiles->flags & TILES_RESCALE))
+    return;
+  for (i = 0; i < n; i++) {
+    *max_val = carmen_fmax(*max_val, data[i]);
+    if (data[i] >= 0)
+      *min_val = carmen_fmin(*min_val, data[i]);
+  }
+}
+
+static void
+invalidate_all(carmen_map_tiles_p tiles)
+{
+  int l, i;
+
+  for (l = 0; l < tiles->num_levels; l++)
+    for (i = 0; i < tiles->level[l].x_tiles*tiles->level[l].y_tiles; i++)
+      tiles->level[l].tiles[i].valid = 0;
+  tiles->next_level = 0;
+  tiles->next_tile = 0;
+}
+
+static void
+render_cells(carmen_map_tiles_p tiles, carmen_map_tile_t *tile, int tx, int ty)
+{
+  int x_size = tiles->map->config.x_size, y_size = tiles->map->config.y_size;
+  int x0 = tx*T, r0 = ty*T, x1, r1, x, r;
+  float *column;
+
+  x1 = carmen_fmin(x0+T, x_size);
+  r1 = carmen_fmin(r0+T, y_size);
+  /* image row r is map row y_size-1-r; walk each map column in memory
+     order */
+  for (x = x0; x < x1; x++) {
+    column = tiles->map->complete_map + x*y_size + y_size-1;
+    for (r = r0; r < r1; r++)
+      cell_colour(tile->image + ((r-r0)*T + x-x0)*3, column[-r],
+		  tiles->flags, tiles->min_val, tiles->max_val);
+  }
+}
+
+static carmen_map_tile_t *build_tile(carmen_map_tiles_p tiles, int level,
+				     int tx, int ty);
+
+/* averages the 2x2 pixel blocks of the four children, skipping pixels
+   beyond the edge of the finer level */
+
+static void
+render_children(carmen_map_tiles_p tiles, carmen_map_tile_t *tile, int level,
+		int tx, int ty)
+{
+  carmen_map_tile_level_t *fine = tiles->level+level-1;
+  carmen_map_tile_t *child;
+  int qx, qy, cx, cy, i, j, di, dj, c, n, px, py, sum[3];
+  unsigned char *src, *dst;
+
+  for (qy = 0; qy < 2; qy++)
+    for (qx = 0; qx < 2; qx++) {
+      cx = 2*tx+qx;
+      cy = 2*ty+qy;
+      if (cx >= fine->x_tiles || cy >= fine->y_tiles)
+	continue;
+      child = build_tile(tiles, level-1, cx, cy);
+      for (j = 0; j < T/2; j++)
+	for (i = 0; i < T/2; i++) {
+	  n = 0;
+	  sum[0] = sum[1] = sum[2] = 0;
+	  for (dj = 0; dj < 2; dj++)
+	    for (di = 0; di < 2; di++) {
+	      px = cx*T + 2*i+di;
+	      py = cy*T + 2*j+dj;
+	      if (px >= fine->width || py >= fine->height)
+		continue;
+	      src = child->image + ((2*j+dj)*T + 2*i+di)*3;
+	      for (c = 0; c < 3; c++)
+		sum[c] += src[c];
+	      n++;
+	    }
+	  if (n == 0)
+	    continue;
+	  dst = tile->image + ((qy*T/2+j)*T + qx*T/2+i)*3;
+	  for (c = 0; c < 3; c++)
+	    dst[c] = (sum[c] + n/2) / n;
+	}
+    }
+}
+
+/* called with the mutex held */
+
+static carmen_map_tile_t *
+build_tile(carmen_map_tiles_p tiles, int level, int tx, int ty)
+{
+  carmen_map_tile_level_t *l = tiles->level+level;
+  carmen_map_tile_t *tile = l->tiles + ty*l->x_tiles + tx;
+
+  if (tile->valid)
+    return tile;
+
+  if (tile->image == NULL) {
+    tile->image = (unsigned char *)calloc(T*T*3, sizeof(unsigned char));
+    carmen_test_alloc(tile->image);
+  }
+  if (level == 0)
+    render_cells(tiles, tile, tx, ty);
+  else
+    render_children(tiles, tile, level, tx, ty);
+  tile->valid = 1;
+
+  return tile;
+}
+
+/* finds the next invalid tile, finest level first so that the coarser
+   levels are built from finished children; called with the mutex held */
+
+static int
+next_invalid(carmen_map_tiles_p tiles, int *level, int *tx, int *ty)
+{
+  carmen_map_tile_level_t *l;
+
+  while (tiles->next_level < tiles->num_levels) {
+    l = tiles->level+tiles->next_level;
+    while (tiles->next_tile < l->x_tiles*l->y_tiles) {
+      if (!l->tiles[tiles->next_tile].valid) {
+	*level = tiles->next_level;
+	*tx = tiles->next_tile % l->x_tiles;
+	*ty = tiles->next_tile / l->x_tiles;
+	return 1;
+      }
+      tiles->next_tile++;
+    }
+    tiles->next_level++;
+    tiles->next_tile = 0;
+  }
+
+  return 0;
+}
+
+static void *
+builder(void *arg)
+{
+  carmen_map_tiles_p tiles = (carmen_map_tiles_p)arg;
+  int level, tx, ty;
+
+  pthread_mutex_lock(&tiles->mutex);
+  while (!tiles->quit) {
+    if (!next_invalid(tiles, &level, &tx, &ty)) {
+      pthread_cond_wait(&tiles->wakeup, &tiles->mutex);
+      continue;
+    }
+    build_tile(tiles, level, tx, ty);
+    /* let the viewer in between tiles */
+    pthread_mutex_unlock(&tiles->mutex);
+    pthread_mutex_lock(&tiles->mutex);
+  }
+  pthread_mutex_unlock(&tiles->mutex);
+
+  return NULL;
+}
+
+carmen_map_tiles_p
+carmen_map_tiles_new(carmen_map_p map, int flags, int background)
+{
+  carmen_map_tiles_p tiles;
+  carmen_map_tile_level_t *l;
+  int width, height;
+
+  if (map == NULL || map->complete_map == NULL) {
+    carmen_warn("carmen_map_tiles_new was passed NULL map.\n");
+    return NULL;
+  }
+
+  tiles = (carmen_map_tiles_p)calloc(1, sizeof(carmen_map_tiles_t));
+  carmen_test_alloc(tiles);
+  tiles->map = map;
+  tiles->flags = flags;
+  find_range(tiles, &tiles->min_val, &tiles->max_val);
+
+  width = map->config.x_size;
+  height = map->config.y_size;
+  do {
+    l = tiles->level+tiles->num_levels;
+    l->width = width;
+    l->height = height;
+    l->x_tiles = (width+T-1)/T;
+    l->y_tiles = (height+T-1)/T;
+    l->tiles = (carmen_map_tile_t *)
+      calloc(l->x_tiles*l->y_tiles, sizeof(carmen_map_tile_t));
+    carmen_test_alloc(l->tiles);
+    tiles->num_levels++;
+    width = (width+1)/2;
+    height = (height+1)/2;
+  } while ((l->x_tiles > 1 || l->y_tiles > 1) &&
+	   tiles->num_levels < CARMEN_MAP_TILE_MAX_LEVELS);
+
+  pthread_mutex_init(&tiles->mutex, NULL);
+  pthread_cond_init(&tiles->wakeup, NULL);
+  if (background) {
+    if (pthread_create(&tiles->builder, NULL, builder, tiles) != 0)
+      carmen_warn("Could not start the map tile builder thread.\n");
+    else
+      tiles->builder_running = 1;
+  }
+
+  return tiles;
+}
+
+void
+carmen_map_tiles_free(carmen_map_tiles_p tiles)
+{
+  int l, i;
+
+  if (tiles == NULL)
+    return;
+
+  if (tiles->builder_running) {
+    pthread_mutex_lock(&tiles->mutex);
+    tiles->quit = 1;
+    pthread_cond_signal(&tiles->wakeup);
+    pthread_mutex_unlock(&tiles->mutex);
+    pthread_join(tiles->builder, NULL);
+  }
+  pthread_mutex_destroy(&tiles->mutex);
+  pthread_cond_destroy(&tiles->wakeup);
+
+  for (l = 0; l < tiles->num_levels; l++) {
+    for (i = 0; i < tiles->level[l].x_tiles*tiles->level[l].y_tiles; i++)
+      free(tiles->level[l].tiles[i].image);
+    free(tiles->level[l].tiles);
+  }
+  free(tiles);
+}
+
+int
+carmen_map_tiles_update(carmen_map_tiles_p tiles, float *data, int flags)
+{
+  int x_size = tiles->map->config.x_size, y_size = tiles->map->config.y_size;
+  carmen_map_tile_level_t *l0 = tiles->level;
+  float *map_data = tiles->map->complete_map;
+  int tx, ty, x, x1, y0, n, k, changed, count = 0;
+  double min_val, max_val;
+
+  pthread_mutex_lock(&tiles->mutex);
+
+  if (data == map_data) {
+    /* changed in place, nothing to compare against */
+    count = l0->x_tiles*l0->y_tiles;
+    invalidate_all(tiles);
+  } else {
+    for (ty = 0; ty < l0->y_tiles; ty++) {
+      /* tile row ty covers map rows [y0, y0+n) */
+      n = carmen_fmin(T, y_size - ty*T);
+      y0 = y_size - ty*T - n;
+      for (tx = 0; tx < l0->x_tiles; tx++) {
+	changed = 0;
+	x1 = carmen_fmin((tx+1)*T, x_size);
+	for (x = tx*T; x < x1; x++)
+	  if (memcmp(map_data + x*y_size + y0, data + x*y_size + y0,
+		     n*sizeof(float)) != 0) {
+	    memcpy(map_data + x*y_size + y0, data + x*y_size + y0,
+		   n*sizeof(float));
+	    changed = 1;
+	  }
+	if (!changed)
+	  continue;
+	count++;
+	for (k = 0; k < tiles->num_levels; k++)
+	  tiles->level[k].tiles[(ty>>k)*tiles->level[k].x_tiles + (tx>>k)].
+	    valid = 0;
+      }
+    }
+    tiles->next_level = 0;
+    tiles->next_tile = 0;
+  }
+
+  if (flags != tiles->flags) {
+    tiles->flags = flags;
+    count = l0->x_tiles*l0->y_tiles;
+    invalidate_all(tiles);
+  }
+  if (count > 0 && (flags & TILES_RESCALE)) {
+    find_range(tiles, &min_val, &max_val);
+    if (min_val != tiles->min_val || max_val != tiles->max_val) {
+      tiles->min_val = min_val;
+      tiles->max_val = max_val;
+      count = l0->x_tiles*l0->y_tiles;
+      invalidate_all(tiles);
+    }
+  }
+
+  if (count > 0)
+    pthread_cond_signal(&tiles->wakeup);
+  pthread_mutex_unlock(&tiles->mutex);
+
+  return count;
+}
+
+int
+carmen_map_tiles_level(carmen_map_tiles_p tiles, double scale)
+{
+  int level = 0;
+
+  while (level+1 < tiles->num_levels && scale*(2 << level) <= 1.0)
+    level++;
+
+  return level;
+}
+
+unsigned char *
+carmen_map_tiles_get(carmen_map_tiles_p tiles, int level, int tx, int ty)
+{
+  carmen_map_tile_t *tile;
+
+  if (level < 0 || level >= tiles->num_levels ||
+      tx < 0 || tx >= tiles->level[level].x_tiles ||
+      ty < 0 || ty >= tiles->level[level].y_tiles)
+    return NULL;
+
+  pthread_mutex_lock(&tiles->mutex);
+  tile = build_tile(tiles, level, tx, ty);
+  pthread_mutex_unlock(&tiles->mutex);
+
+  return tile->image;
+}
+
+void
+carmen_map_tiles_build_all(carmen_map_tiles_p tiles)
+{
+  int level, tx, ty;
+
+  pthread_mutex_lock(&tiles->mutex);
+  while (next_invalid(tiles, &level, &tx, &ty))
+    build_tile(tiles, level, tx, ty);
+  pthread_mutex_unlock(&tiles->mutex);
+}
@@ -0,0 +1,112 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/** @addtogroup maptools libmap_graphics **/
+// @{
+
+/** \file map_tiles.h
+ * \brief Tiled image pyramid of a grid map for the map viewer.
+ *
+ * The map is rendered into RGB tiles of CARMEN_MAP_TILE_SIZE pixels
+ * square, in screen orientation (row 0 is the top of the map).  Level
+ * 0 has one pixel per map cell, each further level halves the
+ * resolution, up to a level that fits into a single tile.  Tiles are
+ * rendered on demand, or ahead of time by a background thread, and
+ * only the tiles whose cells changed are invalidated when the map is
+ * updated.  Nothing here depends on GTK.
+ **/
+
+#ifndef CARMEN_MAP_TILES_H
+#define CARMEN_MAP_TILES_H
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CARMEN_MAP_TILE_SIZE       128
+#define CARMEN_MAP_TILE_MAX_LEVELS 16
+
+typedef struct {
+  unsigned char *image;
+  int valid;
+} carmen_map_tile_t;
+
+typedef struct {
+  int width, height;
+  int x_tiles, y_tiles;
+  carmen_map_tile_t *tiles;
+} carmen_map_tile_level_t;
+
+typedef struct {
+  carmen_map_p map;
+  int flags;
+  double min_val, max_val;
+  int num_levels;
+  carmen_map_tile_level_t level[CARMEN_MAP_TILE_MAX_LEVELS];
+  int next_level, next_tile;
+  pthread_mutex_t mutex;
+  pthread_cond_t wakeup;
+  pthread_t builder;
+  int builder_running, quit;
+} carmen_map_tiles_t, *carmen_map_tiles_p;
+
+/** Creates the tile cache for map, drawn with the CARMEN_GRAPHICS_*
+    flags.  The map is not copied: it must outlive the cache and must
+    only be changed through carmen_map_tiles_update.  If background is
+    set, a thread renders all tiles ahead of time. **/
+carmen_map_tiles_p carmen_map_tiles_new(carmen_map_p map, int flags,
+					int background);
+
+void carmen_map_tiles_free(carmen_map_tiles_p tiles);
+
+/** Copies data into the map and invalidates the tiles whose cells
+    changed, or all of them if the flags or the rescaling range changed.
+    Returns the number of level 0 tiles invalidated. **/
+int carmen_map_tiles_update(carmen_map_tiles_p tiles, float *data, int flags);
+
+/** Coarsest level that still has at least one pixel per screen pixel
+    when a map cell is drawn scale pixels wide. **/
+int carmen_map_tiles_level(carmen_map_tiles_p tiles, double scale);
+
+/** Returns tile (tx, ty) of a level, rendering it first if necessary.
+    The image is CARMEN_MAP_TILE_SIZE*CARMEN_MAP_TILE_SIZE RGB pixels,
+    and stays valid until the next call to carmen_map_tiles_update. **/
+unsigned char *carmen_map_tiles_get(carmen_map_tiles_p tiles, int level,
+				    int tx, int ty);
+
+/** Renders every invalid tile of every level. **/
+void carmen_map_tiles_build_all(carmen_map_tiles_p tiles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+// @}
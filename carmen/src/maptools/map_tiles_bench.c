@@ -0,0 +1,140 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Times the map viewer's tile cache without a display: building the
+ * whole pyramid, fetching the tiles of one viewport at several zoom
+ * levels from a cold and a warm cache, and re-rendering after a small
+ * map change.
+ *
+ * usage: map_tiles_bench <map file> [view width] [view height]
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+#include "map_tiles.h"
+
+static int view_tiles(carmen_map_tiles_p tiles, double scale,
+		      int view_width, int view_height)
+{
+  int level, tx, ty, tx0, ty0, tx1, ty1, n = 0;
+  double tile_pixels, x0, y0;
+
+  level = carmen_map_tiles_level(tiles, scale);
+  tile_pixels = CARMEN_MAP_TILE_SIZE*(1 << level)*scale;
+
+  /* viewport in the middle of the map */
+  x0 = carmen_fmax(0, tiles->map->config.x_size*scale/2 - view_width/2);
+  y0 = carmen_fmax(0, tiles->map->config.y_size*scale/2 - view_height/2);
+  tx0 = x0/tile_pixels;
+  ty0 = y0/tile_pixels;
+  tx1 = carmen_fmin((x0+view_width)/tile_pixels,
+		    tiles->level[level].x_tiles-1);
+  ty1 = carmen_fmin((y0+view_height)/tile_pixels,
+		    tiles->level[level].y_tiles-1);
+
+  for (ty = ty0; ty <= ty1; ty++)
+    for (tx = tx0; tx <= tx1; tx++) {
+      carmen_map_tiles_get(tiles, level, tx, ty);
+      n++;
+    }
+
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  carmen_map_t map;
+  carmen_map_tiles_p tiles;
+  int view_width, view_height, i, n, x, y, count;
+  double start, t_build, t_cold, t_warm, scale, fit;
+  double scales[4] = {0, 1.0, 2.0, 4.0};
+  float *data;
+
+  if (argc < 2)
+    carmen_die("usage: %s <map file> [view width] [view height]\n", argv[0]);
+  view_width = (argc > 2 ? atoi(argv[2]) : 800);
+  view_height = (argc > 3 ? atoi(argv[3]) : 600);
+
+  if (carmen_map_read_gridmap_chunk(argv[1], &map) < 0)
+    carmen_die("Could not read a gridmap from %s\n", argv[1]);
+  printf("%d x %d map, %d x %d view, %d pixel tiles\n", map.config.x_size,
+	 map.config.y_size, view_width, view_height, CARMEN_MAP_TILE_SIZE);
+
+  start = carmen_get_time();
+  tiles = carmen_map_tiles_new(&map, 0, 0);
+  carmen_map_tiles_build_all(tiles);
+  t_build = carmen_get_time() - start;
+  printf("whole pyramid (%d levels): %8.3f ms\n", tiles->num_levels,
+	 1000.0*t_build);
+  carmen_map_tiles_free(tiles);
+
+  fit = carmen_fmin(view_width/(double)map.config.x_size,
+		    view_height/(double)map.config.y_size);
+  scales[0] = fit;
+  for (i = 0; i < 4; i++) {
+    scale = scales[i];
+    tiles = carmen_map_tiles_new(&map, 0, 0);
+    start = carmen_get_time();
+    n = view_tiles(tiles, scale, view_width, view_height);
+    t_cold = carmen_get_time() - start;
+    start = carmen_get_time();
+    view_tiles(tiles, scale, view_width, view_height);
+    t_warm = carmen_get_time() - start;
+    printf("scale %6.3f: level %d, %3d tiles, cold %8.3f ms, "
+	   "warm %8.3f ms\n", scale, carmen_map_tiles_level(tiles, scale), n,
+	   1000.0*t_cold, 1000.0*t_warm);
+    carmen_map_tiles_free(tiles);
+  }
+
+  /* a small change in the middle of an otherwise unchanged map */
+  tiles = carmen_map_tiles_new(&map, 0, 0);
+  carmen_map_tiles_build_all(tiles);
+  data = (float *)calloc(map.config.x_size*map.config.y_size, sizeof(float));
+  carmen_test_alloc(data);
+  memcpy(data, map.complete_map,
+	 map.config.x_size*map.config.y_size*sizeof(float));
+  for (x = map.config.x_size/2; x < map.config.x_size/2+16 &&
+	 x < map.config.x_size; x++)
+    for (y = map.config.y_size/2; y < map.config.y_size/2+16 &&
+	   y < map.config.y_size; y++)
+      data[x*map.config.y_size+y] = 1.0 - data[x*map.config.y_size+y];
+  start = carmen_get_time();
+  count = carmen_map_tiles_update(tiles, data, 0);
+  carmen_map_tiles_build_all(tiles);
+  printf("16 x 16 cell change: %d tiles invalidated, %8.3f ms "
+	 "(whole pyramid %8.3f ms)\n", count,
+	 1000.0*(carmen_get_time() - start), 1000.0*t_build);
+  carmen_map_tiles_free(tiles);
+
+  free(data);
+  free(map.complete_map);
+  free(map.map);
+
+  return 0;
+}
@@ -27,6 +27,7 @@
  ********************************************************/
 
 #include <carmen/carmen.h>
+#include <pthread.h>
 
 /* An implementation of bicubic image interpolation, shamelessly borrowed
    from an implementation by Blake Carlson (blake-carlson@uiowa.edu). 
@@ -72,6 +73,104 @@ cubic_bspline(float x)
   return (one_sixth * (a - (4.0 * b) + (6.0 * c) - (4.0 * d)));
 }
 
+/* Runs columns(arg, x0, x1) over [0, x_size) split into one range of
+   columns per processor.  Workers write disjoint columns of the result,
+   so they need no locking. */
+
+#define MAX_THREADS         16
+#define MIN_THREAD_COLUMNS  16
+
+typedef void (*column_function_t)(void *arg, int x0, int x1);
+
+typedef struct {
+  column_function_t columns;
+  void *arg;
+  int x0, x1;
+} column_job_t;
+
+static void *
+column_worker(void *arg)
+{
+  column_job_t *job = (column_job_t *)arg;
+
+  job->columns(job->arg, job->x0, job->x1);
+  return NULL;
+}
+
+static void
+for_each_column_range(int x_size, column_function_t columns, void *arg)
+{
+  column_job_t jobs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+  int started[MAX_THREADS];
+  int num_threads, i;
+
+  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  num_threads = carmen_clamp(1, num_threads, MAX_THREADS);
+  num_threads = carmen_clamp(1, x_size/MIN_THREAD_COLUMNS, num_threads);
+
+  for (i = 0; i < num_threads; i++) {
+    jobs[i].columns = columns;
+    jobs[i].arg = arg;
+    jobs[i].x0 = (long)x_size*i/num_threads;
+    jobs[i].x1 = (long)x_size*(i+1)/num_threads;
+  }
+  for (i = 1; i < num_threads; i++)
+    started[i] = (pthread_create(threads+i, NULL, column_worker, 
+				 jobs+i) == 0);
+  column_worker(jobs);
+  for (i = 1; i < num_threads; i++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      column_worker(jobs+i);
+}
+
+typedef struct {
+  float **padded_map, **new_map;
+  int y_size;
+  int *i_x, *i_y;
+  float (*x_weight)[4], (*y_weight)[4];
+} resample_t;
+
+/* The kernel is separable, so its weights depend on the column or on
+   the row alone and are computed once per column and per row.  Each
+   cell still sums the same products in the same order as the
+   straightforward cell by cell version, so the result is identical to
+   the last bit. */
+
+static void
+resample_columns(void *arg, int x0, int x1)
+{
+  resample_t *r = (resample_t *)arg;
+  float *source[4], *x_weight, *y_weight, *new_column, tmp, r1;
+  int x, y, m, n, i_y;
+
+  for (x = x0; x < x1; x++) {
+    for (n = 0; n < 4; n++)
+      source[n] = r->padded_map[r->i_x[x]+n+1];
+    x_weight = r->x_weight[x];
+    new_column = r->new_map[x];
+    for (y = 0; y < r->y_size; y++) {
+      i_y = r->i_y[y]+1;
+      y_weight = r->y_weight[y];
+      // Implement EQ 14.5-3 here
+      tmp = 0.0;
+      for (m = 0; m < 4; m++) {
+	r1 = y_weight[m];
+	for (n = 0; n < 4; n++)
+	  tmp += source[n][i_y+m] * r1 * x_weight[n];
+      }
+
+      if (tmp < 0)
+	tmp = -1;
+      if (tmp > 1.0)
+	tmp = 1.0;
+      new_column[y] = tmp;
+    }
+  }
+}
+
 void
 carmen_map_util_change_resolution(carmen_map_p map, double new_resolution)
 {
@@ -85,9 +184,9 @@ carmen_map_util_change_resolution(carmen_map_p map, double new_resolution)
   int padded_x_size, padded_y_size;
   float scale_factor;
 
-  int x, y;
-  float f_x, f_y, a, b, tmp, r1, r2;
-  int i_x, i_y, m, n;
+  int x, y, m, n;
+  float f_x, f_y, a, b;
+  resample_t resample;
 
   new_config.x_size = map->config.resolution/new_resolution * 
     map->config.x_size;
@@ -134,34 +233,42 @@ carmen_map_util_change_resolution(carmen_map_p map, double new_resolution)
 
   scale_factor = map->config.resolution / new_resolution;
 
+  resample.i_x = (int *)calloc(new_config.x_size, sizeof(int));
+  carmen_test_alloc(resample.i_x);
+  resample.x_weight = (float (*)[4])calloc(new_config.x_size, 
+					   4*sizeof(float));
+  carmen_test_alloc(resample.x_weight);
+  for (x = 0; x < new_config.x_size; x++) {
+    f_x = x / scale_factor;
+    resample.i_x[x] = carmen_trunc(f_x);
+    b   = f_x - carmen_trunc(f_x);
+    for(n = -1; n < 3; n++)
+      resample.x_weight[x][n+1] = cubic_bspline(-1.0*((float)n - b)); 
+  }
+
+  resample.i_y = (int *)calloc(new_config.y_size, sizeof(int));
+  carmen_test_alloc(resample.i_y);
+  resample.y_weight = (float (*)[4])calloc(new_config.y_size, 
+					   4*sizeof(float));
+  carmen_test_alloc(resample.y_weight);
   for (y = 0; y < new_config.y_size; y++) {
     f_y = y / scale_factor;
-    i_y = carmen_trunc(f_y);
+    resample.i_y[y] = carmen_trunc(f_y);
     a   = f_y - carmen_trunc(f_y);		
-    for (x = 0; x < new_config.x_size; x++) {
-      f_x = x / scale_factor;
-      i_x = carmen_trunc(f_x);
-      b   = f_x - carmen_trunc(f_x);
-        
-      // Implement EQ 14.5-3 here
-      tmp = 0.0;
-      for(m = -1; m < 3; m++) {
-	r1 = cubic_bspline((float) m - a);
-          
-	for(n = -1; n < 3; n++) {
-	  r2 = cubic_bspline(-1.0*((float)n - b)); 
-	  tmp += padded_map[i_x+n+2][i_y+m+2] * r1 * r2;
-	}
-      }
-
-      if (tmp < 0)
-	tmp = -1;
-      if (tmp > 1.0)
-	tmp = 1.0;
-      new_map[x][y] = tmp;
-    }		
+    for(m = -1; m < 3; m++)
+      resample.y_weight[y][m+1] = cubic_bspline((float) m - a);
   }
 
+  resample.padded_map = padded_map;
+  resample.new_map = new_map;
+  resample.y_size = new_config.y_size;
+  for_each_column_range(new_config.x_size, resample_columns, &resample);
+
+  free(resample.i_x);
+  free(resample.x_weight);
+  free(resample.i_y);
+  free(resample.y_weight);
+
   free(padded_map);
   free(padded_backing);
 
@@ -269,11 +376,60 @@ void carmen_minimize_places(carmen_map_placelist_t *places,
 }
 
 
+#define ROTATE_BLOCK  64
+
+typedef struct {
+  float **map, *new_map;
+  int rotation, width, height, new_y_size;
+} rotate_t;
+
+/* fills columns [x0, x1) of the rotated map in square blocks, so that
+   the reads across the columns of the old map stay in cache */
+
+static void
+rotate_columns(void *arg, int x0, int x1)
+{
+  rotate_t *r = (rotate_t *)arg;
+  int x, y, xb, yb, x_end, y_end;
+  float *column, *old_column;
+
+  if (r->rotation == 0 || r->rotation == 2) {
+    for (x = x0; x < x1; x++) {
+      column = r->new_map + (long)x*r->new_y_size;
+      if (r->rotation == 0)
+	memcpy(column, r->map[x], r->height*sizeof(float));
+      else {
+	old_column = r->map[r->width-x-1] + r->height-1;
+	for (y = 0; y < r->height; y++)
+	  column[y] = *(old_column--);
+      }
+    }
+    return;
+  }
+
+  for (xb = x0; xb < x1; xb += ROTATE_BLOCK) {
+    x_end = carmen_imin(xb+ROTATE_BLOCK, x1);
+    for (yb = 0; yb < r->new_y_size; yb += ROTATE_BLOCK) {
+      y_end = carmen_imin(yb+ROTATE_BLOCK, r->new_y_size);
+      for (x = xb; x < x_end; x++) {
+	column = r->new_map + (long)x*r->new_y_size;
+	if (r->rotation == 1)
+	  for (y = yb; y < y_end; y++)
+	    column[y] = r->map[y][r->height-x-1];
+	else
+	  for (y = yb; y < y_end; y++)
+	    column[y] = r->map[r->width-y-1][x];
+      }
+    }
+  }
+}
+
 void carmen_rotate_gridmap(carmen_map_p map, int rotation) 
 {
-  int index, x = 0, y = 0;
+  int index;
   int height, width;
-  float *new_map, *new_map_ptr;
+  float *new_map;
+  rotate_t rotate;
   
   new_map = (float *)calloc(map->config.x_size*map->config.y_size, 
 			    sizeof(float));
@@ -282,24 +438,21 @@ void carmen_rotate_gridmap(carmen_map_p map, int rotation)
   rotation = rotation % 4;
   if (rotation < 0)
     rotation = rotation + 4;
-  new_map_ptr = new_map;
   width = map->config.x_size;
   height = map->config.y_size;
-  for (index = 0; index < width*height; index++) {      
-    if (rotation == 0) {
-      x = index / height;
-      y = index % height;
-    } else if (rotation == 1) {
-      x = index % width;
-      y = height - (index / width) - 1;
-    } else if (rotation == 2) {
-      x = width - (index / height) - 1;
-      y = height - (index % height) - 1;
-    } else if (rotation == 3) {
-      x = width - (index % width) - 1;
-      y = index / width;
-    }
-    *(new_map_ptr++) = map->map[x][y];
+
+  rotate.map = map->map;
+  rotate.new_map = new_map;
+  rotate.rotation = rotation;
+  rotate.width = width;
+  rotate.height = height;
+  if (rotation == 1 || rotation == 3) {
+    rotate.new_y_size = width;
+    for_each_column_range(height, rotate_columns, &rotate);
+  }
+  else {
+    rotate.new_y_size = height;
+    for_each_column_range(width, rotate_columns, &rotate);
   }
 
   free(map->complete_map);
@@ -0,0 +1,246 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation;
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/*
+ * Times carmen_map_util_change_resolution and carmen_rotate_gridmap
+ * against the cell by cell versions they replaced, kept below as a
+ * reference, and checks that both give the same map to the last bit.
+ * The map is tiled copies x copies times to make it larger.
+ *
+ * usage: map_util_bench <map file> [new resolution] [copies]
+ */
+
+#include <carmen/carmen.h>
+#include "map_io.h"
+#include "map_util.h"
+
+static const float one_sixth = 1.0 / 6.0;
+
+static float
+cubic_bspline(float x)
+{
+  float a, b, c, d;
+
+  a = (x + 2.0) <= 0.0 ? 0.0 : pow((x + 2.0), 3.0);
+  b = (x + 1.0) <= 0.0 ? 0.0 : pow((x + 1.0), 3.0);
+  c = x <= 0 ? 0.0 : pow(x, 3.0);
+  d = (x - 1.0) <= 0.0 ? 0.0 : pow((x - 1.0), 3.0);
+
+  return (one_sixth * (a - (4.0 * b) + (6.0 * c) - (4.0 * d)));
+}
+
+static void
+reference_change_resolution(carmen_map_p map, carmen_map_p new_map,
+			    double new_resolution)
+{
+  float **padded_map, *padded_backing, scale_factor;
+  float f_x, f_y, a, b, tmp, r1, r2;
+  int padded_x_size, padded_y_size, x, y, i_x, i_y, m, n;
+
+  new_map->config = map->config;
+  new_map->config.x_size = map->config.resolution/new_resolution *
+    map->config.x_size;
+  new_map->config.y_size = map->config.resolution/new_resolution *
+    map->config.y_size;
+  new_map->config.resolution = new_resolution;
+  new_map->complete_map = (float *)
+    calloc(new_map->config.x_size*new_map->config.y_size, sizeof(float));
+  carmen_test_alloc(new_map->complete_map);
+  new_map->map = (float **)calloc(new_map->config.x_size, sizeof(float *));
+  carmen_test_alloc(new_map->map);
+  for (x = 0; x < new_map->config.x_size; x++)
+    new_map->map[x] = new_map->complete_map+x*new_map->config.y_size;
+
+  padded_x_size = map->config.x_size+4;
+  padded_y_size = map->config.y_size+4;
+  padded_backing = (float *)calloc(padded_x_size*padded_y_size, sizeof(float));
+  carmen_test_alloc(padded_backing);
+  padded_map = (float **)calloc(padded_x_size, sizeof(float *));
+  carmen_test_alloc(padded_map);
+  for (x = 0; x < padded_x_size; x++)
+    padded_map[x] = padded_backing+x*padded_y_size;
+  for (x = 2; x < padded_x_size-2; x++) {
+    memcpy(padded_map[x]+2, map->map[x-2], map->config.y_size*sizeof(float));
+    memcpy(padded_map[x], padded_map[x]+2, 2*sizeof(float));
+    memcpy(padded_map[x]+2+map->config.y_size,
+	   padded_map[x]+map->config.y_size, 2*sizeof(float));
+  }
+  memcpy(padded_map[0], padded_map[2], padded_y_size*sizeof(float));
+  memcpy(padded_map[1], padded_map[2], padded_y_size*sizeof(float));
+  memcpy(padded_map[padded_x_size-2], padded_map[padded_x_size-3],
+	 padded_y_size*sizeof(float));
+  memcpy(padded_map[padded_x_size-1], padded_map[padded_x_size-3],
+	 padded_y_size*sizeof(float));
+
+  scale_factor = map->config.resolution / new_resolution;
+  for (y = 0; y < new_map->config.y_size; y++) {
+    f_y = y / scale_factor;
+    i_y = carmen_trunc(f_y);
+    a   = f_y - carmen_trunc(f_y);
+    for (x = 0; x < new_map->config.x_size; x++) {
+      f_x = x / scale_factor;
+      i_x = carmen_trunc(f_x);
+      b   = f_x - carmen_trunc(f_x);
+      tmp = 0.0;
+      for(m = -1; m < 3; m++) {
+	r1 = cubic_bspline((float) m - a);
+	for(n = -1; n < 3; n++) {
+	  r2 = cubic_bspline(-1.0*((float)n - b));
+	  tmp += padded_map[i_x+n+2][i_y+m+2] * r1 * r2;
+	}
+      }
+      if (tmp < 0)
+	tmp = -1;
+      if (tmp > 1.0)
+	tmp = 1.0;
+      new_map->map[x][y] = tmp;
+    }
+  }
+
+  free(padded_map);
+  free(padded_backing);
+}
+
+static void
+reference_rotate(carmen_map_p map, float *new_map, int rotation)
+{
+  int index, x = 0, y = 0, width, height;
+
+  width = map->config.x_size;
+  height = map->config.y_size;
+  for (index = 0; index < width*height; index++) {
+    if (rotation == 0) {
+      x = index / height;
+      y = index % height;
+    } else if (rotation == 1) {
+      x = index % width;
+      y = height - (index / width) - 1;
+    } else if (rotation == 2) {
+      x = width - (index / height) - 1;
+      y = height - (index % height) - 1;
+    } else if (rotation == 3) {
+      x = width - (index % width) - 1;
+      y = index / width;
+    }
+    new_map[index] = map->map[x][y];
+  }
+}
+
+static void
+copy_map(carmen_map_p map, carmen_map_p copy)
+{
+  int x, n = map->config.x_size*map->config.y_size;
+
+  copy->config = map->config;
+  copy->complete_map = (float *)calloc(n, sizeof(float));
+  carmen_test_alloc(copy->complete_map);
+  memcpy(copy->complete_map, map->complete_map, n*sizeof(float));
+  copy->map = (float **)calloc(map->config.x_size, sizeof(float *));
+  carmen_test_alloc(copy->map);
+  for (x = 0; x < map->config.x_size; x++)
+    copy->map[x] = copy->complete_map+x*map->config.y_size;
+}
+
+int main(int argc, char **argv)
+{
+  carmen_map_t file_map, map, copy, reference;
+  double new_resolution, start, t_reference, t_new;
+  int copies, x, y, rotation;
+  float *rotated;
+
+  if (argc < 2)
+    carmen_die("usage: %s <map file> [new resolution] [copies]\n", argv[0]);
+  if (carmen_map_read_gridmap_chunk(argv[1], &file_map) < 0)
+    carmen_die("Could not read a gridmap from %s\n", argv[1]);
+  new_resolution = (argc > 2 ? atof(argv[2]) :
+		    file_map.config.resolution/2);
+  copies = (argc > 3 ? atoi(argv[3]) : 1);
+
+  map.config = file_map.config;
+  map.config.x_size *= copies;
+  map.config.y_size *= copies;
+  map.complete_map = (float *)calloc(map.config.x_size*map.config.y_size,
+				     sizeof(float));
+  carmen_test_alloc(map.complete_map);
+  map.map = (float **)calloc(map.config.x_size, sizeof(float *));
+  carmen_test_alloc(map.map);
+  for (x = 0; x < map.config.x_size; x++) {
+    map.map[x] = map.complete_map+x*map.config.y_size;
+    for (y = 0; y < map.config.y_size; y++)
+      map.map[x][y] = file_map.map[x % file_map.config.x_size]
+	[y % file_map.config.y_size];
+  }
+  printf("%d x %d cells at %.3f m\n", map.config.x_size, map.config.y_size,
+	 map.config.resolution);
+
+  start = carmen_get_time();
+  reference_change_resolution(&map, &reference, new_resolution);
+  t_reference = carmen_get_time() - start;
+  copy_map(&map, &copy);
+  start = carmen_get_time();
+  carmen_map_util_change_resolution(&copy, new_resolution);
+  t_new = carmen_get_time() - start;
+  if (copy.config.x_size != reference.config.x_size ||
+      copy.config.y_size != reference.config.y_size ||
+      memcmp(copy.complete_map, reference.complete_map, copy.config.x_size*
+	     copy.config.y_size*sizeof(float)))
+    carmen_die("change_resolution differs from the reference\n");
+  printf("change resolution to %.3f m (%d x %d): reference %9.3f ms, "
+	 "now %9.3f ms\n", new_resolution, copy.config.x_size,
+	 copy.config.y_size, 1000.0*t_reference, 1000.0*t_new);
+  free(copy.complete_map);
+  free(copy.map);
+  free(reference.complete_map);
+  free(reference.map);
+
+  rotated = (float *)calloc(map.config.x_size*map.config.y_size,
+			    sizeof(float));
+  carmen_test_alloc(rotated);
+  for (rotation = 0; rotation < 4; rotation++) {
+    start = carmen_get_time();
+    reference_rotate(&map, rotated, rotation);
+    t_reference = carmen_get_time() - start;
+    copy_map(&map, &copy);
+    start = carmen_get_time();
+    carmen_rotate_gridmap(&copy, rotation);
+    t_new = carmen_get_time() - start;
+    if (memcmp(copy.complete_map, rotated, map.config.x_size*
+	       map.config.y_size*sizeof(float)))
+      carmen_die("rotation %d differs from the reference\n", rotation);
+    printf("rotate by %d: reference %9.3f ms, now %9.3f ms\n", rotation,
+	   1000.0*t_reference, 1000.0*t_new);
+    free(copy.complete_map);
+    free(copy.map);
+  }
+
+  free(rotated);
+  free(map.complete_map);
+  free(map.map);
+
+  return 0;
+}
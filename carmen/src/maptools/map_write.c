@@ -57,6 +57,7 @@ void write_fixed_string(carmen_FILE *fp, char *str, int n)
  * LASERSCANS:   carmen_laser_scan_p scan_list, int num_scans
  * CREATOR:      (none)
  * HMAP:         carmen_hmap_p hmap
+ * LIKELIHOOD:   int size of the (possibly compressed) fields
  *
  */
 static int vchunk_size(unsigned int chunk_type, va_list ap)
@@ -136,6 +137,11 @@ static int vchunk_size(unsigned int chunk_type, va_list ap)
       }
       size += num;
     }
+    break;
+
+  case CARMEN_MAP_LIKELIHOOD_CHUNK:
+    size += 4 + 4 + 8 + 4 + 5 * 8 + va_arg(ap, int);
+    break;
   }
 
   return size;
@@ -306,11 +312,36 @@ static int carmen_map_write_gridmap_chunk_data(carmen_FILE *fp, float **prob,
   return 0;
 }
 
+/* Writes a padding chunk if the cells of a gridmap chunk whose header
+   (type, size, description, name and dimensions) takes header_size bytes
+   would not start 4-byte aligned, so that carmen_map_file_map_gridmap
+   can use them in place.  An empty padding chunk takes 15 bytes. */
+static void carmen_map_write_gridmap_padding(carmen_FILE *fp, int header_size)
+{
+  off_t pos;
+  int misalignment, size, i;
+
+  pos = carmen_ftell(fp);
+  if (pos < 0)
+    return;
+  misalignment = (pos + header_size) % sizeof(float);
+  if (misalignment == 0)
+    return;
+
+  carmen_fputc(CARMEN_MAP_PADDING_CHUNK, fp);
+  size = 10 + (sizeof(float) - misalignment + 1) % sizeof(float);
+  carmen_fwrite(&size, sizeof(int), 1, fp);
+  carmen_fprintf(fp, "PADDING   ");
+  for (i = 10; i < size; i++)
+    carmen_fputc(0, fp);
+}
+
 int carmen_map_write_gridmap_chunk(carmen_FILE *fp, float **prob, 
 				   int size_x, int size_y, double resolution)
 {
   int size;
 
+  carmen_map_write_gridmap_padding(fp, 1 + sizeof(int) + 10 + 12);
   carmen_fputc(CARMEN_MAP_GRIDMAP_CHUNK, fp);
   size = chunk_size(CARMEN_MAP_GRIDMAP_CHUNK, size_x, size_y);
   carmen_fwrite(&size, sizeof(int), 1, fp);
@@ -324,6 +355,8 @@ int carmen_map_write_named_gridmap_chunk(carmen_FILE *fp, char *name, float **pr
 {
   int size;
 
+  carmen_map_write_gridmap_padding(fp, 1 + sizeof(int) + 10 +
+				   strlen(name) + 1 + 12);
   carmen_fputc(CARMEN_MAP_GRIDMAP_CHUNK | CARMEN_MAP_NAMED_CHUNK_FLAG, fp);
   size = named_chunk_size(CARMEN_MAP_GRIDMAP_CHUNK, name, size_x, size_y);
   carmen_fwrite(&size, sizeof(int), 1, fp);
@@ -621,6 +654,93 @@ int carmen_map_write_hmap_chunk(carmen_FILE *fp, carmen_hmap_p hmap)
   return carmen_map_write_hmap_chunk_data(fp, hmap);
 }
 
+/* each likelihood field is stored as its raw size, its stored size and
+   the stored bytes; the field is zlib compressed if that made it
+   smaller and stored raw otherwise */
+
+typedef struct {
+  void *data;
+  int raw_size, stored_size;
+  unsigned char *stored;
+} likelihood_field_t;
+
+static void pack_likelihood_field(likelihood_field_t *field, void *data,
+				  int raw_size)
+{
+  field->data = data;
+  field->raw_size = raw_size;
+  field->stored_size = raw_size;
+  field->stored = (unsigned char *)data;
+
+#ifndef NO_ZLIB
+  {
+    uLongf compressed_size;
+    unsigned char *compressed;
+
+    compressed_size = compressBound(raw_size);
+    compressed = (unsigned char *)calloc(compressed_size, 1);
+    carmen_test_alloc(compressed);
+    if(compress2(compressed, &compressed_size, (Bytef *)data, raw_size,
+		 Z_BEST_SPEED) == Z_OK && (int)compressed_size < raw_size) {
+      field->stored = compressed;
+      field->stored_size = compressed_size;
+    }
+    else
+      free(compressed);
+  }
+#endif
+}
+
+int carmen_map_write_likelihood_chunk(carmen_FILE *fp, 
+				      carmen_map_likelihood_p likelihood)
+{
+  likelihood_field_t fields[5];
+  int size, data_size, num_cells, i;
+
+  num_cells = likelihood->x_size * likelihood->y_size;
+  pack_likelihood_field(fields + 0, likelihood->distance, 
+			num_cells * sizeof(float));
+  pack_likelihood_field(fields + 1, likelihood->x_offset, 
+			num_cells * sizeof(short int));
+  pack_likelihood_field(fields + 2, likelihood->y_offset, 
+			num_cells * sizeof(short int));
+  pack_likelihood_field(fields + 3, likelihood->prob, 
+			num_cells * sizeof(float));
+  pack_likelihood_field(fields + 4, likelihood->gprob, 
+			num_cells * sizeof(float));
+
+  data_size = 0;
+  for(i = 0; i < 5; i++)
+    data_size += 8 + fields[i].stored_size;
+
+  carmen_fputc(CARMEN_MAP_LIKELIHOOD_CHUNK, fp);
+  size = chunk_size(CARMEN_MAP_LIKELIHOOD_CHUNK, data_size);
+  carmen_fwrite(&size, sizeof(int), 1, fp);
+  carmen_fprintf(fp, "LIKELIHOOD");
+
+  carmen_fwrite(&likelihood->x_size, sizeof(int), 1, fp);
+  carmen_fwrite(&likelihood->y_size, sizeof(int), 1, fp);
+  carmen_fwrite(&likelihood->resolution, sizeof(double), 1, fp);
+  carmen_fwrite(&likelihood->gridmap_hash, sizeof(unsigned int), 1, fp);
+  carmen_fwrite(&likelihood->occupied_prob, sizeof(double), 1, fp);
+  carmen_fwrite(&likelihood->lmap_std, sizeof(double), 1, fp);
+  carmen_fwrite(&likelihood->global_lmap_std, sizeof(double), 1, fp);
+  carmen_fwrite(&likelihood->tracking_beam_minlikelihood, sizeof(double), 
+		1, fp);
+  carmen_fwrite(&likelihood->global_beam_minlikelihood, sizeof(double), 
+		1, fp);
+
+  for(i = 0; i < 5; i++) {
+    carmen_fwrite(&fields[i].raw_size, sizeof(int), 1, fp);
+    carmen_fwrite(&fields[i].stored_size, sizeof(int), 1, fp);
+    carmen_fwrite(fields[i].stored, fields[i].stored_size, 1, fp);
+    if(fields[i].stored != fields[i].data)
+      free(fields[i].stored);
+  }
+
+  return 0;
+}
+
 int carmen_map_write_to_ppm(carmen_map_p map, char *output_filename)
 {
   int x, y;
@@ -152,7 +152,8 @@ static void help(int argc, char **argv)
 	    "passed through untouched.\n");
     fprintf(stderr, "<chunk type> can be one of \"laserscans\", "
 	    "\"places\", \"gridmap\", \"offlimits\", ");
-    fprintf(stderr, "                                \"expected\".\n\n");
+    fprintf(stderr, "                                \"expected\", "
+	    "\"likelihood\".\n\n");
 
     exit(0);
   }
@@ -359,9 +360,9 @@ static void rotate(int argc, char *argv[])
   if (out_fp == NULL)
     carmen_die_syserror("Couldn't open %s for writing", output_filename);
   
-  if (carmen_map_vstrip(in_fp, out_fp, 3, CARMEN_MAP_GRIDMAP_CHUNK,
-			CARMEN_MAP_OFFLIMITS_CHUNK, 
-			CARMEN_MAP_PLACES_CHUNK) < 0) 
+  if (carmen_map_vstrip(in_fp, out_fp, 4, CARMEN_MAP_GRIDMAP_CHUNK,
+			CARMEN_MAP_OFFLIMITS_CHUNK, CARMEN_MAP_PLACES_CHUNK,
+			CARMEN_MAP_LIKELIHOOD_CHUNK) < 0) 
     carmen_die_syserror("Couldn't strip map to %s", output_filename);
 
   if (carmen_map_write_gridmap_chunk(out_fp, map.map, map.config.x_size, 
@@ -474,9 +475,9 @@ static void minimize(int argc, char *argv[])
   if (out_fp == NULL)
     carmen_die_syserror("Couldn't open %s for writing", output_filename);
   
-  if (carmen_map_vstrip(in_fp, out_fp, 3, CARMEN_MAP_GRIDMAP_CHUNK,
-			CARMEN_MAP_OFFLIMITS_CHUNK, 
-			CARMEN_MAP_PLACES_CHUNK) < 0) 
+  if (carmen_map_vstrip(in_fp, out_fp, 4, CARMEN_MAP_GRIDMAP_CHUNK,
+			CARMEN_MAP_OFFLIMITS_CHUNK, CARMEN_MAP_PLACES_CHUNK,
+			CARMEN_MAP_LIKELIHOOD_CHUNK) < 0) 
     carmen_die_syserror("Couldn't strip map to %s", output_filename);
   
 
@@ -758,6 +759,10 @@ static void strip(int argc, char *argv[])
     if (carmen_map_strip(fp_in, fp_out, CARMEN_MAP_PLACES_CHUNK) < 0) 
       carmen_die_syserror("Error: could not strip file");
   }
+  else if (carmen_strcasecmp(chunk_type, "likelihood") == 0) {
+    if (carmen_map_strip(fp_in, fp_out, CARMEN_MAP_LIKELIHOOD_CHUNK) < 0) 
+      carmen_die_syserror("Error: could not strip file");
+  }
 
   carmen_fclose(fp_in);
   carmen_fclose(fp_out); 
@@ -850,6 +855,11 @@ static void info(int argc, char *argv[])
     printf("LASERSCANS    : yes (%d bytes)\n", chunk_size);
   else
     printf("LASERSCANS    : no\n");
+  chunk_size = carmen_map_chunk_exists(filename, CARMEN_MAP_LIKELIHOOD_CHUNK);
+  if(chunk_size > 0)
+    printf("LIKELIHOOD    : yes (%d bytes)\n", chunk_size);
+  else
+    printf("LIKELIHOOD    : no\n");
 
   if(carmen_map_chunk_exists(filename, CARMEN_MAP_PLACES_CHUNK)) {
     printf("\nMap contains the following places:\n");
@@ -31,17 +31,11 @@
 
 #include "navigator.h"
 #include "conventional.h" 
-
-#define NUM_ACTIONS 8
+#include "hierarchy.h"
 
 extern carmen_map_t * carmen_planner_map;
-extern int carmen_planner_x_offset[NUM_ACTIONS];
-extern int carmen_planner_y_offset[NUM_ACTIONS];
 
 #define MAX_UTILITY 1000.0
-/* How much to reduce the cost per meter.
-   Kind of arbitrary, but related to MAX_UTILITY */
-#define MIN_COST 0.1
 
 struct state_struct {
   int x, y;
@@ -64,6 +58,32 @@ static int x_size, y_size;
 static double *costs = NULL;
 static double *utility = NULL;
 
+/* Utility functions computed before, each to a goal cell on the costs
+   of the unmodified map, that is, as last built from the whole map.
+   Reset the map to the same costs and they are still right; any other
+   costs built from the whole map empty the cache. */
+typedef struct {
+  int goal_x, goal_y;
+  double *utility;
+  unsigned long last_used;
+} cached_utility_t;
+
+static cached_utility_t *utility_cache = NULL;
+static int utility_cache_length = 0, utility_cache_capacity = 0;
+static int utility_cache_megabytes = 0;
+static unsigned long utility_cache_clock = 0;
+static double *base_costs = NULL;
+static int costs_modified = 1;
+
+/* While planning in a corridor, the tiles the utility function is
+   computed in.  Only the tiles of the last corridor then hold values
+   to reset, unless the utility function was last computed or copied
+   whole. */
+static unsigned char *corridor = NULL;
+static int corridor_tile_size = 0, corridor_y_tiles = 0;
+static unsigned char *utility_tiles = NULL;
+static int utility_num_tiles = 0, utility_is_partial = 0;
+
 carmen_inline static int 
 is_out_of_map(int x, int y)
 {
@@ -242,6 +262,122 @@ insert_into_queue(state_ptr new_state, queue the_queue)
     }
 }
 
+static void
+flush_utility_cache(void)
+{
+  int index;
+
+  for (index = 0; index < utility_cache_length; index++)
+    free(utility_cache[index].utility);
+  utility_cache_length = 0;
+}
+
+/* How many utility functions of this map fit in the cache */
+static int
+utility_cache_entries(void)
+{
+  return (int)(utility_cache_megabytes*1048576.0 / 
+	       ((double)x_size*y_size*sizeof(double)));
+}
+
+/* Remembers the costs just built from the whole map as those of the
+   unmodified map, and forgets the utility functions of any other. */
+static void
+keep_base_costs(void)
+{
+  costs_modified = 0;
+  if (utility_cache_megabytes == 0)
+    return;
+
+  if (base_costs != NULL && 
+      memcmp(base_costs, costs, x_size*y_size*sizeof(double)) == 0)
+    return;
+
+  flush_utility_cache();
+  free(base_costs);
+  base_costs = (double *)calloc(x_size*y_size, sizeof(double));
+  carmen_test_alloc(base_costs);
+  memcpy(base_costs, costs, x_size*y_size*sizeof(double));
+}
+
+static cached_utility_t *
+find_cached_utility(int goal_x, int goal_y)
+{
+  int index;
+
+  for (index = 0; index < utility_cache_length; index++)
+    if (utility_cache[index].goal_x == goal_x && 
+	utility_cache[index].goal_y == goal_y) {
+      utility_cache[index].last_used = ++utility_cache_clock;
+      return utility_cache + index;
+    }
+  return NULL;
+}
+
+static int
+least_recently_used(void)
+{
+  int index, oldest = 0;
+
+  for (index = 1; index < utility_cache_length; index++)
+    if (utility_cache[index].last_used < utility_cache[oldest].last_used)
+      oldest = index;
+  return oldest;
+}
+
+/* A cache entry for the goal, the least recently used one if the cache
+   is full, or NULL if no utility function fits. */
+static cached_utility_t *
+new_cached_utility(int goal_x, int goal_y)
+{
+  cached_utility_t *entry;
+  int max_entries = utility_cache_entries();
+
+  if (max_entries == 0)
+    return NULL;
+
+  if (utility_cache_length < max_entries) {
+    if (utility_cache_length == utility_cache_capacity) {
+      utility_cache_capacity = carmen_imax(8, 2*utility_cache_capacity);
+      utility_cache = (cached_utility_t *)
+	realloc(utility_cache, utility_cache_capacity*sizeof(cached_utility_t));
+      carmen_test_alloc(utility_cache);
+    }
+    entry = utility_cache + utility_cache_length++;
+    entry->utility = (double *)calloc(x_size*y_size, sizeof(double));
+    carmen_test_alloc(entry->utility);
+  } else
+    entry = utility_cache + least_recently_used();
+
+  entry->goal_x = goal_x;
+  entry->goal_y = goal_y;
+  entry->last_used = ++utility_cache_clock;
+  return entry;
+}
+
+void 
+carmen_conventional_set_utility_cache(int megabytes)
+{
+  int index, max_entries;
+
+  utility_cache_megabytes = carmen_imax(0, megabytes);
+  if (utility_cache_megabytes == 0) {
+    flush_utility_cache();
+    free(base_costs);
+    base_costs = NULL;
+    return;
+  }
+
+  if (x_size == 0 || y_size == 0)
+    return;
+  max_entries = utility_cache_entries();
+  while (utility_cache_length > max_entries) {
+    index = least_recently_used();
+    free(utility_cache[index].utility);
+    utility_cache[index] = utility_cache[--utility_cache_length];
+  }
+}
+
 void carmen_conventional_build_costs(carmen_robot_config_t *robot_conf,
 				     carmen_map_point_t *robot_posn,
 				     carmen_navigator_config_t *navigator_conf)
@@ -265,6 +401,9 @@ void carmen_conventional_build_costs(carmen_robot_config_t *robot_conf,
     costs = NULL;
     free(utility);
     utility = NULL;
+    flush_utility_cache();
+    free(base_costs);
+    base_costs = NULL;
   }
 
   x_size = carmen_planner_map->config.x_size;
@@ -398,9 +537,139 @@ void carmen_conventional_build_costs(carmen_robot_config_t *robot_conf,
     if (x_index >= 0 && x_index < x_size && y_index >= 0 && y_index < y_size)
       *(costs+x_index*y_size+y_index) = MIN_COST;
   }
+
+  carmen_hierarchy_costs_changed(x_start, y_start, x_end, y_end);
+  if (robot_posn == NULL)
+    keep_base_costs();
+  else
+    costs_modified = 1;
   carmen_verbose("done\n");
 }
 
+/* An obstacle raises the cost of cells up to 1/resolution cells away
+   (its MAX_UTILITY drops by resolution*MAX_UTILITY per cell), so a
+   changed map cell can only change costs that close to it, and these
+   only depend on map cells that close to them.  Recomputes the costs
+   of that neighbourhood of the changed window, with the same passes as
+   carmen_conventional_build_costs but over a copy of it, which gives
+   the same costs as rebuilding the whole map. */
+void carmen_conventional_update_costs(carmen_robot_config_t *robot_conf,
+				      int x_start, int y_start,
+				      int x_end, int y_end)
+{
+  static double *window = NULL;
+  static int window_size = 0;
+  int reach, x_min, y_min, x_max, y_max, width, height;
+  int x_index, y_index, x, y, index;
+  double value, resolution, robot_distance;
+  double *cost_ptr;
+  float *map_ptr;
+
+  if (costs == NULL || x_size != carmen_planner_map->config.x_size ||
+      y_size != carmen_planner_map->config.y_size) {
+    carmen_conventional_build_costs(robot_conf, NULL, NULL);
+    return;
+  }
+  if (x_start >= x_end || y_start >= y_end)
+    return;
+  costs_modified = 1;
+
+  resolution = carmen_planner_map->config.resolution;
+  reach = (int)ceil(1.0/resolution) + 1;
+
+  /* the costs that can change */
+  x_start = carmen_clamp(0, x_start - reach, x_size);
+  y_start = carmen_clamp(0, y_start - reach, y_size);
+  x_end = carmen_clamp(0, x_end + reach, x_size);
+  y_end = carmen_clamp(0, y_end + reach, y_size);
+
+  /* and the map cells they depend on */
+  x_min = carmen_clamp(0, x_start - reach, x_size);
+  y_min = carmen_clamp(0, y_start - reach, y_size);
+  x_max = carmen_clamp(0, x_end + reach, x_size);
+  y_max = carmen_clamp(0, y_end + reach, y_size);
+  width = x_max - x_min;
+  height = y_max - y_min;
+
+  if (width*height > window_size) {
+    window_size = width*height;
+    free(window);
+    window = (double *)calloc(window_size, sizeof(double));
+    carmen_test_alloc(window);
+  }
+
+  cost_ptr = window;
+  for (x_index = x_min; x_index < x_max; x_index++) {
+    map_ptr = carmen_planner_map->complete_map+x_index*y_size+y_min;
+    for (y_index = y_min; y_index < y_max; y_index++) {
+      value = *(map_ptr++);
+      if (value >= 0 && value < MIN_COST)
+	value = MIN_COST;
+      else
+	value = MAX_UTILITY;
+      *(cost_ptr++) = value;
+    }
+  }
+
+  for (x_index = x_min; x_index < x_max; x_index++) {
+    cost_ptr = window+(x_index-x_min)*height;
+    for (y_index = y_min; y_index < y_max; y_index++, cost_ptr++) {
+      if (x_index < 1 || x_index >= x_size-1 || y_index < 1 || 
+	  y_index >= y_size-1) 
+	continue;
+      
+      for (index = 0; index < NUM_ACTIONS; index++) {
+	x = x_index + carmen_planner_x_offset[index];
+	y = y_index + carmen_planner_y_offset[index];
+	if (x < x_min || x >= x_max || y < y_min || y >= y_max)
+	  continue;
+	
+	value = *(window+(x-x_min)*height+y-y_min) - resolution*MAX_UTILITY;
+	if (value > *cost_ptr) 
+	  *cost_ptr = value; 
+      }
+    }
+  }
+
+  for (x_index = x_max-1; x_index >= x_min; x_index--) {
+    cost_ptr = window+(x_index-x_min)*height+height-1;
+    for (y_index = y_max-1; y_index >= y_min; y_index--, cost_ptr--) {
+      if (x_index < 1 || x_index >= x_size-1 || y_index < 1 || 
+	  y_index >= y_size-1) 
+	continue;
+      
+      for (index = 0; index < NUM_ACTIONS; index++) {
+	x = x_index + carmen_planner_x_offset[index];
+	y = y_index + carmen_planner_y_offset[index];
+	if (x < x_min || x >= x_max || y < y_min || y >= y_max)
+	  continue;
+	
+	value = *(window+(x-x_min)*height+y-y_min) - resolution*MAX_UTILITY;
+	if (value > *cost_ptr) 
+	  *cost_ptr = value; 
+      }
+    }
+  }
+
+  robot_distance = robot_conf->width/2*MAX_UTILITY;
+
+  for (x_index = x_start; x_index < x_end; x_index++) {
+    cost_ptr = window+(x_index-x_min)*height+y_start-y_min;
+    for (y_index = y_start; y_index < y_end; y_index++) {
+      value = *(cost_ptr++);
+      if (value < MAX_UTILITY - robot_distance) {
+	value = value / (2*MAX_UTILITY);
+	if (value < MIN_COST)
+	  value = MIN_COST;
+      } else 
+	value = 1.0;
+      *(costs+x_index*y_size+y_index) = value;
+    }
+  }
+
+  carmen_hierarchy_costs_changed(x_start, y_start, x_end, y_end);
+}
+
 double 
 carmen_conventional_get_cost(int x, int y)  
 {
@@ -479,7 +748,12 @@ add_neighbours_to_queue(int x, int y, queue state_queue)
       cur_x = x + carmen_planner_x_offset[index];
       cur_y = y + carmen_planner_y_offset[index];
 
-      if (is_out_of_map(cur_x, cur_y) || *(costs+cur_x*y_size + cur_y) > 0.5)
+      if (is_out_of_map(cur_x, cur_y) || *(costs+cur_x*y_size + cur_y) > 
+	  MAX_FREE_COST)
+	continue;
+      if (corridor != NULL && !corridor[(cur_x/corridor_tile_size)*
+					corridor_y_tiles + 
+					cur_y/corridor_tile_size])
 	continue;
       
       cur_util = *(utility_value(cur_x, cur_y));
@@ -491,11 +765,61 @@ add_neighbours_to_queue(int x, int y, queue state_queue)
   
 }
 
-void 
-carmen_conventional_dynamic_program(int goal_x, int goal_y) 
+/* Resets the utility function to -1: only in the tiles of the last
+   corridor if it is partial, that is, holds values nowhere else.
+   Remembers which tiles the next one will be computed in. */
+static void
+clear_utility(int partial, unsigned char *tiles)
 {
+  int tile_size = carmen_hierarchy_tile_size();
+  int y_tiles = 0, num_tiles = 0;
+  int tile, x_index, y_index, x_end, y_end;
   double *utility_ptr;
-  int index;
+
+  if (tile_size > 0) {
+    y_tiles = (y_size + tile_size - 1) / tile_size;
+    num_tiles = (x_size + tile_size - 1) / tile_size * y_tiles;
+  }
+
+  if (partial && tile_size == corridor_tile_size &&
+      num_tiles == utility_num_tiles) {
+    for (tile = 0; tile < num_tiles; tile++) {
+      if (!utility_tiles[tile])
+	continue;
+      x_end = carmen_imin((tile/y_tiles+1)*tile_size, x_size);
+      y_end = carmen_imin((tile%y_tiles+1)*tile_size, y_size);
+      for (x_index = tile/y_tiles*tile_size; x_index < x_end; x_index++) {
+	utility_ptr = utility+x_index*y_size;
+	for (y_index = tile%y_tiles*tile_size; y_index < y_end; y_index++)
+	  utility_ptr[y_index] = -1;
+      }
+    }
+  } else {
+    utility_ptr = utility;
+    for (tile = 0; tile < x_size * y_size; tile++) 
+      *(utility_ptr++) = -1;
+  }
+
+  if (tiles == NULL)
+    return;
+  if (num_tiles != utility_num_tiles) {
+    free(utility_tiles);
+    utility_tiles = (unsigned char *)calloc(num_tiles, 1);
+    carmen_test_alloc(utility_tiles);
+    utility_num_tiles = num_tiles;
+  }
+  memcpy(utility_tiles, tiles, num_tiles);
+  corridor_tile_size = tile_size;
+  corridor_y_tiles = y_tiles;
+}
+
+/* Computes the utility function to the goal, only in the tiles given
+   if there are any.  A path in them costs at most MAX_FREE_COST per
+   cell, more than MAX_UTILITY in a long enough corridor, so the goal's
+   utility is raised to keep all others positive. */
+static void
+compute_utility(int goal_x, int goal_y, unsigned char *tiles, int num_tiles) 
+{
   double max_val, min_val;
   int num_expanded;
   int done;
@@ -523,11 +847,11 @@ carmen_conventional_dynamic_program(int goal_x, int goal_y)
   if (utility == NULL) {
     utility = (double *)calloc(x_size*y_size, sizeof(double));
     carmen_test_alloc(utility);
+    utility_is_partial = 0;
   }
   
-  utility_ptr = utility;
-  for (index = 0; index < x_size * y_size; index++) 
-    *(utility_ptr++) = -1;
+  clear_utility(utility_is_partial, tiles);
+  utility_is_partial = (tiles != NULL);
 
   if (is_out_of_map(goal_x, goal_y))
     return;
@@ -538,8 +862,12 @@ carmen_conventional_dynamic_program(int goal_x, int goal_y)
 
   state_queue = make_queue();
 
+  corridor = tiles;
   current_state = carmen_conventional_create_state(goal_x, goal_y, 0);
   max_val = MAX_UTILITY;
+  if (tiles != NULL)
+    max_val = carmen_fmax(MAX_UTILITY, MAX_FREE_COST*num_tiles*
+			  corridor_tile_size*corridor_tile_size + 1);
   *(utility_value(goal_x, goal_y)) = max_val;
   add_neighbours_to_queue(goal_x, goal_y, state_queue);    
   num_expanded = 1;
@@ -554,6 +882,7 @@ carmen_conventional_dynamic_program(int goal_x, int goal_y)
   }
 
   delete_queue(&state_queue);
+  corridor = NULL;
 
   gettimeofday(&end_time, NULL);
 
@@ -567,6 +896,125 @@ carmen_conventional_dynamic_program(int goal_x, int goal_y)
   //  carmen_warn("Elasped time for dp: %d secs, %d usecs\n", delta_sec, delta_usec);
 }
 
+static void
+load_cached_utility(cached_utility_t *entry)
+{
+  if (utility == NULL) {
+    utility = (double *)calloc(x_size*y_size, sizeof(double));
+    carmen_test_alloc(utility);
+  }
+  memcpy(utility, entry->utility, x_size*y_size*sizeof(double));
+  utility_is_partial = 0;
+}
+
+void 
+carmen_conventional_dynamic_program(int goal_x, int goal_y) 
+{
+  cached_utility_t *entry;
+
+  if (costs == NULL)
+    return;
+
+  if (costs_modified || is_out_of_map(goal_x, goal_y)) {
+    compute_utility(goal_x, goal_y, NULL, 0);
+    return;
+  }
+
+  entry = find_cached_utility(goal_x, goal_y);
+  if (entry != NULL) {
+    load_cached_utility(entry);
+    return;
+  }
+
+  compute_utility(goal_x, goal_y, NULL, 0);
+  entry = new_cached_utility(goal_x, goal_y);
+  if (entry != NULL)
+    memcpy(entry->utility, utility, x_size*y_size*sizeof(double));
+}
+
+void
+carmen_conventional_corridor_program(int goal_x, int goal_y, 
+				     int start_x, int start_y)
+{
+  unsigned char *tiles;
+  int num_tiles;
+
+  if (costs == NULL)
+    return;
+
+  tiles = NULL;
+  if (carmen_hierarchy_tile_size() > 0 && !is_out_of_map(goal_x, goal_y) &&
+      !is_out_of_map(start_x, start_y))
+    tiles = carmen_hierarchy_find_corridor(start_x, start_y, goal_x, goal_y,
+					   &num_tiles);
+  if (tiles == NULL) {
+    carmen_conventional_dynamic_program(goal_x, goal_y);
+    return;
+  }
+
+  compute_utility(goal_x, goal_y, tiles, num_tiles);
+}
+
+int
+carmen_conventional_utility_covers(int x, int y)
+{
+  if (utility == NULL || is_out_of_map(x, y))
+    return 0;
+  if (!utility_is_partial)
+    return 1;
+  return utility_tiles[(x/corridor_tile_size)*corridor_y_tiles + 
+		       y/corridor_tile_size];
+}
+
+int
+carmen_conventional_cached_utility(int goal_x, int goal_y)
+{
+  cached_utility_t *entry;
+
+  if (costs == NULL || is_out_of_map(goal_x, goal_y))
+    return 0;
+
+  entry = find_cached_utility(goal_x, goal_y);
+  if (entry == NULL)
+    return 0;
+  load_cached_utility(entry);
+  return 1;
+}
+
+int
+carmen_conventional_cache_utility(int goal_x, int goal_y)
+{
+  cached_utility_t *entry;
+  double *current_costs, *current_utility;
+  int current_is_partial;
+
+  if (costs == NULL || is_out_of_map(goal_x, goal_y) ||
+      (costs_modified && base_costs == NULL))
+    return 0;
+
+  if (find_cached_utility(goal_x, goal_y) != NULL)
+    return 0;
+  entry = new_cached_utility(goal_x, goal_y);
+  if (entry == NULL)
+    return 0;
+
+  /* run the dynamic program on the unmodified costs, into the cache;
+     a new or reused entry may hold anything, so it is cleared whole */
+  current_costs = costs;
+  current_utility = utility;
+  current_is_partial = utility_is_partial;
+  if (costs_modified)
+    costs = base_costs;
+  utility = entry->utility;
+  utility_is_partial = 0;
+  compute_utility(goal_x, goal_y, NULL, 0);
+  costs = current_costs;
+  utility = current_utility;
+  utility_is_partial = current_is_partial;
+
+  return 1;
+}
+
 void 
 carmen_conventional_find_best_action(carmen_map_point_p curpoint) 
 {
@@ -611,6 +1059,12 @@ carmen_conventional_end_planner(void)
     free(costs);
   if (utility != NULL)
     free(utility);
-  
+  flush_utility_cache();
+  free(base_costs);
+  free(utility_cache);
+  free(utility_tiles);
+  utility_tiles = NULL;
+  utility_num_tiles = 0;
+  carmen_hierarchy_free();
 }
 
@@ -44,10 +44,47 @@
 extern "C" {
 #endif
 
+  /** The moves to the neighbouring cells, in
+      carmen_planner_x_offset and carmen_planner_y_offset.  The even
+      ones are the four the utility function is computed along. **/
+#define NUM_ACTIONS 8
+
+  extern int carmen_planner_x_offset[NUM_ACTIONS];
+  extern int carmen_planner_y_offset[NUM_ACTIONS];
+
+  /** The least cost of a cell.  How much to reduce the cost per
+      meter.  Kind of arbitrary, but related to MAX_UTILITY. **/
+#define MIN_COST 0.1
+  /** Cells that cost more are not planned through. **/
+#define MAX_FREE_COST 0.5
+
   /** Computes the utility function using dynamic programming. 
       carmen_conventional_build_costs must have been
       called first. **/ 
   void carmen_conventional_dynamic_program(int goal_x, int goal_y);
+  /** Like carmen_conventional_dynamic_program, but with planning tiles
+      set (see hierarchy.h), computes the utility function only in the
+      tiles a coarse plan from the start cell to the goal goes through,
+      and leaves it -1 elsewhere.  Without tiles, or if they give no
+      path, the utility function is computed on the whole map. **/ 
+  void carmen_conventional_corridor_program(int goal_x, int goal_y,
+					    int start_x, int start_y);
+  /** Returns 1 if the utility function was computed at this cell,
+      that is, on the whole map or in a tile of the corridor, even if
+      the cell itself cannot be planned through. **/ 
+  int carmen_conventional_utility_covers(int x, int y);
+  /** Keeps up to this many megabytes of utility functions computed on
+      the map without local modifications, so that planning to the same
+      goal on it again is a copy.  0, the default, keeps none. **/ 
+  void carmen_conventional_set_utility_cache(int megabytes);
+  /** Makes the utility function the one kept for this goal, which was
+      computed on the map without local modifications.  Returns 0 if
+      there is none. **/ 
+  int carmen_conventional_cached_utility(int goal_x, int goal_y);
+  /** Computes and keeps the utility function for this goal on the map
+      without local modifications, leaving the current one alone.
+      Returns 0 if it was kept already or cannot be. **/ 
+  int carmen_conventional_cache_utility(int goal_x, int goal_y);
   /** Takes in the current position (as a map grid cell) and replaces
       the argument with the best neighbour grid cell to visit
       next. carmen_conventional_dynamic_program must have been
@@ -72,6 +109,12 @@ extern "C" {
   void carmen_conventional_build_costs(carmen_robot_config_t *robot_conf,
 				       carmen_map_point_t *robot_posn,
 				       carmen_navigator_config_t *navigator_conf);
+  /** Updates the cost map after the map cells from (x_start, y_start)
+      up to, but not including, (x_end, y_end) have changed.  Only the
+      costs those cells can affect are recomputed. **/ 
+  void carmen_conventional_update_costs(carmen_robot_config_t *robot_conf,
+					int x_start, int y_start,
+					int x_end, int y_end);
 
 #ifdef __cplusplus
 }
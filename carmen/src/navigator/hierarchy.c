@@ -0,0 +1,675 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation; 
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more 
+ * details.
+ *
+ * You should have received a copy of the GNU General 
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, 
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+#include <carmen/carmen.h>
+
+#include "navigator.h"
+#include "conventional.h"
+#include "hierarchy.h"
+
+extern carmen_map_t * carmen_planner_map;
+
+/* The sides of a tile: towards x-1, x+1, y-1 and y+1.  The opposite
+   side is side^1. */
+#define NUM_SIDES 4
+
+/* The portals of a tile, side by side: those on side s are first[s]
+   up to first[s+1].  A tile and its neighbour find the portals on
+   their common border in the same order, so the k-th one on a side of
+   a tile leads to the k-th one on the opposite side of the
+   neighbour. */
+typedef struct {
+  int first[NUM_SIDES+1];
+  int *x, *y;
+  double *distance;
+  int capacity;
+  int dirty;
+} tile_t;
+
+typedef struct {
+  double *key;
+  int *value;
+  int length, capacity;
+} heap_t;
+
+static int tile_size = 0;
+static int x_size = 0, y_size = 0;
+static int x_tiles = 0, y_tiles = 0;
+static tile_t *tiles = NULL;
+static int num_dirty = 0;
+
+/* cheapest ways from one cell within a tile */
+static double *cell_distance = NULL;
+static heap_t cell_heap;
+
+/* the search over portals */
+static int *node_offset = NULL;
+static int *node_tile = NULL;
+static double *node_cost = NULL;
+static int *node_parent = NULL;
+static unsigned char *node_closed = NULL;
+static int node_capacity = 0;
+static double *goal_distance = NULL;
+static int goal_distance_capacity = 0;
+static heap_t node_heap;
+static unsigned char *corridor = NULL;
+
+static void
+heap_push(heap_t *heap, double key, int value)
+{
+  int index, parent;
+
+  if (heap->length == heap->capacity) {
+    heap->capacity = (heap->capacity == 0 ? 256 : 2*heap->capacity);
+    heap->key = (double *)realloc(heap->key, heap->capacity*sizeof(double));
+    carmen_test_alloc(heap->key);
+    heap->value = (int *)realloc(heap->value, heap->capacity*sizeof(int));
+    carmen_test_alloc(heap->value);
+  }
+
+  index = heap->length++;
+  while (index > 0) {
+    parent = (index-1)/2;
+    if (heap->key[parent] <= key)
+      break;
+    heap->key[index] = heap->key[parent];
+    heap->value[index] = heap->value[parent];
+    index = parent;
+  }
+  heap->key[index] = key;
+  heap->value[index] = value;
+}
+
+/* The value with the least key, -1 if the heap is empty */
+static int
+heap_pop(heap_t *heap, double *key)
+{
+  int index, child, value;
+  double last_key;
+
+  if (heap->length == 0)
+    return -1;
+
+  value = heap->value[0];
+  *key = heap->key[0];
+  heap->length--;
+  last_key = heap->key[heap->length];
+
+  index = 0;
+  while ((child = 2*index+1) < heap->length) {
+    if (child+1 < heap->length && heap->key[child+1] < heap->key[child])
+      child++;
+    if (last_key <= heap->key[child])
+      break;
+    heap->key[index] = heap->key[child];
+    heap->value[index] = heap->value[child];
+    index = child;
+  }
+  heap->key[index] = last_key;
+  heap->value[index] = heap->value[heap->length];
+
+  return value;
+}
+
+static void
+free_heap(heap_t *heap)
+{
+  free(heap->key);
+  free(heap->value);
+  memset(heap, 0, sizeof(heap_t));
+}
+
+carmen_inline static double
+cell_cost(double *costs, int x, int y)
+{
+  return costs[x*y_size+y];
+}
+
+carmen_inline static int
+num_nodes(tile_t *tile)
+{
+  return tile->first[NUM_SIDES];
+}
+
+static void
+free_tiles(void)
+{
+  int index;
+
+  for (index = 0; index < x_tiles*y_tiles; index++) {
+    free(tiles[index].x);
+    free(tiles[index].y);
+    free(tiles[index].distance);
+  }
+  free(tiles);
+  tiles = NULL;
+  x_tiles = y_tiles = 0;
+  free(node_offset);
+  node_offset = NULL;
+  num_dirty = 0;
+}
+
+/* Makes the tiles fit the map, all of them to be built if they did
+   not yet. */
+static int
+fit_tiles(void)
+{
+  int index;
+
+  if (tile_size == 0 || carmen_planner_map == NULL)
+    return 0;
+
+  if (tiles != NULL && x_size == carmen_planner_map->config.x_size &&
+      y_size == carmen_planner_map->config.y_size)
+    return 1;
+
+  free_tiles();
+  x_size = carmen_planner_map->config.x_size;
+  y_size = carmen_planner_map->config.y_size;
+  x_tiles = (x_size + tile_size - 1) / tile_size;
+  y_tiles = (y_size + tile_size - 1) / tile_size;
+
+  tiles = (tile_t *)calloc(x_tiles*y_tiles, sizeof(tile_t));
+  carmen_test_alloc(tiles);
+  for (index = 0; index < x_tiles*y_tiles; index++)
+    tiles[index].dirty = 1;
+  num_dirty = x_tiles*y_tiles;
+
+  free(corridor);
+  corridor = (unsigned char *)calloc(x_tiles*y_tiles, 1);
+  carmen_test_alloc(corridor);
+
+  return 1;
+}
+
+/* Fills cell_distance with the cheapest ways from the cell to the
+   others of the tile, staying in it: the costs of the cells entered,
+   4-connected, as the utility function adds them up.  -1 where there
+   is no way. */
+static void
+search_tile(double *costs, int tile_x, int tile_y, int x, int y)
+{
+  int x_start = tile_x*tile_size, y_start = tile_y*tile_size;
+  int x_end = carmen_imin(x_start + tile_size, x_size);
+  int y_end = carmen_imin(y_start + tile_size, y_size);
+  int index, cell, next_x, next_y, next;
+  double distance, next_distance;
+
+  for (index = 0; index < tile_size*tile_size; index++)
+    cell_distance[index] = -1;
+
+  cell = (x-x_start)*tile_size + y-y_start;
+  cell_distance[cell] = 0;
+  cell_heap.length = 0;
+  heap_push(&cell_heap, 0, cell);
+
+  while ((cell = heap_pop(&cell_heap, &distance)) >= 0) {
+    if (distance > cell_distance[cell])
+      continue;
+    x = x_start + cell/tile_size;
+    y = y_start + cell%tile_size;
+    for (index = 0; index < NUM_ACTIONS; index += 2) {
+      next_x = x + carmen_planner_x_offset[index];
+      next_y = y + carmen_planner_y_offset[index];
+      if (next_x < x_start || next_x >= x_end ||
+	  next_y < y_start || next_y >= y_end ||
+	  cell_cost(costs, next_x, next_y) > MAX_FREE_COST)
+	continue;
+      next = (next_x-x_start)*tile_size + next_y-y_start;
+      next_distance = distance + cell_cost(costs, next_x, next_y);
+      if (cell_distance[next] < 0 || next_distance < cell_distance[next]) {
+	cell_distance[next] = next_distance;
+	heap_push(&cell_heap, next_distance, next);
+      }
+    }
+  }
+}
+
+carmen_inline static double
+tile_distance(int tile_x, int tile_y, int x, int y)
+{
+  return cell_distance[(x-tile_x*tile_size)*tile_size + y-tile_y*tile_size];
+}
+
+static void
+add_node(tile_t *tile, int node, int x, int y)
+{
+  if (node == tile->capacity) {
+    tile->capacity = carmen_imax(8, 2*tile->capacity);
+    tile->x = (int *)realloc(tile->x, tile->capacity*sizeof(int));
+    carmen_test_alloc(tile->x);
+    tile->y = (int *)realloc(tile->y, tile->capacity*sizeof(int));
+    carmen_test_alloc(tile->y);
+  }
+  tile->x[node] = x;
+  tile->y[node] = y;
+}
+
+/* Adds a portal for every run of free cells along the side whose
+   neighbours across it are free too: the pair of the run that costs
+   least, nearest its middle if several do.  The neighbour looking
+   back across the same border picks the same pairs. */
+static int
+find_portals(double *costs, tile_t *tile, int tile_x, int tile_y,
+	     int side, int node)
+{
+  int x_start = tile_x*tile_size, y_start = tile_y*tile_size;
+  int x_end = carmen_imin(x_start + tile_size, x_size);
+  int y_end = carmen_imin(y_start + tile_size, y_size);
+  int along_start, along_end, across, beyond, along, run_start, best;
+  int x, y, best_offset, offset, open;
+  double cost, best_cost = 0;
+
+  switch (side) {
+  case 0:
+    across = x_start;
+    beyond = x_start-1;
+    break;
+  case 1:
+    across = x_end-1;
+    beyond = x_end;
+    break;
+  case 2:
+    across = y_start;
+    beyond = y_start-1;
+    break;
+  default:
+    across = y_end-1;
+    beyond = y_end;
+    break;
+  }
+  if (side < 2) {
+    along_start = y_start;
+    along_end = y_end;
+    if (beyond < 0 || beyond >= x_size)
+      return node;
+  } else {
+    along_start = x_start;
+    along_end = x_end;
+    if (beyond < 0 || beyond >= y_size)
+      return node;
+  }
+
+  run_start = -1;
+  best_offset = 0;
+  for (along = along_start; along <= along_end; along++) {
+    open = 0;
+    if (along < along_end) {
+      if (side < 2)
+	open = (cell_cost(costs, across, along) <= MAX_FREE_COST &&
+		cell_cost(costs, beyond, along) <= MAX_FREE_COST);
+      else
+	open = (cell_cost(costs, along, across) <= MAX_FREE_COST &&
+		cell_cost(costs, along, beyond) <= MAX_FREE_COST);
+    }
+    if (open) {
+      if (run_start < 0)
+	run_start = along;
+      continue;
+    }
+    if (run_start < 0)
+      continue;
+
+    /* the run is over: of the cheapest pairs, take the one nearest the
+       middle */
+    best = -1;
+    for (offset = run_start; offset < along; offset++) {
+      if (side < 2)
+	cost = cell_cost(costs, across, offset) +
+	  cell_cost(costs, beyond, offset);
+      else
+	cost = cell_cost(costs, offset, across) +
+	  cell_cost(costs, offset, beyond);
+      if (best < 0 || cost < best_cost ||
+	  (cost == best_cost &&
+	   abs(2*offset - run_start - along + 1) < best_offset)) {
+	best = offset;
+	best_cost = cost;
+	best_offset = abs(2*offset - run_start - along + 1);
+      }
+    }
+    if (side < 2) {
+      x = across;
+      y = best;
+    } else {
+      x = best;
+      y = across;
+    }
+    add_node(tile, node++, x, y);
+    run_start = -1;
+  }
+
+  return node;
+}
+
+/* Finds the portals of the tile and the cheapest ways between them */
+static void
+build_tile(double *costs, int tile_x, int tile_y)
+{
+  tile_t *tile = tiles + tile_x*y_tiles + tile_y;
+  int side, node, from, to, n;
+
+  node = 0;
+  for (side = 0; side < NUM_SIDES; side++) {
+    tile->first[side] = node;
+    node = find_portals(costs, tile, tile_x, tile_y, side, node);
+  }
+  tile->first[NUM_SIDES] = node;
+  n = node;
+
+  free(tile->distance);
+  tile->distance = NULL;
+  if (n > 0) {
+    tile->distance = (double *)calloc(n*n, sizeof(double));
+    carmen_test_alloc(tile->distance);
+  }
+  for (from = 0; from < n; from++) {
+    search_tile(costs, tile_x, tile_y, tile->x[from], tile->y[from]);
+    for (to = 0; to < n; to++)
+      tile->distance[from*n+to] =
+	tile_distance(tile_x, tile_y, tile->x[to], tile->y[to]);
+  }
+
+  tile->dirty = 0;
+}
+
+static void
+build_dirty_tiles(double *costs)
+{
+  double start_time;
+  int tile_x, tile_y, num_built;
+
+  if (num_dirty == 0)
+    return;
+
+  start_time = carmen_get_time();
+  num_built = 0;
+  for (tile_x = 0; tile_x < x_tiles; tile_x++)
+    for (tile_y = 0; tile_y < y_tiles; tile_y++)
+      if (tiles[tile_x*y_tiles+tile_y].dirty) {
+	build_tile(costs, tile_x, tile_y);
+	num_built++;
+      }
+  num_dirty = 0;
+
+  carmen_verbose("Built %d of %d planning tiles in %.3f s\n", num_built,
+		 x_tiles*y_tiles, carmen_get_time() - start_time);
+}
+
+void
+carmen_hierarchy_set_tile_size(int cells)
+{
+  cells = carmen_imax(0, cells);
+  if (cells == tile_size)
+    return;
+
+  carmen_hierarchy_free();
+  tile_size = cells;
+  if (tile_size == 0)
+    return;
+
+  cell_distance = (double *)calloc(tile_size*tile_size, sizeof(double));
+  carmen_test_alloc(cell_distance);
+}
+
+int
+carmen_hierarchy_tile_size(void)
+{
+  return tile_size;
+}
+
+void
+carmen_hierarchy_costs_changed(int x_start, int y_start, int x_end, int y_end)
+{
+  int tile_x, tile_y, tile_x_end, tile_y_end;
+  tile_t *tile;
+
+  if (tiles == NULL || x_size != carmen_planner_map->config.x_size ||
+      y_size != carmen_planner_map->config.y_size)
+    return;
+
+  /* a changed cell also changes the portals across the border it is on */
+  x_start = carmen_clamp(0, x_start-1, x_size);
+  y_start = carmen_clamp(0, y_start-1, y_size);
+  x_end = carmen_clamp(0, x_end+1, x_size);
+  y_end = carmen_clamp(0, y_end+1, y_size);
+  if (x_start >= x_end || y_start >= y_end)
+    return;
+
+  tile_x_end = (x_end-1)/tile_size;
+  tile_y_end = (y_end-1)/tile_size;
+  for (tile_x = x_start/tile_size; tile_x <= tile_x_end; tile_x++)
+    for (tile_y = y_start/tile_size; tile_y <= tile_y_end; tile_y++) {
+      tile = tiles + tile_x*y_tiles + tile_y;
+      if (!tile->dirty) {
+	tile->dirty = 1;
+	num_dirty++;
+      }
+    }
+}
+
+static void
+fit_nodes(void)
+{
+  int index, num, tile;
+
+  if (node_offset == NULL) {
+    node_offset = (int *)calloc(x_tiles*y_tiles+1, sizeof(int));
+    carmen_test_alloc(node_offset);
+  }
+
+  num = 0;
+  for (tile = 0; tile < x_tiles*y_tiles; tile++) {
+    node_offset[tile] = num;
+    num += num_nodes(tiles+tile);
+  }
+  node_offset[x_tiles*y_tiles] = num;
+
+  /* one more for the goal */
+  if (num+1 > node_capacity) {
+    node_capacity = num+1;
+    free(node_tile);
+    free(node_cost);
+    free(node_parent);
+    free(node_closed);
+    node_tile = (int *)calloc(node_capacity, sizeof(int));
+    carmen_test_alloc(node_tile);
+    node_cost = (double *)calloc(node_capacity, sizeof(double));
+    carmen_test_alloc(node_cost);
+    node_parent = (int *)calloc(node_capacity, sizeof(int));
+    carmen_test_alloc(node_parent);
+    node_closed = (unsigned char *)calloc(node_capacity, 1);
+    carmen_test_alloc(node_closed);
+  }
+
+  for (tile = 0; tile < x_tiles*y_tiles; tile++)
+    for (index = node_offset[tile]; index < node_offset[tile+1]; index++)
+      node_tile[index] = tile;
+  node_tile[num] = -1;
+  for (index = 0; index <= num; index++) {
+    node_cost[index] = -1;
+    node_parent[index] = -1;
+  }
+  memset(node_closed, 0, num+1);
+}
+
+carmen_inline static void
+reach_node(int node, double cost, int parent, double estimate)
+{
+  if (node_closed[node] || (node_cost[node] >= 0 && node_cost[node] <= cost))
+    return;
+  node_cost[node] = cost;
+  node_parent[node] = parent;
+  heap_push(&node_heap, cost + estimate, node);
+}
+
+/* Searches from the start over the portals: within a tile along the
+   cheapest ways kept, across a border into the cell beyond, and from
+   the tile of the goal to it.  The Manhattan distance to the goal at
+   the least cost of a cell never overestimates what is left, so the
+   first time the goal comes off the heap its cost is the least. */
+unsigned char *
+carmen_hierarchy_find_corridor(int start_x, int start_y,
+			       int goal_x, int goal_y, int *num_tiles)
+{
+  double *costs = carmen_conventional_get_costs_ptr();
+  int start_tile_x, start_tile_y, goal_tile_x, goal_tile_y;
+  int start_tile, goal_tile, goal_node, node, tile_index, next, n, k, side;
+  int next_tile_x, next_tile_y;
+  tile_t *tile, *next_tile;
+  double cost, key;
+
+  if (costs == NULL || !fit_tiles() ||
+      start_x < 0 || start_x >= x_size || start_y < 0 || start_y >= y_size ||
+      goal_x < 0 || goal_x >= x_size || goal_y < 0 || goal_y >= y_size)
+    return NULL;
+
+  build_dirty_tiles(costs);
+  fit_nodes();
+
+  start_tile_x = start_x/tile_size;
+  start_tile_y = start_y/tile_size;
+  start_tile = start_tile_x*y_tiles + start_tile_y;
+  goal_tile_x = goal_x/tile_size;
+  goal_tile_y = goal_y/tile_size;
+  goal_tile = goal_tile_x*y_tiles + goal_tile_y;
+  goal_node = node_offset[x_tiles*y_tiles];
+
+  /* from the portals of the goal's tile to the goal: the way back,
+     less the cost of the portal and plus that of the goal */
+  tile = tiles + goal_tile;
+  n = num_nodes(tile);
+  if (n > goal_distance_capacity) {
+    goal_distance_capacity = n;
+    free(goal_distance);
+    goal_distance = (double *)calloc(n, sizeof(double));
+    carmen_test_alloc(goal_distance);
+  }
+  search_tile(costs, goal_tile_x, goal_tile_y, goal_x, goal_y);
+  for (k = 0; k < n; k++) {
+    cost = tile_distance(goal_tile_x, goal_tile_y, tile->x[k], tile->y[k]);
+    if (cost >= 0)
+      cost += cell_cost(costs, goal_x, goal_y) -
+	cell_cost(costs, tile->x[k], tile->y[k]);
+    goal_distance[k] = cost;
+  }
+
+  node_heap.length = 0;
+  search_tile(costs, start_tile_x, start_tile_y, start_x, start_y);
+  tile = tiles + start_tile;
+  for (k = 0; k < num_nodes(tile); k++) {
+    cost = tile_distance(start_tile_x, start_tile_y, tile->x[k], tile->y[k]);
+    if (cost >= 0)
+      reach_node(node_offset[start_tile]+k, cost, -1, MIN_COST*
+		 (abs(tile->x[k]-goal_x) + abs(tile->y[k]-goal_y)));
+  }
+  if (start_tile == goal_tile) {
+    cost = tile_distance(start_tile_x, start_tile_y, goal_x, goal_y);
+    if (cost >= 0)
+      reach_node(goal_node, cost, -1, 0);
+  }
+
+  while ((node = heap_pop(&node_heap, &key)) >= 0) {
+    if (node_closed[node])
+      continue;
+    node_closed[node] = 1;
+    if (node == goal_node)
+      break;
+
+    tile_index = node_tile[node];
+    tile = tiles + tile_index;
+    n = num_nodes(tile);
+    k = node - node_offset[tile_index];
+
+    for (next = 0; next < n; next++) {
+      cost = tile->distance[k*n+next];
+      if (next != k && cost >= 0)
+	reach_node(node_offset[tile_index]+next, node_cost[node] + cost, node,
+		   MIN_COST*(abs(tile->x[next]-goal_x) +
+			     abs(tile->y[next]-goal_y)));
+    }
+
+    if (tile_index == goal_tile && goal_distance[k] >= 0)
+      reach_node(goal_node, node_cost[node] + goal_distance[k], node, 0);
+
+    /* across the border */
+    for (side = 0; side < NUM_SIDES && k >= tile->first[side+1]; side++)
+      ;
+    next_tile_x = tile_index/y_tiles + (side == 0 ? -1 : side == 1 ? 1 : 0);
+    next_tile_y = tile_index%y_tiles + (side == 2 ? -1 : side == 3 ? 1 : 0);
+    next_tile = tiles + next_tile_x*y_tiles + next_tile_y;
+    next = k - tile->first[side] + next_tile->first[side^1];
+    if (next >= next_tile->first[(side^1)+1])
+      continue;
+    reach_node(node_offset[next_tile_x*y_tiles + next_tile_y] + next,
+	       node_cost[node] + cell_cost(costs, next_tile->x[next],
+					   next_tile->y[next]), node,
+	       MIN_COST*(abs(next_tile->x[next]-goal_x) +
+			 abs(next_tile->y[next]-goal_y)));
+  }
+
+  if (!node_closed[goal_node])
+    return NULL;
+
+  memset(corridor, 0, x_tiles*y_tiles);
+  corridor[start_tile] = 1;
+  corridor[goal_tile] = 1;
+  for (node = node_parent[goal_node]; node >= 0; node = node_parent[node])
+    corridor[node_tile[node]] = 1;
+
+  *num_tiles = 0;
+  for (tile_index = 0; tile_index < x_tiles*y_tiles; tile_index++)
+    *num_tiles += corridor[tile_index];
+
+  return corridor;
+}
+
+void
+carmen_hierarchy_free(void)
+{
+  free_tiles();
+  free(cell_distance);
+  cell_distance = NULL;
+  free_heap(&cell_heap);
+  free_heap(&node_heap);
+  free(node_tile);
+  node_tile = NULL;
+  free(node_cost);
+  node_cost = NULL;
+  free(node_parent);
+  node_parent = NULL;
+  free(node_closed);
+  node_closed = NULL;
+  node_capacity = 0;
+  free(goal_distance);
+  goal_distance = NULL;
+  goal_distance_capacity = 0;
+  free(corridor);
+  corridor = NULL;
+  tile_size = 0;
+}
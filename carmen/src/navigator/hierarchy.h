@@ -0,0 +1,76 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation; 
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more 
+ * details.
+ *
+ * You should have received a copy of the GNU General 
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, 
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/** @addtogroup navigator libconventional **/
+// @{
+
+/**
+ * \file hierarchy.h
+ * \brief Coarse planning over tiles of the cost map.
+ *
+ * The cost map is cut into square tiles.  Where two tiles share free
+ * cells along their border, one pair of them is a portal between the
+ * tiles, and the cheapest way between any two portals of a tile is
+ * kept.  Planning over portals finds the tiles a path to the goal has
+ * to go through, and only those are planned over cell by cell.
+ **/
+
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /** Plans over tiles of this many cells a side first.  0, the
+      default, turns the tiles off. **/
+  void carmen_hierarchy_set_tile_size(int cells);
+  /** Returns the tile size, 0 if there are no tiles. **/
+  int carmen_hierarchy_tile_size(void);
+  /** Tells the tiles that the costs from (x_start, y_start) up to, but
+      not including, (x_end, y_end) have changed.  The tiles they touch
+      are built again before the next plan. **/
+  void carmen_hierarchy_costs_changed(int x_start, int y_start,
+				      int x_end, int y_end);
+  /** Plans from the start cell to the goal cell over the tiles.
+      Returns for every tile, in row-major order, whether the path goes
+      through it, and the number of such tiles in num_tiles, or NULL if
+      the tiles give no path.  The array is overwritten by the next
+      call. **/
+  unsigned char *carmen_hierarchy_find_corridor(int start_x, int start_y,
+						int goal_x, int goal_y,
+						int *num_tiles);
+  /** Frees memory structures. **/
+  void carmen_hierarchy_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+// @}
@@ -38,14 +38,22 @@
 
 typedef struct {
   int x, y;
-  double value;
 } grid_cell_t, *grid_cell_p;
 
+/* The cells each of the last LASER_HISTORY_LENGTH scans changed */
 static grid_cell_p *laser_scan;
 static int *scan_size;
 static int *max_scan_size;
 static int current_data_set = 0;
 
+/* For every cell, the number of the last scan that filled it and of the
+   last one that cleared it.  Scans drop out of the history oldest first,
+   so once the last scan that filled a cell is gone, so are all others
+   that did, and a cell's value follows from these two numbers alone. */
+static int *filled_at = NULL, *cleared_at = NULL;
+static int cells_x_size = 0, cells_y_size = 0;
+static int scan_number = 0;
+
 carmen_inline static int 
 is_empty(double value) 
 {
@@ -68,43 +76,40 @@ is_in_map(int x, int y, carmen_map_p map)
   return 1;
 }
 
-static int 
-point_exists(int x, int y, double value) 
+carmen_inline static int
+in_history(int scan)
 {
-  int num_points = scan_size[current_data_set];
-  grid_cell_p cell = laser_scan[current_data_set];
-  int index;
-
-  if (num_points == 0)
-    return 0;
-
-  for (index = num_points-1; index >= 0; index--) {
-    if (x == cell[index].x && y == cell[index].y &&
-	fabs(value - cell[index].value) < .01)
-      return 1;
-  }
-  
-  return 0;
+  return scan > 0 && scan > scan_number - LASER_HISTORY_LENGTH;
 }
 
-static void 
-add_filled_point(int x, int y, carmen_map_p true_map, carmen_map_p modify_map) 
+static void
+check_cell_history(carmen_map_p modify_map)
 {
-  int num_points;
-  grid_cell_p cell_list;
-  double value;
+  int index;
 
-  if (!is_in_map(x, y, modify_map))
+  if (cells_x_size == modify_map->config.x_size &&
+      cells_y_size == modify_map->config.y_size)
     return;
 
-  value = true_map->map[x][y];  
-  if (is_filled(value))
-    return;
+  free(filled_at);
+  free(cleared_at);
+  cells_x_size = modify_map->config.x_size;
+  cells_y_size = modify_map->config.y_size;
+  filled_at = (int *)calloc(cells_x_size*cells_y_size, sizeof(int));
+  carmen_test_alloc(filled_at);
+  cleared_at = (int *)calloc(cells_x_size*cells_y_size, sizeof(int));
+  carmen_test_alloc(cleared_at);
+
+  for (index = 0; index < LASER_HISTORY_LENGTH; index++)
+    scan_size[index] = 0;
+  scan_number = 0;
+}
 
-  /*   if (point_exists(x, y, FILLED)) */
-  /*     return; */
+static void 
+add_to_scan(int x, int y) 
+{
+  int num_points = scan_size[current_data_set];
 
-  num_points = scan_size[current_data_set];
   if (num_points == max_scan_size[current_data_set]) {
     max_scan_size[current_data_set] *= 2;
     laser_scan[current_data_set] = 
@@ -113,62 +118,93 @@ add_filled_point(int x, int y, carmen_map_p true_map, carmen_map_p modify_map)
     carmen_test_alloc(laser_scan[current_data_set]);
   }
 
-  cell_list = laser_scan[current_data_set];
-  value = FILLED;
-  /*      carmen_warn("Filling point %d (%d) %d %d\n", num_points, */
-  /*  	 current_data_set, x, y); */
-  cell_list[num_points].x = x;
-  cell_list[num_points].y = y;
-  cell_list[num_points].value = value;
+  laser_scan[current_data_set][num_points].x = x;
+  laser_scan[current_data_set][num_points].y = y;
   scan_size[current_data_set]++;
-  modify_map->map[x][y] = 2.0;
 }
 
+/* Sets the cell from its history: filled if a scan still in the history
+   filled it after (or in the same scan as) the last one that cleared
+   it, empty if it was cleared, and as in the true map otherwise. */
 static void 
-add_clear_point(int x, int y, carmen_map_p true_map, carmen_map_p modify_map) 
+update_cell(int x, int y, carmen_map_p true_map, carmen_map_p modify_map,
+	    map_modify_region_p changed, int *num_changed) 
 {
-  int num_points = scan_size[current_data_set];
-  grid_cell_p cell_list;
-  double value;
+  int index = x*cells_y_size + y;
+  int filled = in_history(filled_at[index]);
+  int cleared = in_history(cleared_at[index]);
+  float value;
+
+  if (filled && (!cleared || filled_at[index] >= cleared_at[index]))
+    value = FILLED;
+  else if (cleared)
+    value = EMPTY;
+  else
+    value = true_map->map[x][y];
+
+  if (modify_map->map[x][y] == value)
+    return;
+
+  modify_map->map[x][y] = value;
+  if (*num_changed == 0) {
+    changed->x_min = changed->x_max = x;
+    changed->y_min = changed->y_max = y;
+  } else {
+    changed->x_min = carmen_imin(changed->x_min, x);
+    changed->x_max = carmen_imax(changed->x_max, x);
+    changed->y_min = carmen_imin(changed->y_min, y);
+    changed->y_max = carmen_imax(changed->y_max, y);
+  }
+  (*num_changed)++;
+}
+
+static void 
+add_filled_point(int x, int y, carmen_map_p true_map, carmen_map_p modify_map,
+		 map_modify_region_p changed, int *num_changed) 
+{
+  int index;
 
   if (!is_in_map(x, y, modify_map))
     return;
 
-  value = true_map->map[x][y];
+  if (is_filled(true_map->map[x][y]))
+    return;
 
-  /*   if (is_empty(value))  */
-  /* 		return; */
-		
-  if (point_exists(x, y, EMPTY))
+  index = x*cells_y_size + y;
+  if (filled_at[index] == scan_number)
     return;
+  if (cleared_at[index] != scan_number)
+    add_to_scan(x, y);
+  filled_at[index] = scan_number;
+  update_cell(x, y, true_map, modify_map, changed, num_changed);
+}
 
-  if (num_points == max_scan_size[current_data_set]) {
-    max_scan_size[current_data_set] *= 2;
-    laser_scan[current_data_set] = 
-      realloc(laser_scan[current_data_set], 
-	      max_scan_size[current_data_set]*sizeof(grid_cell_t));
-    carmen_test_alloc(laser_scan[current_data_set]);
-  }
+static void 
+add_clear_point(int x, int y, carmen_map_p true_map, carmen_map_p modify_map,
+		map_modify_region_p changed, int *num_changed) 
+{
+  int index = x*cells_y_size + y;
 
-  cell_list = laser_scan[current_data_set];
-  value = EMPTY;
-  cell_list[num_points].x = x;
-  cell_list[num_points].y = y;
-  cell_list[num_points].value = value;
-  scan_size[current_data_set]++;
-  modify_map->map[x][y] = value;
+  if (cleared_at[index] == scan_number)
+    return;
+  if (filled_at[index] != scan_number)
+    add_to_scan(x, y);
+  cleared_at[index] = scan_number;
+  update_cell(x, y, true_map, modify_map, changed, num_changed);
 }
 
+/* Starts a new scan in place of the oldest one, and puts back the cells
+   only that one was still holding. */
 static void 
-update_existing_data(carmen_map_p true_map, carmen_map_p modify_map) 
+update_existing_data(carmen_map_p true_map, carmen_map_p modify_map,
+		     map_modify_region_p changed, int *num_changed) 
 {
   grid_cell_p cell;
   int num_changed_points;
   int index;
-  double value;
-  int list_index;
 
   current_data_set = (current_data_set+1) % LASER_HISTORY_LENGTH;
+  scan_number++;
   
   if (laser_scan[current_data_set] == NULL) {
     laser_scan[current_data_set] = 
@@ -179,36 +215,19 @@ update_existing_data(carmen_map_p true_map, carmen_map_p modify_map)
   }
 
   /* The oldest scan is erased here */
-  cell = laser_scan[current_data_set];
-
   num_changed_points = scan_size[current_data_set];
   cell = laser_scan[current_data_set];
   for (index = 0; index < num_changed_points; index++) {
-    value = true_map->map[cell->x][cell->y];
-    modify_map->map[cell->x][cell->y] = value;
+    update_cell(cell->x, cell->y, true_map, modify_map, changed, num_changed);
     cell++;
   }
   scan_size[current_data_set] = 0;
-
-  /* The other scans are recopied in here */
-
-  for (list_index = 0; list_index < LASER_HISTORY_LENGTH; list_index++) {
-    cell = laser_scan[list_index];
-    if (cell == NULL)
-      continue;
-    num_changed_points = scan_size[list_index];
-    for (index = 0; index < num_changed_points; index++) {
-      modify_map->map[cell->x][cell->y] = cell->value;
-      /*        carmen_warn("Filling point %d of %d in list %d: %d %d\n", index, */
-      /*  	   num_changed_points, list_index, cell->x, cell->y); */
-      cell++;
-    }
-  }
 }
 
 void 
 trace_laser(int x_1, int y_1, int x_2, int y_2, carmen_map_p true_map, 
-	    carmen_map_p modify_map) 
+	    carmen_map_p modify_map, map_modify_region_p changed, 
+	    int *num_changed) 
 {
   carmen_bresenham_param_t params;
   int X, Y;
@@ -225,34 +244,43 @@ trace_laser(int x_1, int y_1, int x_2, int y_2, carmen_map_p true_map,
     modified_map_value = modify_map->map[X][Y];
     
     if (!is_empty(modified_map_value)  &&   is_empty(true_map_value)) 
-      add_clear_point(X, Y, true_map, modify_map);
+      add_clear_point(X, Y, true_map, modify_map, changed, num_changed);
   } while (carmen_get_next_point(&params));
 }
 
-void 
+int 
 map_modify_update(carmen_robot_laser_message *laser_msg, 
 		  carmen_navigator_config_t *config,
 		  carmen_world_point_p world_point, 
 		  carmen_map_p true_map, 
-		  carmen_map_p modify_map) 
+		  carmen_map_p modify_map,
+		  map_modify_region_p changed) 
 {
   int index;
   double angle, separation;
+  double cos_angle, sin_angle;
   int laser_x, laser_y;
   double dist;
   int increment;
   carmen_map_point_t map_point;  
   int count;
+  map_modify_region_t region;
+  int num_changed = 0;
   
   int maxrange_beam;
 
+  if (changed == NULL)
+    changed = &region;
+  changed->x_min = changed->y_min = 0;
+  changed->x_max = changed->y_max = -1;
+
   if (!config->map_update_freespace &&  !config->map_update_obstacles)
-    return;
+    return 0;
 
   if (true_map == NULL || modify_map == NULL)
     {
       carmen_warn("%s called with NULL map argument.\n", __FUNCTION__);
-      return;
+      return 0;
     }
 
   if (laser_scan == NULL) {
@@ -266,7 +294,8 @@ map_modify_update(carmen_robot_laser_message *laser_msg,
     carmen_test_alloc(max_scan_size);
   }
 
-  update_existing_data(true_map, modify_map);
+  check_cell_history(modify_map);
+  update_existing_data(true_map, modify_map, changed, &num_changed);
 
   if (laser_msg->num_readings < config->num_lasers_to_use)   {
     increment = 1;
@@ -292,6 +321,9 @@ map_modify_update(carmen_robot_laser_message *laser_msg,
     else
       maxrange_beam = 1;
 
+    cos_angle = cos(angle);
+    sin_angle = sin(angle);
+
     if (config->map_update_freespace) {
 
       dist = laser_msg->range[index] - modify_map->config.resolution;
@@ -300,12 +332,13 @@ map_modify_update(carmen_robot_laser_message *laser_msg,
       if (dist > config->map_update_radius)
 	dist = config->map_update_radius;
       
-      laser_x = carmen_round(map_point.x + (cos(angle)*dist)/
+      laser_x = carmen_round(map_point.x + (cos_angle*dist)/
 			     modify_map->config.resolution);
-      laser_y = carmen_round(map_point.y + (sin(angle)*dist)/
+      laser_y = carmen_round(map_point.y + (sin_angle*dist)/
 			     modify_map->config.resolution);    
       
-      trace_laser(map_point.x, map_point.y, laser_x, laser_y, true_map, modify_map);
+      trace_laser(map_point.x, map_point.y, laser_x, laser_y, true_map, 
+		  modify_map, changed, &num_changed);
     }
 
     if (config->map_update_obstacles) {
@@ -316,21 +349,24 @@ map_modify_update(carmen_robot_laser_message *laser_msg,
 	dist = laser_msg->range[index];
 	
 	
-	laser_x = carmen_round(map_point.x + (cos(angle)*dist)/
+	laser_x = carmen_round(map_point.x + (cos_angle*dist)/
 			       modify_map->config.resolution);
-	laser_y = carmen_round(map_point.y + (sin(angle)*dist)/
+	laser_y = carmen_round(map_point.y + (sin_angle*dist)/
 			       modify_map->config.resolution);
 
 	if (is_in_map(laser_x, laser_y, modify_map) && 
 	    dist < config->map_update_radius &&
 	    dist < (laser_msg->config.maximum_range - 2*modify_map->config.resolution)) {
 	  count++;
-	  add_filled_point(laser_x, laser_y, true_map, modify_map);
+	  add_filled_point(laser_x, laser_y, true_map, modify_map, changed,
+			   &num_changed);
 	}
       }
     }
     angle += separation;
   }
+
+  return num_changed;
 }
 
 void 
@@ -343,6 +379,11 @@ map_modify_clear(carmen_map_p true_map, carmen_map_p modify_map)
 
   for (index = 0; index < LASER_HISTORY_LENGTH; index++)
     scan_size[index] = 0;
+  if (filled_at != NULL) {
+    memset(filled_at, 0, cells_x_size*cells_y_size*sizeof(int));
+    memset(cleared_at, 0, cells_x_size*cells_y_size*sizeof(int));
+  }
+  scan_number = 0;
 
   memcpy(modify_map->complete_map, true_map->complete_map, 
 	 true_map->config.x_size*true_map->config.y_size*sizeof(float));
@@ -35,10 +35,21 @@
 extern "C" {
 #endif
 
-  void map_modify_update(carmen_robot_laser_message *laser_msg, 
-			 carmen_navigator_config_t *navigator_config,
-			 carmen_world_point_p world_point, 
-			 carmen_map_p true_map, carmen_map_p modify_map);
+  /* The cells changed by an update, bounds included; empty if x_min is
+     greater than x_max */
+  typedef struct {
+    int x_min, y_min, x_max, y_max;
+  } map_modify_region_t, *map_modify_region_p;
+
+  /* Marks the obstacles and free space the scan shows in modify_map,
+     and forgets those seen in the scan that drops out of the history.
+     Returns 0 if no cell changed, and if changed is not NULL, fills in
+     a rectangle holding all cells that did. */
+  int map_modify_update(carmen_robot_laser_message *laser_msg, 
+			carmen_navigator_config_t *navigator_config,
+			carmen_world_point_p world_point, 
+			carmen_map_p true_map, carmen_map_p modify_map,
+			map_modify_region_p changed);
   void map_modify_clear(carmen_map_p true_map, carmen_map_p modify_map);
 
 #ifdef __cplusplus
@@ -40,6 +40,9 @@ static carmen_navigator_config_t nav_config;
 
 static int cheat = 0;
 static int autonomous_status = 0;
+static int utility_cache_size = 0;
+static int planning_tile_size = 0;
+static int next_place = 0;
 
 static carmen_traj_point_t robot_position;
 
@@ -356,6 +359,29 @@ map_update_handler(carmen_map_t *new_map)
   carmen_map_destroy(&nav_map);
   nav_map = carmen_map_copy(new_map);
   carmen_planner_set_map(nav_map, &robot_config);
+  next_place = 0;
+}
+
+/* Plans to the places of the map while the robot is not driving, one
+   per call, so that setting one of them as the goal later is
+   immediate. */
+static void 
+precompute_places_timer(void *clientdata __attribute__ ((unused)),
+			unsigned long currenttime __attribute__ ((unused)),
+			unsigned long scheduledTime __attribute__ ((unused)))
+{
+  carmen_point_t goal;
+
+  if (autonomous_status)
+    return;
+
+  while (next_place < placelist.num_places) {
+    goal.x = placelist.places[next_place].x;
+    goal.y = placelist.places[next_place].y;
+    next_place++;
+    if (carmen_planner_precompute_goal(&goal))
+      break;
+  }
 }
 
 static void 
@@ -417,7 +443,11 @@ read_parameters(int argc, char **argv)
     {"navigator", "dont_integrate_odometry", CARMEN_PARAM_ONOFF,
      &nav_config.dont_integrate_odometry, 1, NULL},
     {"navigator", "plan_to_nearest_free_point", CARMEN_PARAM_ONOFF,
-     &nav_config.plan_to_nearest_free_point, 1, NULL}
+     &nav_config.plan_to_nearest_free_point, 1, NULL},
+    {"navigator", "utility_cache_size", CARMEN_PARAM_INT, 
+     &utility_cache_size, 0, NULL},
+    {"navigator", "planning_tile_size", CARMEN_PARAM_INT, 
+     &planning_tile_size, 0, NULL}
   };
 
   num_items = sizeof(param_list)/sizeof(param_list[0]);
@@ -463,6 +493,8 @@ int main(int argc, char **argv)
   carmen_map_apply_offlimits_chunk_to_map(offlimits, num_offlimits_segments, 
 					  nav_map);
   carmen_map_get_placelist(&placelist);
+  carmen_planner_set_utility_cache(utility_cache_size);
+  carmen_planner_set_tile_size(planning_tile_size);
   carmen_planner_set_map(nav_map, &robot_config);
 
   if(!nav_config.dont_integrate_odometry)
@@ -496,6 +528,9 @@ int main(int argc, char **argv)
        CARMEN_SUBSCRIBE_LATEST);
   }
   
+  if (utility_cache_size > 0)
+    carmen_ipc_addPeriodicTimer(1.0, precompute_places_timer, NULL);
+
   if (carmen_param_get_string("init_goal", &goal_string, NULL) == 1) {
     sscanf(goal_string, "%d %d", &x, &y);
     carmen_navigator_goal(x, y);
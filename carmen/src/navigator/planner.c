@@ -31,11 +31,10 @@
 #include "planner_interface.h"
 #include "navigator.h"
 #include "conventional.h"
+#include "hierarchy.h"
 #include "trajectory.h"
 #include "map_modify.h"
 
-#define NUM_ACTIONS 8
-
 int carmen_planner_x_offset[NUM_ACTIONS] = {0, 1, 1, 1, 0, -1, -1, -1};
 int carmen_planner_y_offset[NUM_ACTIONS] = {-1, -1, 0, 1, 1, 1, 0, -1};
 
@@ -55,13 +54,144 @@ static carmen_planner_path_t path = {NULL, 0, 0};
 
 static int goal_set = 0;
 
+static double last_plan_time = 0;
+
+/* The path last extracted from the utility function, and how it was
+   smoothed.  As long as the utility function and the costs stay the
+   same, the descent from any cell of it follows the rest of it, and
+   smoothing on from any point it kept keeps the same points again, so
+   an update only has to redo the part between the robot and where its
+   path joins the last one.  cells[k] is the map cell of point k (the
+   robot's cell for k = 0), kept[k] the index of the point in the
+   smoothed path, or -1 if smoothing dropped it. */
+typedef struct {
+  carmen_map_point_p cells;
+  int *kept;
+  int length, capacity;
+  int smoothed;
+  carmen_planner_path_t smoothed_path;
+} planner_cells_t, *planner_cells_p;
+
+static planner_cells_t last_path, new_path;
+
+/* For every cell of the last path, its distance from the end of the
+   path plus one (which does not change when the front of the path
+   does), 0 for all other cells. */
+static int *cell_index = NULL;
+static int cell_index_x_size = 0, cell_index_y_size = 0;
+
+static void
+add_cell(carmen_map_point_p cell, planner_cells_p cells)
+{
+  if (cells->length == cells->capacity) {
+    cells->capacity = (cells->capacity == 0 ? 256 : 2*cells->capacity);
+    cells->cells = (carmen_map_point_p)
+      realloc(cells->cells, cells->capacity*sizeof(carmen_map_point_t));
+    carmen_test_alloc(cells->cells);
+    cells->kept = (int *)realloc(cells->kept, cells->capacity*sizeof(int));
+    carmen_test_alloc(cells->kept);
+  }
+  cells->cells[cells->length] = *cell;
+  cells->kept[cells->length] = -1;
+  cells->length++;
+}
+
+static void
+forget_last_path(void)
+{
+  carmen_map_point_p cell;
+  int k;
+
+  if (cell_index != NULL)
+    for (k = 0; k < last_path.length; k++) {
+      cell = last_path.cells+k;
+      cell_index[cell->x*cell_index_y_size + cell->y] = 0;
+    }
+  last_path.length = 0;
+  last_path.smoothed = 0;
+}
+
+/* Index of the cell in the last path, or -1 */
+static int
+last_path_index(carmen_map_point_p cell)
+{
+  int mark, k;
+
+  if (last_path.length == 0 || cell->x < 0 || cell->y < 0 ||
+      cell->x >= cell_index_x_size || cell->y >= cell_index_y_size)
+    return -1;
+  mark = cell_index[cell->x*cell_index_y_size + cell->y];
+  k = last_path.length - mark;
+  if (mark == 0 || k < 0 || last_path.cells[k].x != cell->x ||
+      last_path.cells[k].y != cell->y)
+    return -1;
+  return k;
+}
+
+/* Keeps the new path for the next update.  Only the cells in front of
+   where the two paths join change their marks. */
+static void
+remember_path(int join, int last_join, int smoothed)
+{
+  planner_cells_t swap;
+  carmen_map_point_p cell;
+  int k;
+
+  if (cell_index_x_size != carmen_planner_map->config.x_size ||
+      cell_index_y_size != carmen_planner_map->config.y_size) {
+    free(cell_index);
+    cell_index_x_size = carmen_planner_map->config.x_size;
+    cell_index_y_size = carmen_planner_map->config.y_size;
+    cell_index = (int *)calloc(cell_index_x_size*cell_index_y_size, 
+			       sizeof(int));
+    carmen_test_alloc(cell_index);
+    last_path.length = 0;
+    join = last_join = -1;
+  }
+
+  for (k = 0; k < (last_join >= 0 ? last_join+1 : last_path.length); k++) {
+    cell = last_path.cells+k;
+    cell_index[cell->x*cell_index_y_size + cell->y] = 0;
+  }
+  for (k = 0; k < (join >= 0 ? join+1 : new_path.length); k++) {
+    cell = new_path.cells+k;
+    if (cell->x >= 0 && cell->y >= 0 && cell->x < cell_index_x_size &&
+	cell->y < cell_index_y_size)
+      cell_index[cell->x*cell_index_y_size + cell->y] = new_path.length-k;
+  }
+
+  new_path.smoothed = smoothed;
+  if (smoothed) {
+    if (new_path.smoothed_path.capacity < path.length) {
+      new_path.smoothed_path.capacity = path.capacity;
+      new_path.smoothed_path.points = (carmen_traj_point_p)
+	realloc(new_path.smoothed_path.points, 
+		path.capacity*sizeof(carmen_traj_point_t));
+      carmen_test_alloc(new_path.smoothed_path.points);
+    }
+    memcpy(new_path.smoothed_path.points, path.points, 
+	   path.length*sizeof(carmen_traj_point_t));
+    new_path.smoothed_path.length = path.length;
+  }
+
+  swap = last_path;
+  last_path = new_path;
+  new_path = swap;
+}
+
+/* Follows the utility function from the robot to the goal.  Once the
+   descent reaches a cell of the last path, the rest is copied from it;
+   join and last_join are then the indices of that cell in the new and
+   in the last path, -1 otherwise. */
 static int 
-extract_path_from_value_function(void) 
+extract_path_from_value_function(int *join, int *last_join) 
 {
-  int position;
+  int k;
   carmen_traj_point_t path_point;
   carmen_map_point_t cur_point, prev_point, map_goal;
 
+  *join = *last_join = -1;
+
   if (!have_plan) 
     return -1;
   
@@ -69,6 +199,8 @@ extract_path_from_value_function(void)
   carmen_planner_util_add_path_point(robot, &path);
 
   carmen_trajectory_to_map(&robot, &cur_point, carmen_planner_map);
+  new_path.length = 0;
+  add_cell(&cur_point, &new_path);
 
   if (goal_is_accessible) {
     map_goal.x = carmen_round(requested_goal.x / 
@@ -88,35 +220,35 @@ extract_path_from_value_function(void)
     prev_point = cur_point;
     carmen_conventional_find_best_action(&cur_point);
     carmen_map_to_trajectory(&cur_point, &path_point);
-    position = carmen_planner_util_add_path_point(path_point, &path);
+    carmen_planner_util_add_path_point(path_point, &path);
+    add_cell(&cur_point, &new_path);
     if (cur_point.x == map_goal.x && cur_point.y == map_goal.y) 
       return 0;
+    *last_join = last_path_index(&cur_point);
+    if (*last_join >= 0) {
+      *join = new_path.length-1;
+      for (k = *last_join+1; k < last_path.length; k++) {
+	carmen_map_to_trajectory(last_path.cells+k, &path_point);
+	carmen_planner_util_add_path_point(path_point, &path);
+	add_cell(last_path.cells+k, &new_path);
+      }
+      return 0;
+    }
   } while (cur_point.x != prev_point.x || cur_point.y != prev_point.y);
 
   return -1;
 }
 
 static void
-compute_cost(int start_index, int end_index, double *cost_along_path, 
-	     double *min_cost)
+compute_cost(carmen_map_point_p p1, carmen_map_point_p p2, 
+	     double *cost_along_path, double *min_cost)
 {
-  carmen_traj_point_p start_point;
-  carmen_traj_point_p end_point;
-
-  carmen_map_point_t p1;
-  carmen_map_point_t p2;
-
   carmen_bresenham_param_t params;
 
   int x, y;
   double total_cost, cur_cost = 0;
 
-  start_point = carmen_planner_util_get_path_point(start_index, &path);
-  carmen_trajectory_to_map(start_point, &p1, carmen_planner_map);
-  end_point = carmen_planner_util_get_path_point(end_index, &path);
-  carmen_trajectory_to_map(end_point, &p2, carmen_planner_map);
-
-  carmen_get_bresenham_parameters(p1.x, p1.y, p2.x, p2.y, &params);
+  carmen_get_bresenham_parameters(p1->x, p1->y, p2->x, p2->y, &params);
   
   total_cost = 0;
   carmen_get_current_point(&params, &x, &y);
@@ -132,64 +264,79 @@ compute_cost(int start_index, int end_index, double *cost_along_path,
   *cost_along_path = total_cost;  
 }
 
-static double
-cost_of_path(void) 
-{
-  int path_index;
-  double cost, min_cost;
-  double total_cost;
-
-  total_cost = 0.0;
-  for (path_index = 1; path_index < path.length; 
-       path_index++)
-    {
-      compute_cost(path_index-1, path_index, &cost, &min_cost);
-      total_cost += cost;
-    }
-
-  return total_cost;
-}
-
-
+/* Pulls the path straight in one pass: from the last point kept, each
+   point is dropped if going straight past it to the next one costs no
+   more and gets no closer to obstacles.  The line from the last point
+   kept to the dropped one was already walked, so every point costs two
+   lines.  Points are dropped by not copying them forward.  Once a point
+   is kept that the last smoothing kept too, and the paths are the same
+   from there on, the rest of the last smoothed path is reused. */
 static void 
-smooth_path(carmen_navigator_config_t *nav_conf) 
+smooth_path(carmen_navigator_config_t *nav_conf, int join, int last_join) 
 {
-  int path_index;
-  int new_path_counter;
+  carmen_map_point_p cells = new_path.cells;
+  int first, anchor, index, out, last_index, tail, k;
   double cost_along_prev, cost_along_next;
   double min_cost_prev, min_cost_next;
   double new_cost, new_min_cost;
-  double prev_cost;
-
-  prev_cost = cost_of_path();
 
-  new_path_counter = 0;
-  path_index = 1;
-
-  while (path.length > 2 && carmen_distance_traj
-	 (&robot, carmen_planner_util_get_path_point(1, &path)) <
-	 nav_conf->goal_size) {
-    carmen_planner_util_delete_path_point(1, &path); 
+  if (path.length <= 2) {
+    for (index = 0; index < path.length; index++)
+      new_path.kept[index] = index;
+    return;
   }
 
-  while (path_index < path.length-1) 
+  first = 1;
+  while (path.length - first > 1 && carmen_distance_traj
+	 (&robot, path.points+first) < nav_conf->goal_size)
+    first++;
+
+  new_path.kept[0] = 0;
+  out = 1;
+  anchor = 0;
+  index = first;
+  compute_cost(cells+anchor, cells+index, &cost_along_prev, &min_cost_prev);
+  while (index < path.length-1) 
     {
-      compute_cost(path_index-1, path_index, &cost_along_prev, &min_cost_prev);
-      compute_cost(path_index, path_index+1, &cost_along_next, &min_cost_next);
-      compute_cost(path_index-1, path_index+1, &new_cost, &new_min_cost);
+      compute_cost(cells+index, cells+index+1, &cost_along_next, 
+		   &min_cost_next);
+      compute_cost(cells+anchor, cells+index+1, &new_cost, &new_min_cost);
       
       if (cost_along_prev+cost_along_next+1e-6 < new_cost ||
 	  min_cost_next < new_min_cost || min_cost_prev < new_min_cost) 
 	{
-	  path_index++;     
+	  path.points[out] = path.points[index];
+	  new_path.kept[index] = out++;
+	  anchor = index;
+	  cost_along_prev = cost_along_next;
+	  min_cost_prev = min_cost_next;
+
+	  last_index = anchor - join + last_join;
+	  if (join >= 0 && anchor >= join && last_path.smoothed && 
+	      last_index >= 1 && last_path.kept[last_index] >= 0) {
+	    k = last_path.kept[last_index];
+	    tail = last_path.smoothed_path.length-k-1;
+	    memcpy(path.points+out, last_path.smoothed_path.points+k+1, 
+		   tail*sizeof(carmen_traj_point_t));
+	    for (index = last_index+1; index < last_path.length; index++)
+	      if (last_path.kept[index] >= 0)
+		new_path.kept[index-last_join+join] = 
+		  last_path.kept[index]-k+out-1;
+	    path.length = out+tail;
+	    return;
+	  }
 	} 
       else
 	{
-	  carmen_planner_util_delete_path_point(path_index, &path);
+	  cost_along_prev = new_cost;
+	  min_cost_prev = new_min_cost;
 	}
+      index++;
     }
 
-  new_cost = cost_of_path();
+  path.points[out] = path.points[path.length-1];
+  new_path.kept[path.length-1] = out++;
+  path.length = out;
 }
 
 static int find_nearest_free_point_to_goal(void)
@@ -252,7 +399,6 @@ plan(carmen_navigator_config_t *nav_conf)
   static int old_goal_x, old_goal_y;
   static carmen_traj_point_t old_robot;
   static carmen_map_point_t map_pt;
-  static double last_plan_time = 0;
   int goal_x, goal_y;
 
   if (nav_conf->replan_frequency > 0) {
@@ -267,11 +413,12 @@ plan(carmen_navigator_config_t *nav_conf)
   goal_y = carmen_round(requested_goal.y / 
 			carmen_planner_map->config.resolution);
 
-  carmen_verbose("Doing DP to %d %d\n", goal_x, goal_y);
-  carmen_conventional_dynamic_program(goal_x , goal_y);
-
   carmen_trajectory_to_map(&robot, &map_pt, carmen_planner_map);
 
+  carmen_verbose("Doing DP to %d %d\n", goal_x, goal_y);
+  carmen_conventional_corridor_program(goal_x, goal_y, map_pt.x, map_pt.y);
+  forget_last_path();
+
   if (carmen_conventional_get_utility(map_pt.x, map_pt.y) < 0) {
     goal_is_accessible = 0;
     if (nav_conf->plan_to_nearest_free_point) 
@@ -287,22 +434,53 @@ plan(carmen_navigator_config_t *nav_conf)
   old_robot = robot;
 }
 
+/* Plans with the utility function kept for the goal, if there is one
+   and it reaches the robot.  It was computed on the map without local
+   modifications, so the next map update replans whatever the replan
+   frequency; that is a copy too if the map is still unmodified. */
+static int
+plan_from_cache(void)
+{
+  carmen_map_point_t map_pt;
+  int goal_x, goal_y;
+
+  goal_x = carmen_round(requested_goal.x / 
+			carmen_planner_map->config.resolution);
+  goal_y = carmen_round(requested_goal.y / 
+			carmen_planner_map->config.resolution);
+  if (!carmen_conventional_cached_utility(goal_x, goal_y))
+    return 0;
+
+  /* either way, the utility function is no longer that of the last plan */
+  last_plan_time = 0;
+  carmen_trajectory_to_map(&robot, &map_pt, carmen_planner_map);
+  if (carmen_conventional_get_utility(map_pt.x, map_pt.y) < 0)
+    return 0;
+
+  have_plan = 1;
+  goal_is_accessible = 1;
+  return 1;
+}
+
 //we need to make regenerate trajectory polymorphic somehow
 static void 
 regenerate_trajectory(carmen_navigator_config_t *nav_conf)
 {
   struct timeval start, end;
   int sec, msec;
-  int index;
+  int index, join, last_join;
   carmen_traj_point_p path_point;
   
   gettimeofday(&start, NULL);
-  if (extract_path_from_value_function() < 0) 
+  if (extract_path_from_value_function(&join, &last_join) < 0) {
     carmen_planner_util_clear_path(&path);
+    forget_last_path();
+  }
 	
   else /* if (extract_path_from_value_function() < 0) ... */ {
     if (nav_conf->smooth_path)
-      smooth_path(nav_conf);
+      smooth_path(nav_conf, join, last_join);
+    remember_path(join, last_join, nav_conf->smooth_path);
     //	  Refine_Path_Using_Velocities();
     
     /* Add path orientations in */
@@ -347,6 +525,7 @@ carmen_planner_update_robot(carmen_traj_point_p new_position,
 {
   static carmen_traj_point_t old_position;
   static int first_time = 1;
+  carmen_map_point_t map_pt;
 
   if (!carmen_planner_map)
     return 0;
@@ -365,6 +544,16 @@ carmen_planner_update_robot(carmen_traj_point_p new_position,
       carmen_planner_map->config.resolution) 
     return 0;
 
+  /* With planning tiles, the utility function only covers the tiles
+     of the plan; replan if the robot has left them. */
+  if (goal_set) {
+    carmen_trajectory_to_map(&robot, &map_pt, carmen_planner_map);
+    if (!carmen_conventional_utility_covers(map_pt.x, map_pt.y)) {
+      last_plan_time = 0;
+      plan(nav_conf);
+    }
+  }
+
   regenerate_trajectory(nav_conf);
   old_position = *new_position;
 
@@ -385,8 +574,10 @@ carmen_planner_update_goal(carmen_point_p new_goal, int any_orientation,
   requested_goal = *new_goal;
   allow_any_orientation = any_orientation;
   goal_set = 1;
+  forget_last_path();
 
-  plan(nav_conf);
+  if (!plan_from_cache())
+    plan(nav_conf);
       
   regenerate_trajectory(nav_conf);
 
@@ -416,6 +607,7 @@ void carmen_planner_update_grid(carmen_map_p new_map,
   carmen_world_to_map(&world_point, &map_point);
 
   carmen_conventional_build_costs(robot_conf, &map_point, nav_conf);  
+  forget_last_path();
 
   if (!goal_set)
     return;
@@ -437,6 +629,7 @@ carmen_planner_set_map(carmen_map_p new_map, carmen_robot_config_t *robot_conf)
 
   map_modify_clear(true_map, carmen_planner_map);
   carmen_conventional_build_costs(robot_conf, NULL, NULL);
+  forget_last_path();
 }
 
 
@@ -445,6 +638,7 @@ carmen_planner_reset_map(carmen_robot_config_t *robot_conf)
 {  
   map_modify_clear(true_map, carmen_planner_map);
   carmen_conventional_build_costs(robot_conf, NULL, NULL);
+  forget_last_path();
 }
 
 void 
@@ -453,7 +647,7 @@ carmen_planner_update_map(carmen_robot_laser_message *laser_msg,
 			  carmen_robot_config_t *robot_conf)
 {
   carmen_world_point_t world_point;
-  carmen_map_point_t map_point;
+  map_modify_region_t changed;
 
   if (carmen_planner_map == NULL)
     return;
@@ -465,10 +659,12 @@ carmen_planner_update_map(carmen_robot_laser_message *laser_msg,
 
   /// CYRILL: HIER UEBERGABE AENDERN! (laser cfg)
 
-  map_modify_update(laser_msg, nav_conf, &world_point, true_map, carmen_planner_map);
-
-  carmen_world_to_map(&world_point, &map_point);
-  carmen_conventional_build_costs(robot_conf, &map_point, nav_conf);
+  if (map_modify_update(laser_msg, nav_conf, &world_point, true_map, 
+			carmen_planner_map, &changed) > 0) {
+    carmen_conventional_update_costs(robot_conf, changed.x_min, changed.y_min,
+				     changed.x_max+1, changed.y_max+1);
+    forget_last_path();
+  }
 
   if (!goal_set)
     return;
@@ -478,6 +674,29 @@ carmen_planner_update_map(carmen_robot_laser_message *laser_msg,
   regenerate_trajectory(nav_conf);  
 }
 
+void
+carmen_planner_set_utility_cache(int megabytes)
+{
+  carmen_conventional_set_utility_cache(megabytes);
+}
+
+void
+carmen_planner_set_tile_size(int cells)
+{
+  carmen_hierarchy_set_tile_size(cells);
+}
+
+int
+carmen_planner_precompute_goal(carmen_point_p goal)
+{
+  if (carmen_planner_map == NULL)
+    return 0;
+
+  return carmen_conventional_cache_utility
+    (carmen_round(goal->x / carmen_planner_map->config.resolution),
+     carmen_round(goal->y / carmen_planner_map->config.resolution));
+}
+
 void 
 carmen_planner_get_status(carmen_planner_status_p status) 
 {
@@ -128,6 +128,26 @@ extern "C" {
 				  carmen_robot_config_t *robot_conf,
 				  carmen_navigator_config_t *nav_conf);
 
+  /** Keeps up to this many megabytes of utility functions of goals
+      planned to before, so that planning to one of them again on the
+      same map is immediate.  0 keeps none. **/
+
+  void carmen_planner_set_utility_cache(int megabytes);
+
+  /** Plans over tiles of this many map cells a side first, and then
+      cell by cell only in the tiles that plan goes through, which is
+      much faster on large maps.  The tiles are built when the first
+      plan needs them and again where the map changes.  0 plans over
+      the whole map. **/
+
+  void carmen_planner_set_tile_size(int cells);
+
+  /** Computes the utility function for a goal ahead of time, on the
+      map without local modifications, and keeps it for when the goal
+      is set.  Returns 0 if it was kept already or does not fit. **/
+
+  int carmen_planner_precompute_goal(carmen_point_p goal);
+
   /** A helper function for extracting the internal representation
       of the map, cost map or utility function. 
    **/
@@ -115,7 +115,7 @@ robot_frontlaser_handler(carmen_robot_laser_message *msg)
   nav_conf.map_update_obstacles = 1;
 
   
-  map_modify_update(msg, &nav_conf, &world_point, true_map, map);
+  map_modify_update(msg, &nav_conf, &world_point, true_map, map, NULL);
 
   carmen_map_graphics_modify_map(map_view, map->complete_map, 0);
   carmen_map_graphics_adjust_scrollbars(map_view, &world_point);    
@@ -101,6 +101,23 @@ def test3():
 	
 	sleep(1)
 
+
+#laser statistics straight from the scan history, without a python
+#object per reading; on_message is called with the message type, so
+#no getter is looked up by name
+class ScanStats(pyMessageHandler):
+	def on_message(self, the_type):
+		if the_type != pyCarmen.PYCARMEN_FRONT_LASER:
+			return
+		ranges, remissions, timestamps = self.scan_batch(the_type, 10)
+		print "%d scans over %.2f s, mean range %.2f" % \
+		    (len(timestamps), timestamps[-1]-timestamps[0], ranges.mean())
+
+def test4():
+	robot = ScanStats().__disown__()
+	fl = pyCarmen.front_laser(robot)
+	robot.connect()
+
 	
 test1()
 #test2()
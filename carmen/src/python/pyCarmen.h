@@ -26,10 +26,137 @@
  *
  ********************************************************/
 
+#include <Python.h>
 #include <carmen/carmen.h>
 #include <cstdio>
 #include <iostream>
 
+/* The messages MessageHandler::on_message() is called with.  The lasers
+   come first, and also name the laser for laser_range() and friends. */
+typedef enum {PYCARMEN_FRONT_LASER, PYCARMEN_REAR_LASER,
+	      PYCARMEN_ROBOT_LASER1, PYCARMEN_ROBOT_LASER2,
+	      PYCARMEN_LASER1, PYCARMEN_LASER2, PYCARMEN_LASER3,
+	      PYCARMEN_LASER4, PYCARMEN_LASER5,
+	      PYCARMEN_GLOBAL_POSE, PYCARMEN_ODOMETRY, PYCARMEN_SONAR,
+	      PYCARMEN_BUMPER, PYCARMEN_NAVIGATOR_STATUS,
+	      PYCARMEN_NAVIGATOR_PLAN, PYCARMEN_NAVIGATOR_STOPPED,
+	      PYCARMEN_ARM_STATE, PYCARMEN_MAP_CHANGE,
+	      PYCARMEN_SIM_GLOBAL_POSE} pycarmen_message_t;
+
+#define PYCARMEN_NUM_LASERS  (PYCARMEN_LASER5+1)
+
+/* Number of scans of each laser kept for laser_scans() */
+#define PYCARMEN_SCAN_HISTORY 64
+
+#ifndef SWIG
+
+/* What run_cb() was called with before on_message() */
+static const char *const pycarmen_message_type[] = {
+  "front_laser", "rear_laser", "robot_laser1", "robot_laser2",
+  "laser1", "laser2", "laser3", "laser4", "laser5",
+  "global_pose", "odometry", "sonar", "bumper", "navigator_status",
+  "navigator_plan", "navigator_stopped", "arm_state", "map_change",
+  "sim_global_pose"};
+
+static const char *const pycarmen_message_getter[] = {
+  "get_front_laser_message()", "get_rear_laser_message()",
+  "get_robot_laser1_message()", "get_robot_laser2_message()",
+  "get_laser1_message()", "get_laser2_message()", "get_laser3_message()",
+  "get_laser4_message()", "get_laser5_message()",
+  "get_globalpos_message()", "get_odometry_message()",
+  "get_sonar_message()", "get_bumper_message()",
+  "get_navigator_status_message()", "get_navigator_plan_message()",
+  "get_navigator_autonomous_stopped_message()", "get_arm_state_message()",
+  "get_map_message()", "sim_global_pose_message()"};
+
+/* A read-only Python buffer over C memory, which numpy.frombuffer turns
+   into an array without copying */
+static inline PyObject *pycarmen_view(void *data, Py_ssize_t size)
+{
+#if PY_MAJOR_VERSION >= 3
+  return PyMemoryView_FromMemory((char *)data, size, PyBUF_READ);
+#else
+  return PyBuffer_FromMemory(data, size);
+#endif
+}
+
+/* The last PYCARMEN_SCAN_HISTORY scans of one laser.  Every scan has a
+   fixed row of "width" readings in range and remission, so a row stays
+   where it is until the scan is PYCARMEN_SCAN_HISTORY messages old.
+   Rows only move if a laser sends more readings than before. */
+class ScanHistory {
+ public:
+  float *range, *remission;
+  double *timestamp;
+  int width, count, newest;
+  /* laser_scans() copies the scans asked for here, oldest first */
+  float *batch_range, *batch_remission;
+  double *batch_timestamp;
+
+  ScanHistory() : range(0), remission(0), timestamp(0), width(0),
+    count(0), newest(0), batch_range(0), batch_remission(0),
+    batch_timestamp(0) {}
+  ~ScanHistory() {
+    free(range); free(remission); free(timestamp);
+    free(batch_range); free(batch_remission); free(batch_timestamp);
+  }
+
+  int row(int age) {
+    return (newest - age + PYCARMEN_SCAN_HISTORY) % PYCARMEN_SCAN_HISTORY;
+  }
+
+  void add(int num_readings, float *new_range, int num_remissions,
+	   float *new_remission, double new_timestamp) {
+    int n = PYCARMEN_SCAN_HISTORY;
+
+    if (num_readings > width) {
+      width = num_readings;
+      count = 0;
+      range = (float *)realloc(range, n*width*sizeof(float));
+      carmen_test_alloc(range);
+      remission = (float *)realloc(remission, n*width*sizeof(float));
+      carmen_test_alloc(remission);
+      timestamp = (double *)realloc(timestamp, n*sizeof(double));
+      carmen_test_alloc(timestamp);
+      batch_range = (float *)realloc(batch_range, n*width*sizeof(float));
+      carmen_test_alloc(batch_range);
+      batch_remission = (float *)realloc(batch_remission,
+					 n*width*sizeof(float));
+      carmen_test_alloc(batch_remission);
+      batch_timestamp = (double *)realloc(batch_timestamp, n*sizeof(double));
+      carmen_test_alloc(batch_timestamp);
+    }
+    newest = (count == 0 ? 0 : row(-1));
+    if (count < n)
+      count++;
+    memset(range+newest*width, 0, width*sizeof(float));
+    memset(remission+newest*width, 0, width*sizeof(float));
+    memcpy(range+newest*width, new_range, num_readings*sizeof(float));
+    if (new_remission)
+      memcpy(remission+newest*width, new_remission,
+	     carmen_imin(num_remissions, width)*sizeof(float));
+    timestamp[newest] = new_timestamp;
+  }
+
+  /* Copies the last "n" scans to the batch arrays and returns how many
+     there were */
+  int batch(int n) {
+    int i;
+
+    n = carmen_imin(carmen_imax(n, 0), count);
+    for (i = 0; i < n; i++) {
+      memcpy(batch_range+i*width, range+row(n-1-i)*width,
+	     width*sizeof(float));
+      memcpy(batch_remission+i*width, remission+row(n-1-i)*width,
+	     width*sizeof(float));
+      batch_timestamp[i] = timestamp[row(n-1-i)];
+    }
+    return n;
+  }
+};
+
+#endif
+
 class MessageHandler {
  private:
   carmen_robot_laser_message the_latest_msg_front;
@@ -51,6 +178,34 @@ class MessageHandler {
   carmen_arm_state_message the_latest_arm_state;
   carmen_map_p the_latest_map;
   carmen_simulator_truepos_message the_latest_truepos;
+#ifndef SWIG
+  ScanHistory scans[PYCARMEN_NUM_LASERS];
+
+  /* The latest message of a laser keeps its readings in the history, so
+     they stay valid after carmen reuses the message */
+  template <class laser_message>
+  void keep_laser_message(pycarmen_message_t laser, laser_message *latest,
+			  laser_message *msg) {
+    ScanHistory *history = &scans[laser];
+
+    memcpy(latest, msg, sizeof(laser_message));
+    history->add(msg->num_readings, msg->range, msg->num_remissions,
+		 msg->remission, msg->timestamp);
+    latest->range = history->range+history->newest*history->width;
+    latest->remission = history->remission+history->newest*history->width;
+  }
+
+  /* The history of a laser, or NULL with a ValueError set if "laser"
+     is not one */
+  ScanHistory *laser_history(pycarmen_message_t laser) {
+    if ((unsigned int)laser >= PYCARMEN_NUM_LASERS) {
+      PyErr_Format(PyExc_ValueError, "message type %d is not a laser",
+		   (int)laser);
+      return NULL;
+    }
+    return &scans[laser];
+  }
+#endif
  public:
         MessageHandler(){
 	  the_latest_map = 0;
@@ -60,52 +215,106 @@ class MessageHandler {
 	virtual void run_cb(char* type, char* msg) //carmen_robot_laser_message *msg) 
 	  {}
 
+	/* Called for every message, with the type of the message rather
+	   than the name of its getter; calls run_cb() unless overridden */
+	virtual void on_message(pycarmen_message_t type)
+	  {run_cb((char *)pycarmen_message_type[type],
+		  (char *)pycarmen_message_getter[type]);}
+
+	/* The ranges and remissions of the latest scan of a laser, as
+	   buffers of float32 that numpy.frombuffer can use without
+	   copying.  They show the scan until it is PYCARMEN_SCAN_HISTORY
+	   messages old; copy them to keep them longer. */
+	PyObject *laser_range(pycarmen_message_t laser) {
+	  ScanHistory *history = laser_history(laser);
+	  if (history == NULL)
+	    return NULL;
+	  return pycarmen_view(history->range+history->newest*history->width,
+			       history->count ? history->width*sizeof(float) : 0);
+	}
+	PyObject *laser_remission(pycarmen_message_t laser) {
+	  ScanHistory *history = laser_history(laser);
+	  if (history == NULL)
+	    return NULL;
+	  return pycarmen_view(history->remission+
+			       history->newest*history->width,
+			       history->count ? history->width*sizeof(float) : 0);
+	}
+
+	/* Up to the last "n" scans of a laser, oldest first, as a tuple
+	   (ranges, remissions, timestamps, width): scan i has its readings
+	   at [i*width, (i+1)*width) of ranges and remissions.  The buffers
+	   are reused by the next call for the same laser. */
+	PyObject *laser_scans(pycarmen_message_t laser, int n) {
+	  ScanHistory *history = laser_history(laser);
+	  if (history == NULL)
+	    return NULL;
+	  n = history->batch(n);
+	  return Py_BuildValue("(NNNi)",
+			       pycarmen_view(history->batch_range,
+					     n*history->width*sizeof(float)),
+			       pycarmen_view(history->batch_remission,
+					     n*history->width*sizeof(float)),
+			       pycarmen_view(history->batch_timestamp,
+					     n*sizeof(double)),
+			       history->width);
+	}
+
+	/* The latest map as a buffer of x_size*y_size float32, x major */
+	PyObject *map_grid(void) {
+	  if (the_latest_map == 0)
+	    return pycarmen_view(0, 0);
+	  return pycarmen_view(the_latest_map->complete_map,
+			       the_latest_map->config.x_size*
+			       the_latest_map->config.y_size*sizeof(float));
+	}
+
 	/*Front Laser Messages*/
 	void set_front_laser_message(carmen_robot_laser_message *msg)
-	  {memcpy(&the_latest_msg_front, msg, sizeof(carmen_robot_laser_message));}
+	  {keep_laser_message(PYCARMEN_FRONT_LASER, &the_latest_msg_front, msg);}
 	carmen_robot_laser_message* get_front_laser_message(void)
 	  {return &the_latest_msg_front;}
 	
 	/*Rear Laser Messages*/
 	void set_rear_laser_message(carmen_robot_laser_message *msg)
-	  {memcpy(&the_latest_msg_rear, msg, sizeof(carmen_robot_laser_message));}
+	  {keep_laser_message(PYCARMEN_REAR_LASER, &the_latest_msg_rear, msg);}
 	carmen_robot_laser_message* get_rear_laser_message(void)
 	  {return &the_latest_msg_rear;}
 
 	/*laser numbered messages, from robot */
 	void set_robot_laser1_message(carmen_robot_laser_message *msg)
-	  {memcpy(&the_latest_msg_robot_laser1, msg, sizeof(carmen_robot_laser_message));}
+	  {keep_laser_message(PYCARMEN_ROBOT_LASER1, &the_latest_msg_robot_laser1, msg);}
 	carmen_robot_laser_message* get_robot_laser1_message(void)
 	  {return &the_latest_msg_robot_laser1;}
 
 	void set_robot_laser2_message(carmen_robot_laser_message *msg)
-	  {memcpy(&the_latest_msg_robot_laser2, msg, sizeof(carmen_robot_laser_message));}
+	  {keep_laser_message(PYCARMEN_ROBOT_LASER2, &the_latest_msg_robot_laser2, msg);}
 	carmen_robot_laser_message* get_robot_laser2_message(void)
 	  {return &the_latest_msg_robot_laser2;}
 
 	/*laser numbered messages, from laser */
 	void set_laser1_message(carmen_laser_laser_message *msg)
-	  {memcpy(&the_latest_msg_laser1, msg, sizeof(carmen_laser_laser_message));}
+	  {keep_laser_message(PYCARMEN_LASER1, &the_latest_msg_laser1, msg);}
 	carmen_laser_laser_message* get_laser1_message(void)
 	  {return &the_latest_msg_laser1;}
 
 	void set_laser2_message(carmen_laser_laser_message *msg)
-	  {memcpy(&the_latest_msg_laser2, msg, sizeof(carmen_laser_laser_message));}
+	  {keep_laser_message(PYCARMEN_LASER2, &the_latest_msg_laser2, msg);}
 	carmen_laser_laser_message* get_laser2_message(void)
 	  {return &the_latest_msg_laser2;}
 
 	void set_laser3_message(carmen_laser_laser_message *msg)
-	  {memcpy(&the_latest_msg_laser3, msg, sizeof(carmen_laser_laser_message));}
+	  {keep_laser_message(PYCARMEN_LASER3, &the_latest_msg_laser3, msg);}
 	carmen_laser_laser_message* get_laser3_message(void)
 	  {return &the_latest_msg_laser3;}
 
 	void set_laser4_message(carmen_laser_laser_message *msg)
-	  {memcpy(&the_latest_msg_laser4, msg, sizeof(carmen_laser_laser_message));}
+	  {keep_laser_message(PYCARMEN_LASER4, &the_latest_msg_laser4, msg);}
 	carmen_laser_laser_message* get_laser4_message(void)
 	  {return &the_latest_msg_laser4;}
 
 	void set_laser5_message(carmen_laser_laser_message *msg)
-	  {memcpy(&the_latest_msg_laser5, msg, sizeof(carmen_laser_laser_message));}
+	  {keep_laser_message(PYCARMEN_LASER5, &the_latest_msg_laser5, msg);}
 	carmen_laser_laser_message* get_laser5_message(void)
 	  {return &the_latest_msg_laser5;}
 
@@ -165,6 +374,16 @@ class MessageHandler {
 	  }*/
 
 	void set_map_message(carmen_map_p msg){
+	  /* a map of the same size is copied in place, so that map_grid()
+	     views stay valid */
+	  if(the_latest_map != 0 &&
+	     the_latest_map->config.x_size == msg->config.x_size &&
+	     the_latest_map->config.y_size == msg->config.y_size) {
+	    memcpy(the_latest_map->complete_map, msg->complete_map,
+		   msg->config.x_size*msg->config.y_size*sizeof(float));
+	    the_latest_map->config = msg->config;
+	    return;
+	  }
 	  if(!the_latest_map == 0)
 	    carmen_map_destroy(&the_latest_map);
 	  the_latest_map = carmen_map_copy(msg);
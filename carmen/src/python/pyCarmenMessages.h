@@ -39,7 +39,7 @@ class front_laser{
   static void lazer_msg(carmen_robot_laser_message *msg)
   {
     _laser_callback->set_front_laser_message(msg);
-    if (_laser_callback) _laser_callback->run_cb("front_laser", "get_front_laser_message()");
+    if (_laser_callback) _laser_callback->on_message(PYCARMEN_FRONT_LASER);
   }
 
   front_laser(MessageHandler *cb)
@@ -58,7 +58,7 @@ class rear_laser{
   static void lazer_msg_rear(carmen_robot_laser_message *msg)
   {
     _rlaser_callback->set_rear_laser_message(msg);
-    if (_rlaser_callback) _rlaser_callback->run_cb("rear_laser", "get_rear_laser_message()");
+    if (_rlaser_callback) _rlaser_callback->on_message(PYCARMEN_REAR_LASER);
   }
 
   rear_laser(MessageHandler *cb)
@@ -76,7 +76,7 @@ class robot_laser1{
   static void robot_lazer1_msg(carmen_robot_laser_message *msg)
   {
     _robot_laser1_callback->set_robot_laser1_message(msg);
-    if (_robot_laser1_callback) _robot_laser1_callback->run_cb("robot_laser1", "get_robot_laser1_message()");
+    if (_robot_laser1_callback) _robot_laser1_callback->on_message(PYCARMEN_ROBOT_LASER1);
   }
 
   robot_laser1(MessageHandler *cb)
@@ -93,7 +93,7 @@ class robot_laser2{
   static void robot_lazer2_msg(carmen_robot_laser_message *msg)
   {
     _robot_laser2_callback->set_robot_laser2_message(msg);
-    if (_robot_laser2_callback) _robot_laser2_callback->run_cb("robot_laser2", "get_robot_laser2_message()");
+    if (_robot_laser2_callback) _robot_laser2_callback->on_message(PYCARMEN_ROBOT_LASER2);
   }
 
   robot_laser2(MessageHandler *cb)
@@ -112,7 +112,7 @@ class laser1{
   static void lazer1_msg(carmen_laser_laser_message *msg)
   {
     _laser1_callback->set_laser1_message(msg);
-    if (_laser1_callback) _laser1_callback->run_cb("laser1", "get_laser1_message()");
+    if (_laser1_callback) _laser1_callback->on_message(PYCARMEN_LASER1);
   }
 
   laser1(MessageHandler *cb)
@@ -129,7 +129,7 @@ class laser2{
   static void lazer2_msg(carmen_laser_laser_message *msg)
   {
     _laser2_callback->set_laser2_message(msg);
-    if (_laser2_callback) _laser2_callback->run_cb("laser2", "get_laser2_message()");
+    if (_laser2_callback) _laser2_callback->on_message(PYCARMEN_LASER2);
   }
 
   laser2(MessageHandler *cb)
@@ -146,7 +146,7 @@ class laser3{
   static void lazer3_msg(carmen_laser_laser_message *msg)
   {
     _laser3_callback->set_laser3_message(msg);
-    if (_laser3_callback) _laser3_callback->run_cb("laser3", "get_laser3_message()");
+    if (_laser3_callback) _laser3_callback->on_message(PYCARMEN_LASER3);
   }
 
   laser3(MessageHandler *cb)
@@ -163,7 +163,7 @@ class laser4{
   static void lazer4_msg(carmen_laser_laser_message *msg)
   {
     _laser4_callback->set_laser4_message(msg);
-    if (_laser4_callback) _laser4_callback->run_cb("laser4", "get_laser4_message()");
+    if (_laser4_callback) _laser4_callback->on_message(PYCARMEN_LASER4);
   }
 
   laser4(MessageHandler *cb)
@@ -180,7 +180,7 @@ class laser5{
   static void lazer5_msg(carmen_laser_laser_message *msg)
   {
     _laser5_callback->set_laser5_message(msg);
-    if (_laser5_callback) _laser5_callback->run_cb("laser5", "get_laser5_message()");
+    if (_laser5_callback) _laser5_callback->on_message(PYCARMEN_LASER5);
   }
 
   laser5(MessageHandler *cb)
@@ -199,7 +199,7 @@ class global_pose{
   static void my_callback(carmen_localize_globalpos_message *msg)
   {
     _global_pose_callback->set_globalpos_message(msg);
-    if (_global_pose_callback) _global_pose_callback->run_cb("global_pose", "get_globalpos_message()");
+    if (_global_pose_callback) _global_pose_callback->on_message(PYCARMEN_GLOBAL_POSE);
   }
 
   global_pose(MessageHandler *cb)
@@ -218,7 +218,7 @@ class odometry {
   static void my_callback(carmen_base_odometry_message *msg)
   {
     _odometry_callback->set_odometry_message(msg);
-    if (_odometry_callback) _odometry_callback->run_cb("odometry", "get_odometry_message()");
+    if (_odometry_callback) _odometry_callback->on_message(PYCARMEN_ODOMETRY);
   }
 
   odometry(MessageHandler *cb)
@@ -238,7 +238,7 @@ class sonar {
   static void my_callback(carmen_base_sonar_message *msg)
   {
     _sonar_callback->set_sonar_message(msg);
-    if (_sonar_callback) _sonar_callback->run_cb("sonar", "get_sonar_message()");
+    if (_sonar_callback) _sonar_callback->on_message(PYCARMEN_SONAR);
   }
 
   sonar(MessageHandler *cb)
@@ -258,7 +258,7 @@ class bumper {
   static void my_callback(carmen_base_bumper_message *msg)
   {
     _bumper_callback->set_bumper_message(msg);
-    if (_bumper_callback) _bumper_callback->run_cb("bumper", "get_bumper_message()");
+    if (_bumper_callback) _bumper_callback->on_message(PYCARMEN_BUMPER);
   }
 
   bumper(MessageHandler *cb)
@@ -277,7 +277,7 @@ class navigator_status {
   static void my_callback(carmen_navigator_status_message *msg)
   {
     _navigator_status_callback->set_navigator_status_message(msg);
-    if (_navigator_status_callback) _navigator_status_callback->run_cb("navigator_status", "get_navigator_status_message()");
+    if (_navigator_status_callback) _navigator_status_callback->on_message(PYCARMEN_NAVIGATOR_STATUS);
   }
 
   navigator_status(MessageHandler *cb)
@@ -297,7 +297,7 @@ class navigator_plan {
   static void my_callback(carmen_navigator_plan_message *msg)
   {
     _navigator_plan_callback->set_navigator_plan_message(msg);
-    if (_navigator_plan_callback) _navigator_plan_callback->run_cb("navigator_plan", "get_navigator_plan_message()");
+    if (_navigator_plan_callback) _navigator_plan_callback->on_message(PYCARMEN_NAVIGATOR_PLAN);
   }
 
   navigator_plan(MessageHandler *cb)
@@ -317,7 +317,7 @@ class navigator_stopped {
   static void my_callback(carmen_navigator_autonomous_stopped_message *msg)
   {
     _navigator_stopped_callback->set_navigator_autonomous_stopped_message(msg);
-    if (_navigator_stopped_callback) _navigator_stopped_callback->run_cb("navigator_stopped", "get_navigator_autonomous_stopped_message()");
+    if (_navigator_stopped_callback) _navigator_stopped_callback->on_message(PYCARMEN_NAVIGATOR_STOPPED);
   }
 
   navigator_stopped(MessageHandler *cb)
@@ -337,7 +337,7 @@ class arm{
   static void my_callback(carmen_arm_state_message *msg)
   {
     _arm_callback->set_arm_state_message(msg);
-    if (_arm_callback) _arm_callback->run_cb("arm_state", "get_arm_state_message()");
+    if (_arm_callback) _arm_callback->on_message(PYCARMEN_ARM_STATE);
   }
 
   arm(MessageHandler *cb)
@@ -357,7 +357,7 @@ class map_change{
   static void map_update_handler(carmen_map_p msg) 
     {
       _map_callback->set_map_message(msg);
-      if (_map_callback) _map_callback->run_cb("map_change", "get_map_message()");
+      if (_map_callback) _map_callback->on_message(PYCARMEN_MAP_CHANGE);
     }
 
   map_change(MessageHandler *cb)
@@ -388,7 +388,7 @@ class sim_global_pose{
   static void sim_pose_handler(carmen_simulator_truepos_message *msg) 
     {
       _sim_pose_callback->set_sim_truepos_message(msg);
-      if (_sim_pose_callback) _sim_pose_callback->run_cb("sim_global_pose", "sim_global_pose_message()");
+      if (_sim_pose_callback) _sim_pose_callback->on_message(PYCARMEN_SIM_GLOBAL_POSE);
     }
 
   sim_global_pose(MessageHandler *cb)
@@ -5,6 +5,7 @@ from threading import Thread
 from time import sleep
 from sys import exit
 from scipy import *
+from numpy import frombuffer, float32, float64, zeros
 
 #You need to override the callback function in order
 #to get the functionality of this class
@@ -28,6 +29,36 @@ class pyMessageHandler(pyCarmen.MessageHandler, Thread):
 		#print dir(msg)
 		pass
 
+	# The arrays below are views of the data MessageHandler keeps, not
+	# copies: a laser's arrays change once its scan is
+	# PYCARMEN_SCAN_HISTORY messages old, and scan_batch's with the
+	# next call.  Use .copy() to keep them.
+
+	def range_array(self, laser):
+		return frombuffer(self.laser_range(laser), float32)
+
+	def remission_array(self, laser):
+		return frombuffer(self.laser_remission(laser), float32)
+
+	# The last n scans of a laser, oldest first: (ranges, remissions,
+	# timestamps), the first two with a row per scan
+	def scan_batch(self, laser, n):
+		ranges, remissions, timestamps, width = self.laser_scans(laser, n)
+		if width == 0 or len(timestamps) == 0:
+			return (zeros((0, width), float32), zeros((0, width), float32),
+				zeros(0, float64))
+		return (frombuffer(ranges, float32).reshape(-1, width),
+			frombuffer(remissions, float32).reshape(-1, width),
+			frombuffer(timestamps, float64))
+
+	# The latest map, indexed [x, y]
+	def map_array(self):
+		the_map = self.get_map_message()
+		if the_map is None:
+			return zeros((0, 0), float32)
+		return frombuffer(self.map_grid(), float32).reshape(
+			the_map.config.x_size, the_map.config.y_size)
+
 	def connect(self):
 		while(1):
 			pyCarmen.carmen_ipc_sleep(0.05)
@@ -31,6 +31,7 @@
 #include "robot_central.h"
 #include "robot_main.h"
 #include "robot_laser.h"
+#include "robot_local_planner.h"
 
 static double frontlaser_offset;
 static double rearlaser_offset;
@@ -309,6 +310,13 @@ laser_frontlaser_handler(void)
     robot_front_laser.range[i] = robot_front_laser.config.maximum_range;
   }
 
+  carmen_robot_local_planner_add_laser
+    (0, robot_front_laser.range, robot_front_laser.num_readings,
+     front_laser.config.start_angle + frontlaser_angular_offset,
+     front_laser.config.angular_resolution,
+     front_laser.config.maximum_range, frontlaser_offset, 
+     frontlaser_side_offset);
+
   carmen_robot_sensor_time_of_last_update = carmen_get_time();
 
   if (carmen_robot_sensor_time_of_last_update - time_since_last_process < 
@@ -447,6 +455,13 @@ laser_rearlaser_handler(void)
     robot_rear_laser.range[i] = robot_rear_laser.config.maximum_range;
   }
 
+  carmen_robot_local_planner_add_laser
+    (1, robot_rear_laser.range, robot_rear_laser.num_readings,
+     rear_laser.config.start_angle + rearlaser_angular_offset,
+     rear_laser.config.angular_resolution,
+     rear_laser.config.maximum_range, rearlaser_offset, 
+     rearlaser_side_offset);
+
   carmen_robot_sensor_time_of_last_update = carmen_get_time();
 
   if (carmen_robot_sensor_time_of_last_update - time_since_last_process < 
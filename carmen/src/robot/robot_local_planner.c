@@ -0,0 +1,525 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation; 
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more 
+ * details.
+ *
+ * You should have received a copy of the GNU General 
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, 
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+/* A dynamic window local planner. Each cycle it samples translational
+   and rotational velocities the robot can reach soon, rolls every pair
+   forward as an arc over the planning horizon and scores the arcs
+   against a distance field built around the robot from the latest
+   laser scans. The candidates are kept one quantity per array and
+   advanced a step at a time, so that the rollout loops run over all
+   candidates at once and the compiler can vectorize them. */
+
+#include <carmen/carmen.h>
+
+#include "robot_central.h"
+#include "robot_local_planner.h"
+
+#define      LOCAL_RESOLUTION     0.05   /* m per distance field cell */
+#define      CLEARANCE_CAP        1.0    /* m; more clearance scores no better */
+#define      WINDOW_TIME          0.5    /* s of acceleration the samples span */
+#define      REPORT_INTERVAL      30.0   /* s between timing reports */
+#define      MAX_LASERS           2
+#define      MAX_SCANS            40
+#define      SCAN_MEMORY          2.0    /* s the scans are remembered */
+#define      MAX_CANDIDATES       1024
+
+typedef struct {
+  float *x, *y;
+  int num_points, max_points;
+  double timestamp;
+} scan_points_t;
+
+static double frequency = 20.0;
+static double horizon = 2.0;
+static int tv_samples = 6;
+static int rv_samples = 21;
+static double heading_weight = 1.0;
+static double clearance_weight = 0.3;
+static double velocity_weight = 0.3;
+
+static int initialized = 0;
+
+/* obstacle points of the recent scans, in the odometry frame. A front
+   laser alone does not see what the robot turns past, so the older scans
+   stand in for it for a while. */
+static scan_points_t scans[MAX_SCANS];
+static int next_scan = 0;
+static int last_scan[MAX_LASERS] = {-1, -1};
+
+/* distance in m from each cell to the nearest obstacle, in the current
+   robot frame with the robot at the centre cell */
+static float *field = NULL;
+static int field_size = 0;
+static float *obstacle_x = NULL, *obstacle_y = NULL;
+static int max_obstacles = 0;
+
+/* the candidates, fixed size so the compiler can tell the arrays apart */
+static int num_candidates = 0;
+static float cand_tv[MAX_CANDIDATES], cand_rv[MAX_CANDIDATES];
+static float cand_x[MAX_CANDIDATES], cand_y[MAX_CANDIDATES];
+static float cand_cos[MAX_CANDIDATES], cand_sin[MAX_CANDIDATES];
+static float step_cos[MAX_CANDIDATES], step_sin[MAX_CANDIDATES];
+static float cand_clearance[MAX_CANDIDATES], cand_hit[MAX_CANDIDATES];
+static float cand_approach[MAX_CANDIDATES], cand_last[MAX_CANDIDATES];
+static float cand_distance[MAX_CANDIDATES];
+static int cand_cell[MAX_CANDIDATES];
+
+static carmen_robot_local_planner_stats_t stats;
+static double total_time = 0, time_of_last_report = 0;
+
+static double robot_radius(void)
+{
+  return 0.5 * carmen_fmax(carmen_robot_config.length, 
+			   carmen_robot_config.width);
+}
+
+static carmen_inline float closer(float d1, float d2)
+{
+  return d1 < d2 ? d1 : d2;
+}
+
+void carmen_robot_add_local_planner_parameters(int argc, char **argv)
+{
+  int num_items, half_size;
+  double reach;
+
+  carmen_param_t param_list[] = {
+    {"robot", "local_planner_frequency", CARMEN_PARAM_DOUBLE, 
+     &frequency, 0, NULL},
+    {"robot", "local_planner_horizon", CARMEN_PARAM_DOUBLE, 
+     &horizon, 0, NULL},
+    {"robot", "local_planner_tv_samples", CARMEN_PARAM_INT, 
+     &tv_samples, 0, NULL},
+    {"robot", "local_planner_rv_samples", CARMEN_PARAM_INT, 
+     &rv_samples, 0, NULL},
+    {"robot", "local_planner_heading_weight", CARMEN_PARAM_DOUBLE, 
+     &heading_weight, 1, NULL},
+    {"robot", "local_planner_clearance_weight", CARMEN_PARAM_DOUBLE, 
+     &clearance_weight, 1, NULL},
+    {"robot", "local_planner_velocity_weight", CARMEN_PARAM_DOUBLE, 
+     &velocity_weight, 1, NULL},
+  };
+
+  num_items = sizeof(param_list)/sizeof(param_list[0]);
+  carmen_param_install_params(argc, argv, param_list, num_items);
+
+  if (frequency <= 0 || horizon <= 0)
+    carmen_die("robot_local_planner_frequency and robot_local_planner_horizon"
+	       " must be positive.\n");
+  if (tv_samples < 1 || rv_samples < 2)
+    carmen_die("The local planner needs at least 1 tv sample and 2 rv "
+	       "samples.\n");
+  /* each tv sample also gets the arc that runs straight to the target */
+  if (tv_samples * (rv_samples + 1) > MAX_CANDIDATES)
+    carmen_die("The local planner takes at most %d velocity pairs; lower "
+	       "robot_local_planner_tv_samples or rv_samples.\n", 
+	       MAX_CANDIDATES);
+
+  /* the field covers the furthest any arc can go, plus the robot and the
+     clearance that still counts */
+  reach = carmen_robot_config.max_t_vel * horizon + robot_radius() + 
+    carmen_robot_config.side_dist + CLEARANCE_CAP;
+  half_size = (int)ceil(reach / LOCAL_RESOLUTION);
+  field_size = 2 * half_size + 1;
+  field = (float *)calloc(field_size * field_size, sizeof(float));
+  carmen_test_alloc(field);
+
+  initialized = 1;
+}
+
+double carmen_robot_local_planner_period(void)
+{
+  return 1.0 / frequency;
+}
+
+void carmen_robot_local_planner_add_laser(int laser, float *range, 
+					  int num_readings, 
+					  double start_angle,
+					  double angular_resolution,
+					  double maximum_range,
+					  double offset, double side_offset)
+{
+  scan_points_t *points;
+  double theta, px, py, cos_theta, sin_theta, now;
+  int i;
+
+  if (!initialized || laser < 0 || laser >= MAX_LASERS)
+    return;
+
+  /* a scan coming soon after the last one of the same laser replaces it,
+     so that the history spans SCAN_MEMORY whatever the laser rate */
+  now = carmen_get_time();
+  if (last_scan[laser] < 0 || now - scans[last_scan[laser]].timestamp > 
+      SCAN_MEMORY * MAX_LASERS / MAX_SCANS) {
+    last_scan[laser] = next_scan;
+    scans[next_scan].timestamp = now;
+    next_scan = (next_scan + 1) % MAX_SCANS;
+  }
+
+  points = scans + last_scan[laser];
+  if (num_readings > points->max_points) {
+    points->max_points = num_readings;
+    points->x = (float *)realloc(points->x, num_readings * sizeof(float));
+    carmen_test_alloc(points->x);
+    points->y = (float *)realloc(points->y, num_readings * sizeof(float));
+    carmen_test_alloc(points->y);
+  }
+
+  cos_theta = cos(carmen_robot_latest_odometry.theta);
+  sin_theta = sin(carmen_robot_latest_odometry.theta);
+
+  points->num_points = 0;
+  theta = start_angle;
+  for (i = 0; i < num_readings; i++, theta += angular_resolution) {
+    if (range[i] <= 0 || range[i] >= maximum_range)
+      continue;
+    px = offset + range[i] * cos(theta);
+    py = side_offset + range[i] * sin(theta);
+    points->x[points->num_points] = carmen_robot_latest_odometry.x + 
+      cos_theta * px - sin_theta * py;
+    points->y[points->num_points] = carmen_robot_latest_odometry.y + 
+      sin_theta * px + cos_theta * py;
+    points->num_points++;
+  }
+}
+
+/* Marks the obstacles in the current robot frame and spreads their
+   distance over the field with a two pass chamfer transform. The
+   dependency on the previous row is taken a whole row at a time. */
+
+static void build_field(void)
+{
+  int i, x, y, n, centre, num_obstacles, cell_x, cell_y;
+  float *row, *other, d1, d2, far_away;
+  double cos_theta, sin_theta, dx, dy, oldest;
+  scan_points_t *points;
+
+  n = field_size;
+  centre = n / 2;
+  d1 = LOCAL_RESOLUTION;
+  d2 = LOCAL_RESOLUTION * M_SQRT2;
+  far_away = 2 * n * LOCAL_RESOLUTION;
+
+  for (i = 0; i < n * n; i++)
+    field[i] = far_away;
+
+  oldest = carmen_get_time() - SCAN_MEMORY;
+  num_obstacles = 0;
+  for (i = 0; i < MAX_SCANS; i++)
+    if (scans[i].timestamp >= oldest)
+      num_obstacles += scans[i].num_points;
+  if (num_obstacles > max_obstacles) {
+    max_obstacles = num_obstacles;
+    obstacle_x = (float *)realloc(obstacle_x, max_obstacles * sizeof(float));
+    carmen_test_alloc(obstacle_x);
+    obstacle_y = (float *)realloc(obstacle_y, max_obstacles * sizeof(float));
+    carmen_test_alloc(obstacle_y);
+  }
+
+  cos_theta = cos(carmen_robot_latest_odometry.theta);
+  sin_theta = sin(carmen_robot_latest_odometry.theta);
+  num_obstacles = 0;
+  for (i = 0; i < MAX_SCANS; i++) {
+    points = scans + i;
+    if (points->timestamp < oldest)
+      continue;
+    for (x = 0; x < points->num_points; x++) {
+      dx = points->x[x] - carmen_robot_latest_odometry.x;
+      dy = points->y[x] - carmen_robot_latest_odometry.y;
+      obstacle_x[num_obstacles + x] = cos_theta * dx + sin_theta * dy;
+      obstacle_y[num_obstacles + x] = -sin_theta * dx + cos_theta * dy;
+    }
+    num_obstacles += points->num_points;
+  }
+
+  for (i = 0; i < num_obstacles; i++) {
+    cell_x = (int)floor(obstacle_x[i] / LOCAL_RESOLUTION + 0.5) + centre;
+    cell_y = (int)floor(obstacle_y[i] / LOCAL_RESOLUTION + 0.5) + centre;
+    if (cell_x >= 0 && cell_x < n && cell_y >= 0 && cell_y < n)
+      field[cell_x * n + cell_y] = 0;
+  }
+
+  for (x = 0; x < n; x++) {
+    row = field + x * n;
+    if (x > 0) {
+      other = row - n;
+      for (y = 1; y < n - 1; y++)
+	row[y] = closer(closer(row[y], other[y] + d1), 
+			closer(other[y - 1] + d2, other[y + 1] + d2));
+      row[0] = closer(row[0], closer(other[0] + d1, other[1] + d2));
+      row[n - 1] = closer(row[n - 1], closer(other[n - 1] + d1, 
+					     other[n - 2] + d2));
+    }
+    for (y = 1; y < n; y++)
+      row[y] = closer(row[y], row[y - 1] + d1);
+  }
+
+  for (x = n - 1; x >= 0; x--) {
+    row = field + x * n;
+    if (x < n - 1) {
+      other = row + n;
+      for (y = 1; y < n - 1; y++)
+	row[y] = closer(closer(row[y], other[y] + d1), 
+			closer(other[y - 1] + d2, other[y + 1] + d2));
+      row[0] = closer(row[0], closer(other[0] + d1, other[1] + d2));
+      row[n - 1] = closer(row[n - 1], closer(other[n - 1] + d1, 
+					     other[n - 2] + d2));
+    }
+    for (y = n - 2; y >= 0; y--)
+      row[y] = closer(row[y], row[y + 1] + d1);
+  }
+}
+
+static void add_candidate(double tv, double rv)
+{
+  cand_tv[num_candidates] = tv;
+  cand_rv[num_candidates] = 
+    carmen_clamp(-carmen_robot_config.max_r_vel, rv, 
+		 carmen_robot_config.max_r_vel);
+  num_candidates++;
+}
+
+/* Fills in the velocity pairs to try: a grid over the dynamic window
+   and, for every tv, the arc that ends on the target. */
+
+static void sample_velocities(carmen_traj_point_p target, int target_is_final)
+{
+  carmen_traj_point_t start, centre;
+  double tv_min, tv_max, tv, rv, radius, curvature, stopping, distance;
+  int i, j, have_curvature;
+
+  tv_min = carmen_fmax(0, carmen_robot_latest_odometry.tv - 
+		       carmen_robot_config.deceleration * WINDOW_TIME);
+  tv_max = carmen_fmin(carmen_robot_config.max_t_vel, 
+		       carmen_robot_latest_odometry.tv + 
+		       carmen_robot_config.acceleration * WINDOW_TIME);
+  if (target_is_final) {
+    stopping = hypot(target->x, target->y) - 
+      carmen_robot_config.approach_dist / 2;
+    tv_max = carmen_fmin(tv_max, sqrt(2 * carmen_robot_config.deceleration *
+				      carmen_fmax(stopping, 0)));
+  }
+  if (tv_max < tv_min)
+    tv_min = tv_max;
+
+  /* The geometry library wants a target away from the robot, but not so
+     far that the arc radius passes its limit of 10 km (the radius can
+     reach 50 times the distance), and gives no curvature for a target
+     straight ahead or straight behind; the behind case is left to the
+     rotations in the grid. */
+  have_curvature = 0;
+  curvature = 0;
+  distance = hypot(target->x, target->y);
+  if (distance > LOCAL_RESOLUTION && distance < 100) {
+    memset(&start, 0, sizeof(start));
+    carmen_geometry_compute_centre_and_curvature(start, 0, *target, 
+						 &centre, &radius);
+    if (radius > 0) {
+      curvature = (centre.y > 0 ? 1 : -1) / radius;
+      have_curvature = 1;
+    } else if (target->x > 0)
+      have_curvature = 1;
+  }
+
+  num_candidates = 0;
+  for (i = 0; i < tv_samples; i++) {
+    if (tv_samples == 1)
+      tv = tv_max;
+    else
+      tv = tv_min + i * (tv_max - tv_min) / (tv_samples - 1);
+    for (j = 0; j < rv_samples; j++) {
+      rv = -carmen_robot_config.max_r_vel + 
+	j * 2 * carmen_robot_config.max_r_vel / (rv_samples - 1);
+      add_candidate(tv, rv);
+    }
+    if (have_curvature && tv > 0)
+      add_candidate(tv, tv * curvature);
+  }
+}
+
+/* Rolls every candidate forward over the horizon in steps short enough
+   not to skip a cell, keeping the lowest clearance seen, the time it
+   first hits something or closes in on it within the side distance, and
+   how near it came to the target. Within the side distance only closing
+   in counts, so that a robot in a narrow passage can still go on along
+   it or back off. */
+
+static void roll_out(carmen_traj_point_p target, float body, float margin)
+{
+  int i, k, n, steps, centre;
+  float dt, t, cell_x, cell_y, d, hit, dx, dy, approach, next_cos;
+  float inverse_resolution, top, target_x, target_y;
+
+  n = field_size;
+  centre = n / 2;
+  inverse_resolution = 1.0 / LOCAL_RESOLUTION;
+  top = n - 1;
+  target_x = target->x;
+  target_y = target->y;
+
+  dt = LOCAL_RESOLUTION / carmen_fmax(carmen_robot_config.max_t_vel, 0.01);
+  dt = carmen_fmin(dt, 0.1);
+  steps = (int)ceil(horizon / dt);
+
+  for (i = 0; i < num_candidates; i++) {
+    cand_x[i] = 0;
+    cand_y[i] = 0;
+    cand_cos[i] = 1;
+    cand_sin[i] = 0;
+    step_cos[i] = cos(cand_rv[i] * dt);
+    step_sin[i] = sin(cand_rv[i] * dt);
+    cand_clearance[i] = field[centre * n + centre];
+    cand_last[i] = cand_clearance[i];
+    cand_hit[i] = FLT_MAX;
+    cand_approach[i] = target_x * target_x + target_y * target_y;
+  }
+
+  for (k = 0; k < steps; k++) {
+    t = k * dt;
+    for (i = 0; i < num_candidates; i++) {
+      cand_x[i] += cand_tv[i] * dt * cand_cos[i];
+      cand_y[i] += cand_tv[i] * dt * cand_sin[i];
+      next_cos = cand_cos[i] * step_cos[i] - cand_sin[i] * step_sin[i];
+      cand_sin[i] = cand_sin[i] * step_cos[i] + cand_cos[i] * step_sin[i];
+      cand_cos[i] = next_cos;
+
+      cell_x = cand_x[i] * inverse_resolution + centre + 0.5f;
+      cell_y = cand_y[i] * inverse_resolution + centre + 0.5f;
+      cell_x = cell_x < 0 ? 0 : (cell_x > top ? top : cell_x);
+      cell_y = cell_y < 0 ? 0 : (cell_y > top ? top : cell_y);
+      cand_cell[i] = (int)cell_x * n + (int)cell_y;
+
+      dx = cand_x[i] - target_x;
+      dy = cand_y[i] - target_y;
+      approach = dx * dx + dy * dy;
+      cand_approach[i] = approach < cand_approach[i] ? 
+	approach : cand_approach[i];
+    }
+    for (i = 0; i < num_candidates; i++)
+      cand_distance[i] = field[cand_cell[i]];
+    for (i = 0; i < num_candidates; i++) {
+      d = cand_distance[i];
+      cand_clearance[i] = d < cand_clearance[i] ? d : cand_clearance[i];
+      hit = d < margin ? t : FLT_MAX;
+      hit = d < cand_last[i] ? hit : FLT_MAX;
+      hit = d < body ? t : hit;
+      cand_hit[i] = hit < cand_hit[i] ? hit : cand_hit[i];
+      cand_last[i] = d;
+    }
+  }
+}
+
+static void report_stats(double now)
+{
+  carmen_robot_local_planner_stats_t current;
+
+  carmen_robot_local_planner_get_stats(&current);
+  carmen_warn("\nLocal planner: %d cycles, %.2f ms mean, %.2f ms max, "
+	      "%d over the %.0f ms period\n", current.cycles, 
+	      1e3 * current.mean_time, 1e3 * current.max_time, 
+	      current.overruns, 1e3 / frequency);
+  time_of_last_report = now;
+}
+
+void carmen_robot_local_planner_choose_velocity(carmen_traj_point_p target,
+						int target_is_final,
+						double *tv, double *rv)
+{
+  double start_time, cycle_time, score, best_score, align, clear;
+  double approach_dist;
+  float body;
+  int i, best;
+
+  if (!initialized) {
+    *tv = 0;
+    *rv = 0;
+    return;
+  }
+
+  start_time = carmen_get_time();
+
+  build_field();
+  sample_velocities(target, target_is_final);
+
+  body = robot_radius();
+  roll_out(target, body, body + carmen_robot_config.side_dist);
+
+  approach_dist = carmen_robot_config.approach_dist;
+  best = -1;
+  best_score = 0;
+  for (i = 0; i < num_candidates; i++) {
+    /* it has to be able to stop before it gets too close, which for
+       tv^2 <= 2 deceleration tv (hit - reaction time) comes down to */
+    if (cand_tv[i] > 0 && cand_tv[i] > 2 * carmen_robot_config.deceleration *
+	((double)cand_hit[i] - carmen_robot_config.reaction_time))
+      continue;
+    if (cand_approach[i] < approach_dist * approach_dist)
+      align = 1;
+    else
+      align = 1 - fabs(carmen_normalize_theta
+		       (atan2(target->y - cand_y[i], target->x - cand_x[i]) - 
+			atan2(cand_sin[i], cand_cos[i]))) / M_PI;
+    clear = carmen_clamp(0, cand_clearance[i] - body, CLEARANCE_CAP) / 
+      CLEARANCE_CAP;
+    score = heading_weight * align + clearance_weight * clear + 
+      velocity_weight * cand_tv[i] / carmen_robot_config.max_t_vel;
+    if (best < 0 || score > best_score) {
+      best = i;
+      best_score = score;
+    }
+  }
+
+  if (best < 0) {
+    fprintf(stderr, "S");
+    *tv = 0;
+    *rv = 0;
+  } else {
+    *tv = cand_tv[best];
+    *rv = cand_rv[best];
+  }
+
+  cycle_time = carmen_get_time() - start_time;
+  total_time += cycle_time;
+  stats.cycles++;
+  if (cycle_time > stats.max_time)
+    stats.max_time = cycle_time;
+  if (cycle_time > 1.0 / frequency)
+    stats.overruns++;
+
+  if (time_of_last_report == 0)
+    time_of_last_report = start_time;
+  else if (start_time - time_of_last_report > REPORT_INTERVAL)
+    report_stats(start_time);
+}
+
+void carmen_robot_local_planner_get_stats
+(carmen_robot_local_planner_stats_t *current)
+{
+  *current = stats;
+  current->mean_time = (stats.cycles > 0 ? total_time / stats.cycles : 0);
+}
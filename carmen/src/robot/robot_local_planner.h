@@ -0,0 +1,64 @@
+/*********************************************************
+ *
+ * This source code is part of the Carnegie Mellon Robot
+ * Navigation Toolkit (CARMEN)
+ *
+ * CARMEN Copyright (c) 2002 Michael Montemerlo, Nicholas
+ * Roy, Sebastian Thrun, Dirk Haehnel, Cyrill Stachniss,
+ * and Jared Glover
+ *
+ * CARMEN is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation; 
+ * either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * CARMEN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied 
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more 
+ * details.
+ *
+ * You should have received a copy of the GNU General 
+ * Public License along with CARMEN; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, 
+ * Suite 330, Boston, MA  02111-1307 USA
+ *
+ ********************************************************/
+
+#ifndef ROBOT_LOCAL_PLANNER_H
+#define ROBOT_LOCAL_PLANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* Cycle timing of the local planner, in seconds. Overruns are cycles
+     that took longer than the planner period. */
+
+typedef struct {
+  int cycles;
+  double mean_time;
+  double max_time;
+  int overruns;
+} carmen_robot_local_planner_stats_t;
+
+void carmen_robot_add_local_planner_parameters(int argc, char **argv);
+double carmen_robot_local_planner_period(void);
+void carmen_robot_local_planner_add_laser(int laser, float *range, 
+					  int num_readings, 
+					  double start_angle,
+					  double angular_resolution,
+					  double maximum_range,
+					  double offset, double side_offset);
+void carmen_robot_local_planner_choose_velocity(carmen_traj_point_p target,
+						int target_is_final,
+						double *tv, double *rv);
+void carmen_robot_local_planner_get_stats
+(carmen_robot_local_planner_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -34,6 +34,7 @@
 
 #include "robot_sonar.h"
 #include "robot_bumper.h"
+#include "robot_local_planner.h"
 
 #include "robot_central.h"
 
@@ -64,6 +65,8 @@ static int use_3d_control = 0;
 static double control_lookahead = 10.0;
 static double control_lookahead_approach_dist = 0.3;
 
+static int use_local_planner = 0;
+
 static double theta_gain;
 static double theta_d_gain;
 static double disp_gain;
@@ -80,6 +83,8 @@ static double vector_distance;
 static double vector_angle;
 static int following_vector = 0;
 static int following_trajectory = 0;
+static int following_local_plan = 0;
+static carmen_traj_point_t local_target;
 
 static void publish_vector_status(double distance, double angle);
 
@@ -232,10 +237,11 @@ void carmen_robot_stop_robot(int how)
   command_tv = 0.0;
   if (how == CARMEN_ROBOT_ALL_STOP)
     command_rv = 0.0;
-  if (following_vector || following_trajectory)
+  if (following_vector || following_trajectory || following_local_plan)
     command_rv = 0.0;
   following_vector = 0;
   following_trajectory = 0;
+  following_local_plan = 0;
   publish_vector_status(0, 0);
 
   carmen_robot_send_base_velocity_command();
@@ -348,7 +354,7 @@ static void velocity_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
   command_rv = v.rv;
   command_tv = v.tv;
 
-  following_vector = following_trajectory = 0;
+  following_vector = following_trajectory = following_local_plan = 0;
   carmen_robot_send_base_velocity_command();
   publish_vector_status(0, 0);
   IPC_freeDataElements(formatter, &v);
@@ -473,6 +479,54 @@ static void follow_trajectory_3d(void)
   carmen_robot_send_base_velocity_command();
 }
 
+/* Drives towards local_target, which is in the robot frame at
+   start_position, with the velocities the local planner picks. Once the
+   final goal is within the approach distance, follow_vector takes over to
+   stop and align on it. */
+
+static void follow_local_plan(void)
+{
+  carmen_traj_point_t target;
+  double theta, dx, dy, x, y, distance;
+
+  theta = carmen_robot_latest_odometry.theta - start_position.theta;
+  dx = carmen_robot_latest_odometry.x - start_position.x;
+  dy = carmen_robot_latest_odometry.y - start_position.y;
+  x = local_target.x - 
+    (dx * cos(start_position.theta) + dy * sin(start_position.theta));
+  y = local_target.y - 
+    (-dx * sin(start_position.theta) + dy * cos(start_position.theta));
+
+  target = local_target;
+  target.x = x * cos(theta) + y * sin(theta);
+  target.y = -x * sin(theta) + y * cos(theta);
+  distance = hypot(target.x, target.y);
+
+  if (goal_is_final && distance < carmen_robot_config.approach_dist) {
+    following_local_plan = 0;
+    following_vector = 1;
+    vector_distance = hypot(local_target.x, local_target.y);
+    vector_angle = atan2(local_target.y, local_target.x);
+    follow_vector();
+    return;
+  }
+
+  carmen_robot_local_planner_choose_velocity(&target, goal_is_final,
+					     &command_tv, &command_rv);
+
+  publish_vector_status(distance, atan2(target.y, target.x));
+  carmen_robot_send_base_velocity_command();
+}
+
+static void 
+local_planner_timer(void *clientdata __attribute__ ((unused)),
+		    unsigned long currenttime __attribute__ ((unused)),
+		    unsigned long scheduledTime __attribute__ ((unused)))
+{
+  if (following_local_plan)
+    follow_local_plan();
+}
+
 static void 
 vector_move_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
 		    void *clientData __attribute__ ((unused)))
@@ -494,6 +548,7 @@ vector_move_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
   following_vector = 1;
   if (following_trajectory)
     following_trajectory = 0;
+  following_local_plan = 0;
 
   start_position.x = carmen_robot_latest_odometry.x;
   start_position.y = carmen_robot_latest_odometry.y;
@@ -538,6 +593,7 @@ follow_trajectory_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
   if (use_3d_control) {
     following_vector = 0;
     following_trajectory = 1;
+    following_local_plan = 0;
     goal = msg.trajectory[0];
     follow_trajectory_3d();
   } else {
@@ -574,7 +630,22 @@ follow_trajectory_handler(MSG_INSTANCE msgRef, BYTE_ARRAY callData,
 
     vector_angle = carmen_normalize_theta(vector_angle - msg.robot_position.theta);
 
-    follow_vector();      
+    /* The local planner drives until the final goal is close enough to
+       align on, from its own timer. */
+    if (use_local_planner && !aligning && 
+	(!goal_is_final || 
+	 vector_distance >= carmen_robot_config.approach_dist)) {
+      following_vector = 0;
+      following_local_plan = 1;
+      local_target = goal;
+      local_target.x = goal.x * cos(msg.robot_position.theta) + 
+	goal.y * sin(msg.robot_position.theta);
+      local_target.y = -goal.x * sin(msg.robot_position.theta) + 
+	goal.y * cos(msg.robot_position.theta);
+    } else {
+      following_local_plan = 0;
+      follow_vector();      
+    }
   }
   IPC_freeDataElements(formatter, &msg);
 }
@@ -711,7 +782,9 @@ static int read_robot_parameters(int argc, char **argv)
      &turn_before_driving_if_heading_bigger_than_deg, 0, NULL},
     {"robot", "interpolate_odometry",
      CARMEN_PARAM_ONOFF,
-     &carmen_robot_config.interpolate_odometry, 1, NULL}
+     &carmen_robot_config.interpolate_odometry, 1, NULL},
+    {"robot", "use_local_planner", CARMEN_PARAM_ONOFF, 
+     &use_local_planner, 0, NULL}
   };
 
 
@@ -727,6 +800,8 @@ static int read_robot_parameters(int argc, char **argv)
   if (use_laser)
     carmen_robot_add_laser_parameters(argc, argv);
 #endif
+  if (use_local_planner)
+    carmen_robot_add_local_planner_parameters(argc, argv);
 
   turn_before_driving_if_heading_bigger_than = 
     carmen_degrees_to_radians(turn_before_driving_if_heading_bigger_than_deg);
@@ -764,6 +839,9 @@ int carmen_robot_start(int argc, char **argv)
     carmen_robot_add_sonar_handler();
   if (use_bumper)
     carmen_robot_add_bumper_handler();
+  if (use_local_planner)
+    carmen_ipc_addPeriodicTimer(carmen_robot_local_planner_period(), 
+				local_planner_timer, NULL);
 
   return 0;
 }
@@ -238,20 +238,22 @@ add_sonar_error(carmen_base_sonar_message * base_sonar,
 		carmen_simulator_sonar_config_t *sonar_config)
 {
   int i;
+  carmen_random_state_t *rng = carmen_random_thread_state();
+
   for(i=0;i<base_sonar->num_sonars; i++)
     {
       if(base_sonar->range[i] > sonar_config->max_range)
 	base_sonar->range[i] = sonar_config->max_range;
-      else if (carmen_uniform_random(0, 1.0) < 
+      else if (carmen_uniform_random_r(rng, 0, 1.0) < 
 	       sonar_config->prob_of_random_max)
 	base_sonar->range[i] = sonar_config->max_range;
-      else if (carmen_uniform_random(0, 1.0) < 
+      else if (carmen_uniform_random_r(rng, 0, 1.0) < 
 	       sonar_config->prob_of_random_reading)
-	base_sonar->range[i] = carmen_uniform_random
-	  (0, sonar_config->max_range);
+	base_sonar->range[i] = carmen_uniform_random_r
+	  (rng, 0, sonar_config->max_range);
       else
-	base_sonar->range[i] += carmen_gaussian_random
-	  (0.0, sonar_config->variance);
+	base_sonar->range[i] += carmen_gaussian_random_r
+	  (rng, 0.0, sonar_config->variance);
     }
 }
 
@@ -261,19 +263,21 @@ add_laser_error(carmen_laser_laser_message * laser,
 		carmen_simulator_laser_config_t *laser_config)
 {
   int i;
+  carmen_random_state_t *rng = carmen_random_thread_state();
+
   for(i = 0; i < laser_config->num_lasers; i ++)
     {
       if (laser->range[i] > laser_config->max_range)
 	laser->range[i] = laser_config->max_range;
-      else if (carmen_uniform_random(0, 1.0) < 
+      else if (carmen_uniform_random_r(rng, 0, 1.0) < 
 	       laser_config->prob_of_random_max)
 	laser->range[i] = laser_config->max_range;
-      else if(carmen_uniform_random(0, 1.0) < 
+      else if(carmen_uniform_random_r(rng, 0, 1.0) < 
 	      laser_config->prob_of_random_reading)
-	laser->range[i] = carmen_uniform_random(0, laser_config->num_lasers);
+	laser->range[i] = carmen_uniform_random_r(rng, 0, laser_config->num_lasers);
       else 
 	laser->range[i] += 
-	  carmen_gaussian_random(0.0, laser_config->variance);
+	  carmen_gaussian_random_r(rng, 0.0, laser_config->variance);
     }
 }
 